@@ -0,0 +1,36 @@
+// The C side of a program `compiler -x86` compiled, linked in as
+//
+//   gcc -O2 program.s runtime/x86_runtime.c -o program
+//
+// main runs sysy_main and exits with what it returned. With SYSY_REPEAT=n set, sysy_main
+// runs n times instead, and the time per run and the returned value go to stderr, for
+// benchmarking the generated code on the host.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+int sysy_main(void);
+
+static double seconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double) now.tv_sec + (double) now.tv_nsec * 1e-9;
+}
+
+int main(void) {
+    const char *repeat = getenv("SYSY_REPEAT");
+    if (repeat == NULL) {
+        return sysy_main();
+    }
+    long runs = atol(repeat);
+    int result = 0;
+    double start = seconds();
+    for (long i = 0; i < runs; i++) {
+        result = sysy_main();
+    }
+    double elapsed = seconds() - start;
+    fprintf(stderr, "sysy_main returned %d, %ld runs, %.1f ns per run\n", result, runs,
+            runs > 0 ? elapsed * 1e9 / (double) runs : 0.0);
+    return result;
+}
@@ -7,6 +7,7 @@
 //%type <ast_val> FuncDef FuncType Block Stmt
 // %type <int_val> Number
 #include "iostream"
+#include "symbol_table.h"
 
 // AST
 class BaseAST {
@@ -15,6 +16,22 @@ public:
 
     virtual std::string dump() = 0;
 
+    // direct sub-nodes in source order, used by passes that walk the whole tree
+    virtual std::vector<BaseAST *> children() {
+        return {};
+    }
+
+    // drops the null entries of unused choice slots
+    static std::vector<BaseAST *> non_null(std::initializer_list<BaseAST *> nodes) {
+        std::vector<BaseAST *> result;
+        for (auto node: nodes) {
+            if (node != nullptr) {
+                result.push_back(node);
+            }
+        }
+        return result;
+    }
+
 };
 
 // This is the top level AST node
@@ -25,6 +42,10 @@ public:
     std::string dump() override {
         return func_def->dump();
     }
+
+    std::vector<BaseAST *> children() override {
+        return non_null({func_def.get()});
+    }
 };
 
 // This is the AST node for a function definition
@@ -38,7 +59,9 @@ public:
         return func_type->dump() + " " + ident + " " + block->dump();
     }
 
-
+    std::vector<BaseAST *> children() override {
+        return non_null({func_type.get(), block.get()});
+    }
 };
 
 // This is the AST node for a function type
@@ -56,10 +79,16 @@ public:
 class BlockAST : public BaseAST {
 public:
     std::unique_ptr<BaseAST> block_item_list;
+    // from '{' to '}'
+    std::shared_ptr<Location> location;
 
     std::string dump() override {
         return "{" + block_item_list->dump() + "}";
     }
+
+    std::vector<BaseAST *> children() override {
+        return non_null({block_item_list.get()});
+    }
 };
 
 enum BlockItemListChoice {
@@ -89,6 +118,14 @@ public:
             return block_item_string;
         }
     }
+
+    std::vector<BaseAST *> children() override {
+        std::vector<BaseAST *> result;
+        for (auto &item: list) {
+            result.push_back(item.get());
+        }
+        return result;
+    }
 };
 
 
@@ -111,6 +148,10 @@ public:
             return declaration->dump();
         }
     }
+
+    std::vector<BaseAST *> children() override {
+        return non_null({statement.get(), declaration.get()});
+    }
 };
 
 class LValAST : public BaseAST {
@@ -179,6 +220,9 @@ public:
 
     }
 
+    std::vector<BaseAST *> children() override {
+        return non_null({left_value.get(), exp.get(), block.get(), if_statement.get(), else_statement.get()});
+    }
 };
 
 
@@ -202,6 +246,9 @@ public:
         return lor_exp->dump();
     }
 
+    std::vector<BaseAST *> children() override {
+        return non_null({lor_exp.get()});
+    }
 };
 
 
@@ -267,6 +314,10 @@ public:
             return mul_exp->dump() + mul_op + unary_exp->dump();
         }
     }
+
+    std::vector<BaseAST *> children() override {
+        return non_null({mul_exp.get(), unary_exp.get()});
+    }
 };
 
 // //AddExp      ::= MulExp | AddExp ("+" | "-") MulExp;
@@ -318,6 +369,10 @@ public:
             return add_exp->dump() + add_op + mul_exp->dump();
         }
     }
+
+    std::vector<BaseAST *> children() override {
+        return non_null({add_exp.get(), mul_exp.get()});
+    }
 };
 
 
@@ -363,6 +418,10 @@ public:
             return unary_op->dump() + unary_exp->dump();
         }
     }
+
+    std::vector<BaseAST *> children() override {
+        return non_null({unary_op.get(), unary_exp.get(), primary_exp.get()});
+    }
 };
 
 //
@@ -428,6 +487,10 @@ public:
             return std::to_string(number);
         }
     }
+
+    std::vector<BaseAST *> children() override {
+        return non_null({exp.get(), left_value.get()});
+    }
 };
 
 
@@ -461,6 +524,10 @@ public:
             return rel_exp->dump() + rel_op + add_exp->dump();
         }
     }
+
+    std::vector<BaseAST *> children() override {
+        return non_null({rel_exp.get(), add_exp.get()});
+    }
 };
 
 enum EqExpASTChoice {
@@ -485,6 +552,10 @@ public:
             return eq_exp->dump() + eq_op + rel_exp->dump();
         }
     }
+
+    std::vector<BaseAST *> children() override {
+        return non_null({eq_exp.get(), rel_exp.get()});
+    }
 };
 
 enum LAndExpASTChoice {
@@ -509,6 +580,10 @@ public:
             return land_exp->dump() + land_op + eq_exp->dump();
         }
     }
+
+    std::vector<BaseAST *> children() override {
+        return non_null({land_exp.get(), eq_exp.get()});
+    }
 };
 
 enum LOrExpASTChoice {
@@ -533,6 +608,10 @@ public:
             return lor_exp->dump() + lor_op + land_exp->dump();
         }
     }
+
+    std::vector<BaseAST *> children() override {
+        return non_null({lor_exp.get(), land_exp.get()});
+    }
 };
 
 
@@ -567,6 +646,10 @@ public:
             return var_declaration->dump();
         }
     }
+
+    std::vector<BaseAST *> children() override {
+        return non_null({const_declaration.get(), var_declaration.get()});
+    }
 };
 
 // region: const declaration
@@ -587,6 +670,10 @@ public:
         ss << ";";
         return ss.str();
     }
+
+    std::vector<BaseAST *> children() override {
+        return non_null({b_type.get(), const_definition_list.get()});
+    }
 };
 
 
@@ -617,12 +704,25 @@ public:
             return final;
         }
     }
+
+    std::vector<BaseAST *> children() override {
+        if (choice == CONST_DEFINITION) {
+            return non_null({const_definition.get()});
+        }
+        std::vector<BaseAST *> result;
+        for (auto &item: list) {
+            result.push_back(item.get());
+        }
+        return result;
+    }
 };
 
 
 class ConstDefinitionAST : public BaseAST {
 public:
     std::string ident;
+    // of the identifier
+    std::shared_ptr<Location> location;
     std::unique_ptr<BaseAST> const_initialization_expression;
 
     std::string dump() override {
@@ -632,6 +732,10 @@ public:
         ss << const_initialization_expression->dump();
         return ss.str();
     }
+
+    std::vector<BaseAST *> children() override {
+        return non_null({const_initialization_expression.get()});
+    }
 };
 
 class ConstInitializationExpressionAST : public BaseAST {
@@ -641,6 +745,10 @@ public:
     std::string dump() override {
         return const_expression->dump();
     }
+
+    std::vector<BaseAST *> children() override {
+        return non_null({const_expression.get()});
+    }
 };
 
 
@@ -651,6 +759,10 @@ public:
     std::string dump() override {
         return expression->dump();
     }
+
+    std::vector<BaseAST *> children() override {
+        return non_null({expression.get()});
+    }
 };
 
 // endregion
@@ -677,6 +789,10 @@ public:
         ss << ";";
         return ss.str();
     }
+
+    std::vector<BaseAST *> children() override {
+        return non_null({b_type.get(), var_definition_list.get()});
+    }
 };
 
 
@@ -707,12 +823,25 @@ public:
             return final;
         }
     }
+
+    std::vector<BaseAST *> children() override {
+        if (choice == VAR_DEFINITION) {
+            return non_null({var_definition.get()});
+        }
+        std::vector<BaseAST *> result;
+        for (auto &item: list) {
+            result.push_back(item.get());
+        }
+        return result;
+    }
 };
 
 
 class VarDefinitionAST : public BaseAST {
 public:
     std::string ident;
+    // of the identifier
+    std::shared_ptr<Location> location;
     std::unique_ptr<BaseAST> var_initialization_expression;
 
     std::string dump() override {
@@ -722,6 +851,10 @@ public:
         ss << var_initialization_expression->dump();
         return ss.str();
     }
+
+    std::vector<BaseAST *> children() override {
+        return non_null({var_initialization_expression.get()});
+    }
 };
 
 class VarInitializationExpressionAST : public BaseAST {
@@ -731,6 +864,10 @@ public:
     std::string dump() override {
         return var_expression->dump();
     }
+
+    std::vector<BaseAST *> children() override {
+        return non_null({var_expression.get()});
+    }
 };
 
 
@@ -741,6 +878,10 @@ public:
     std::string dump() override {
         return expression->dump();
     }
+
+    std::vector<BaseAST *> children() override {
+        return non_null({expression.get()});
+    }
 };
 
 // endregion
\ No newline at end of file
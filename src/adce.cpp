@@ -0,0 +1,110 @@
+#include "adce.h"
+
+#include <iostream>
+#include "simplify_cfg.h"
+
+void AdceStatistics::print(const std::string &function) const {
+    std::cout << "adce @" << function << ": " << instructions_removed << " instructions removed, "
+              << branches_removed << " branches removed, " << blocks_removed << " blocks removed" << std::endl;
+}
+
+void Adce::mark(IrValueId inst) {
+    // constants and undef are never placed and need nothing
+    if (inst != 0 && !_live[inst] && (*_function)[inst].block != 0) {
+        _live[inst] = true;
+        _worklist.push_back(inst);
+    }
+}
+
+AdceStatistics Adce::run(AnalysisCache &analyses) {
+    auto &function = analyses.function();
+    _function = &function;
+    AdceStatistics statistics;
+
+    // code after a return; the post-dominator tree must not see it
+    statistics.blocks_removed = remove_unreachable_blocks(function);
+    if (statistics.blocks_removed != 0) {
+        analyses.invalidate(ANALYSIS_CFG);
+    }
+    auto &post_dominators = analyses.post_dominators();
+
+    _live.assign(function.instructions.size(), false);
+    _live_blocks.assign(function.blocks.size(), false);
+    _worklist.clear();
+    for (auto block: function.layout) {
+        for (auto inst = function.blocks[block].first; inst != 0; inst = function[inst].next) {
+            auto opcode = function[inst].opcode;
+            if (opcode == IR_RET || opcode == IR_STORE) {
+                mark(inst);
+            }
+        }
+        if (!post_dominators.contains(block)) {
+            // never reaches a return, so it is control dependent on nothing we can see
+            mark(function.terminator(block));
+        }
+    }
+
+    while (!_worklist.empty()) {
+        auto inst = _worklist.back();
+        _worklist.pop_back();
+        auto block = function[inst].block;
+        if (!_live_blocks[block]) {
+            _live_blocks[block] = true;
+            for (auto branch: post_dominators.frontier(block)) {
+                mark(function.terminator(branch));
+            }
+        }
+        for (uint32_t i = 0; i < function[inst].operand_count; i++) {
+            mark(function.operand(inst, i));
+        }
+        if (function[inst].opcode == IR_PHI) {
+            for (uint32_t i = 0; i < function[inst].operand_count; i++) {
+                mark(function.terminator(function.incoming_block(inst, i)));
+            }
+        }
+    }
+
+    // jumps carry no computation, they stay and simplify-cfg merges the empty blocks
+    std::vector<IrValueId> dead;
+    std::vector<IrValueId> dead_branches;
+    for (auto block: function.layout) {
+        for (auto inst = function.blocks[block].first; inst != 0; inst = function[inst].next) {
+            if (_live[inst] || function[inst].opcode == IR_JUMP) {
+                continue;
+            }
+            (function[inst].opcode == IR_BR ? dead_branches : dead).push_back(inst);
+        }
+    }
+    // dead values may use each other, cut the uses first
+    for (auto inst: dead) {
+        function.replace_all_uses(inst, function.undef());
+    }
+    for (auto inst: dead) {
+        function.erase(inst);
+    }
+    statistics.instructions_removed = dead.size();
+
+    IrBuilder builder(&function);
+    for (auto branch: dead_branches) {
+        auto block = function[branch].block;
+        auto target = post_dominators.idom(block);
+        while (target != 0 && !_live_blocks[target]) {
+            target = post_dominators.idom(target);
+        }
+        if (target == 0) {
+            continue;
+        }
+        // a live phi in the target would have kept this branch, so no phi needs a new operand
+        function.erase(branch);
+        builder.set_block(block);
+        builder.jump(target);
+        statistics.branches_removed++;
+    }
+
+    auto removed = remove_unreachable_blocks(function);
+    statistics.blocks_removed += removed;
+    if (statistics.branches_removed + removed != 0) {
+        analyses.invalidate(ANALYSIS_CFG);
+    }
+    return statistics;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "analysis_cache.h"
+#include "ir.h"
+
+class AdceStatistics {
+public:
+    size_t instructions_removed = 0;
+    size_t branches_removed = 0;
+    size_t blocks_removed = 0;
+
+    bool changed() const {
+        return instructions_removed + branches_removed + blocks_removed != 0;
+    }
+
+    void print(const std::string &function) const;
+};
+
+/**
+ * Aggressive dead code elimination (Cytron et al.). Everything is dead until proven live:
+ * returns and stores are the roots, a live instruction makes its operands live, and a live
+ * block makes the branches it is control dependent on live, read off the post-dominance
+ * frontiers. A phi also needs the edges it merges, so the predecessors it names stay live.
+ *
+ * Dead instructions are deleted, a dead branch becomes a jump to its nearest live
+ * post-dominator, and the blocks that leaves unreachable go too.
+ */
+class Adce {
+public:
+    AdceStatistics run(AnalysisCache &analyses);
+
+private:
+    IrFunction *_function = nullptr;
+    std::vector<bool> _live;
+    std::vector<bool> _live_blocks;
+    std::vector<IrValueId> _worklist;
+
+    void mark(IrValueId inst);
+};
@@ -0,0 +1,69 @@
+#include "analysis_cache.h"
+
+const ControlFlowGraph &AnalysisCache::cfg() {
+    if (_cfg == nullptr) {
+        _cfg = std::make_unique<ControlFlowGraph>(_function);
+    }
+    return *_cfg;
+}
+
+const DominatorTree &AnalysisCache::dominators() {
+    if (_dominators == nullptr) {
+        _dominators = std::make_unique<DominatorTree>(cfg());
+    }
+    return *_dominators;
+}
+
+const DominatorTree &AnalysisCache::post_dominators() {
+    if (_post_dominators == nullptr) {
+        _post_dominators = std::make_unique<DominatorTree>(cfg(), true);
+    }
+    return *_post_dominators;
+}
+
+const LoopForest &AnalysisCache::loops() {
+    if (_loops == nullptr) {
+        _loops = std::make_unique<LoopForest>(cfg(), dominators());
+    }
+    return *_loops;
+}
+
+const Liveness &AnalysisCache::liveness() {
+    if (_liveness == nullptr) {
+        _liveness = std::make_unique<Liveness>(_function, cfg());
+    }
+    return *_liveness;
+}
+
+void AnalysisCache::invalidate(int analyses) {
+    // everything else is derived from the CFG, the loops also from the dominators
+    if (analyses & ANALYSIS_CFG) {
+        analyses = ANALYSIS_ALL;
+    }
+    if (analyses & ANALYSIS_DOMINATORS) {
+        analyses |= ANALYSIS_LOOPS;
+    }
+    if (analyses & ANALYSIS_CFG) {
+        _cfg.reset();
+    }
+    if (analyses & ANALYSIS_DOMINATORS) {
+        _dominators.reset();
+    }
+    if (analyses & ANALYSIS_POST_DOMINATORS) {
+        _post_dominators.reset();
+    }
+    if (analyses & ANALYSIS_LOOPS) {
+        _loops.reset();
+    }
+    if (analyses & ANALYSIS_LIVENESS) {
+        _liveness.reset();
+    }
+}
+
+int AnalysisCache::cached() const {
+    return (_cfg != nullptr ? ANALYSIS_CFG : 0)
+           | (_dominators != nullptr ? ANALYSIS_DOMINATORS : 0)
+           | (_post_dominators != nullptr ? ANALYSIS_POST_DOMINATORS : 0)
+           | (_loops != nullptr ? ANALYSIS_LOOPS : 0)
+           | (_liveness != nullptr ? ANALYSIS_LIVENESS : 0);
+}
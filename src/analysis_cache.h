@@ -0,0 +1,55 @@
+#pragma once
+
+#include <memory>
+#include "cfg.h"
+#include "ir.h"
+#include "liveness.h"
+
+enum IrAnalysis {
+    ANALYSIS_CFG = 1 << 0,
+    ANALYSIS_DOMINATORS = 1 << 1,
+    ANALYSIS_POST_DOMINATORS = 1 << 2,
+    ANALYSIS_LOOPS = 1 << 3,
+    ANALYSIS_LIVENESS = 1 << 4,
+    ANALYSIS_ALL = (1 << 5) - 1
+};
+
+/**
+ * Analyses of one function, computed on first request and kept until a transformation
+ * invalidates them. Nothing is invalidated automatically: a pass that changes the CFG
+ * must say so, and a stale result is a bug in that pass. Liveness depends on every
+ * instruction, so under the PassManager any change drops it unless a pass preserves it.
+ */
+class AnalysisCache {
+public:
+    explicit AnalysisCache(IrFunction &function) : _function(function) {
+    }
+
+    IrFunction &function() {
+        return _function;
+    }
+
+    const ControlFlowGraph &cfg();
+
+    const DominatorTree &dominators();
+
+    const DominatorTree &post_dominators();
+
+    const LoopForest &loops();
+
+    const Liveness &liveness();
+
+    // drops the given analyses and everything computed from them
+    void invalidate(int analyses = ANALYSIS_ALL);
+
+    // bitmask of the analyses currently cached
+    int cached() const;
+
+private:
+    IrFunction &_function;
+    std::unique_ptr<ControlFlowGraph> _cfg;
+    std::unique_ptr<DominatorTree> _dominators;
+    std::unique_ptr<DominatorTree> _post_dominators;
+    std::unique_ptr<LoopForest> _loops;
+    std::unique_ptr<Liveness> _liveness;
+};
@@ -0,0 +1,228 @@
+#include "block_layout.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+void BlockLayoutStatistics::print(const std::string &function) const {
+    std::cout << "block-layout @" << function << ": " << jumps_threaded << " jumps threaded, " << branches_removed
+              << " branches removed, " << blocks_removed << " blocks removed, " << jumps_removed
+              << " jumps removed, " << branches_inverted << " branches inverted" << std::endl;
+}
+
+BlockLayoutStatistics BlockLayout::run(MachineFunction &function) {
+    _function = &function;
+    _statistics = BlockLayoutStatistics();
+    thread_jumps();
+    reorder(place_blocks());
+    fall_through();
+    return _statistics;
+}
+
+void BlockLayout::thread_jumps() {
+    auto &blocks = _function->blocks;
+    // where control entering `block` ends up, through blocks holding only a jump; the
+    // entry keeps its place whatever it holds
+    auto destination = [&blocks](MachineBlockId block) {
+        for (size_t steps = 0; steps < blocks.size(); steps++) {
+            auto &instructions = blocks[block].instructions;
+            if (block == 0 || instructions.size() != 1 || instructions[0].opcode != RV_J) {
+                break;
+            }
+            block = instructions[0].target;
+        }
+        return block;
+    };
+
+    for (auto &block: blocks) {
+        auto &instructions = block.instructions;
+        for (auto &inst: instructions) {
+            if (riscv_is_terminator(inst.opcode) && inst.opcode != RV_RET) {
+                auto target = destination(inst.target);
+                _statistics.jumps_threaded += target != inst.target;
+                inst.target = target;
+            }
+        }
+        auto size = instructions.size();
+        if (size >= 2 && instructions[size - 1].opcode == RV_J && instructions[size - 2].opcode != RV_J
+            && riscv_is_terminator(instructions[size - 2].opcode)
+            && instructions[size - 2].target == instructions[size - 1].target) {
+            instructions.erase(instructions.end() - 2);
+            _statistics.branches_removed++;
+        }
+    }
+}
+
+std::vector<MachineBlockId> BlockLayout::place_blocks() {
+    auto &function = *_function;
+    auto count = function.blocks.size();
+    std::vector<std::vector<MachineBlockId>> successors(count);
+    for (MachineBlockId block = 0; block < count; block++) {
+        successors[block] = function.successors(block);
+    }
+
+    // region: back edges, from a depth first search
+    std::vector<bool> reached(count, false);
+    std::vector<bool> on_stack(count, false);
+    std::vector<std::pair<MachineBlockId, MachineBlockId>> back_edges;
+    std::vector<MachineBlockId> order;
+    std::vector<std::pair<MachineBlockId, size_t>> stack = {{0, 0}};
+    reached[0] = on_stack[0] = true;
+    while (!stack.empty()) {
+        auto block = stack.back().first;
+        auto &next = stack.back().second;
+        if (next == successors[block].size()) {
+            on_stack[block] = false;
+            order.push_back(block);
+            stack.pop_back();
+            continue;
+        }
+        auto successor = successors[block][next++];
+        if (on_stack[successor]) {
+            back_edges.emplace_back(block, successor);
+        } else if (!reached[successor]) {
+            reached[successor] = on_stack[successor] = true;
+            stack.emplace_back(successor, 0);
+        }
+    }
+    auto is_back_edge = [&back_edges](MachineBlockId from, MachineBlockId to) {
+        return std::find(back_edges.begin(), back_edges.end(), std::make_pair(from, to)) != back_edges.end();
+    };
+    _statistics.blocks_removed = count - order.size();
+    // endregion
+
+    // region: edge weights
+    struct Edge {
+        MachineBlockId from;
+        MachineBlockId to;
+        double weight;
+    };
+    std::vector<Edge> edges;
+    auto depth = [&function](MachineBlockId block) {
+        return function.blocks[block].loop_depth;
+    };
+    auto returns = [&function](MachineBlockId block) {
+        auto &instructions = function.blocks[block].instructions;
+        return !instructions.empty() && instructions.back().opcode == RV_RET;
+    };
+    for (MachineBlockId block = 0; block < count; block++) {
+        auto &instructions = function.blocks[block].instructions;
+        if (!reached[block] || instructions.empty() || instructions.back().opcode != RV_J) {
+            continue;
+        }
+        auto frequency = std::pow(10.0, std::min(depth(block), 8));
+        auto jump = instructions.back().target;
+        if (instructions.size() < 2 || !riscv_is_terminator(instructions[instructions.size() - 2].opcode)) {
+            edges.push_back({block, jump, frequency});
+            continue;
+        }
+        // how likely the branch before the jump is taken
+        auto branch = instructions[instructions.size() - 2].target;
+        double taken = 0.5;
+        if (is_back_edge(block, branch) != is_back_edge(block, jump)) {
+            taken = is_back_edge(block, branch) ? 0.9 : 0.1;
+        } else if ((depth(branch) < depth(block)) != (depth(jump) < depth(block))) {
+            taken = depth(branch) < depth(block) ? 0.1 : 0.9;
+        } else if (returns(branch) != returns(jump)) {
+            taken = returns(branch) ? 0.1 : 0.9;
+        }
+        edges.push_back({block, branch, frequency * taken});
+        edges.push_back({block, jump, frequency * (1 - taken)});
+    }
+    std::stable_sort(edges.begin(), edges.end(), [](const Edge &a, const Edge &b) {
+        return a.weight > b.weight;
+    });
+    // endregion
+
+    // region: chains
+    std::vector<std::vector<MachineBlockId>> chains(count);
+    std::vector<size_t> chain(count);
+    for (MachineBlockId block = 0; block < count; block++) {
+        chains[block] = {block};
+        chain[block] = block;
+    }
+    for (auto &edge: edges) {
+        auto &head = chains[chain[edge.from]];
+        auto &tail = chains[chain[edge.to]];
+        if (&head == &tail || head.back() != edge.from || tail.front() != edge.to || edge.to == 0) {
+            continue;
+        }
+        for (auto block: tail) {
+            chain[block] = chain[edge.from];
+        }
+        head.insert(head.end(), tail.begin(), tail.end());
+        tail.clear();
+    }
+    // endregion
+
+    // the entry chain first, then the chain the heaviest edge from a placed block reaches
+    std::vector<MachineBlockId> result;
+    std::vector<bool> placed(count, false);
+    auto place = [&](size_t index) {
+        for (auto block: chains[index]) {
+            result.push_back(block);
+            placed[block] = true;
+        }
+        chains[index].clear();
+    };
+    place(chain[0]);
+    while (result.size() < order.size()) {
+        auto next = count;
+        for (auto &edge: edges) {
+            if (placed[edge.from] && !placed[edge.to]) {
+                next = chain[edge.to];
+                break;
+            }
+        }
+        for (MachineBlockId block = 0; block < count && next == count; block++) {
+            if (reached[block] && !placed[block]) {
+                next = chain[block];
+            }
+        }
+        place(next);
+    }
+    return result;
+}
+
+void BlockLayout::reorder(const std::vector<MachineBlockId> &order) {
+    auto &function = *_function;
+    std::vector<MachineBlockId> position(function.blocks.size(), 0);
+    for (MachineBlockId i = 0; i < order.size(); i++) {
+        position[order[i]] = i;
+    }
+    std::vector<MachineBlock> blocks;
+    blocks.reserve(order.size());
+    for (auto block: order) {
+        blocks.push_back(std::move(function.blocks[block]));
+        for (auto &inst: blocks.back().instructions) {
+            if (riscv_is_terminator(inst.opcode) && inst.opcode != RV_RET) {
+                inst.target = position[inst.target];
+            }
+        }
+    }
+    function.blocks = std::move(blocks);
+}
+
+void BlockLayout::fall_through() {
+    auto &blocks = _function->blocks;
+    for (MachineBlockId block = 0; block + 1 < blocks.size(); block++) {
+        auto &instructions = blocks[block].instructions;
+        auto size = instructions.size();
+        if (size == 0 || instructions.back().opcode != RV_J) {
+            continue;
+        }
+        if (instructions.back().target == block + 1) {
+            instructions.pop_back();
+            _statistics.jumps_removed++;
+        } else if (size >= 2 && riscv_is_terminator(instructions[size - 2].opcode)
+                   && instructions[size - 2].opcode != RV_J && instructions[size - 2].target == block + 1) {
+            // branch to where the jump went, and fall through to where the branch went
+            auto &branch = instructions[size - 2];
+            riscv_invert_branch(branch);
+            branch.target = instructions.back().target;
+            instructions.pop_back();
+            _statistics.branches_inverted++;
+            _statistics.jumps_removed++;
+        }
+    }
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <string>
+#include "riscv.h"
+
+class BlockLayoutStatistics {
+public:
+    size_t jumps_threaded = 0;
+    // branches to where the jump after them goes anyway
+    size_t branches_removed = 0;
+    size_t blocks_removed = 0;
+    // jumps to the next block, gone, and branches turned around so the jump after them could go
+    size_t jumps_removed = 0;
+    size_t branches_inverted = 0;
+
+    void print(const std::string &function) const;
+};
+
+/**
+ * Orders the blocks of a finished function so the likely successor of each block comes
+ * right after it, then lets control fall through instead of jumping there.
+ *
+ * Branches and jumps to a block holding nothing but a jump go straight to its target, and
+ * blocks no longer reached are dropped. Without a profile, the likelihood of an edge comes
+ * from static guesses: loop back edges are taken, loop exits and early returns are not,
+ * scaled by 10 to the power of the loop depth of the source. Chains are formed the way of
+ * Pettis and Hansen, joining the tail of one to the head of another along the heaviest
+ * edges first, and placed after the entry chain by the heaviest edge reaching them.
+ */
+class BlockLayout {
+public:
+    BlockLayoutStatistics run(MachineFunction &function);
+
+private:
+    MachineFunction *_function = nullptr;
+    BlockLayoutStatistics _statistics;
+
+    void thread_jumps();
+
+    // the blocks in their new order, the entry first and unreachable blocks left out
+    std::vector<MachineBlockId> place_blocks();
+
+    void reorder(const std::vector<MachineBlockId> &order);
+
+    void fall_through();
+};
@@ -0,0 +1,32 @@
+#include "buffered_writer.h"
+
+BufferedWriter &BufferedWriter::operator<<(int32_t value) {
+    char digits[12];
+    auto magnitude = value < 0 ? 0u - static_cast<uint32_t>(value) : static_cast<uint32_t>(value);
+    auto end = digits + sizeof(digits);
+    auto begin = end;
+    do {
+        *--begin = static_cast<char>('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude != 0);
+    if (value < 0) {
+        *--begin = '-';
+    }
+    return write(begin, static_cast<size_t>(end - begin));
+}
+
+void BufferedWriter::flush() {
+    emit(_buffer, _used);
+    _used = 0;
+}
+
+void BufferedWriter::emit(const char *data, size_t size) {
+    if (size == 0) {
+        return;
+    }
+    if (_file != nullptr) {
+        fwrite(data, 1, size, _file);
+    } else {
+        _text->append(data, size);
+    }
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+/**
+ * Output through a fixed buffer that goes to the file in large writes, with integers
+ * formatted by hand; for the assembly writers, which produce many short pieces.
+ * Writing to a string instead of a file is for dumps and tests.
+ */
+class BufferedWriter {
+public:
+    static constexpr size_t CAPACITY = 1 << 16;
+
+    explicit BufferedWriter(FILE *file) : _file(file) {
+    }
+
+    explicit BufferedWriter(std::string *text) : _text(text) {
+    }
+
+    BufferedWriter(const BufferedWriter &) = delete;
+
+    BufferedWriter &operator=(const BufferedWriter &) = delete;
+
+    ~BufferedWriter() {
+        flush();
+    }
+
+    BufferedWriter &write(const char *data, size_t size) {
+        if (_used + size > CAPACITY) {
+            flush();
+            if (size > CAPACITY) {
+                emit(data, size);
+                return *this;
+            }
+        }
+        memcpy(_buffer + _used, data, size);
+        _used += size;
+        return *this;
+    }
+
+    BufferedWriter &operator<<(const char *text) {
+        return write(text, strlen(text));
+    }
+
+    BufferedWriter &operator<<(const std::string &text) {
+        return write(text.data(), text.size());
+    }
+
+    BufferedWriter &operator<<(char c) {
+        return write(&c, 1);
+    }
+
+    BufferedWriter &operator<<(int32_t value);
+
+    void flush();
+
+private:
+    FILE *_file = nullptr;
+    std::string *_text = nullptr;
+    char _buffer[CAPACITY];
+    size_t _used = 0;
+
+    void emit(const char *data, size_t size);
+};
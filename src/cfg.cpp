@@ -0,0 +1,222 @@
+#include "cfg.h"
+
+#include <algorithm>
+
+// iterative, so that long chains of blocks cannot overflow the stack
+static std::vector<IrBlockId> reverse_postorder(IrBlockId root, const std::vector<std::vector<IrBlockId>> &next) {
+    std::vector<IrBlockId> postorder;
+    std::vector<bool> visited(next.size(), false);
+    // block and index of the next successor to visit
+    std::vector<std::pair<IrBlockId, size_t>> stack;
+    stack.emplace_back(root, 0);
+    visited[root] = true;
+    while (!stack.empty()) {
+        auto &top = stack.back();
+        if (top.second < next[top.first].size()) {
+            auto successor = next[top.first][top.second++];
+            if (!visited[successor]) {
+                visited[successor] = true;
+                stack.emplace_back(successor, 0);
+            }
+        } else {
+            postorder.push_back(top.first);
+            stack.pop_back();
+        }
+    }
+    std::reverse(postorder.begin(), postorder.end());
+    return postorder;
+}
+
+ControlFlowGraph::ControlFlowGraph(const IrFunction &function) {
+    auto size = function.blocks.size();
+    successors.resize(size);
+    predecessors.resize(size);
+    rpo_number.assign(size, -1);
+
+    for (auto block: function.layout) {
+        successors[block] = function.successors(block);
+    }
+    reverse_postorder = ::reverse_postorder(function.entry(), successors);
+    for (size_t i = 0; i < reverse_postorder.size(); i++) {
+        rpo_number[reverse_postorder[i]] = static_cast<int>(i);
+    }
+    // edges out of unreachable blocks do not count
+    for (auto block: reverse_postorder) {
+        for (auto successor: successors[block]) {
+            predecessors[successor].push_back(block);
+        }
+        auto terminator = function.terminator(block);
+        if (terminator != 0 && function[terminator].opcode == IR_RET) {
+            exits.push_back(block);
+        }
+    }
+}
+
+DominatorTree::DominatorTree(const ControlFlowGraph &cfg, bool post) : _post(post) {
+    auto size = cfg.successors.size();
+    const std::vector<std::vector<IrBlockId>> *next = &cfg.successors;
+    const std::vector<std::vector<IrBlockId>> *previous = &cfg.predecessors;
+    IrBlockId root = cfg.entry();
+
+    // the post-dominator tree is the dominator tree of the reversed graph, rooted at block 0
+    std::vector<std::vector<IrBlockId>> reversed_next;
+    std::vector<std::vector<IrBlockId>> reversed_previous;
+    if (post) {
+        reversed_next = cfg.predecessors;
+        reversed_previous = cfg.successors;
+        reversed_next[0] = cfg.exits;
+        for (auto exit: cfg.exits) {
+            reversed_previous[exit].push_back(0);
+        }
+        next = &reversed_next;
+        previous = &reversed_previous;
+        root = 0;
+    }
+
+    auto order = post ? reverse_postorder(root, *next) : cfg.reverse_postorder;
+    std::vector<int> number(size, -1);
+    for (size_t i = 0; i < order.size(); i++) {
+        number[order[i]] = static_cast<int>(i);
+    }
+
+    // Cooper-Harvey-Kennedy on reverse postorder numbers
+    std::vector<int> idom(order.size(), -1);
+    idom[0] = 0;
+    auto intersect = [&idom](int a, int b) {
+        while (a != b) {
+            while (a > b) {
+                a = idom[a];
+            }
+            while (b > a) {
+                b = idom[b];
+            }
+        }
+        return a;
+    };
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (size_t i = 1; i < order.size(); i++) {
+            int candidate = -1;
+            for (auto predecessor: (*previous)[order[i]]) {
+                auto p = number[predecessor];
+                if (p < 0 || idom[p] < 0) {
+                    continue;
+                }
+                candidate = candidate < 0 ? p : intersect(p, candidate);
+            }
+            if (idom[i] != candidate) {
+                idom[i] = candidate;
+                changed = true;
+            }
+        }
+    }
+
+    _idom.assign(size, 0);
+    _children.resize(size);
+    _in_tree.assign(size, false);
+    for (size_t i = 0; i < order.size(); i++) {
+        _in_tree[order[i]] = true;
+        if (i != 0) {
+            _idom[order[i]] = order[idom[i]];
+            _children[order[idom[i]]].push_back(order[i]);
+        }
+    }
+
+    // interval numbering of the tree for constant time dominates()
+    _enter.assign(size, 0);
+    _leave.assign(size, 0);
+    int clock = 0;
+    std::vector<std::pair<IrBlockId, size_t>> stack;
+    stack.emplace_back(root, 0);
+    _enter[root] = clock++;
+    _preorder.push_back(root);
+    while (!stack.empty()) {
+        auto &top = stack.back();
+        if (top.second < _children[top.first].size()) {
+            auto child = _children[top.first][top.second++];
+            _enter[child] = clock++;
+            _preorder.push_back(child);
+            stack.emplace_back(child, 0);
+        } else {
+            _leave[top.first] = clock++;
+            stack.pop_back();
+        }
+    }
+
+    // frontiers, walking up from the predecessors of every join
+    _frontiers.resize(size);
+    for (auto block: order) {
+        auto &predecessors = (*previous)[block];
+        if (predecessors.size() < 2) {
+            continue;
+        }
+        for (auto predecessor: predecessors) {
+            if (!_in_tree[predecessor]) {
+                continue;
+            }
+            for (auto runner = predecessor; runner != _idom[block]; runner = _idom[runner]) {
+                auto &frontier = _frontiers[runner];
+                if (frontier.empty() || frontier.back() != block) {
+                    frontier.push_back(block);
+                }
+                if (runner == root) {
+                    break;
+                }
+            }
+        }
+    }
+}
+
+LoopForest::LoopForest(const ControlFlowGraph &cfg, const DominatorTree &dominators) {
+    auto size = cfg.successors.size();
+    std::vector<bool> in_body(size, false);
+    for (auto header: cfg.reverse_postorder) {
+        Loop loop;
+        loop.header = header;
+        std::vector<IrBlockId> worklist;
+        for (auto predecessor: cfg.predecessors[header]) {
+            if (dominators.dominates(header, predecessor)) {
+                worklist.push_back(predecessor);
+            }
+        }
+        if (worklist.empty()) {
+            continue;
+        }
+        // the body is everything that reaches a back edge without passing the header
+        in_body[header] = true;
+        loop.blocks.push_back(header);
+        while (!worklist.empty()) {
+            auto block = worklist.back();
+            worklist.pop_back();
+            if (in_body[block]) {
+                continue;
+            }
+            in_body[block] = true;
+            loop.blocks.push_back(block);
+            for (auto predecessor: cfg.predecessors[block]) {
+                worklist.push_back(predecessor);
+            }
+        }
+        for (auto block: loop.blocks) {
+            in_body[block] = false;
+        }
+        loops.push_back(std::move(loop));
+    }
+
+    // an enclosing loop is strictly larger, so outer loops claim their blocks first
+    std::stable_sort(loops.begin(), loops.end(), [](const Loop &a, const Loop &b) {
+        return a.blocks.size() > b.blocks.size();
+    });
+    _innermost.assign(size, -1);
+    for (size_t i = 0; i < loops.size(); i++) {
+        auto &loop = loops[i];
+        loop.parent = _innermost[loop.header];
+        if (loop.parent >= 0) {
+            loop.depth = loops[loop.parent].depth + 1;
+            loops[loop.parent].children.push_back(static_cast<int>(i));
+        }
+        for (auto block: loop.blocks) {
+            _innermost[block] = static_cast<int>(i);
+        }
+    }
+}
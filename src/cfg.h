@@ -0,0 +1,123 @@
+#pragma once
+
+#include <vector>
+#include "ir.h"
+
+/**
+ * Successors, predecessors and a reverse postorder of the blocks reachable from the entry.
+ * Per-block tables are indexed by block id.
+ */
+class ControlFlowGraph {
+public:
+    explicit ControlFlowGraph(const IrFunction &function);
+
+    // reachable blocks, entry first
+    std::vector<IrBlockId> reverse_postorder;
+    // position in reverse_postorder, -1 for unreachable blocks
+    std::vector<int> rpo_number;
+    std::vector<std::vector<IrBlockId>> successors;
+    std::vector<std::vector<IrBlockId>> predecessors;
+    // blocks ending in a return
+    std::vector<IrBlockId> exits;
+
+    IrBlockId entry() const {
+        return reverse_postorder.front();
+    }
+
+    bool reachable(IrBlockId block) const {
+        return rpo_number[block] >= 0;
+    }
+
+    size_t size() const {
+        return reverse_postorder.size();
+    }
+};
+
+/**
+ * Immediate dominators by Cooper, Harvey and Kennedy, "A Simple, Fast Dominance Algorithm",
+ * plus dominance frontiers and constant time dominance queries through tree intervals.
+ *
+ * Built with post = true it is the post-dominator tree instead, rooted at a virtual exit
+ * (block id 0) that every return flows into.
+ */
+class DominatorTree {
+public:
+    DominatorTree(const ControlFlowGraph &cfg, bool post = false);
+
+    // 0 for the root and for blocks not in the tree
+    IrBlockId idom(IrBlockId block) const {
+        return _idom[block];
+    }
+
+    const std::vector<IrBlockId> &children(IrBlockId block) const {
+        return _children[block];
+    }
+
+    // tree blocks, parents before children
+    const std::vector<IrBlockId> &preorder() const {
+        return _preorder;
+    }
+
+    bool contains(IrBlockId block) const {
+        return _in_tree[block];
+    }
+
+    // reflexive
+    bool dominates(IrBlockId a, IrBlockId b) const {
+        return _in_tree[a] && _in_tree[b] && _enter[a] <= _enter[b] && _leave[b] <= _leave[a];
+    }
+
+    const std::vector<IrBlockId> &frontier(IrBlockId block) const {
+        return _frontiers[block];
+    }
+
+    bool post() const {
+        return _post;
+    }
+
+private:
+    bool _post;
+    std::vector<IrBlockId> _idom;
+    std::vector<std::vector<IrBlockId>> _children;
+    std::vector<IrBlockId> _preorder;
+    std::vector<bool> _in_tree;
+    std::vector<int> _enter;
+    std::vector<int> _leave;
+    std::vector<std::vector<IrBlockId>> _frontiers;
+};
+
+class Loop {
+public:
+    IrBlockId header = 0;
+    // header included
+    std::vector<IrBlockId> blocks;
+    // index into LoopForest::loops, -1 for an outermost loop
+    int parent = -1;
+    std::vector<int> children;
+    // 1 for an outermost loop
+    int depth = 1;
+};
+
+/**
+ * The natural loops of the function, nested. A loop is identified by its header, the
+ * target of a back edge whose source it dominates; back edges into a non-dominating block
+ * (irreducible control flow) are not treated as loops.
+ */
+class LoopForest {
+public:
+    LoopForest(const ControlFlowGraph &cfg, const DominatorTree &dominators);
+
+    std::vector<Loop> loops;
+
+    // the innermost loop containing the block, -1 if none
+    int loop_of(IrBlockId block) const {
+        return _innermost[block];
+    }
+
+    int depth(IrBlockId block) const {
+        return _innermost[block] < 0 ? 0 : loops[_innermost[block]].depth;
+    }
+
+private:
+    std::vector<int> _innermost;
+};
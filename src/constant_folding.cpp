@@ -0,0 +1,565 @@
+#include "constant_folding.h"
+
+#include <climits>
+#include <cstdint>
+#include <typeinfo>
+
+// region: helpers
+
+// the grammar levels an expression slot can belong to, outermost first
+enum ExpressionLevel {
+    LOR_LEVEL,
+    LAND_LEVEL,
+    EQ_LEVEL,
+    REL_LEVEL,
+    ADD_LEVEL,
+    MUL_LEVEL,
+    UNARY_LEVEL,
+    PRIMARY_LEVEL
+};
+
+// builds the single-child chain from `level` down to a number literal
+static std::unique_ptr<BaseAST> make_constant(ExpressionLevel level, int value) {
+    auto primary = std::make_unique<PrimaryExpAST>();
+    primary->choice = NUMBER;
+    primary->number = value;
+    std::unique_ptr<BaseAST> node = std::move(primary);
+    if (level == PRIMARY_LEVEL) {
+        return node;
+    }
+
+    auto unary = std::make_unique<UnaryExpAST>();
+    unary->choice = PRIMARY;
+    unary->primary_exp = std::move(node);
+    node = std::move(unary);
+    if (level == UNARY_LEVEL) {
+        return node;
+    }
+
+    auto mul = std::make_unique<MulExpAST>();
+    mul->choice = UNARYEXP;
+    mul->unary_exp = std::move(node);
+    node = std::move(mul);
+    if (level == MUL_LEVEL) {
+        return node;
+    }
+
+    auto add = std::make_unique<AddExpAST>();
+    add->choice = MULEXP;
+    add->mul_exp = std::move(node);
+    node = std::move(add);
+    if (level == ADD_LEVEL) {
+        return node;
+    }
+
+    auto rel = std::make_unique<RelExpAST>();
+    rel->choice = ADDEXP;
+    rel->add_exp = std::move(node);
+    node = std::move(rel);
+    if (level == REL_LEVEL) {
+        return node;
+    }
+
+    auto eq = std::make_unique<EqExpAST>();
+    eq->choice = RELEXP;
+    eq->rel_exp = std::move(node);
+    node = std::move(eq);
+    if (level == EQ_LEVEL) {
+        return node;
+    }
+
+    auto land = std::make_unique<LAndExpAST>();
+    land->choice = EQEXP;
+    land->eq_exp = std::move(node);
+    node = std::move(land);
+    if (level == LAND_LEVEL) {
+        return node;
+    }
+
+    auto lor = std::make_unique<LOrExpAST>();
+    lor->choice = LAND_EXP;
+    lor->land_exp = std::move(node);
+    return lor;
+}
+
+// the only child slot of a node that merely wraps one sub-expression, nullptr otherwise
+static std::unique_ptr<BaseAST> *wrapped_child(BaseAST *node) {
+    if (auto exp = dynamic_cast<ExpAST *>(node)) {
+        return &exp->lor_exp;
+    } else if (auto lor = dynamic_cast<LOrExpAST *>(node); lor && lor->choice == LAND_EXP) {
+        return &lor->land_exp;
+    } else if (auto land = dynamic_cast<LAndExpAST *>(node); land && land->choice == EQEXP) {
+        return &land->eq_exp;
+    } else if (auto eq = dynamic_cast<EqExpAST *>(node); eq && eq->choice == RELEXP) {
+        return &eq->rel_exp;
+    } else if (auto rel = dynamic_cast<RelExpAST *>(node); rel && rel->choice == ADDEXP) {
+        return &rel->add_exp;
+    } else if (auto add = dynamic_cast<AddExpAST *>(node); add && add->choice == MULEXP) {
+        return &add->mul_exp;
+    } else if (auto mul = dynamic_cast<MulExpAST *>(node); mul && mul->choice == UNARYEXP) {
+        return &mul->unary_exp;
+    } else if (auto unary = dynamic_cast<UnaryExpAST *>(node); unary && unary->choice == PRIMARY) {
+        return &unary->primary_exp;
+    } else if (auto primary = dynamic_cast<PrimaryExpAST *>(node); primary && primary->choice == EXP) {
+        return &primary->exp;
+    } else if (auto const_exp = dynamic_cast<ConstExpressionAST *>(node)) {
+        return &const_exp->expression;
+    } else if (auto const_init = dynamic_cast<ConstInitializationExpressionAST *>(node)) {
+        return &const_init->const_expression;
+    } else if (auto var_exp = dynamic_cast<VarExpressionAST *>(node)) {
+        return &var_exp->expression;
+    } else if (auto var_init = dynamic_cast<VarInitializationExpressionAST *>(node)) {
+        return &var_init->var_expression;
+    }
+    return nullptr;
+}
+
+// the slot holding the innermost node reached through single-child wrappers
+static std::unique_ptr<BaseAST> *innermost_slot(std::unique_ptr<BaseAST> &slot) {
+    auto current = &slot;
+    while (auto child = wrapped_child(current->get())) {
+        current = child;
+    }
+    return current;
+}
+
+static BaseAST *unwrap(BaseAST *node) {
+    while (auto child = wrapped_child(node)) {
+        node = child->get();
+    }
+    return node;
+}
+
+static std::string unary_operator(UnaryExpAST *node) {
+    return dynamic_cast<UnaryOpAST *>(node->unary_op.get())->op;
+}
+
+// structural equality of two pure expressions, ignoring redundant wrappers and parentheses
+static bool same_expression(BaseAST *lhs, BaseAST *rhs) {
+    lhs = unwrap(lhs);
+    rhs = unwrap(rhs);
+    if (lhs == nullptr || rhs == nullptr || typeid(*lhs) != typeid(*rhs)) {
+        return false;
+    }
+    if (auto primary = dynamic_cast<PrimaryExpAST *>(lhs)) {
+        auto other = dynamic_cast<PrimaryExpAST *>(rhs);
+        if (primary->choice != other->choice) {
+            return false;
+        }
+        if (primary->choice == NUMBER) {
+            return primary->number == other->number;
+        }
+        return same_expression(primary->left_value.get(), other->left_value.get());
+    } else if (auto lval = dynamic_cast<LValAST *>(lhs)) {
+        return lval->ident == dynamic_cast<LValAST *>(rhs)->ident;
+    } else if (auto unary = dynamic_cast<UnaryExpAST *>(lhs)) {
+        auto other = dynamic_cast<UnaryExpAST *>(rhs);
+        return unary_operator(unary) == unary_operator(other)
+               && same_expression(unary->unary_exp.get(), other->unary_exp.get());
+    } else if (auto mul = dynamic_cast<MulExpAST *>(lhs)) {
+        auto other = dynamic_cast<MulExpAST *>(rhs);
+        return mul->mul_op == other->mul_op
+               && same_expression(mul->mul_exp.get(), other->mul_exp.get())
+               && same_expression(mul->unary_exp.get(), other->unary_exp.get());
+    } else if (auto add = dynamic_cast<AddExpAST *>(lhs)) {
+        auto other = dynamic_cast<AddExpAST *>(rhs);
+        return add->add_op == other->add_op
+               && same_expression(add->add_exp.get(), other->add_exp.get())
+               && same_expression(add->mul_exp.get(), other->mul_exp.get());
+    } else if (auto rel = dynamic_cast<RelExpAST *>(lhs)) {
+        auto other = dynamic_cast<RelExpAST *>(rhs);
+        return rel->rel_op == other->rel_op
+               && same_expression(rel->rel_exp.get(), other->rel_exp.get())
+               && same_expression(rel->add_exp.get(), other->add_exp.get());
+    } else if (auto eq = dynamic_cast<EqExpAST *>(lhs)) {
+        auto other = dynamic_cast<EqExpAST *>(rhs);
+        return eq->eq_op == other->eq_op
+               && same_expression(eq->eq_exp.get(), other->eq_exp.get())
+               && same_expression(eq->rel_exp.get(), other->rel_exp.get());
+    } else if (auto land = dynamic_cast<LAndExpAST *>(lhs)) {
+        auto other = dynamic_cast<LAndExpAST *>(rhs);
+        return land->land_op == other->land_op
+               && same_expression(land->land_exp.get(), other->land_exp.get())
+               && same_expression(land->eq_exp.get(), other->eq_exp.get());
+    } else if (auto lor = dynamic_cast<LOrExpAST *>(lhs)) {
+        auto other = dynamic_cast<LOrExpAST *>(rhs);
+        return lor->lor_op == other->lor_op
+               && same_expression(lor->lor_exp.get(), other->lor_exp.get())
+               && same_expression(lor->land_exp.get(), other->land_exp.get());
+    }
+    return false;
+}
+
+// true if the expression can only evaluate to 0 or 1
+static bool is_boolean(BaseAST *node) {
+    node = unwrap(node);
+    if (auto unary = dynamic_cast<UnaryExpAST *>(node)) {
+        return unary->choice == UNARYOP_UNARYEXP && unary_operator(unary) == "!";
+    } else if (auto rel = dynamic_cast<RelExpAST *>(node)) {
+        return rel->choice == REL_OP_ADDEXP;
+    } else if (auto eq = dynamic_cast<EqExpAST *>(node)) {
+        return eq->choice == EQ_OP_RELEXP;
+    } else if (auto land = dynamic_cast<LAndExpAST *>(node)) {
+        return land->choice == LAND_OP_EQEXP;
+    } else if (auto lor = dynamic_cast<LOrExpAST *>(node)) {
+        return lor->choice == LOR_OP_LAND_EXP;
+    }
+    auto value = ConstantFolder::constant_value(node);
+    return value && (*value == 0 || *value == 1);
+}
+
+// endregion
+
+
+FoldingStatistics ConstantFolder::fold(std::unique_ptr<BaseAST> &root) {
+    _statistics = FoldingStatistics();
+    _scopes.clear();
+    _scopes.emplace_back();
+
+    int before = count_nodes(root.get());
+    visit(root.get());
+    _statistics.nodes_removed = before - count_nodes(root.get());
+    return _statistics;
+}
+
+std::optional<int> ConstantFolder::constant_value(BaseAST *node) {
+    auto primary = dynamic_cast<PrimaryExpAST *>(unwrap(node));
+    if (primary != nullptr && primary->choice == NUMBER) {
+        return primary->number;
+    }
+    return std::nullopt;
+}
+
+std::optional<int> ConstantFolder::evaluate_binary(const std::string &op, int lhs, int rhs) {
+    auto l = static_cast<uint32_t>(lhs);
+    auto r = static_cast<uint32_t>(rhs);
+    if (op == "+") {
+        return static_cast<int>(l + r);
+    } else if (op == "-") {
+        return static_cast<int>(l - r);
+    } else if (op == "*") {
+        return static_cast<int>(l * r);
+    } else if (op == "/" || op == "%") {
+        // leave the trap (or whatever the target does) to run time
+        if (rhs == 0 || (lhs == INT_MIN && rhs == -1)) {
+            return std::nullopt;
+        }
+        return op == "/" ? lhs / rhs : lhs % rhs;
+    } else if (op == "<") {
+        return lhs < rhs;
+    } else if (op == ">") {
+        return lhs > rhs;
+    } else if (op == "<=") {
+        return lhs <= rhs;
+    } else if (op == ">=") {
+        return lhs >= rhs;
+    } else if (op == "==") {
+        return lhs == rhs;
+    } else if (op == "!=") {
+        return lhs != rhs;
+    } else if (op == "&&") {
+        return lhs != 0 && rhs != 0;
+    } else if (op == "||") {
+        return lhs != 0 || rhs != 0;
+    }
+    return std::nullopt;
+}
+
+std::optional<int> ConstantFolder::evaluate_unary(const std::string &op, int operand) {
+    if (op == "+") {
+        return operand;
+    } else if (op == "-") {
+        return static_cast<int>(0u - static_cast<uint32_t>(operand));
+    } else if (op == "!") {
+        return operand == 0;
+    }
+    return std::nullopt;
+}
+
+int ConstantFolder::count_nodes(BaseAST *node) {
+    if (node == nullptr) {
+        return 0;
+    }
+    int count = 1;
+    for (auto child: node->children()) {
+        count += count_nodes(child);
+    }
+    return count;
+}
+
+void ConstantFolder::visit(BaseAST *node) {
+    if (node == nullptr) {
+        return;
+    }
+    if (auto block = dynamic_cast<BlockAST *>(node)) {
+        _scopes.emplace_back();
+        visit(block->block_item_list.get());
+        _scopes.pop_back();
+    } else if (auto exp = dynamic_cast<ExpAST *>(node)) {
+        fold_expression(exp);
+    } else if (auto const_def = dynamic_cast<ConstDefinitionAST *>(node)) {
+        visit(const_def->const_initialization_expression.get());
+        _scopes.back()[const_def->ident] = constant_value(const_def->const_initialization_expression.get());
+    } else if (auto var_def = dynamic_cast<VarDefinitionAST *>(node)) {
+        // the variable is in scope inside its own initializer, as in C
+        _scopes.back()[var_def->ident] = std::nullopt;
+        visit(var_def->var_initialization_expression.get());
+    } else {
+        for (auto child: node->children()) {
+            visit(child);
+        }
+    }
+}
+
+std::optional<int> ConstantFolder::lookup_constant(const std::string &ident) {
+    for (auto scope = _scopes.rbegin(); scope != _scopes.rend(); ++scope) {
+        auto found = scope->find(ident);
+        if (found != scope->end()) {
+            return found->second;
+        }
+    }
+    return std::nullopt;
+}
+
+void ConstantFolder::fold_expression(ExpAST *exp) {
+    fold_lor(exp->lor_exp);
+}
+
+std::optional<int> ConstantFolder::fold_lor(std::unique_ptr<BaseAST> &slot) {
+    auto node = dynamic_cast<LOrExpAST *>(slot.get());
+    if (node == nullptr) {
+        return std::nullopt;
+    }
+    if (node->choice == LAND_EXP) {
+        return fold_land(node->land_exp);
+    }
+
+    auto lhs = fold_lor(node->lor_exp);
+    auto rhs = fold_land(node->land_exp);
+    std::optional<int> value;
+    if (lhs && rhs) {
+        value = evaluate_binary(node->lor_op, *lhs, *rhs);
+    } else if ((lhs && *lhs != 0) || (rhs && *rhs != 0)) {
+        value = 1;
+    }
+    if (value) {
+        slot = make_constant(LOR_LEVEL, *value);
+        _statistics.constants_folded++;
+    }
+    return value;
+}
+
+std::optional<int> ConstantFolder::fold_land(std::unique_ptr<BaseAST> &slot) {
+    auto node = dynamic_cast<LAndExpAST *>(slot.get());
+    if (node == nullptr) {
+        return std::nullopt;
+    }
+    if (node->choice == EQEXP) {
+        return fold_eq(node->eq_exp);
+    }
+
+    auto lhs = fold_land(node->land_exp);
+    auto rhs = fold_eq(node->eq_exp);
+    std::optional<int> value;
+    if (lhs && rhs) {
+        value = evaluate_binary(node->land_op, *lhs, *rhs);
+    } else if (node->land_op == "&&" && ((lhs && *lhs == 0) || (rhs && *rhs == 0))) {
+        value = 0;
+    } else if (node->land_op == "||" && ((lhs && *lhs != 0) || (rhs && *rhs != 0))) {
+        value = 1;
+    }
+    if (value) {
+        slot = make_constant(LAND_LEVEL, *value);
+        _statistics.constants_folded++;
+    }
+    return value;
+}
+
+std::optional<int> ConstantFolder::fold_eq(std::unique_ptr<BaseAST> &slot) {
+    auto node = dynamic_cast<EqExpAST *>(slot.get());
+    if (node == nullptr) {
+        return std::nullopt;
+    }
+    if (node->choice == RELEXP) {
+        return fold_rel(node->rel_exp);
+    }
+
+    auto lhs = fold_eq(node->eq_exp);
+    auto rhs = fold_rel(node->rel_exp);
+    std::optional<int> value;
+    if (lhs && rhs) {
+        value = evaluate_binary(node->eq_op, *lhs, *rhs);
+    } else if (same_expression(node->eq_exp.get(), node->rel_exp.get())) {
+        value = node->eq_op == "==";
+    }
+    if (value) {
+        slot = make_constant(EQ_LEVEL, *value);
+        _statistics.constants_folded++;
+    }
+    return value;
+}
+
+std::optional<int> ConstantFolder::fold_rel(std::unique_ptr<BaseAST> &slot) {
+    auto node = dynamic_cast<RelExpAST *>(slot.get());
+    if (node == nullptr) {
+        return std::nullopt;
+    }
+    if (node->choice == ADDEXP) {
+        return fold_add(node->add_exp);
+    }
+
+    auto lhs = fold_rel(node->rel_exp);
+    auto rhs = fold_add(node->add_exp);
+    if (lhs && rhs) {
+        auto value = evaluate_binary(node->rel_op, *lhs, *rhs);
+        slot = make_constant(REL_LEVEL, *value);
+        _statistics.constants_folded++;
+        return value;
+    }
+    return std::nullopt;
+}
+
+std::optional<int> ConstantFolder::fold_add(std::unique_ptr<BaseAST> &slot) {
+    auto node = dynamic_cast<AddExpAST *>(slot.get());
+    if (node == nullptr) {
+        return std::nullopt;
+    }
+    if (node->choice == MULEXP) {
+        return fold_mul(node->mul_exp);
+    }
+
+    auto lhs = fold_add(node->add_exp);
+    auto rhs = fold_mul(node->mul_exp);
+    if (lhs && rhs) {
+        auto value = evaluate_binary(node->add_op, *lhs, *rhs);
+        slot = make_constant(ADD_LEVEL, *value);
+        _statistics.constants_folded++;
+        return value;
+    }
+
+    if (rhs && *rhs == 0) {
+        // x + 0, x - 0
+        slot = std::move(node->add_exp);
+        _statistics.identities_applied++;
+    } else if (lhs && *lhs == 0 && node->add_op == "+") {
+        // 0 + x
+        node->choice = MULEXP;
+        node->add_exp.reset();
+        node->add_op.clear();
+        _statistics.identities_applied++;
+    } else if (node->add_op == "-" && same_expression(node->add_exp.get(), node->mul_exp.get())) {
+        // x - x
+        slot = make_constant(ADD_LEVEL, 0);
+        _statistics.identities_applied++;
+        return 0;
+    }
+    return std::nullopt;
+}
+
+std::optional<int> ConstantFolder::fold_mul(std::unique_ptr<BaseAST> &slot) {
+    auto node = dynamic_cast<MulExpAST *>(slot.get());
+    if (node == nullptr) {
+        return std::nullopt;
+    }
+    if (node->choice == UNARYEXP) {
+        return fold_unary(node->unary_exp);
+    }
+
+    auto lhs = fold_mul(node->mul_exp);
+    auto rhs = fold_unary(node->unary_exp);
+    if (lhs && rhs) {
+        auto value = evaluate_binary(node->mul_op, *lhs, *rhs);
+        if (value) {
+            slot = make_constant(MUL_LEVEL, *value);
+            _statistics.constants_folded++;
+        }
+        return value;
+    }
+
+    auto &op = node->mul_op;
+    if ((op == "*" && ((lhs && *lhs == 0) || (rhs && *rhs == 0)))
+        || (op == "%" && rhs && (*rhs == 1 || *rhs == -1))) {
+        // x * 0, 0 * x, x % 1, x % -1
+        slot = make_constant(MUL_LEVEL, 0);
+        _statistics.identities_applied++;
+        return 0;
+    } else if ((op == "*" || op == "/") && rhs && *rhs == 1) {
+        // x * 1, x / 1
+        slot = std::move(node->mul_exp);
+        _statistics.identities_applied++;
+    } else if (op == "*" && lhs && *lhs == 1) {
+        // 1 * x
+        node->choice = UNARYEXP;
+        node->mul_exp.reset();
+        node->mul_op.clear();
+        _statistics.identities_applied++;
+    }
+    return std::nullopt;
+}
+
+std::optional<int> ConstantFolder::fold_unary(std::unique_ptr<BaseAST> &slot) {
+    auto node = dynamic_cast<UnaryExpAST *>(slot.get());
+    if (node == nullptr) {
+        return std::nullopt;
+    }
+    if (node->choice == PRIMARY) {
+        return fold_primary(node->primary_exp);
+    }
+
+    auto op = unary_operator(node);
+    auto operand = fold_unary(node->unary_exp);
+    if (operand) {
+        auto value = evaluate_unary(op, *operand);
+        slot = make_constant(UNARY_LEVEL, *value);
+        _statistics.constants_folded++;
+        return value;
+    }
+
+    auto inner = dynamic_cast<UnaryExpAST *>(node->unary_exp.get());
+    if (op == "+") {
+        // +x
+        slot = std::move(node->unary_exp);
+        _statistics.identities_applied++;
+    } else if (inner != nullptr && inner->choice == UNARYOP_UNARYEXP && unary_operator(inner) == op
+               && (op == "-" || is_boolean(inner->unary_exp.get()))) {
+        // --x, and !!x when x already is 0 or 1
+        slot = std::move(inner->unary_exp);
+        _statistics.identities_applied++;
+    }
+    return std::nullopt;
+}
+
+std::optional<int> ConstantFolder::fold_primary(std::unique_ptr<BaseAST> &slot) {
+    auto node = dynamic_cast<PrimaryExpAST *>(slot.get());
+    if (node == nullptr) {
+        return std::nullopt;
+    }
+
+    std::optional<int> value;
+    if (node->choice == NUMBER) {
+        return node->number;
+    } else if (node->choice == LEFT_VALUE) {
+        value = lookup_constant(dynamic_cast<LValAST *>(node->left_value.get())->ident);
+    } else {
+        auto exp = dynamic_cast<ExpAST *>(node->exp.get());
+        value = fold_lor(exp->lor_exp);
+        if (!value) {
+            // (x) -> x when nothing but wrappers sit between the parentheses and x
+            auto inner = innermost_slot(node->exp);
+            if (dynamic_cast<PrimaryExpAST *>(inner->get()) != nullptr) {
+                slot = std::move(*inner);
+                _statistics.identities_applied++;
+            }
+            return std::nullopt;
+        }
+    }
+
+    if (value) {
+        node->choice = NUMBER;
+        node->number = *value;
+        node->exp.reset();
+        node->left_value.reset();
+        _statistics.constants_folded++;
+    }
+    return value;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+#include "Ast.h"
+
+class FoldingStatistics {
+public:
+    // number of AST nodes that disappeared from the tree
+    int nodes_removed = 0;
+    // sub-expressions replaced by a single number
+    int constants_folded = 0;
+    // algebraic identities such as x+0, x*1, --x applied
+    int identities_applied = 0;
+
+    void print() const {
+        std::cout << "constant folding: " << nodes_removed << " nodes removed, "
+                  << constants_folded << " constants folded, "
+                  << identities_applied << " identities applied" << std::endl;
+    }
+};
+
+/**
+ * Folds constant sub-expressions and simplifies algebraic identities in place.
+ *
+ * Every rewrite keeps the grammar shape of the tree: a node is only ever replaced
+ * by another node of the same level (an AddExp slot still holds an AddExpAST), so
+ * dump() and later lowering see a well formed tree.
+ *
+ * SysY expressions have no side effects yet, which is what makes x*0 and x-x safe.
+ */
+class ConstantFolder {
+public:
+    FoldingStatistics fold(std::unique_ptr<BaseAST> &root);
+
+    // the value of an expression node if it is (after folding) a literal
+    static std::optional<int> constant_value(BaseAST *node);
+
+    // 32-bit wrapping semantics; empty for division by zero and INT_MIN / -1
+    static std::optional<int> evaluate_binary(const std::string &op, int lhs, int rhs);
+
+    static std::optional<int> evaluate_unary(const std::string &op, int operand);
+
+    static int count_nodes(BaseAST *node);
+
+private:
+    FoldingStatistics _statistics;
+
+    // innermost scope last; an empty optional shadows an outer const with a variable
+    std::vector<std::map<std::string, std::optional<int>>> _scopes;
+
+    void visit(BaseAST *node);
+
+    void fold_expression(ExpAST *exp);
+
+    std::optional<int> fold_lor(std::unique_ptr<BaseAST> &slot);
+
+    std::optional<int> fold_land(std::unique_ptr<BaseAST> &slot);
+
+    std::optional<int> fold_eq(std::unique_ptr<BaseAST> &slot);
+
+    std::optional<int> fold_rel(std::unique_ptr<BaseAST> &slot);
+
+    std::optional<int> fold_add(std::unique_ptr<BaseAST> &slot);
+
+    std::optional<int> fold_mul(std::unique_ptr<BaseAST> &slot);
+
+    std::optional<int> fold_unary(std::unique_ptr<BaseAST> &slot);
+
+    std::optional<int> fold_primary(std::unique_ptr<BaseAST> &slot);
+
+    std::optional<int> lookup_constant(const std::string &ident);
+};
@@ -0,0 +1,90 @@
+#include "constant_materialization.h"
+
+#include <iostream>
+#include <optional>
+
+void ConstantMaterializationStatistics::print(const std::string &function) const {
+    std::cout << "constants @" << function << ": " << expanded << " expanded, " << reused << " reused, instructions "
+              << instructions_before << " -> " << instructions_after << std::endl;
+}
+
+static MachineInstruction make(RiscvOpcode opcode, MachineRegister rd, MachineRegister rs1, int32_t imm) {
+    MachineInstruction inst;
+    inst.opcode = opcode;
+    inst.rd = rd;
+    inst.rs1 = rs1;
+    inst.imm = imm;
+    return inst;
+}
+
+// the 20 bits lui loads, rounded up when the 12 below them read as negative to addi
+static int32_t upper(int32_t value) {
+    return static_cast<int32_t>(((static_cast<uint32_t>(value) + 0x800) >> 12) & 0xfffff);
+}
+
+static int32_t lower(int32_t value) {
+    return static_cast<int32_t>(static_cast<uint32_t>(value) - (static_cast<uint32_t>(upper(value)) << 12));
+}
+
+// what `li value` takes on its own
+static size_t length(int32_t value) {
+    return riscv_fits_immediate(value) || lower(value) == 0 ? 1 : 2;
+}
+
+// `value` in one instruction from `reg`, known to hold `known`
+static std::optional<MachineInstruction> from_known(MachineRegister rd, MachineRegister reg, int32_t known,
+                                                    int32_t value) {
+    auto difference = static_cast<int32_t>(static_cast<uint32_t>(value) - static_cast<uint32_t>(known));
+    if (riscv_fits_immediate(difference)) {
+        return difference == 0 ? make(RV_MV, rd, reg, 0) : make(RV_ADDI, rd, reg, difference);
+    }
+    for (int32_t shift = 1; shift < 32 && known != 0; shift++) {
+        if (static_cast<int32_t>(static_cast<uint32_t>(known) << shift) == value) {
+            return make(RV_SLLI, rd, reg, shift);
+        }
+    }
+    return std::nullopt;
+}
+
+ConstantMaterializationStatistics ConstantMaterialization::run(MachineFunction &function) {
+    ConstantMaterializationStatistics statistics;
+    for (auto &block: function.blocks) {
+        // the constant each register holds, as far as this block shows
+        std::optional<int32_t> known[RV_FIRST_VIRTUAL];
+        std::vector<MachineInstruction> code;
+        for (auto &inst: block.instructions) {
+            if (inst.opcode != RV_LI) {
+                statistics.instructions_before++;
+                code.push_back(inst);
+                if (riscv_has_def(inst.opcode)) {
+                    known[inst.rd] = inst.opcode == RV_MV ? known[inst.rs1] : std::nullopt;
+                }
+                continue;
+            }
+            auto value = inst.imm;
+            statistics.instructions_before += length(value);
+            std::optional<MachineInstruction> reuse;
+            for (MachineRegister reg = 1; reg < RV_FIRST_VIRTUAL && length(value) > 1 && !reuse; reg++) {
+                if (known[reg].has_value()) {
+                    reuse = from_known(inst.rd, reg, *known[reg], value);
+                }
+            }
+            if (reuse.has_value()) {
+                code.push_back(*reuse);
+                statistics.reused++;
+            } else if (length(value) == 1 && riscv_fits_immediate(value)) {
+                code.push_back(inst);
+            } else {
+                code.push_back(make(RV_LUI, inst.rd, RV_ZERO, upper(value)));
+                if (lower(value) != 0) {
+                    code.push_back(make(RV_ADDI, inst.rd, inst.rd, lower(value)));
+                }
+                statistics.expanded++;
+            }
+            known[inst.rd] = value;
+        }
+        statistics.instructions_after += code.size();
+        block.instructions = std::move(code);
+    }
+    return statistics;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <string>
+#include "riscv.h"
+
+class ConstantMaterializationStatistics {
+public:
+    // li expanded into lui and addi, or just lui
+    size_t expanded = 0;
+    // built from a register already holding a nearby constant instead
+    size_t reused = 0;
+    // counting each li the way the assembler would expand it
+    size_t instructions_before = 0;
+    size_t instructions_after = 0;
+
+    void print(const std::string &function) const;
+};
+
+/**
+ * Replaces each li of a finished function with the shortest sequence of real instructions
+ * building its constant: li itself where it fits the 12 bits of an addi, lui where the
+ * low 12 bits are clear, and lui then addi otherwise, with the upper part rounded up when
+ * the lower one is negative. A constant one addi or slli away from one already in a
+ * register, from an li earlier in the block, is built from that register in a single
+ * instruction instead.
+ *
+ * Runs on physical registers, after register allocation has had its chance to
+ * rematerialize constants from their li.
+ */
+class ConstantMaterialization {
+public:
+    ConstantMaterializationStatistics run(MachineFunction &function);
+};
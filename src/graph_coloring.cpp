@@ -0,0 +1,574 @@
+#include "graph_coloring.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include "machine_liveness.h"
+
+// region: interference graph
+
+InterferenceGraph::InterferenceGraph(size_t size) : _adjacent(size) {
+    if (size < BIT_MATRIX_LIMIT) {
+        _matrix.assign((size * (size + 1) / 2 + 63) / 64, 0);
+    }
+}
+
+bool InterferenceGraph::interferes(MachineRegister u, MachineRegister v) const {
+    if (!riscv_is_virtual(u) && !riscv_is_virtual(v)) {
+        return u != v;
+    }
+    if (!_matrix.empty()) {
+        auto index = bit(u, v);
+        return (_matrix[index / 64] >> (index % 64)) & 1;
+    }
+    // physical registers have no list, search the other one's
+    auto &shorter = !riscv_is_virtual(u) || (riscv_is_virtual(v) && _adjacent[v].size() < _adjacent[u].size())
+                    ? _adjacent[v] : _adjacent[u];
+    auto other = &shorter == &_adjacent[u] ? v : u;
+    return std::find(shorter.begin(), shorter.end(), other) != shorter.end();
+}
+
+bool InterferenceGraph::add_edge(MachineRegister u, MachineRegister v) {
+    if (u == v || interferes(u, v)) {
+        return false;
+    }
+    if (!_matrix.empty()) {
+        auto index = bit(u, v);
+        _matrix[index / 64] |= uint64_t(1) << (index % 64);
+    }
+    if (riscv_is_virtual(u)) {
+        _adjacent[u].push_back(v);
+    }
+    if (riscv_is_virtual(v)) {
+        _adjacent[v].push_back(u);
+    }
+    return true;
+}
+
+// endregion
+
+RegisterAllocationStatistics GraphColoring::run(MachineFunction &function) {
+    RegisterAllocationStatistics statistics;
+    _function = &function;
+    _colors = riscv_allocatable_registers().size();
+    _split_from.clear();
+    _slots.assign(function.register_count(), -1);
+    _unspillable.assign(function.register_count(), false);
+
+    std::vector<MachineRegister> spilled;
+    bool tried_splitting = false;
+    do {
+        build();
+        make_worklists();
+        while (true) {
+            if (!_simplify.empty()) {
+                simplify();
+            } else if (!_worklist_moves.empty()) {
+                coalesce();
+            } else if (!_freeze.empty()) {
+                freeze();
+            } else if (!_spill.empty()) {
+                select_spill();
+            } else {
+                break;
+            }
+        }
+        spilled = assign_colors();
+        if (!spilled.empty() && !tried_splitting) {
+            // once, before the first spill: the registers that did not fit may only need to
+            // leave their register where the pressure is
+            tried_splitting = true;
+            statistics.ranges_split = split_live_ranges(function, spilled, _split_from);
+            if (statistics.ranges_split > 0) {
+                continue;
+            }
+        }
+        if (!spilled.empty()) {
+            rewrite(spilled, statistics);
+        }
+    } while (!spilled.empty());
+
+    RegisterAssignment assignment(function);
+    for (MachineRegister reg = RV_FIRST_VIRTUAL; reg < function.register_count(); reg++) {
+        if (_state[reg] != NODE_UNUSED) {
+            statistics.virtual_registers++;
+            assignment.registers[reg] = _color[alias(reg)];
+        }
+    }
+    assign_registers(function, assignment, statistics);
+    return statistics;
+}
+
+bool GraphColoring::relevant(MachineRegister reg) const {
+    if (riscv_is_virtual(reg)) {
+        return true;
+    }
+    auto &allocatable = riscv_allocatable_registers();
+    return std::find(allocatable.begin(), allocatable.end(), reg) != allocatable.end();
+}
+
+// region: building
+
+void GraphColoring::build() {
+    auto &function = *_function;
+    auto size = function.register_count();
+    _graph = std::make_unique<InterferenceGraph>(size);
+    _state.assign(size, NODE_UNUSED);
+    _degree.assign(size, 0);
+    _alias.assign(size, 0);
+    _color.assign(size, RV_ZERO);
+    _cost.assign(size, 0);
+    _move_list.assign(size, {});
+    _moves.clear();
+    _simplify.clear();
+    _freeze.clear();
+    _spill.clear();
+    _worklist_moves.clear();
+    _select.clear();
+    _unspillable.resize(size, false);
+    for (auto reg: riscv_allocatable_registers()) {
+        _state[reg] = NODE_PRECOLORED;
+        _color[reg] = reg;
+        // never simplified, never spilled
+        _degree[reg] = SIZE_MAX / 2;
+    }
+
+    _rematerializable = find_rematerializable(function);
+    MachineLiveness liveness(function);
+    // the live set while walking a block backwards, with positions for constant time removal
+    std::vector<MachineRegister> live;
+    std::vector<int> position(size, -1);
+    auto insert = [&](MachineRegister reg) {
+        if (relevant(reg) && position[reg] < 0) {
+            position[reg] = static_cast<int>(live.size());
+            live.push_back(reg);
+        }
+    };
+    auto erase = [&](MachineRegister reg) {
+        if (position[reg] < 0) {
+            return;
+        }
+        auto last = live.back();
+        live[position[reg]] = last;
+        position[last] = position[reg];
+        live.pop_back();
+        position[reg] = -1;
+    };
+
+    for (MachineBlockId block = 0; block < function.blocks.size(); block++) {
+        auto &instructions = function.blocks[block].instructions;
+        auto weight = std::pow(10.0, std::min(function.blocks[block].loop_depth, 8));
+        for (auto reg: live) {
+            position[reg] = -1;
+        }
+        live.clear();
+        for (auto reg: liveness.live_out(block).members()) {
+            insert(reg);
+        }
+        for (auto inst = instructions.rbegin(); inst != instructions.rend(); ++inst) {
+            MachineRegister uses[2];
+            auto use_count = riscv_uses(*inst, uses);
+            auto def = riscv_has_def(inst->opcode) && relevant(inst->rd) ? inst->rd : RV_ZERO;
+            for (int i = 0; i < use_count; i++) {
+                if (relevant(uses[i])) {
+                    _state[uses[i]] = _state[uses[i]] == NODE_UNUSED ? NODE_INITIAL : _state[uses[i]];
+                    // computing a value again takes no memory access, about half a reload
+                    _cost[uses[i]] += _rematerializable[uses[i]] ? weight / 2 : weight;
+                }
+            }
+            if (def != RV_ZERO) {
+                _state[def] = _state[def] == NODE_UNUSED ? NODE_INITIAL : _state[def];
+                // the definition of a rematerialized register simply goes away
+                _cost[def] += _rematerializable[def] ? 0 : weight;
+            }
+
+            if (inst->opcode == RV_MV && def != RV_ZERO && relevant(inst->rs1)) {
+                // the source does not interfere with the destination just for being copied
+                erase(inst->rs1);
+                _move_list[def].push_back(_moves.size());
+                _move_list[inst->rs1].push_back(_moves.size());
+                _worklist_moves.push_back(_moves.size());
+                _moves.push_back({def, inst->rs1, MOVE_WORKLIST});
+            }
+            if (def != RV_ZERO) {
+                for (auto reg: live) {
+                    add_edge(def, reg);
+                }
+                erase(def);
+            }
+            for (int i = 0; i < use_count; i++) {
+                insert(uses[i]);
+            }
+        }
+    }
+}
+
+void GraphColoring::add_edge(MachineRegister u, MachineRegister v) {
+    if (_graph->add_edge(u, v)) {
+        if (_state[u] != NODE_PRECOLORED) {
+            _degree[u]++;
+        }
+        if (_state[v] != NODE_PRECOLORED) {
+            _degree[v]++;
+        }
+    }
+}
+
+void GraphColoring::make_worklists() {
+    for (MachineRegister reg = RV_FIRST_VIRTUAL; reg < _state.size(); reg++) {
+        if (_state[reg] != NODE_INITIAL) {
+            continue;
+        }
+        if (_degree[reg] >= _colors) {
+            _state[reg] = NODE_SPILL;
+            _spill.push_back(reg);
+        } else if (move_related(reg)) {
+            _state[reg] = NODE_FREEZE;
+            _freeze.push_back(reg);
+        } else {
+            _state[reg] = NODE_SIMPLIFY;
+            _simplify.push_back(reg);
+        }
+    }
+}
+
+// endregion
+
+// region: simplify, coalesce, freeze and spill
+
+std::vector<MachineRegister> GraphColoring::adjacent(MachineRegister reg) const {
+    std::vector<MachineRegister> result;
+    for (auto neighbour: _graph->neighbours(reg)) {
+        if (_state[neighbour] != NODE_SELECT && _state[neighbour] != NODE_COALESCED) {
+            result.push_back(neighbour);
+        }
+    }
+    return result;
+}
+
+std::vector<size_t> GraphColoring::node_moves(MachineRegister reg) const {
+    std::vector<size_t> result;
+    for (auto move: _move_list[reg]) {
+        if (_moves[move].state == MOVE_ACTIVE || _moves[move].state == MOVE_WORKLIST) {
+            result.push_back(move);
+        }
+    }
+    return result;
+}
+
+bool GraphColoring::move_related(MachineRegister reg) const {
+    for (auto move: _move_list[reg]) {
+        if (_moves[move].state == MOVE_ACTIVE || _moves[move].state == MOVE_WORKLIST) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void GraphColoring::simplify() {
+    auto reg = _simplify.back();
+    _simplify.pop_back();
+    if (_state[reg] != NODE_SIMPLIFY) {
+        return;
+    }
+    _state[reg] = NODE_SELECT;
+    _select.push_back(reg);
+    for (auto neighbour: adjacent(reg)) {
+        decrement_degree(neighbour);
+    }
+}
+
+void GraphColoring::decrement_degree(MachineRegister reg) {
+    if (_state[reg] == NODE_PRECOLORED) {
+        return;
+    }
+    if (_degree[reg]-- != _colors) {
+        return;
+    }
+    // just became colourable: its moves and its neighbours' moves may coalesce now
+    enable_moves(reg);
+    for (auto neighbour: adjacent(reg)) {
+        enable_moves(neighbour);
+    }
+    if (_state[reg] != NODE_SPILL) {
+        return;
+    }
+    if (move_related(reg)) {
+        _state[reg] = NODE_FREEZE;
+        _freeze.push_back(reg);
+    } else {
+        _state[reg] = NODE_SIMPLIFY;
+        _simplify.push_back(reg);
+    }
+}
+
+void GraphColoring::enable_moves(MachineRegister reg) {
+    for (auto move: node_moves(reg)) {
+        if (_moves[move].state == MOVE_ACTIVE) {
+            _moves[move].state = MOVE_WORKLIST;
+            _worklist_moves.push_back(move);
+        }
+    }
+}
+
+void GraphColoring::coalesce() {
+    auto move = _worklist_moves.back();
+    _worklist_moves.pop_back();
+    if (_moves[move].state != MOVE_WORKLIST) {
+        return;
+    }
+    auto u = alias(_moves[move].dst);
+    auto v = alias(_moves[move].src);
+    if (_state[v] == NODE_PRECOLORED) {
+        std::swap(u, v);
+    }
+
+    if (u == v) {
+        _moves[move].state = MOVE_COALESCED;
+        add_worklist(u);
+    } else if (_state[v] == NODE_PRECOLORED || _graph->interferes(u, v)) {
+        _moves[move].state = MOVE_CONSTRAINED;
+        add_worklist(u);
+        add_worklist(v);
+    } else if (_state[u] == NODE_PRECOLORED ? george(u, v) : briggs(u, v)) {
+        _moves[move].state = MOVE_COALESCED;
+        combine(u, v);
+        add_worklist(u);
+    } else {
+        _moves[move].state = MOVE_ACTIVE;
+    }
+}
+
+void GraphColoring::add_worklist(MachineRegister reg) {
+    if (_state[reg] == NODE_FREEZE && !move_related(reg) && _degree[reg] < _colors) {
+        _state[reg] = NODE_SIMPLIFY;
+        _simplify.push_back(reg);
+    }
+}
+
+bool GraphColoring::george(MachineRegister r, MachineRegister v) const {
+    // every neighbour of v is harmless to r: insignificant, physical, or already next to r
+    for (auto t: adjacent(v)) {
+        if (_degree[t] >= _colors && _state[t] != NODE_PRECOLORED && !_graph->interferes(t, r)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool GraphColoring::briggs(MachineRegister u, MachineRegister v) const {
+    // fewer than K neighbours of significant degree in the combined node
+    auto neighbours = adjacent(u);
+    auto more = adjacent(v);
+    neighbours.insert(neighbours.end(), more.begin(), more.end());
+    std::sort(neighbours.begin(), neighbours.end());
+    neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+    size_t significant = 0;
+    for (auto t: neighbours) {
+        significant += _degree[t] >= _colors;
+    }
+    return significant < _colors;
+}
+
+MachineRegister GraphColoring::alias(MachineRegister reg) const {
+    while (_state[reg] == NODE_COALESCED) {
+        reg = _alias[reg];
+    }
+    return reg;
+}
+
+void GraphColoring::combine(MachineRegister u, MachineRegister v) {
+    _state[v] = NODE_COALESCED;
+    _alias[v] = u;
+    _move_list[u].insert(_move_list[u].end(), _move_list[v].begin(), _move_list[v].end());
+    enable_moves(v);
+    for (auto t: adjacent(v)) {
+        add_edge(t, u);
+        decrement_degree(t);
+    }
+    if (_degree[u] >= _colors && _state[u] == NODE_FREEZE) {
+        _state[u] = NODE_SPILL;
+        _spill.push_back(u);
+    }
+}
+
+void GraphColoring::freeze() {
+    auto reg = _freeze.back();
+    _freeze.pop_back();
+    if (_state[reg] != NODE_FREEZE) {
+        return;
+    }
+    _state[reg] = NODE_SIMPLIFY;
+    _simplify.push_back(reg);
+    freeze_moves(reg);
+}
+
+void GraphColoring::freeze_moves(MachineRegister reg) {
+    for (auto move: node_moves(reg)) {
+        auto x = alias(_moves[move].dst);
+        auto y = alias(_moves[move].src);
+        auto other = y == alias(reg) ? x : y;
+        _moves[move].state = MOVE_FROZEN;
+        if (_state[other] == NODE_FREEZE && !move_related(other) && _degree[other] < _colors) {
+            _state[other] = NODE_SIMPLIFY;
+            _simplify.push_back(other);
+        }
+    }
+}
+
+void GraphColoring::select_spill() {
+    MachineRegister chosen = RV_ZERO;
+    double best = 0;
+    std::vector<MachineRegister> remaining;
+    for (auto reg: _spill) {
+        if (_state[reg] != NODE_SPILL) {
+            continue;
+        }
+        remaining.push_back(reg);
+        // spilling a register that came from spilling gains nothing
+        auto cost = _unspillable[reg] ? HUGE_VAL : _cost[reg] / static_cast<double>(_degree[reg]);
+        if (chosen == RV_ZERO || cost < best) {
+            chosen = reg;
+            best = cost;
+        }
+    }
+    _spill = remaining;
+    if (chosen == RV_ZERO) {
+        return;
+    }
+    _spill.erase(std::find(_spill.begin(), _spill.end(), chosen));
+    _state[chosen] = NODE_SIMPLIFY;
+    _simplify.push_back(chosen);
+    freeze_moves(chosen);
+}
+
+// endregion
+
+// region: colouring and spilling
+
+std::vector<MachineRegister> GraphColoring::assign_colors() {
+    std::vector<MachineRegister> spilled;
+    std::vector<bool> taken(RV_FIRST_VIRTUAL, false);
+    while (!_select.empty()) {
+        auto reg = _select.back();
+        _select.pop_back();
+        std::fill(taken.begin(), taken.end(), false);
+        for (auto neighbour: _graph->neighbours(reg)) {
+            auto representative = alias(neighbour);
+            if (_state[representative] == NODE_COLORED || _state[representative] == NODE_PRECOLORED) {
+                taken[_color[representative]] = true;
+            }
+        }
+        auto &allocatable = riscv_allocatable_registers();
+        auto color = std::find_if(allocatable.begin(), allocatable.end(), [&taken](MachineRegister candidate) {
+            return !taken[candidate];
+        });
+        if (color == allocatable.end()) {
+            _state[reg] = NODE_SPILLED;
+            spilled.push_back(reg);
+        } else {
+            _state[reg] = NODE_COLORED;
+            _color[reg] = *color;
+        }
+    }
+    for (MachineRegister reg = RV_FIRST_VIRTUAL; reg < _state.size(); reg++) {
+        if (_state[reg] == NODE_COALESCED) {
+            _color[reg] = _color[alias(reg)];
+        }
+    }
+    return spilled;
+}
+
+void GraphColoring::rewrite(const std::vector<MachineRegister> &spilled, RegisterAllocationStatistics &statistics) {
+    auto &function = *_function;
+    std::vector<int32_t> slots(function.register_count(), -1);
+    std::vector<bool> rematerialized(function.register_count(), false);
+    for (auto reg: spilled) {
+        if (_rematerializable[reg]) {
+            rematerialized[reg] = true;
+            statistics.rematerialized++;
+        } else {
+            // a copy and the register it was split from are never live at the same time
+            auto owner = reg < _split_from.size() && _split_from[reg] != RV_ZERO ? _split_from[reg] : reg;
+            _slots.resize(function.register_count(), -1);
+            if (_slots[owner] < 0) {
+                _slots[owner] = function.add_slot();
+            }
+            slots[reg] = _slots[owner];
+            statistics.spilled++;
+        }
+    }
+    auto memory = [](RiscvOpcode opcode, MachineRegister reg, int32_t slot) {
+        MachineInstruction inst;
+        inst.opcode = opcode;
+        inst.rs1 = RV_SP;
+        inst.slot = slot;
+        if (opcode == RV_LW) {
+            inst.rd = reg;
+        } else {
+            inst.rs2 = reg;
+        }
+        return inst;
+    };
+    auto fresh = [&]() {
+        auto reg = function.new_register();
+        _unspillable.resize(function.register_count(), false);
+        _unspillable[reg] = true;
+        return reg;
+    };
+
+    for (auto &block: function.blocks) {
+        std::vector<MachineInstruction> rewritten;
+        rewritten.reserve(block.instructions.size());
+        for (auto inst: block.instructions) {
+            if (riscv_has_def(inst.opcode) && riscv_is_virtual(inst.rd) && rematerialized[inst.rd]) {
+                statistics.spill_stores_avoided++;
+                continue;
+            }
+            if (inst.opcode == RV_MV && riscv_is_virtual(inst.rd) && riscv_is_virtual(inst.rs1)
+                && slots[inst.rd] >= 0 && slots[inst.rd] == slots[inst.rs1]) {
+                // a split copy to or from its original, both in the same slot already
+                statistics.moves_removed++;
+                continue;
+            }
+            // one new register per spilled register and instruction, read and written alike
+            MachineRegister spilled_reg = RV_ZERO;
+            MachineRegister replacement = RV_ZERO;
+            MachineRegister *operands[2];
+            auto count = riscv_use_operands(inst, operands);
+            for (int i = 0; i < count; i++) {
+                auto reg = *operands[i];
+                if (!riscv_is_virtual(reg) || (slots[reg] < 0 && !rematerialized[reg])) {
+                    continue;
+                }
+                if (reg != spilled_reg && rematerialized[reg]) {
+                    spilled_reg = reg;
+                    replacement = fresh();
+                    auto recomputed = *_rematerializable[reg];
+                    recomputed.rd = replacement;
+                    rewritten.push_back(recomputed);
+                    statistics.spill_loads_avoided++;
+                } else if (reg != spilled_reg) {
+                    spilled_reg = reg;
+                    replacement = fresh();
+                    rewritten.push_back(memory(RV_LW, replacement, slots[reg]));
+                    statistics.spill_loads++;
+                }
+                *operands[i] = replacement;
+            }
+            int32_t store = -1;
+            if (riscv_has_def(inst.opcode) && riscv_is_virtual(inst.rd) && slots[inst.rd] >= 0) {
+                store = slots[inst.rd];
+                inst.rd = inst.rd == spilled_reg ? replacement : fresh();
+            }
+            rewritten.push_back(inst);
+            if (store >= 0) {
+                rewritten.push_back(memory(RV_SW, inst.rd, store));
+                statistics.spill_stores++;
+            }
+        }
+        block.instructions = std::move(rewritten);
+    }
+}
+
+// endregion
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+#include "register_allocation.h"
+#include "riscv.h"
+
+/**
+ * Interference between registers. Small functions keep a triangular bit matrix for
+ * constant time queries; from BIT_MATRIX_LIMIT registers on that grows too large and a
+ * query searches the shorter adjacency list instead. Adjacency lists are kept for virtual
+ * registers only: physical ones interfere with each other anyway and are never simplified.
+ */
+class InterferenceGraph {
+public:
+    static constexpr size_t BIT_MATRIX_LIMIT = 4096;
+
+    explicit InterferenceGraph(size_t size);
+
+    bool interferes(MachineRegister u, MachineRegister v) const;
+
+    // false if the edge was already there
+    bool add_edge(MachineRegister u, MachineRegister v);
+
+    const std::vector<MachineRegister> &neighbours(MachineRegister reg) const {
+        return _adjacent[reg];
+    }
+
+    bool uses_bit_matrix() const {
+        return !_matrix.empty();
+    }
+
+private:
+    std::vector<uint64_t> _matrix;
+    std::vector<std::vector<MachineRegister>> _adjacent;
+
+    static size_t bit(MachineRegister u, MachineRegister v) {
+        if (u < v) {
+            std::swap(u, v);
+        }
+        return static_cast<size_t>(u) * (u + 1) / 2 + v;
+    }
+};
+
+/**
+ * Iterated register coalescing (George and Appel): simplify, coalesce conservatively,
+ * freeze and spill until the graph is empty, then colour in reverse; spilled registers
+ * get their loads and stores through new short-lived registers and the whole thing runs
+ * again. Briggs' test decides coalescing of two virtual registers and George's test
+ * coalescing into a physical one, such as a0 for the return value.
+ *
+ * The spill candidate is the register with the lowest cost per neighbour, where every
+ * read and write costs 10 to the power of the loop depth of its block. A constant is
+ * cheaper: it is computed again before each read rather than stored and reloaded. When
+ * the first colouring leaves registers over, their live ranges are split around blocks of
+ * high register pressure before anything is spilled, and colouring starts again; a copy
+ * that spills goes to the slot of its original, and a move between the two disappears.
+ */
+class GraphColoring {
+public:
+    RegisterAllocationStatistics run(MachineFunction &function);
+
+private:
+    enum NodeState : uint8_t {
+        NODE_UNUSED,
+        NODE_PRECOLORED,
+        NODE_INITIAL,
+        NODE_SIMPLIFY,
+        NODE_FREEZE,
+        NODE_SPILL,
+        NODE_SPILLED,
+        NODE_COALESCED,
+        NODE_COLORED,
+        NODE_SELECT
+    };
+
+    enum MoveState : uint8_t {
+        MOVE_WORKLIST,
+        MOVE_ACTIVE,
+        MOVE_COALESCED,
+        MOVE_CONSTRAINED,
+        MOVE_FROZEN
+    };
+
+    struct Move {
+        MachineRegister dst;
+        MachineRegister src;
+        MoveState state;
+    };
+
+    MachineFunction *_function = nullptr;
+    size_t _colors = 0;
+    std::unique_ptr<InterferenceGraph> _graph;
+    std::vector<NodeState> _state;
+    std::vector<size_t> _degree;
+    std::vector<MachineRegister> _alias;
+    std::vector<MachineRegister> _color;
+    std::vector<double> _cost;
+    std::vector<std::vector<size_t>> _move_list;
+    std::vector<Move> _moves;
+    // worklists hold stale entries too, a node's state is what counts
+    std::vector<MachineRegister> _simplify;
+    std::vector<MachineRegister> _freeze;
+    std::vector<MachineRegister> _spill;
+    std::vector<size_t> _worklist_moves;
+    std::vector<MachineRegister> _select;
+    // registers made by spilling, which must not be spilled again
+    std::vector<bool> _unspillable;
+    std::vector<std::optional<MachineInstruction>> _rematerializable;
+    // per split copy, the register it stands in for; RV_ZERO for the others
+    std::vector<MachineRegister> _split_from;
+    // per register, the slot it was spilled to over all rounds; a copy shares its original's
+    std::vector<int32_t> _slots;
+
+    bool relevant(MachineRegister reg) const;
+
+    void build();
+
+    void make_worklists();
+
+    void add_edge(MachineRegister u, MachineRegister v);
+
+    // neighbours neither on the select stack nor coalesced away
+    std::vector<MachineRegister> adjacent(MachineRegister reg) const;
+
+    std::vector<size_t> node_moves(MachineRegister reg) const;
+
+    bool move_related(MachineRegister reg) const;
+
+    void simplify();
+
+    void decrement_degree(MachineRegister reg);
+
+    void enable_moves(MachineRegister reg);
+
+    void coalesce();
+
+    void add_worklist(MachineRegister reg);
+
+    // v may be merged into the physical register r
+    bool george(MachineRegister r, MachineRegister v) const;
+
+    // u and v may be merged, both virtual
+    bool briggs(MachineRegister u, MachineRegister v) const;
+
+    MachineRegister alias(MachineRegister reg) const;
+
+    void combine(MachineRegister u, MachineRegister v);
+
+    void freeze();
+
+    void freeze_moves(MachineRegister reg);
+
+    void select_spill();
+
+    // the spilled registers, none if everything got a colour
+    std::vector<MachineRegister> assign_colors();
+
+    void rewrite(const std::vector<MachineRegister> &spilled, RegisterAllocationStatistics &statistics);
+};
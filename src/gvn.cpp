@@ -0,0 +1,118 @@
+#include "gvn.h"
+
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <utility>
+
+void GvnStatistics::print(const std::string &function) const {
+    std::cout << "gvn @" << function << ": " << instructions_eliminated << " instructions eliminated, "
+              << phis_eliminated << " phis eliminated" << std::endl;
+}
+
+GvnStatistics Gvn::run(AnalysisCache &analyses) {
+    _function = &analyses.function();
+    _table.clear();
+    _scope.clear();
+    _statistics = GvnStatistics();
+
+    // an explicit stack, dominator trees of long straight-line code are deep
+    auto &dominators = analyses.dominators();
+    std::vector<std::pair<IrBlockId, size_t>> stack;
+    std::vector<size_t> scope_marks;
+    stack.emplace_back(analyses.cfg().entry(), 0);
+    scope_marks.push_back(_scope.size());
+    number_block(stack.back().first);
+    while (!stack.empty()) {
+        auto &top = stack.back();
+        auto &children = dominators.children(top.first);
+        if (top.second < children.size()) {
+            auto child = children[top.second++];
+            stack.emplace_back(child, 0);
+            scope_marks.push_back(_scope.size());
+            number_block(child);
+            continue;
+        }
+        while (_scope.size() > scope_marks.back()) {
+            _table.erase(_scope.back());
+            _scope.pop_back();
+        }
+        scope_marks.pop_back();
+        stack.pop_back();
+    }
+    return _statistics;
+}
+
+Gvn::Expression Gvn::canonical(IrValueId inst) const {
+    auto &function = *_function;
+    Expression expression{function[inst].opcode, function.operand(inst, 0), function.operand(inst, 1)};
+    if (expression.opcode == IR_GT || expression.opcode == IR_GE) {
+        expression.opcode = expression.opcode == IR_GT ? IR_LT : IR_LE;
+        std::swap(expression.lhs, expression.rhs);
+    } else if (ir_is_commutative(expression.opcode) && expression.lhs > expression.rhs) {
+        std::swap(expression.lhs, expression.rhs);
+    }
+    return expression;
+}
+
+bool Gvn::fold_phi(IrValueId phi) {
+    auto &function = *_function;
+    IrValueId same = 0;
+    for (uint32_t i = 0; i < function[phi].operand_count; i++) {
+        auto operand = function.operand(phi, i);
+        if (operand == phi || operand == same) {
+            continue;
+        }
+        if (same != 0) {
+            return false;
+        }
+        same = operand;
+    }
+    if (same == 0) {
+        return false;
+    }
+    function.replace_all_uses(phi, same);
+    function.erase(phi);
+    return true;
+}
+
+void Gvn::number_block(IrBlockId block) {
+    auto &function = *_function;
+    // phis of one block that merge the same values over the same edges
+    std::map<std::vector<std::pair<IrBlockId, IrValueId>>, IrValueId> phis;
+    for (auto inst: function.block_instructions(block)) {
+        auto opcode = function[inst].opcode;
+        if (opcode == IR_PHI) {
+            if (fold_phi(inst)) {
+                _statistics.phis_eliminated++;
+                continue;
+            }
+            std::vector<std::pair<IrBlockId, IrValueId>> key;
+            for (uint32_t i = 0; i < function[inst].operand_count; i++) {
+                key.emplace_back(function.incoming_block(inst, i), function.operand(inst, i));
+            }
+            std::sort(key.begin(), key.end());
+            auto found = phis.emplace(std::move(key), inst);
+            if (!found.second) {
+                function.replace_all_uses(inst, found.first->second);
+                function.erase(inst);
+                _statistics.phis_eliminated++;
+            }
+            continue;
+        }
+        // a repeated division traps exactly when the first one does, so it is numbered too
+        if (!ir_is_binary(opcode)) {
+            continue;
+        }
+        auto expression = canonical(inst);
+        auto found = _table.find(expression);
+        if (found != _table.end()) {
+            function.replace_all_uses(inst, found->second);
+            function.erase(inst);
+            _statistics.instructions_eliminated++;
+        } else {
+            _table.emplace(expression, inst);
+            _scope.push_back(expression);
+        }
+    }
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "analysis_cache.h"
+#include "ir.h"
+
+class GvnStatistics {
+public:
+    size_t instructions_eliminated = 0;
+    size_t phis_eliminated = 0;
+
+    bool changed() const {
+        return instructions_eliminated + phis_eliminated != 0;
+    }
+
+    void print(const std::string &function) const;
+};
+
+/**
+ * Dominator-based global value numbering (Briggs, Cooper and Simpson). The dominator tree
+ * is walked in preorder with a scoped hash table from expressions to the instruction that
+ * first computed them; an expression already in the table is available on every path, so
+ * the later instruction is replaced by the earlier one.
+ *
+ * Operands are value numbers themselves, since replacing an instruction rewrites its uses
+ * before the walk reaches them. Commutative operands are ordered by id and > / >= are
+ * turned around into < / <=, so a + b meets b + a and a > b meets b < a.
+ */
+class Gvn {
+public:
+    GvnStatistics run(AnalysisCache &analyses);
+
+private:
+    struct Expression {
+        IrOpcode opcode;
+        IrValueId lhs;
+        IrValueId rhs;
+
+        bool operator==(const Expression &other) const {
+            return opcode == other.opcode && lhs == other.lhs && rhs == other.rhs;
+        }
+    };
+
+    struct ExpressionHash {
+        size_t operator()(const Expression &expression) const {
+            return (static_cast<size_t>(expression.lhs) * 0x9e3779b97f4a7c15ull)
+                   ^ (static_cast<size_t>(expression.rhs) << 8) ^ expression.opcode;
+        }
+    };
+
+    IrFunction *_function = nullptr;
+    std::unordered_map<Expression, IrValueId, ExpressionHash> _table;
+    // expressions entered since the walk started, popped when their block is left
+    std::vector<Expression> _scope;
+    GvnStatistics _statistics;
+
+    Expression canonical(IrValueId inst) const;
+
+    void number_block(IrBlockId block);
+
+    // a phi whose operands are all one value (or itself) is that value
+    bool fold_phi(IrValueId phi);
+};
@@ -0,0 +1,520 @@
+#include "ir.h"
+
+#include <cassert>
+#include <climits>
+#include <iostream>
+#include <set>
+#include <sstream>
+
+// region: opcode properties
+
+const char *ir_opcode_name(IrOpcode opcode) {
+    static const char *names[] = {
+            "const", "undef", "alloca", "load", "store",
+            "add", "sub", "mul", "mulh", "div", "rem", "and", "or", "xor", "shl", "shr", "sar",
+            "eq", "ne", "lt", "gt", "le", "ge",
+            "phi", "br", "jump", "ret"
+    };
+    return names[opcode];
+}
+
+bool ir_is_terminator(IrOpcode opcode) {
+    return opcode == IR_BR || opcode == IR_JUMP || opcode == IR_RET;
+}
+
+bool ir_is_binary(IrOpcode opcode) {
+    return opcode >= IR_ADD && opcode <= IR_GE;
+}
+
+bool ir_is_commutative(IrOpcode opcode) {
+    switch (opcode) {
+        case IR_ADD:
+        case IR_MUL:
+        case IR_MULH:
+        case IR_AND:
+        case IR_OR:
+        case IR_XOR:
+        case IR_EQ:
+        case IR_NE:
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool ir_is_pure(IrOpcode opcode) {
+    return ir_is_binary(opcode) && opcode != IR_DIV && opcode != IR_REM;
+}
+
+bool ir_has_side_effects(IrOpcode opcode) {
+    return opcode == IR_STORE || ir_is_terminator(opcode);
+}
+
+bool ir_evaluate(IrOpcode opcode, int32_t lhs, int32_t rhs, int32_t &result) {
+    auto l = static_cast<uint32_t>(lhs);
+    auto r = static_cast<uint32_t>(rhs);
+    switch (opcode) {
+        case IR_ADD:
+            result = static_cast<int32_t>(l + r);
+            return true;
+        case IR_SUB:
+            result = static_cast<int32_t>(l - r);
+            return true;
+        case IR_MUL:
+            result = static_cast<int32_t>(l * r);
+            return true;
+        case IR_MULH:
+            result = static_cast<int32_t>((static_cast<int64_t>(lhs) * rhs) >> 32);
+            return true;
+        case IR_DIV:
+        case IR_REM:
+            if (rhs == 0 || (lhs == INT_MIN && rhs == -1)) {
+                return false;
+            }
+            result = opcode == IR_DIV ? lhs / rhs : lhs % rhs;
+            return true;
+        case IR_AND:
+            result = lhs & rhs;
+            return true;
+        case IR_OR:
+            result = lhs | rhs;
+            return true;
+        case IR_XOR:
+            result = lhs ^ rhs;
+            return true;
+        case IR_SHL:
+            result = static_cast<int32_t>(l << (r & 31u));
+            return true;
+        case IR_SHR:
+            result = static_cast<int32_t>(l >> (r & 31u));
+            return true;
+        case IR_SAR:
+            result = lhs >> (r & 31u);
+            return true;
+        case IR_EQ:
+            result = lhs == rhs;
+            return true;
+        case IR_NE:
+            result = lhs != rhs;
+            return true;
+        case IR_LT:
+            result = lhs < rhs;
+            return true;
+        case IR_GT:
+            result = lhs > rhs;
+            return true;
+        case IR_LE:
+            result = lhs <= rhs;
+            return true;
+        case IR_GE:
+            result = lhs >= rhs;
+            return true;
+        default:
+            return false;
+    }
+}
+
+// endregion
+
+void IrStatistics::print() const {
+    std::cout << "ir: " << instructions << " instructions in " << blocks << " blocks, "
+              << bytes << " bytes, " << bytes_per_instruction() << " bytes per instruction" << std::endl;
+}
+
+IrFunction::IrFunction(const std::string &name) {
+    this->name = name;
+    instructions.push_back(IrInstruction{});
+    uses.push_back(IrUse{});
+    incoming.push_back(0);
+    blocks.emplace_back();
+}
+
+// region: values
+
+IrValueId IrFunction::constant(int32_t value) {
+    auto found = _constants.find(value);
+    if (found != _constants.end()) {
+        return found->second;
+    }
+    auto id = create(IR_CONST, {});
+    instructions[id].immediate = value;
+    _constants[value] = id;
+    return id;
+}
+
+IrValueId IrFunction::undef() {
+    if (_undef == 0) {
+        _undef = create(IR_UNDEF, {});
+    }
+    return _undef;
+}
+
+IrValueId IrFunction::create(IrOpcode opcode, std::initializer_list<IrValueId> operands) {
+    return create(opcode, std::vector<IrValueId>(operands));
+}
+
+IrValueId IrFunction::create(IrOpcode opcode, const std::vector<IrValueId> &operands) {
+    auto id = static_cast<IrValueId>(instructions.size());
+    IrInstruction inst{};
+    inst.opcode = opcode;
+    inst.operand_count = static_cast<uint16_t>(operands.size());
+    inst.operand_begin = static_cast<uint32_t>(uses.size());
+    instructions.push_back(inst);
+    for (auto value: operands) {
+        new_use(value, id, 0);
+    }
+    return id;
+}
+
+uint32_t IrFunction::new_use(IrValueId value, IrValueId user, IrBlockId from) {
+    auto use = static_cast<uint32_t>(uses.size());
+    uses.push_back(IrUse{value, user, 0, 0});
+    incoming.push_back(from);
+    link_use(use);
+    return use;
+}
+
+void IrFunction::link_use(uint32_t use) {
+    auto &record = uses[use];
+    if (record.value == 0) {
+        return;
+    }
+    auto &value = instructions[record.value];
+    record.prev_use = 0;
+    record.next_use = value.first_use;
+    if (value.first_use != 0) {
+        uses[value.first_use].prev_use = use;
+    }
+    value.first_use = use;
+}
+
+void IrFunction::unlink_use(uint32_t use) {
+    auto &record = uses[use];
+    if (record.value == 0) {
+        return;
+    }
+    if (record.prev_use != 0) {
+        uses[record.prev_use].next_use = record.next_use;
+    } else {
+        instructions[record.value].first_use = record.next_use;
+    }
+    if (record.next_use != 0) {
+        uses[record.next_use].prev_use = record.prev_use;
+    }
+    record.prev_use = record.next_use = 0;
+}
+
+void IrFunction::set_operand(IrValueId inst, uint32_t index, IrValueId value) {
+    auto use = instructions[inst].operand_begin + index;
+    unlink_use(use);
+    uses[use].value = value;
+    link_use(use);
+}
+
+void IrFunction::replace_all_uses(IrValueId from, IrValueId to) {
+    if (from == to) {
+        return;
+    }
+    auto use = instructions[from].first_use;
+    if (use == 0) {
+        return;
+    }
+    // retarget every record, then splice the whole list in front of `to`'s list
+    uint32_t tail = 0;
+    for (auto current = use; current != 0; current = uses[current].next_use) {
+        uses[current].value = to;
+        tail = current;
+    }
+    instructions[from].first_use = 0;
+    auto &target = instructions[to];
+    uses[tail].next_use = target.first_use;
+    if (target.first_use != 0) {
+        uses[target.first_use].prev_use = tail;
+    }
+    target.first_use = use;
+}
+
+size_t IrFunction::use_count(IrValueId value) const {
+    size_t count = 0;
+    for (auto use = instructions[value].first_use; use != 0; use = uses[use].next_use) {
+        count++;
+    }
+    return count;
+}
+
+std::vector<IrValueId> IrFunction::users(IrValueId value) const {
+    std::vector<IrValueId> result;
+    for (auto use = instructions[value].first_use; use != 0; use = uses[use].next_use) {
+        result.push_back(uses[use].user);
+    }
+    return result;
+}
+
+void IrFunction::drop_operands(IrValueId inst) {
+    auto &record = instructions[inst];
+    for (uint32_t i = 0; i < record.operand_count; i++) {
+        unlink_use(record.operand_begin + i);
+        uses[record.operand_begin + i].value = 0;
+    }
+    record.operand_count = 0;
+}
+
+// endregion
+
+// region: phis
+
+void IrFunction::add_incoming(IrValueId phi, IrValueId value, IrBlockId block) {
+    auto &inst = instructions[phi];
+    auto end = inst.operand_begin + inst.operand_count;
+    if (inst.operand_count != 0 && end != uses.size()) {
+        // not at the end of the arena any more, move the operand run there
+        auto begin = static_cast<uint32_t>(uses.size());
+        for (uint32_t i = 0; i < inst.operand_count; i++) {
+            auto old_use = inst.operand_begin + i;
+            auto old_value = uses[old_use].value;
+            auto from = incoming[old_use];
+            unlink_use(old_use);
+            uses[old_use].value = 0;
+            new_use(old_value, phi, from);
+        }
+        instructions[phi].operand_begin = begin;
+    } else if (inst.operand_count == 0) {
+        inst.operand_begin = static_cast<uint32_t>(uses.size());
+    }
+    new_use(value, phi, block);
+    instructions[phi].operand_count++;
+}
+
+void IrFunction::remove_incoming(IrValueId phi, IrBlockId block) {
+    auto &inst = instructions[phi];
+    for (uint32_t i = 0; i < inst.operand_count; i++) {
+        if (incoming[inst.operand_begin + i] != block) {
+            continue;
+        }
+        uint32_t last = inst.operand_count - 1u;
+        if (i != last) {
+            set_operand(phi, i, operand(phi, last));
+            incoming[inst.operand_begin + i] = incoming[inst.operand_begin + last];
+        }
+        unlink_use(inst.operand_begin + last);
+        uses[inst.operand_begin + last].value = 0;
+        inst.operand_count--;
+        return;
+    }
+}
+
+// endregion
+
+// region: blocks and placement
+
+IrBlockId IrFunction::add_block(const std::string &name) {
+    auto id = static_cast<IrBlockId>(blocks.size());
+    blocks.emplace_back();
+    blocks.back().name = name;
+    layout.push_back(id);
+    return id;
+}
+
+void IrFunction::append(IrBlockId block, IrValueId inst) {
+    auto &record = instructions[inst];
+    auto &target = blocks[block];
+    record.block = block;
+    record.prev = target.last;
+    record.next = 0;
+    if (target.last != 0) {
+        instructions[target.last].next = inst;
+    } else {
+        target.first = inst;
+    }
+    target.last = inst;
+}
+
+void IrFunction::insert_before(IrValueId position, IrValueId inst) {
+    auto &anchor = instructions[position];
+    auto &record = instructions[inst];
+    record.block = anchor.block;
+    record.prev = anchor.prev;
+    record.next = position;
+    if (anchor.prev != 0) {
+        instructions[anchor.prev].next = inst;
+    } else {
+        blocks[anchor.block].first = inst;
+    }
+    anchor.prev = inst;
+}
+
+void IrFunction::insert_after(IrValueId position, IrValueId inst) {
+    auto next = instructions[position].next;
+    if (next != 0) {
+        insert_before(next, inst);
+    } else {
+        append(instructions[position].block, inst);
+    }
+}
+
+void IrFunction::unlink(IrValueId inst) {
+    auto &record = instructions[inst];
+    if (record.block == 0) {
+        return;
+    }
+    auto &block = blocks[record.block];
+    if (record.prev != 0) {
+        instructions[record.prev].next = record.next;
+    } else {
+        block.first = record.next;
+    }
+    if (record.next != 0) {
+        instructions[record.next].prev = record.prev;
+    } else {
+        block.last = record.prev;
+    }
+    record.block = 0;
+    record.prev = record.next = 0;
+}
+
+void IrFunction::erase(IrValueId inst) {
+    assert(!has_uses(inst));
+    unlink(inst);
+    drop_operands(inst);
+}
+
+void IrFunction::remove_block(IrBlockId block) {
+    // operands first, so values defined and used inside the block become unused
+    for (auto inst: block_instructions(block)) {
+        drop_operands(inst);
+    }
+    for (auto inst: block_instructions(block)) {
+        if (has_uses(inst)) {
+            replace_all_uses(inst, undef());
+        }
+        erase(inst);
+    }
+    blocks[block].removed = true;
+    for (auto it = layout.begin(); it != layout.end(); ++it) {
+        if (*it == block) {
+            layout.erase(it);
+            break;
+        }
+    }
+}
+
+IrValueId IrFunction::terminator(IrBlockId block) const {
+    auto last = blocks[block].last;
+    return last != 0 && ir_is_terminator(instructions[last].opcode) ? last : 0;
+}
+
+std::vector<IrBlockId> IrFunction::successors(IrBlockId block) const {
+    auto last = terminator(block);
+    if (last == 0) {
+        return {};
+    }
+    auto &inst = instructions[last];
+    if (inst.opcode == IR_BR) {
+        if (inst.targets[0] == inst.targets[1]) {
+            return {inst.targets[0]};
+        }
+        return {inst.targets[0], inst.targets[1]};
+    } else if (inst.opcode == IR_JUMP) {
+        return {inst.targets[0]};
+    }
+    return {};
+}
+
+std::vector<IrValueId> IrFunction::block_instructions(IrBlockId block) const {
+    std::vector<IrValueId> result;
+    for (auto inst = blocks[block].first; inst != 0; inst = instructions[inst].next) {
+        result.push_back(inst);
+    }
+    return result;
+}
+
+// endregion
+
+IrStatistics IrFunction::statistics() const {
+    IrStatistics result;
+    for (auto block: layout) {
+        result.blocks++;
+        for (auto inst = blocks[block].first; inst != 0; inst = instructions[inst].next) {
+            result.instructions++;
+        }
+    }
+    result.bytes = instructions.size() * sizeof(IrInstruction)
+                   + uses.size() * sizeof(IrUse)
+                   + incoming.size() * sizeof(IrBlockId);
+    return result;
+}
+
+std::string IrFunction::value_name(IrValueId value) const {
+    auto &inst = instructions[value];
+    if (inst.opcode == IR_CONST) {
+        return std::to_string(inst.immediate);
+    } else if (inst.opcode == IR_UNDEF) {
+        return "undef";
+    }
+    auto found = names.find(value);
+    if (found != names.end()) {
+        return "@" + found->second;
+    }
+    return "%" + std::to_string(value);
+}
+
+void IrFunction::set_name(IrValueId value, const std::string &source_name) {
+    std::set<std::string> taken;
+    for (auto &entry: names) {
+        taken.insert(entry.second);
+    }
+    auto name = source_name;
+    for (int suffix = 1; taken.count(name) != 0; suffix++) {
+        name = source_name + "_" + std::to_string(suffix);
+    }
+    names[value] = name;
+}
+
+std::string IrFunction::dump() const {
+    std::stringstream ss;
+    ss << "fun @" << name << " {" << std::endl;
+    for (auto block: layout) {
+        ss << "%" << blocks[block].name << ":" << std::endl;
+        for (auto id = blocks[block].first; id != 0; id = instructions[id].next) {
+            auto &inst = instructions[id];
+            ss << "  ";
+            if (!ir_has_side_effects(inst.opcode)) {
+                ss << value_name(id) << " = ";
+            }
+            ss << ir_opcode_name(inst.opcode);
+            for (uint32_t i = 0; i < inst.operand_count; i++) {
+                ss << (i == 0 ? " " : ", ") << value_name(operand(id, i));
+                if (inst.opcode == IR_PHI) {
+                    ss << " from %" << blocks[incoming_block(id, i)].name;
+                }
+            }
+            if (inst.opcode == IR_BR) {
+                ss << ", %" << blocks[inst.targets[0]].name << ", %" << blocks[inst.targets[1]].name;
+            } else if (inst.opcode == IR_JUMP) {
+                ss << " %" << blocks[inst.targets[0]].name;
+            }
+            ss << std::endl;
+        }
+    }
+    ss << "}" << std::endl;
+    return ss.str();
+}
+
+IrStatistics IrModule::statistics() const {
+    IrStatistics result;
+    for (auto &function: functions) {
+        auto stats = function->statistics();
+        result.instructions += stats.instructions;
+        result.blocks += stats.blocks;
+        result.bytes += stats.bytes;
+    }
+    return result;
+}
+
+std::string IrModule::dump() const {
+    std::string result;
+    for (auto &function: functions) {
+        result += function->dump();
+    }
+    return result;
+}
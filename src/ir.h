@@ -0,0 +1,351 @@
+#pragma once
+
+#include <cstdint>
+#include <initializer_list>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Index of an instruction in its function's arena; every instruction is also a value. 0 means none.
+typedef uint32_t IrValueId;
+// Index of a block in its function's block table. 0 means none.
+typedef uint32_t IrBlockId;
+
+enum IrOpcode : uint8_t {
+    // values that live outside any block
+    IR_CONST,
+    IR_UNDEF,
+
+    // memory, one 32-bit int per slot
+    IR_ALLOCA,
+    IR_LOAD,    // address
+    IR_STORE,   // value, address
+
+    // arithmetic with 32-bit wrap around
+    IR_ADD,
+    IR_SUB,
+    IR_MUL,
+    IR_MULH,    // signed, high 32 bits of the 64-bit product
+    IR_DIV,
+    IR_REM,
+    IR_AND,
+    IR_OR,
+    IR_XOR,
+    IR_SHL,
+    IR_SHR,     // logical
+    IR_SAR,     // arithmetic
+
+    // comparisons produce 0 or 1
+    IR_EQ,
+    IR_NE,
+    IR_LT,
+    IR_GT,
+    IR_LE,
+    IR_GE,
+
+    IR_PHI,     // one operand per incoming edge, see IrFunction::incoming
+
+    // terminators
+    IR_BR,      // condition; targets[0] if non-zero, targets[1] otherwise
+    IR_JUMP,    // targets[0]
+    IR_RET      // value
+};
+
+/**
+ * 32 bytes. Operands are not stored inline: they are a contiguous run of IrUse records
+ * in the function's use arena, which at the same time threads every use of a value
+ * into that value's use-list.
+ */
+struct IrInstruction {
+    IrOpcode opcode;
+    uint8_t flags;
+    uint16_t operand_count;
+    uint32_t operand_begin;
+    IrBlockId block;        // 0 while not placed, and always for constants
+    IrValueId prev;         // intrusive list of the block's instructions
+    IrValueId next;
+    uint32_t first_use;     // head of this value's use-list, 0 if unused
+    union {
+        int32_t immediate;          // IR_CONST
+        IrBlockId targets[2];       // IR_BR, IR_JUMP
+    };
+};
+
+// One operand slot of `user`, linked into the use-list of `value`. 16 bytes.
+struct IrUse {
+    IrValueId value;
+    IrValueId user;
+    uint32_t prev_use;
+    uint32_t next_use;
+};
+
+struct IrBlock {
+    std::string name;
+    IrValueId first = 0;
+    IrValueId last = 0;
+    bool removed = false;
+};
+
+class IrStatistics {
+public:
+    size_t instructions = 0;
+    size_t blocks = 0;
+    size_t bytes = 0;
+
+    double bytes_per_instruction() const {
+        return instructions == 0 ? 0 : static_cast<double>(bytes) / static_cast<double>(instructions);
+    }
+
+    void print() const;
+};
+
+/**
+ * A function in SSA form. Instructions, operands and blocks live in per-function arenas
+ * (plain vectors) and refer to each other by 32-bit ids, so the whole function is a
+ * handful of allocations and ids stay valid while the arenas grow.
+ */
+class IrFunction {
+public:
+    std::string name;
+
+    // arenas; slot 0 of each is a sentinel so that id 0 can mean "none"
+    std::vector<IrInstruction> instructions;
+    std::vector<IrUse> uses;
+    // for phi operands, the predecessor block an operand flows in from; parallel to `uses`
+    std::vector<IrBlockId> incoming;
+    std::vector<IrBlock> blocks;
+
+    // emission order of the blocks, entry first
+    std::vector<IrBlockId> layout;
+
+    // source names of allocas, for dumps and Koopa output
+    std::map<IrValueId, std::string> names;
+
+    explicit IrFunction(const std::string &name);
+
+    IrBlockId entry() const {
+        return layout.empty() ? 0 : layout.front();
+    }
+
+    IrInstruction &operator[](IrValueId id) {
+        return instructions[id];
+    }
+
+    const IrInstruction &operator[](IrValueId id) const {
+        return instructions[id];
+    }
+
+    // region: values
+
+    // hash-consed, one instruction per distinct constant
+    IrValueId constant(int32_t value);
+
+    IrValueId undef();
+
+    bool is_constant(IrValueId value) const {
+        return instructions[value].opcode == IR_CONST;
+    }
+
+    int32_t constant_value(IrValueId value) const {
+        return instructions[value].immediate;
+    }
+
+    // a new instruction, not yet placed in any block
+    IrValueId create(IrOpcode opcode, std::initializer_list<IrValueId> operands);
+
+    IrValueId create(IrOpcode opcode, const std::vector<IrValueId> &operands);
+
+    IrValueId operand(IrValueId inst, uint32_t index) const {
+        return uses[instructions[inst].operand_begin + index].value;
+    }
+
+    void set_operand(IrValueId inst, uint32_t index, IrValueId value);
+
+    // every use of `from` is rewritten to `to`, use-lists are spliced rather than rebuilt
+    void replace_all_uses(IrValueId from, IrValueId to);
+
+    bool has_uses(IrValueId value) const {
+        return instructions[value].first_use != 0;
+    }
+
+    size_t use_count(IrValueId value) const;
+
+    // the instructions using `value`, one entry per operand slot
+    std::vector<IrValueId> users(IrValueId value) const;
+
+    // endregion
+
+    // region: phis
+
+    IrBlockId incoming_block(IrValueId phi, uint32_t index) const {
+        return incoming[instructions[phi].operand_begin + index];
+    }
+
+    void set_incoming_block(IrValueId phi, uint32_t index, IrBlockId block) {
+        incoming[instructions[phi].operand_begin + index] = block;
+    }
+
+    void add_incoming(IrValueId phi, IrValueId value, IrBlockId block);
+
+    // drops the operand flowing in from `block`, if any
+    void remove_incoming(IrValueId phi, IrBlockId block);
+
+    // endregion
+
+    // region: blocks and placement
+
+    IrBlockId add_block(const std::string &name);
+
+    void append(IrBlockId block, IrValueId inst);
+
+    void insert_before(IrValueId position, IrValueId inst);
+
+    void insert_after(IrValueId position, IrValueId inst);
+
+    // unlinks from the block but keeps operands, for moving an instruction elsewhere
+    void unlink(IrValueId inst);
+
+    // unlinks and drops all operands; the value must be unused
+    void erase(IrValueId inst);
+
+    // erases every instruction and takes the block out of the layout
+    void remove_block(IrBlockId block);
+
+    // the terminator closing `block`, 0 if the block is still open
+    IrValueId terminator(IrBlockId block) const;
+
+    std::vector<IrBlockId> successors(IrBlockId block) const;
+
+    // instructions of `block` in order; safe against erasing the visited instruction
+    std::vector<IrValueId> block_instructions(IrBlockId block) const;
+
+    // endregion
+
+    IrStatistics statistics() const;
+
+    std::string dump() const;
+
+    std::string value_name(IrValueId value) const;
+
+    // records the source variable an alloca holds; where another value of the function already
+    // has that name, shadowing or a source name such as a_1, the first free name_N is used
+    void set_name(IrValueId value, const std::string &source_name);
+
+private:
+    std::unordered_map<int32_t, IrValueId> _constants;
+    IrValueId _undef = 0;
+
+    uint32_t new_use(IrValueId value, IrValueId user, IrBlockId from);
+
+    void link_use(uint32_t use);
+
+    void unlink_use(uint32_t use);
+
+    void drop_operands(IrValueId inst);
+};
+
+class IrModule {
+public:
+    std::vector<std::unique_ptr<IrFunction>> functions;
+
+    IrStatistics statistics() const;
+
+    std::string dump() const;
+};
+
+/**
+ * Appends instructions to the end of a current block; the small convenience layer used by
+ * lowering and by tests.
+ */
+class IrBuilder {
+private:
+    IrFunction *_function;
+    IrBlockId _block = 0;
+
+public:
+    explicit IrBuilder(IrFunction *function) : _function(function) {
+    }
+
+    void set_block(IrBlockId block) {
+        _block = block;
+    }
+
+    IrBlockId block() const {
+        return _block;
+    }
+
+    // true once the current block has its terminator
+    bool closed() const {
+        return _block == 0 || _function->terminator(_block) != 0;
+    }
+
+    IrValueId constant(int32_t value) {
+        return _function->constant(value);
+    }
+
+    IrValueId emit(IrOpcode opcode, std::initializer_list<IrValueId> operands) {
+        auto inst = _function->create(opcode, operands);
+        _function->append(_block, inst);
+        return inst;
+    }
+
+    IrValueId alloca_slot() {
+        return emit(IR_ALLOCA, {});
+    }
+
+    IrValueId load(IrValueId address) {
+        return emit(IR_LOAD, {address});
+    }
+
+    IrValueId store(IrValueId value, IrValueId address) {
+        return emit(IR_STORE, {value, address});
+    }
+
+    IrValueId binary(IrOpcode opcode, IrValueId lhs, IrValueId rhs) {
+        return emit(opcode, {lhs, rhs});
+    }
+
+    IrValueId phi() {
+        return emit(IR_PHI, {});
+    }
+
+    IrValueId branch(IrValueId condition, IrBlockId if_true, IrBlockId if_false) {
+        auto inst = emit(IR_BR, {condition});
+        (*_function)[inst].targets[0] = if_true;
+        (*_function)[inst].targets[1] = if_false;
+        return inst;
+    }
+
+    IrValueId jump(IrBlockId target) {
+        auto inst = emit(IR_JUMP, {});
+        (*_function)[inst].targets[0] = target;
+        return inst;
+    }
+
+    IrValueId ret(IrValueId value) {
+        return emit(IR_RET, {value});
+    }
+};
+
+// region: opcode properties
+
+const char *ir_opcode_name(IrOpcode opcode);
+
+bool ir_is_terminator(IrOpcode opcode);
+
+bool ir_is_binary(IrOpcode opcode);
+
+bool ir_is_commutative(IrOpcode opcode);
+
+// no side effects, no trap and no memory access: may be computed speculatively or merged
+bool ir_is_pure(IrOpcode opcode);
+
+// must be kept even when its value is unused
+bool ir_has_side_effects(IrOpcode opcode);
+
+// folds a binary opcode with 32-bit wrap around; false for division by zero and INT_MIN / -1
+bool ir_evaluate(IrOpcode opcode, int32_t lhs, int32_t rhs, int32_t &result);
+
+// endregion
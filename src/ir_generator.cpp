@@ -0,0 +1,361 @@
+#include "ir_generator.h"
+
+#include <cassert>
+
+std::unique_ptr<IrModule> IrGenerator::generate(BaseAST *root) {
+    auto module = std::make_unique<IrModule>();
+    auto comp_unit = dynamic_cast<CompUnitAST *>(root);
+    assert(comp_unit);
+    auto func_def = dynamic_cast<FuncDefAST *>(comp_unit->func_def.get());
+    module->functions.push_back(std::make_unique<IrFunction>(func_def->ident));
+    _function = module->functions.back().get();
+    generate_function(func_def);
+    return module;
+}
+
+// region: emission helpers
+
+IrBlockId IrGenerator::new_block(const std::string &prefix) {
+    return _function->add_block(prefix + "_" + std::to_string(_block_counter++));
+}
+
+void IrGenerator::ensure_open() {
+    if (_builder->closed()) {
+        // code after a return, it still needs a block of its own
+        _builder->set_block(new_block("unreachable"));
+    }
+}
+
+IrValueId IrGenerator::emit_binary(IrOpcode opcode, IrValueId lhs, IrValueId rhs) {
+    ensure_open();
+    return _builder->binary(opcode, lhs, rhs);
+}
+
+// endregion
+
+void IrGenerator::generate_function(FuncDefAST *func_def) {
+    _builder = std::make_unique<IrBuilder>(_function);
+    _scopes.clear();
+    _block_counter = 0;
+    _last_alloca = 0;
+
+    _builder->set_block(_function->add_block("entry"));
+    generate_block(dynamic_cast<BlockAST *>(func_def->block.get()));
+
+    // falling off the end of int main() returns 0
+    if (!_builder->closed()) {
+        _builder->ret(_function->constant(0));
+    }
+}
+
+void IrGenerator::generate_block(BlockAST *block) {
+    _scopes.emplace_back();
+    auto list = dynamic_cast<BlockItemListAST *>(block->block_item_list.get());
+    for (auto &item: list->list) {
+        auto block_item = dynamic_cast<BlockItemAST *>(item.get());
+        if (block_item->choice == STATEMENT) {
+            generate_statement(dynamic_cast<StmtAST *>(block_item->statement.get()));
+        } else {
+            generate_declaration(block_item->declaration.get());
+        }
+        if (_builder->closed()) {
+            // the rest of the block follows a return and can never run
+            break;
+        }
+    }
+    _scopes.pop_back();
+}
+
+void IrGenerator::generate_statement(StmtAST *stmt) {
+    if (stmt->choice == ASSIGNMENT_STATEMENT) {
+        auto value = generate_expression(stmt->exp.get());
+        ensure_open();
+        _builder->store(value, lookup(dynamic_cast<LValAST *>(stmt->left_value.get())->ident));
+    } else if (stmt->choice == RETURN_STATEMENT) {
+        auto value = generate_expression(stmt->exp.get());
+        ensure_open();
+        _builder->ret(value);
+    } else if (stmt->choice == EXPRESSION_STATEMENT) {
+        generate_expression(stmt->exp.get());
+    } else if (stmt->choice == BLOCK_STATEMENT) {
+        generate_block(dynamic_cast<BlockAST *>(stmt->block.get()));
+    } else if (stmt->choice == IF_STATEMENT || stmt->choice == IF_ELSE_STATEMENT) {
+        auto then_block = new_block("then");
+        auto else_block = stmt->choice == IF_ELSE_STATEMENT ? new_block("else") : 0;
+        auto end_block = new_block("end");
+
+        generate_condition(stmt->exp.get(), then_block, else_block != 0 ? else_block : end_block);
+
+        _builder->set_block(then_block);
+        generate_statement(dynamic_cast<StmtAST *>(stmt->if_statement.get()));
+        if (!_builder->closed()) {
+            _builder->jump(end_block);
+        }
+        if (else_block != 0) {
+            _builder->set_block(else_block);
+            generate_statement(dynamic_cast<StmtAST *>(stmt->else_statement.get()));
+            if (!_builder->closed()) {
+                _builder->jump(end_block);
+            }
+        }
+        _builder->set_block(end_block);
+    }
+    // EMPTY_STATEMENT generates nothing
+}
+
+void IrGenerator::generate_declaration(BaseAST *node) {
+    if (auto declaration = dynamic_cast<DeclarationAST *>(node)) {
+        generate_declaration(declaration->choice == CONST_DECLARATION ? declaration->const_declaration.get()
+                                                                      : declaration->var_declaration.get());
+    } else if (auto const_decl = dynamic_cast<ConstDeclarationAST *>(node)) {
+        generate_declaration(const_decl->const_definition_list.get());
+    } else if (auto var_decl = dynamic_cast<VarDeclarationAST *>(node)) {
+        generate_declaration(var_decl->var_definition_list.get());
+    } else if (auto const_list = dynamic_cast<ConstDefinitionListAST *>(node)) {
+        for (auto child: const_list->children()) {
+            generate_declaration(child);
+        }
+    } else if (auto var_list = dynamic_cast<VarDefinitionListAST *>(node)) {
+        for (auto child: var_list->children()) {
+            generate_declaration(child);
+        }
+    } else if (auto const_def = dynamic_cast<ConstDefinitionAST *>(node)) {
+        // a const needs no storage, uses refer to its value directly
+        _scopes.back()[const_def->ident] = generate_expression(const_def->const_initialization_expression.get());
+    } else if (auto var_def = dynamic_cast<VarDefinitionAST *>(node)) {
+        auto slot = _function->create(IR_ALLOCA, {});
+        if (_last_alloca == 0) {
+            auto entry = _function->entry();
+            auto first = _function->blocks[entry].first;
+            if (first != 0) {
+                _function->insert_before(first, slot);
+            } else {
+                _function->append(entry, slot);
+            }
+        } else {
+            _function->insert_after(_last_alloca, slot);
+        }
+        _last_alloca = slot;
+        _function->set_name(slot, var_def->ident);
+
+        auto value = generate_expression(var_def->var_initialization_expression.get());
+        ensure_open();
+        _builder->store(value, slot);
+        _scopes.back()[var_def->ident] = slot;
+    }
+}
+
+IrValueId IrGenerator::lookup(const std::string &ident) {
+    for (auto scope = _scopes.rbegin(); scope != _scopes.rend(); ++scope) {
+        auto found = scope->find(ident);
+        if (found != scope->end()) {
+            return found->second;
+        }
+    }
+    std::cerr << "undefined identifier: " << ident << std::endl;
+    assert(false);
+    return 0;
+}
+
+static IrOpcode binary_opcode(const std::string &op) {
+    static const std::map<std::string, IrOpcode> opcodes = {
+            {"+",  IR_ADD},
+            {"-",  IR_SUB},
+            {"*",  IR_MUL},
+            {"/",  IR_DIV},
+            {"%",  IR_REM},
+            {"<",  IR_LT},
+            {">",  IR_GT},
+            {"<=", IR_LE},
+            {">=", IR_GE},
+            {"==", IR_EQ},
+            {"!=", IR_NE},
+    };
+    return opcodes.at(op);
+}
+
+IrValueId IrGenerator::generate_expression(BaseAST *node) {
+    if (auto exp = dynamic_cast<ExpAST *>(node)) {
+        return generate_expression(exp->lor_exp.get());
+    } else if (auto const_init = dynamic_cast<ConstInitializationExpressionAST *>(node)) {
+        return generate_expression(const_init->const_expression.get());
+    } else if (auto const_exp = dynamic_cast<ConstExpressionAST *>(node)) {
+        return generate_expression(const_exp->expression.get());
+    } else if (auto var_init = dynamic_cast<VarInitializationExpressionAST *>(node)) {
+        return generate_expression(var_init->var_expression.get());
+    } else if (auto var_exp = dynamic_cast<VarExpressionAST *>(node)) {
+        return generate_expression(var_exp->expression.get());
+    }
+
+    std::string logical_op;
+    BaseAST *lhs = nullptr;
+    BaseAST *rhs = nullptr;
+    if (auto lor = dynamic_cast<LOrExpAST *>(node)) {
+        if (lor->choice == LAND_EXP) {
+            return generate_expression(lor->land_exp.get());
+        }
+        logical_op = lor->lor_op;
+        lhs = lor->lor_exp.get();
+        rhs = lor->land_exp.get();
+    } else if (auto land = dynamic_cast<LAndExpAST *>(node)) {
+        if (land->choice == EQEXP) {
+            return generate_expression(land->eq_exp.get());
+        }
+        logical_op = land->land_op;
+        lhs = land->land_exp.get();
+        rhs = land->eq_exp.get();
+    }
+    if (!logical_op.empty()) {
+        return generate_logical(logical_op, lhs, rhs);
+    }
+
+    if (auto eq = dynamic_cast<EqExpAST *>(node)) {
+        if (eq->choice == RELEXP) {
+            return generate_expression(eq->rel_exp.get());
+        }
+        auto left = generate_expression(eq->eq_exp.get());
+        return emit_binary(binary_opcode(eq->eq_op), left, generate_expression(eq->rel_exp.get()));
+    } else if (auto rel = dynamic_cast<RelExpAST *>(node)) {
+        if (rel->choice == ADDEXP) {
+            return generate_expression(rel->add_exp.get());
+        }
+        auto left = generate_expression(rel->rel_exp.get());
+        return emit_binary(binary_opcode(rel->rel_op), left, generate_expression(rel->add_exp.get()));
+    } else if (auto add = dynamic_cast<AddExpAST *>(node)) {
+        if (add->choice == MULEXP) {
+            return generate_expression(add->mul_exp.get());
+        }
+        auto left = generate_expression(add->add_exp.get());
+        return emit_binary(binary_opcode(add->add_op), left, generate_expression(add->mul_exp.get()));
+    } else if (auto mul = dynamic_cast<MulExpAST *>(node)) {
+        if (mul->choice == UNARYEXP) {
+            return generate_expression(mul->unary_exp.get());
+        }
+        auto left = generate_expression(mul->mul_exp.get());
+        return emit_binary(binary_opcode(mul->mul_op), left, generate_expression(mul->unary_exp.get()));
+    } else if (auto unary = dynamic_cast<UnaryExpAST *>(node)) {
+        if (unary->choice == PRIMARY) {
+            return generate_expression(unary->primary_exp.get());
+        }
+        auto op = dynamic_cast<UnaryOpAST *>(unary->unary_op.get())->op;
+        auto operand = generate_expression(unary->unary_exp.get());
+        if (op == "-") {
+            return emit_binary(IR_SUB, _function->constant(0), operand);
+        } else if (op == "!") {
+            return emit_binary(IR_EQ, operand, _function->constant(0));
+        }
+        return operand;
+    } else if (auto primary = dynamic_cast<PrimaryExpAST *>(node)) {
+        if (primary->choice == NUMBER) {
+            return _function->constant(primary->number);
+        } else if (primary->choice == EXP) {
+            return generate_expression(primary->exp.get());
+        }
+        auto value = lookup(dynamic_cast<LValAST *>(primary->left_value.get())->ident);
+        if ((*_function)[value].opcode != IR_ALLOCA) {
+            return value;
+        }
+        ensure_open();
+        return _builder->load(value);
+    }
+    std::cerr << "unexpected expression node" << std::endl;
+    assert(false);
+    return 0;
+}
+
+// the node below chains of single-child wrappers, e.g. the LOrExp under `(a || b)` in an if
+static BaseAST *strip_wrappers(BaseAST *node) {
+    while (true) {
+        if (auto exp = dynamic_cast<ExpAST *>(node)) {
+            node = exp->lor_exp.get();
+        } else if (auto lor = dynamic_cast<LOrExpAST *>(node); lor != nullptr && lor->choice == LAND_EXP) {
+            node = lor->land_exp.get();
+        } else if (auto land = dynamic_cast<LAndExpAST *>(node); land != nullptr && land->choice == EQEXP) {
+            node = land->eq_exp.get();
+        } else if (auto eq = dynamic_cast<EqExpAST *>(node); eq != nullptr && eq->choice == RELEXP) {
+            node = eq->rel_exp.get();
+        } else if (auto rel = dynamic_cast<RelExpAST *>(node); rel != nullptr && rel->choice == ADDEXP) {
+            node = rel->add_exp.get();
+        } else if (auto add = dynamic_cast<AddExpAST *>(node); add != nullptr && add->choice == MULEXP) {
+            node = add->mul_exp.get();
+        } else if (auto mul = dynamic_cast<MulExpAST *>(node); mul != nullptr && mul->choice == UNARYEXP) {
+            node = mul->unary_exp.get();
+        } else if (auto unary = dynamic_cast<UnaryExpAST *>(node); unary != nullptr && unary->choice == PRIMARY) {
+            node = unary->primary_exp.get();
+        } else if (auto primary = dynamic_cast<PrimaryExpAST *>(node); primary != nullptr && primary->choice == EXP) {
+            node = primary->exp.get();
+        } else {
+            return node;
+        }
+    }
+}
+
+void IrGenerator::generate_condition(BaseAST *node, IrBlockId if_true, IrBlockId if_false) {
+    node = strip_wrappers(node);
+    // the grammar also accepts || at the precedence of &&, the operator string decides
+    std::string op;
+    BaseAST *lhs = nullptr;
+    BaseAST *rhs = nullptr;
+    if (auto lor = dynamic_cast<LOrExpAST *>(node)) {
+        op = lor->lor_op;
+        lhs = lor->lor_exp.get();
+        rhs = lor->land_exp.get();
+    } else if (auto land = dynamic_cast<LAndExpAST *>(node)) {
+        op = land->land_op;
+        lhs = land->land_exp.get();
+        rhs = land->eq_exp.get();
+    }
+    if (op == "||") {
+        // a true left side decides it, only a false one looks at the right side
+        auto rhs_block = new_block("or_rhs");
+        generate_condition(lhs, if_true, rhs_block);
+        _builder->set_block(rhs_block);
+        generate_condition(rhs, if_true, if_false);
+        return;
+    } else if (op == "&&") {
+        auto rhs_block = new_block("and_rhs");
+        generate_condition(lhs, rhs_block, if_false);
+        _builder->set_block(rhs_block);
+        generate_condition(rhs, if_true, if_false);
+        return;
+    } else if (auto unary = dynamic_cast<UnaryExpAST *>(node)) {
+        if (dynamic_cast<UnaryOpAST *>(unary->unary_op.get())->op == "!") {
+            generate_condition(unary->unary_exp.get(), if_false, if_true);
+            return;
+        }
+    }
+
+    // br tests for non-zero itself, the value needs no normalising
+    auto condition = generate_expression(node);
+    ensure_open();
+    if (_function->is_constant(condition)) {
+        _builder->jump(_function->constant_value(condition) != 0 ? if_true : if_false);
+    } else {
+        _builder->branch(condition, if_true, if_false);
+    }
+}
+
+IrValueId IrGenerator::generate_logical(const std::string &op, BaseAST *lhs, BaseAST *rhs) {
+    auto is_and = op == "&&";
+    auto left = generate_expression(lhs);
+    ensure_open();
+    auto rhs_block = new_block(is_and ? "and_rhs" : "or_rhs");
+    auto end_block = new_block(is_and ? "and_end" : "or_end");
+    auto left_exit = _builder->block();
+    if (is_and) {
+        _builder->branch(left, rhs_block, end_block);
+    } else {
+        _builder->branch(left, end_block, rhs_block);
+    }
+
+    _builder->set_block(rhs_block);
+    auto right = emit_binary(IR_NE, generate_expression(rhs), _function->constant(0));
+    auto right_exit = _builder->block();
+    _builder->jump(end_block);
+
+    _builder->set_block(end_block);
+    auto result = _builder->phi();
+    _function->add_incoming(result, _function->constant(is_and ? 0 : 1), left_exit);
+    _function->add_incoming(result, right, right_exit);
+    return result;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Ast.h"
+#include "ir.h"
+
+/**
+ * Lowers the AST into the native SSA IR. Variables still live in allocas here, every read
+ * is a load and every write a store; promoting them to SSA values is left to the optimiser.
+ */
+class IrGenerator {
+public:
+    std::unique_ptr<IrModule> generate(BaseAST *root);
+
+private:
+    IrFunction *_function = nullptr;
+    std::unique_ptr<IrBuilder> _builder;
+    // allocas are gathered at the top of the entry block, the last one placed so far
+    IrValueId _last_alloca = 0;
+    // name -> alloca of a variable, or the value of a const
+    std::vector<std::map<std::string, IrValueId>> _scopes;
+    int _block_counter = 0;
+
+    IrBlockId new_block(const std::string &prefix);
+
+    // the current block, or a fresh one when the last instruction was a terminator
+    void ensure_open();
+
+    IrValueId emit_binary(IrOpcode opcode, IrValueId lhs, IrValueId rhs);
+
+    void generate_function(FuncDefAST *func_def);
+
+    void generate_block(BlockAST *block);
+
+    void generate_statement(StmtAST *stmt);
+
+    void generate_declaration(BaseAST *node);
+
+    IrValueId generate_expression(BaseAST *node);
+
+    // branches to `if_true` or `if_false` on the truth of `node`, && and || short-circuit
+    void generate_condition(BaseAST *node, IrBlockId if_true, IrBlockId if_false);
+
+    // && or || as a 0/1 value: the right side in a block of its own, merged by a phi
+    IrValueId generate_logical(const std::string &op, BaseAST *lhs, BaseAST *rhs);
+
+    IrValueId lookup(const std::string &ident);
+};
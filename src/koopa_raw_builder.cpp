@@ -0,0 +1,229 @@
+#include "koopa_raw_builder.h"
+
+#include <cassert>
+
+const koopa_raw_program_t &KoopaRawBuilder::build(const IrModule &module) {
+    auto functions = new_buffer();
+    for (auto &function: module.functions) {
+        build_function(*function);
+        functions->push_back(&_functions.back());
+    }
+    _program.values = slice(new_buffer(), KOOPA_RSIK_VALUE);
+    _program.funcs = slice(functions, KOOPA_RSIK_FUNCTION);
+    return _program;
+}
+
+// region: raw structure helpers
+
+koopa_raw_type_t KoopaRawBuilder::type(koopa_raw_type_tag_t tag, koopa_raw_type_t base) {
+    _types.emplace_back();
+    auto &result = _types.back();
+    result.tag = tag;
+    if (tag == KOOPA_RTT_POINTER) {
+        result.data.pointer.base = base;
+    } else if (tag == KOOPA_RTT_FUNCTION) {
+        result.data.function.params = slice(new_buffer(), KOOPA_RSIK_TYPE);
+        result.data.function.ret = base;
+    }
+    return &result;
+}
+
+std::vector<const void *> *KoopaRawBuilder::new_buffer() {
+    _buffers.emplace_back();
+    return &_buffers.back();
+}
+
+koopa_raw_slice_t KoopaRawBuilder::slice(std::vector<const void *> *items, koopa_raw_slice_item_kind_t kind) {
+    koopa_raw_slice_t result;
+    result.buffer = items->empty() ? nullptr : items->data();
+    result.len = static_cast<uint32_t>(items->size());
+    result.kind = kind;
+    return result;
+}
+
+const char *KoopaRawBuilder::name(const std::string &text) {
+    _names.push_back(text);
+    return _names.back().c_str();
+}
+
+koopa_raw_value_data_t *KoopaRawBuilder::new_value(koopa_raw_type_t type, koopa_raw_value_tag_t tag) {
+    _values.emplace_back();
+    auto value = &_values.back();
+    value->ty = type;
+    value->name = nullptr;
+    value->used_by = slice(new_buffer(), KOOPA_RSIK_VALUE);
+    value->kind.tag = tag;
+    return value;
+}
+
+koopa_raw_value_t KoopaRawBuilder::operand(IrValueId value) {
+    auto &inst = (*_function)[value];
+    if (inst.opcode == IR_CONST) {
+        auto result = new_value(type(KOOPA_RTT_INT32), KOOPA_RVT_INTEGER);
+        result->kind.data.integer.value = inst.immediate;
+        return result;
+    } else if (inst.opcode == IR_UNDEF) {
+        return new_value(type(KOOPA_RTT_INT32), KOOPA_RVT_UNDEF);
+    }
+    assert(_lowered[value] != nullptr);
+    return _lowered[value];
+}
+
+koopa_raw_slice_t KoopaRawBuilder::arguments(IrBlockId from, IrBlockId target) {
+    auto &function = *_function;
+    auto result = new_buffer();
+    for (auto phi = function.blocks[target].first; phi != 0 && function[phi].opcode == IR_PHI;
+         phi = function[phi].next) {
+        koopa_raw_value_t argument = nullptr;
+        for (uint32_t j = 0; j < function[phi].operand_count; j++) {
+            if (function.incoming_block(phi, j) == from) {
+                argument = operand(function.operand(phi, j));
+            }
+        }
+        result->push_back(argument != nullptr ? argument : new_value(type(KOOPA_RTT_INT32), KOOPA_RVT_UNDEF));
+    }
+    return slice(result, KOOPA_RSIK_VALUE);
+}
+
+// endregion
+
+static koopa_raw_binary_op_t koopa_operator(IrOpcode opcode) {
+    switch (opcode) {
+        case IR_ADD:
+            return KOOPA_RBO_ADD;
+        case IR_SUB:
+            return KOOPA_RBO_SUB;
+        case IR_MUL:
+            return KOOPA_RBO_MUL;
+        case IR_DIV:
+            return KOOPA_RBO_DIV;
+        case IR_REM:
+            return KOOPA_RBO_MOD;
+        case IR_AND:
+            return KOOPA_RBO_AND;
+        case IR_OR:
+            return KOOPA_RBO_OR;
+        case IR_XOR:
+            return KOOPA_RBO_XOR;
+        case IR_SHL:
+            return KOOPA_RBO_SHL;
+        case IR_SHR:
+            return KOOPA_RBO_SHR;
+        case IR_SAR:
+            return KOOPA_RBO_SAR;
+        case IR_EQ:
+            return KOOPA_RBO_EQ;
+        case IR_NE:
+            return KOOPA_RBO_NOT_EQ;
+        case IR_LT:
+            return KOOPA_RBO_LT;
+        case IR_GT:
+            return KOOPA_RBO_GT;
+        case IR_LE:
+            return KOOPA_RBO_LE;
+        case IR_GE:
+            return KOOPA_RBO_GE;
+        default:
+            // Koopa has no high multiply, divisions must stay divisions for this output
+            assert(false);
+            return KOOPA_RBO_ADD;
+    }
+}
+
+void KoopaRawBuilder::build_function(const IrFunction &function) {
+    _function = &function;
+    _lowered.assign(function.instructions.size(), nullptr);
+    _lowered_blocks.assign(function.blocks.size(), nullptr);
+
+    _functions.emplace_back();
+    auto &raw = _functions.back();
+    raw.ty = type(KOOPA_RTT_FUNCTION, type(KOOPA_RTT_INT32));
+    raw.name = name("@" + function.name);
+    raw.params = slice(new_buffer(), KOOPA_RSIK_VALUE);
+
+    // every block and value exists before any is filled in: branches lead to blocks further
+    // down, and a value may be laid out after a block it dominates
+    auto blocks = new_buffer();
+    for (auto block: function.layout) {
+        _blocks.emplace_back();
+        auto &raw_block = _blocks.back();
+        raw_block.name = name("%" + function.blocks[block].name);
+        raw_block.used_by = slice(new_buffer(), KOOPA_RSIK_VALUE);
+        auto parameters = new_buffer();
+        for (auto id = function.blocks[block].first; id != 0; id = function[id].next) {
+            auto opcode = function[id].opcode;
+            if (opcode == IR_PHI) {
+                _lowered[id] = new_value(type(KOOPA_RTT_INT32), KOOPA_RVT_BLOCK_ARG_REF);
+                _lowered[id]->kind.data.block_arg_ref.index = parameters->size();
+                parameters->push_back(_lowered[id]);
+            } else if (opcode == IR_ALLOCA) {
+                _lowered[id] = new_value(type(KOOPA_RTT_POINTER, type(KOOPA_RTT_INT32)), KOOPA_RVT_ALLOC);
+                auto source = function.names.find(id);
+                if (source != function.names.end()) {
+                    _lowered[id]->name = name("@" + source->second);
+                }
+            } else if (opcode == IR_LOAD) {
+                _lowered[id] = new_value(type(KOOPA_RTT_INT32), KOOPA_RVT_LOAD);
+            } else if (ir_is_binary(opcode)) {
+                _lowered[id] = new_value(type(KOOPA_RTT_INT32), KOOPA_RVT_BINARY);
+            }
+        }
+        raw_block.params = slice(parameters, KOOPA_RSIK_VALUE);
+        _lowered_blocks[block] = &raw_block;
+        blocks->push_back(&raw_block);
+    }
+
+    for (auto block: function.layout) {
+        auto instructions = new_buffer();
+        for (auto id = function.blocks[block].first; id != 0; id = function[id].next) {
+            if (function[id].opcode != IR_PHI) {
+                build_instruction(id, block);
+                instructions->push_back(_lowered[id]);
+            }
+        }
+        _lowered_blocks[block]->insts = slice(instructions, KOOPA_RSIK_VALUE);
+    }
+    raw.bbs = slice(blocks, KOOPA_RSIK_BASIC_BLOCK);
+}
+
+void KoopaRawBuilder::build_instruction(IrValueId id, IrBlockId block) {
+    auto &function = *_function;
+    auto &inst = function[id];
+    switch (inst.opcode) {
+        case IR_ALLOCA:
+            break;
+        case IR_LOAD:
+            _lowered[id]->kind.data.load.src = operand(function.operand(id, 0));
+            break;
+        case IR_STORE:
+            _lowered[id] = new_value(type(KOOPA_RTT_UNIT), KOOPA_RVT_STORE);
+            _lowered[id]->kind.data.store.value = operand(function.operand(id, 0));
+            _lowered[id]->kind.data.store.dest = operand(function.operand(id, 1));
+            break;
+        case IR_BR: {
+            _lowered[id] = new_value(type(KOOPA_RTT_UNIT), KOOPA_RVT_BRANCH);
+            auto &branch = _lowered[id]->kind.data.branch;
+            branch.cond = operand(function.operand(id, 0));
+            branch.true_bb = _lowered_blocks[inst.targets[0]];
+            branch.false_bb = _lowered_blocks[inst.targets[1]];
+            branch.true_args = arguments(block, inst.targets[0]);
+            branch.false_args = arguments(block, inst.targets[1]);
+            break;
+        }
+        case IR_JUMP:
+            _lowered[id] = new_value(type(KOOPA_RTT_UNIT), KOOPA_RVT_JUMP);
+            _lowered[id]->kind.data.jump.target = _lowered_blocks[inst.targets[0]];
+            _lowered[id]->kind.data.jump.args = arguments(block, inst.targets[0]);
+            break;
+        case IR_RET:
+            _lowered[id] = new_value(type(KOOPA_RTT_UNIT), KOOPA_RVT_RETURN);
+            _lowered[id]->kind.data.ret.value = operand(function.operand(id, 0));
+            break;
+        default:
+            assert(ir_is_binary(inst.opcode));
+            _lowered[id]->kind.data.binary.op = koopa_operator(inst.opcode);
+            _lowered[id]->kind.data.binary.lhs = operand(function.operand(id, 0));
+            _lowered[id]->kind.data.binary.rhs = operand(function.operand(id, 1));
+            break;
+    }
+}
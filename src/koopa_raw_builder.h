@@ -0,0 +1,58 @@
+#pragma once
+
+#include <deque>
+#include <string>
+#include <vector>
+#include "koopa.h"
+#include "ir.h"
+
+/**
+ * Lowers the optimised IR into libkoopa's raw program structures, so Koopa output goes
+ * through libkoopa itself instead of text printed by hand: koopa_generate_raw_to_koopa
+ * checks the program and dumps it. Phis become block parameters, and every branch into a
+ * block passes its arguments; allocas keep their source names.
+ *
+ * Every object the returned program points to is owned by the builder; keep it alive as
+ * long as the raw program is in use.
+ */
+class KoopaRawBuilder {
+public:
+    const koopa_raw_program_t &build(const IrModule &module);
+
+private:
+    koopa_raw_program_t _program{};
+
+    // backing storage of the raw program, deques never move their elements
+    std::deque<koopa_raw_type_kind_t> _types;
+    std::deque<koopa_raw_value_data_t> _values;
+    std::deque<koopa_raw_basic_block_data_t> _blocks;
+    std::deque<koopa_raw_function_data_t> _functions;
+    std::deque<std::vector<const void *>> _buffers;
+    std::deque<std::string> _names;
+
+    // state of the function being lowered, indexed by IR value and block id
+    const IrFunction *_function = nullptr;
+    std::vector<koopa_raw_value_data_t *> _lowered;
+    std::vector<koopa_raw_basic_block_data_t *> _lowered_blocks;
+
+    koopa_raw_type_t type(koopa_raw_type_tag_t tag, koopa_raw_type_t base = nullptr);
+
+    std::vector<const void *> *new_buffer();
+
+    // the slice points into `items`, which must not grow afterwards
+    koopa_raw_slice_t slice(std::vector<const void *> *items, koopa_raw_slice_item_kind_t kind);
+
+    const char *name(const std::string &text);
+
+    koopa_raw_value_data_t *new_value(koopa_raw_type_t type, koopa_raw_value_tag_t tag);
+
+    // constants and undef are made fresh at each use, like Koopa text has them inline
+    koopa_raw_value_t operand(IrValueId value);
+
+    // the values the edge from `from` passes to the parameters of `target`
+    koopa_raw_slice_t arguments(IrBlockId from, IrBlockId target);
+
+    void build_function(const IrFunction &function);
+
+    void build_instruction(IrValueId id, IrBlockId block);
+};
@@ -0,0 +1,129 @@
+#include "linear_scan.h"
+
+#include <algorithm>
+#include "machine_liveness.h"
+
+struct LiveInterval {
+    MachineRegister reg;
+    int start;
+    int end;
+};
+
+RegisterAllocationStatistics LinearScan::run(MachineFunction &function) {
+    RegisterAllocationStatistics statistics;
+    auto size = function.register_count();
+    MachineLiveness liveness(function);
+
+    // region: intervals
+    std::vector<int> start(size, -1);
+    std::vector<int> end(size, -1);
+    auto extend = [&](MachineRegister reg, int position) {
+        if (!riscv_is_virtual(reg)) {
+            return;
+        }
+        if (start[reg] < 0 || position < start[reg]) {
+            start[reg] = position;
+        }
+        if (position > end[reg]) {
+            end[reg] = position;
+        }
+    };
+    int index = 0;
+    for (MachineBlockId block = 0; block < function.blocks.size(); block++) {
+        auto &instructions = function.blocks[block].instructions;
+        auto first = 2 * index;
+        auto last = 2 * (index + static_cast<int>(instructions.size())) - 1;
+        for (auto reg: liveness.live_in(block).members()) {
+            extend(reg, first);
+        }
+        for (auto &inst: instructions) {
+            MachineRegister uses[2];
+            auto count = riscv_uses(inst, uses);
+            for (int i = 0; i < count; i++) {
+                extend(uses[i], 2 * index);
+            }
+            if (riscv_has_def(inst.opcode)) {
+                extend(inst.rd, 2 * index + 1);
+            }
+            index++;
+        }
+        for (auto reg: liveness.live_out(block).members()) {
+            extend(reg, last);
+        }
+    }
+    std::vector<LiveInterval> intervals;
+    for (MachineRegister reg = RV_FIRST_VIRTUAL; reg < size; reg++) {
+        if (start[reg] >= 0) {
+            intervals.push_back({reg, start[reg], end[reg]});
+        }
+    }
+    std::sort(intervals.begin(), intervals.end(), [](const LiveInterval &a, const LiveInterval &b) {
+        return a.start < b.start || (a.start == b.start && a.reg < b.reg);
+    });
+    statistics.virtual_registers = intervals.size();
+    // endregion
+
+    RegisterAssignment assignment(function);
+    auto rematerializable = find_rematerializable(function);
+    auto &allocatable = riscv_allocatable_registers();
+    std::vector<bool> free(RV_FIRST_VIRTUAL, false);
+    for (auto reg: allocatable) {
+        free[reg] = true;
+    }
+    auto spill = [&](MachineRegister reg) {
+        if (rematerializable[reg]) {
+            assignment.rematerialized[reg] = true;
+            statistics.rematerialized++;
+        } else {
+            assignment.slots[reg] = function.add_slot();
+            statistics.spilled++;
+        }
+    };
+    // sorted by end
+    std::vector<LiveInterval> active;
+    for (auto &interval: intervals) {
+        // expire what ended before this one starts
+        size_t expired = 0;
+        while (expired < active.size() && active[expired].end < interval.start) {
+            free[assignment.registers[active[expired].reg]] = true;
+            expired++;
+        }
+        active.erase(active.begin(), active.begin() + static_cast<long>(expired));
+
+        auto chosen = std::find_if(allocatable.begin(), allocatable.end(), [&free](MachineRegister reg) {
+            return free[reg];
+        });
+        if (chosen != allocatable.end()) {
+            free[*chosen] = false;
+            assignment.registers[interval.reg] = *chosen;
+        } else {
+            // a value that is cheap to compute again goes first, then the one reaching furthest
+            auto victim = active.rend();
+            if (!rematerializable[interval.reg]) {
+                victim = std::find_if(active.rbegin(), active.rend(), [&](const LiveInterval &other) {
+                    return rematerializable[other.reg].has_value();
+                });
+                if (victim == active.rend() && active.back().end > interval.end) {
+                    victim = active.rbegin();
+                }
+            }
+            if (victim == active.rend()) {
+                spill(interval.reg);
+                continue;
+            }
+            auto reg = victim->reg;
+            active.erase(std::next(victim).base());
+            assignment.registers[interval.reg] = assignment.registers[reg];
+            spill(reg);
+        }
+        auto current = interval;
+        auto position = std::upper_bound(active.begin(), active.end(), current,
+                                         [](const LiveInterval &a, const LiveInterval &b) {
+                                             return a.end < b.end;
+                                         });
+        active.insert(position, current);
+    }
+
+    assign_registers(function, assignment, statistics);
+    return statistics;
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "register_allocation.h"
+#include "riscv.h"
+
+/**
+ * Linear scan register allocation (Poletto and Sarkar). Every virtual register gets one
+ * interval from its first to its last point of life in layout order, blocks it is live
+ * through included. Intervals are visited by start; when no register is free, the interval
+ * that ends last, the new one or an active one, goes to the stack for its whole length,
+ * unless one of them holds a constant: that is computed again at each use instead.
+ *
+ * Each instruction has two positions, operands are read at the first and the result is
+ * written at the second, so a register freed by the last read can take the result.
+ */
+class LinearScan {
+public:
+    RegisterAllocationStatistics run(MachineFunction &function);
+};
@@ -0,0 +1,68 @@
+#include "liveness.h"
+
+#include <algorithm>
+
+Liveness::Liveness(const IrFunction &function, const ControlFlowGraph &cfg) {
+    auto size = function.blocks.size();
+    _live_in.resize(size);
+    _live_out.resize(size);
+    // values are explored one at a time in increasing order, so comparing with the last
+    // entry both deduplicates and keeps the sets sorted
+    auto add = [](std::vector<IrValueId> &set, IrValueId value) {
+        if (!set.empty() && set.back() == value) {
+            return false;
+        }
+        set.push_back(value);
+        return true;
+    };
+
+    std::vector<IrBlockId> worklist;
+    for (IrValueId value = 1; value < function.instructions.size(); value++) {
+        auto &inst = function[value];
+        if (inst.block == 0 || !cfg.reachable(inst.block) || !function.has_uses(value)) {
+            continue;
+        }
+        auto definition = inst.block;
+        auto is_phi = inst.opcode == IR_PHI;
+
+        worklist.clear();
+        for (auto use = inst.first_use; use != 0; use = function.uses[use].next_use) {
+            auto user = function.uses[use].user;
+            auto block = function[user].block;
+            if (block == 0 || !cfg.reachable(block)) {
+                continue;
+            }
+            if (function[user].opcode == IR_PHI) {
+                auto from = function.incoming[use];
+                add(_live_out[from], value);
+                worklist.push_back(from);
+            } else {
+                worklist.push_back(block);
+            }
+        }
+
+        while (!worklist.empty()) {
+            auto block = worklist.back();
+            worklist.pop_back();
+            // defined here: a phi is still live-in, anything else is not
+            if (block == definition && !is_phi) {
+                continue;
+            }
+            if (!add(_live_in[block], value) || block == definition) {
+                continue;
+            }
+            for (auto predecessor: cfg.predecessors[block]) {
+                add(_live_out[predecessor], value);
+                worklist.push_back(predecessor);
+            }
+        }
+    }
+}
+
+bool Liveness::is_live_in(IrBlockId block, IrValueId value) const {
+    return std::binary_search(_live_in[block].begin(), _live_in[block].end(), value);
+}
+
+bool Liveness::is_live_out(IrBlockId block, IrValueId value) const {
+    return std::binary_search(_live_out[block].begin(), _live_out[block].end(), value);
+}
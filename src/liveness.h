@@ -0,0 +1,36 @@
+#pragma once
+
+#include <vector>
+#include "cfg.h"
+#include "ir.h"
+
+/**
+ * Live-in and live-out sets of SSA values per block, by path exploration from every use
+ * (Brandner et al., "Computing Liveness Sets for SSA-Form Programs"): a use walks up the
+ * predecessors until it reaches the block defining the value, so no fixpoint iteration
+ * is needed.
+ *
+ * A phi operand is used at the end of its incoming block, not in the phi's block; a phi
+ * itself is live-in to its block when it is used there or further on.
+ */
+class Liveness {
+public:
+    Liveness(const IrFunction &function, const ControlFlowGraph &cfg);
+
+    // sorted by value id
+    const std::vector<IrValueId> &live_in(IrBlockId block) const {
+        return _live_in[block];
+    }
+
+    const std::vector<IrValueId> &live_out(IrBlockId block) const {
+        return _live_out[block];
+    }
+
+    bool is_live_in(IrBlockId block, IrValueId value) const;
+
+    bool is_live_out(IrBlockId block, IrValueId value) const;
+
+private:
+    std::vector<std::vector<IrValueId>> _live_in;
+    std::vector<std::vector<IrValueId>> _live_out;
+};
@@ -0,0 +1,104 @@
+#include "machine_liveness.h"
+
+#include <algorithm>
+
+bool RegisterSet::unite(const RegisterSet &other) {
+    bool changed = false;
+    for (size_t i = 0; i < _words.size(); i++) {
+        auto merged = _words[i] | other._words[i];
+        changed = changed || merged != _words[i];
+        _words[i] = merged;
+    }
+    return changed;
+}
+
+bool RegisterSet::unite_except(const RegisterSet &other, const RegisterSet &excluded) {
+    bool changed = false;
+    for (size_t i = 0; i < _words.size(); i++) {
+        auto merged = _words[i] | (other._words[i] & ~excluded._words[i]);
+        changed = changed || merged != _words[i];
+        _words[i] = merged;
+    }
+    return changed;
+}
+
+std::vector<MachineRegister> RegisterSet::members() const {
+    std::vector<MachineRegister> result;
+    for (size_t i = 0; i < _words.size(); i++) {
+        for (auto word = _words[i]; word != 0; word &= word - 1) {
+            result.push_back(static_cast<MachineRegister>(i * 64 + __builtin_ctzll(word)));
+        }
+    }
+    return result;
+}
+
+MachineLiveness::MachineLiveness(const MachineFunction &function) {
+    auto size = function.register_count();
+    auto count = function.blocks.size();
+    // read before written in the block, and written in it
+    std::vector<RegisterSet> used(count, RegisterSet(size));
+    std::vector<RegisterSet> defined(count, RegisterSet(size));
+    std::vector<std::vector<MachineBlockId>> successors(count);
+    for (MachineBlockId block = 0; block < count; block++) {
+        for (auto &inst: function.blocks[block].instructions) {
+            MachineRegister uses[2];
+            auto use_count = riscv_uses(inst, uses);
+            for (int i = 0; i < use_count; i++) {
+                if (!defined[block].contains(uses[i])) {
+                    used[block].add(uses[i]);
+                }
+            }
+            if (riscv_has_def(inst.opcode)) {
+                defined[block].add(inst.rd);
+            }
+        }
+        successors[block] = function.successors(block);
+    }
+
+    _live_in = used;
+    _live_out.assign(count, RegisterSet(size));
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (auto block = count; block-- > 0;) {
+            for (auto successor: successors[block]) {
+                _live_out[block].unite(_live_in[successor]);
+            }
+            // live-in = used + (live-out - defined)
+            changed = _live_in[block].unite_except(_live_out[block], defined[block]) || changed;
+        }
+    }
+}
+
+size_t register_pressure(const std::vector<MachineInstruction> &instructions, const RegisterSet &live_out) {
+    std::vector<bool> counted(RV_FIRST_VIRTUAL, false);
+    for (auto reg: riscv_allocatable_registers()) {
+        counted[reg] = true;
+    }
+    auto counts = [&counted](MachineRegister reg) {
+        return riscv_is_virtual(reg) || counted[reg];
+    };
+
+    // walking backwards
+    auto live = live_out;
+    size_t pressure = 0;
+    for (auto reg: live.members()) {
+        pressure += counts(reg);
+    }
+    auto highest = pressure;
+    for (auto inst = instructions.rbegin(); inst != instructions.rend(); ++inst) {
+        if (riscv_has_def(inst->opcode) && live.contains(inst->rd)) {
+            live.remove(inst->rd);
+            pressure -= counts(inst->rd);
+        }
+        MachineRegister uses[2];
+        auto count = riscv_uses(*inst, uses);
+        for (int i = 0; i < count; i++) {
+            if (!live.contains(uses[i])) {
+                live.add(uses[i]);
+                pressure += counts(uses[i]);
+            }
+        }
+        highest = std::max(highest, pressure);
+    }
+    return highest;
+}
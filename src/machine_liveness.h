@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "riscv.h"
+
+// A dense set of registers, physical and virtual, one bit each.
+class RegisterSet {
+public:
+    explicit RegisterSet(size_t size = 0) : _words((size + 63) / 64, 0) {
+    }
+
+    void add(MachineRegister reg) {
+        _words[reg / 64] |= uint64_t(1) << (reg % 64);
+    }
+
+    void remove(MachineRegister reg) {
+        _words[reg / 64] &= ~(uint64_t(1) << (reg % 64));
+    }
+
+    bool contains(MachineRegister reg) const {
+        return (_words[reg / 64] >> (reg % 64)) & 1;
+    }
+
+    // true if anything was added
+    bool unite(const RegisterSet &other);
+
+    // adds what is in `other` but not in `excluded`, true if anything was added
+    bool unite_except(const RegisterSet &other, const RegisterSet &excluded);
+
+    std::vector<MachineRegister> members() const;
+
+private:
+    std::vector<uint64_t> _words;
+};
+
+/**
+ * Live-in and live-out registers of every machine block. Out of SSA a register may be
+ * written in several places, so this is the classic backward dataflow iterated to a
+ * fixpoint, visiting blocks in reverse layout order.
+ */
+class MachineLiveness {
+public:
+    explicit MachineLiveness(const MachineFunction &function);
+
+    const RegisterSet &live_in(MachineBlockId block) const {
+        return _live_in[block];
+    }
+
+    const RegisterSet &live_out(MachineBlockId block) const {
+        return _live_out[block];
+    }
+
+private:
+    std::vector<RegisterSet> _live_in;
+    std::vector<RegisterSet> _live_out;
+};
+
+// The most registers live at once in `instructions`, given what is live after them. Virtual
+// registers count, and of the physical ones those the allocators hand out.
+size_t register_pressure(const std::vector<MachineInstruction> &instructions, const RegisterSet &live_out);
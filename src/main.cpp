@@ -4,6 +4,15 @@
 #include <memory>
 #include <string>
 #include "Ast.h"
+#include "constant_folding.h"
+#include "ir_generator.h"
+#include "koopa.h"
+#include "koopa_raw_builder.h"
+#include "pass_manager.h"
+#include "riscv_backend.h"
+#include "riscv_writer.h"
+#include "syntax_directed_emitter.h"
+#include "x86_backend.h"
 
 
 using namespace std;
@@ -38,6 +47,45 @@ void listFilesRecursively(const fs::path &directory) {
     }
 }
 
+// -koopa prints the IR, -riscv compiles it down to assembly, -x86 to assembly for the host
+// that links with runtime/x86_runtime.c; returns the exit code
+static int write_output(const std::string &mode, const IrModule &module, const char *output, int level) {
+    if (mode == "-koopa") {
+        // libkoopa checks the lowered program and prints it, phis become block arguments
+        KoopaRawBuilder builder;
+        auto &raw = builder.build(module);
+        koopa_program_t program;
+        auto status = koopa_generate_raw_to_koopa(&raw, &program);
+        if (status != KOOPA_EC_SUCCESS) {
+            std::cerr << "libkoopa rejected the program, error " << status << std::endl;
+            return 1;
+        }
+        status = koopa_dump_to_file(program, output);
+        koopa_delete_program(program);
+        if (status != KOOPA_EC_SUCCESS) {
+            std::cerr << "cannot write " << output << ", libkoopa error " << status << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+    std::unique_ptr<MachineModule> machine;
+    if (mode == "-riscv") {
+        machine = RiscvBackend(level).generate(module);
+    }
+    auto file = fopen(output, "w");
+    assert(file);
+    {
+        BufferedWriter out(file);
+        if (machine) {
+            RiscvWriter().write(*machine, out);
+        } else {
+            X86Backend().write(module, out);
+        }
+    }
+    fclose(file);
+    return 0;
+}
+
 int main(int argc, const char *argv[]) {
     // try {
     //     fs::path currentPath = fs::current_path();
@@ -53,10 +101,26 @@ int main(int argc, const char *argv[]) {
 
     // 解析命令行参数. 测试脚本/评测平台要求你的编译器能接收如下参数:
     // compiler 模式 输入文件 -o 输出文件
-    assert(argc == 5);
+    // an optional -O0, -O1 or -O2 after that picks the pipeline, -O1 by default;
+    // -O0 is the single pass path that never builds the AST
+    assert(argc == 5 || argc == 6);
     auto mode = argv[1];
     auto input = argv[2];
     auto output = argv[4];
+    int level = 1;
+    if (argc == 6) {
+        std::string option = argv[5];
+        if (option != "-O0" && option != "-O1" && option != "-O2") {
+            std::cerr << "unsupported option: " << option << std::endl;
+            return 1;
+        }
+        level = option[2] - '0';
+    }
+    bool syntax_directed = level == 0;
+    if (std::string(mode) != "-koopa" && std::string(mode) != "-riscv" && std::string(mode) != "-x86") {
+        std::cerr << "unsupported mode: " << mode << std::endl;
+        return 1;
+    }
 
     std::cout << "input: " << input << std::endl;
     // 打开输入文件, 并且指定 lexer 在解析的时候读取这个文件
@@ -65,14 +129,37 @@ int main(int argc, const char *argv[]) {
 
     // 调用 parser 函数, parser 函数会进一步调用 lexer 解析输入文件的
     unique_ptr<BaseAST> ast;
+    if (syntax_directed) {
+        SyntaxDirectedEmitter emitter;
+        syntax_directed_emitter = &emitter;
+        auto ret = yyparse(ast);
+        assert(!ret);
+        syntax_directed_emitter = nullptr;
+
+        auto module = emitter.finish();
+        module->statistics().print();
+        cout << "syntax-directed emission, value stack depth " << emitter.peak_stack_depth() << endl;
+        return write_output(mode, *module, output, level);
+    }
     auto ret = yyparse(ast);
     assert(!ret);
 
+    ConstantFolder folder;
+    folder.fold(ast).print();
+
     cout << "syntax analyze result:" << endl;
     // 输出解析得到的 AST
     cout << ast->dump() << endl;
 
     SymbolTableFactory::symbol_table->print();
 
-    return 0;
+    IrGenerator ir_generator;
+    auto module = ir_generator.generate(ast.get());
+    auto passes = PassManager::for_level(level, std::string(mode) == "-koopa" ? TARGET_KOOPA : TARGET_NATIVE);
+    passes->run(*module);
+    passes->print_timings();
+    cout << module->dump();
+    module->statistics().print();
+
+    return write_output(mode, *module, output, level);
 }
\ No newline at end of file
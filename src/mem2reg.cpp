@@ -0,0 +1,189 @@
+#include "mem2reg.h"
+
+#include <iostream>
+
+void Mem2RegStatistics::print(const std::string &function) const {
+    std::cout << "mem2reg @" << function << ": " << allocas_promoted << " allocas promoted, "
+              << loads_removed << " loads and " << stores_removed << " stores eliminated, "
+              << phis_inserted << " phis inserted" << std::endl;
+}
+
+Mem2RegStatistics Mem2Reg::run(IrFunction &function) {
+    _function = &function;
+    _statistics = Mem2RegStatistics();
+    _predecessors.clear();
+    _end_values.clear();
+    _entry_values.clear();
+    _replaced.clear();
+    _incomplete.clear();
+
+    auto slots = promotable_slots();
+    if (slots.empty()) {
+        return _statistics;
+    }
+    for (auto block: function.layout) {
+        for (auto successor: function.successors(block)) {
+            _predecessors[successor].push_back(block);
+        }
+    }
+
+    // local pass: inside a block, a load reads the last store before it
+    std::vector<std::pair<IrValueId, IrBlockId>> upward_exposed;
+    for (auto block: function.layout) {
+        for (auto inst: function.block_instructions(block)) {
+            auto opcode = function[inst].opcode;
+            if (opcode == IR_STORE && slots.count(function.operand(inst, 1)) != 0) {
+                _end_values[function.operand(inst, 1)][block] = function.operand(inst, 0);
+                function.erase(inst);
+                _statistics.stores_removed++;
+            } else if (opcode == IR_LOAD && slots.count(function.operand(inst, 0)) != 0) {
+                auto slot = function.operand(inst, 0);
+                auto found = _end_values[slot].find(block);
+                if (found != _end_values[slot].end()) {
+                    replace(inst, resolve(found->second));
+                    function.erase(inst);
+                    _statistics.loads_removed++;
+                } else {
+                    upward_exposed.emplace_back(inst, block);
+                }
+            }
+        }
+    }
+
+    // global pass: the remaining loads read the value live into their block
+    for (auto &load: upward_exposed) {
+        auto value = read_at_entry(function.operand(load.first, 0), load.second);
+        replace(load.first, value);
+        function.erase(load.first);
+        _statistics.loads_removed++;
+    }
+
+    for (auto slot: slots) {
+        function.erase(slot);
+        _statistics.allocas_promoted++;
+    }
+    return _statistics;
+}
+
+std::set<IrValueId> Mem2Reg::promotable_slots() {
+    // an alloca qualifies if its address is only ever used as the address of a load or store
+    std::set<IrValueId> result;
+    for (auto block: _function->layout) {
+        for (auto inst = _function->blocks[block].first; inst != 0; inst = (*_function)[inst].next) {
+            if ((*_function)[inst].opcode != IR_ALLOCA) {
+                continue;
+            }
+            bool promotable = true;
+            for (auto use = (*_function)[inst].first_use; use != 0; use = _function->uses[use].next_use) {
+                auto user = _function->uses[use].user;
+                auto opcode = (*_function)[user].opcode;
+                auto index = use - (*_function)[user].operand_begin;
+                if (!(opcode == IR_LOAD || (opcode == IR_STORE && index == 1))) {
+                    promotable = false;
+                    break;
+                }
+            }
+            if (promotable) {
+                result.insert(inst);
+            }
+        }
+    }
+    return result;
+}
+
+IrValueId Mem2Reg::resolve(IrValueId value) {
+    auto found = _replaced.find(value);
+    while (found != _replaced.end()) {
+        value = found->second;
+        found = _replaced.find(value);
+    }
+    return value;
+}
+
+void Mem2Reg::replace(IrValueId value, IrValueId by) {
+    _function->replace_all_uses(value, by);
+    _replaced[value] = by;
+}
+
+IrValueId Mem2Reg::read_at_end(IrValueId slot, IrBlockId block) {
+    auto &values = _end_values[slot];
+    auto found = values.find(block);
+    if (found != values.end()) {
+        return resolve(found->second);
+    }
+    return read_at_entry(slot, block);
+}
+
+IrValueId Mem2Reg::read_at_entry(IrValueId slot, IrBlockId block) {
+    auto &values = _entry_values[slot];
+    auto found = values.find(block);
+    if (found != values.end()) {
+        return resolve(found->second);
+    }
+
+    auto &predecessors = _predecessors[block];
+    if (predecessors.empty()) {
+        // the entry block or unreachable code, the slot was never written
+        values[block] = _function->undef();
+        return values[block];
+    }
+    if (predecessors.size() == 1) {
+        // the placeholder only shows if this is an unreachable cycle
+        values[block] = _function->undef();
+        auto value = read_at_end(slot, predecessors.front());
+        _entry_values[slot][block] = value;
+        return value;
+    }
+
+    // a join: the phi is recorded before its operands are read, which ends any cycle here
+    auto phi = _function->create(IR_PHI, {});
+    auto first = _function->blocks[block].first;
+    if (first != 0) {
+        _function->insert_before(first, phi);
+    } else {
+        _function->append(block, phi);
+    }
+    values[block] = phi;
+    _statistics.phis_inserted++;
+    _incomplete.insert(phi);
+    for (auto predecessor: predecessors) {
+        _function->add_incoming(phi, read_at_end(slot, predecessor), predecessor);
+    }
+    _incomplete.erase(phi);
+    return remove_trivial_phi(phi);
+}
+
+IrValueId Mem2Reg::remove_trivial_phi(IrValueId phi) {
+    IrValueId same = 0;
+    for (uint32_t i = 0; i < (*_function)[phi].operand_count; i++) {
+        auto operand = _function->operand(phi, i);
+        if (operand == same || operand == phi) {
+            continue;
+        }
+        if (same != 0) {
+            return phi;
+        }
+        same = operand;
+    }
+    if (same == 0) {
+        same = _function->undef();
+    }
+
+    std::vector<IrValueId> phi_users;
+    for (auto user: _function->users(phi)) {
+        if (user != phi && (*_function)[user].opcode == IR_PHI) {
+            phi_users.push_back(user);
+        }
+    }
+    replace(phi, same);
+    _function->erase(phi);
+    _statistics.phis_inserted--;
+
+    // removing this phi may have made the phis using it trivial as well
+    for (auto user: phi_users) {
+        if ((*_function)[user].block != 0 && resolve(user) == user && _incomplete.count(user) == 0) {
+            remove_trivial_phi(user);
+        }
+    }
+    return same;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include "ir.h"
+
+class Mem2RegStatistics {
+public:
+    size_t allocas_promoted = 0;
+    size_t loads_removed = 0;
+    size_t stores_removed = 0;
+    size_t phis_inserted = 0;
+
+    bool changed() const {
+        return allocas_promoted != 0;
+    }
+
+    void print(const std::string &function) const;
+};
+
+/**
+ * Promotes allocas that are only ever loaded from and stored to into SSA values, after
+ * Braun et al., "Simple and Efficient Construction of Static Single Assignment Form".
+ *
+ * The CFG is complete before the pass starts, so every block is sealed from the outset:
+ * a first sweep numbers values locally within each block, and the loads that read a value
+ * from before their block are then resolved by walking predecessors, placing phis only at
+ * joins and dropping the trivial ones again.
+ */
+class Mem2Reg {
+public:
+    Mem2RegStatistics run(IrFunction &function);
+
+private:
+    IrFunction *_function = nullptr;
+    Mem2RegStatistics _statistics;
+    std::map<IrBlockId, std::vector<IrBlockId>> _predecessors;
+    // slot -> block -> value the slot holds at the end / at the start of the block
+    std::map<IrValueId, std::map<IrBlockId, IrValueId>> _end_values;
+    std::map<IrValueId, std::map<IrBlockId, IrValueId>> _entry_values;
+    // loads and phis that were replaced, the tables above may still mention them
+    std::map<IrValueId, IrValueId> _replaced;
+    // phis still collecting their operands, not to be judged trivial yet
+    std::set<IrValueId> _incomplete;
+
+    std::set<IrValueId> promotable_slots();
+
+    IrValueId resolve(IrValueId value);
+
+    void replace(IrValueId value, IrValueId by);
+
+    IrValueId read_at_end(IrValueId slot, IrBlockId block);
+
+    IrValueId read_at_entry(IrValueId slot, IrBlockId block);
+
+    IrValueId remove_trivial_phi(IrValueId phi);
+};
@@ -0,0 +1,230 @@
+#include "pass_manager.h"
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include "adce.h"
+#include "gvn.h"
+#include "mem2reg.h"
+#include "reassociate.h"
+#include "sccp.h"
+#include "simplify_cfg.h"
+#include "strength_reduction.h"
+
+// region: passes
+
+// analyses that only depend on the shape of the CFG
+static const int CFG_ANALYSES = ANALYSIS_CFG | ANALYSIS_DOMINATORS | ANALYSIS_POST_DOMINATORS | ANALYSIS_LOOPS;
+
+class Mem2RegPass : public Pass {
+public:
+    const char *name() const override {
+        return "mem2reg";
+    }
+
+    int preserved() const override {
+        return CFG_ANALYSES;
+    }
+
+    bool run(AnalysisCache &analyses) override {
+        auto statistics = Mem2Reg().run(analyses.function());
+        statistics.print(analyses.function().name);
+        return statistics.changed();
+    }
+};
+
+class SccpPass : public Pass {
+public:
+    const char *name() const override {
+        return "sccp";
+    }
+
+    int required() const override {
+        return ANALYSIS_CFG;
+    }
+
+    bool run(AnalysisCache &analyses) override {
+        auto statistics = Sccp().run(analyses);
+        statistics.print(analyses.function().name);
+        return statistics.changed();
+    }
+};
+
+class ReassociatePass : public Pass {
+public:
+    const char *name() const override {
+        return "reassociate";
+    }
+
+    int required() const override {
+        return ANALYSIS_CFG;
+    }
+
+    int preserved() const override {
+        return CFG_ANALYSES;
+    }
+
+    bool run(AnalysisCache &analyses) override {
+        auto statistics = Reassociate().run(analyses);
+        statistics.print(analyses.function().name);
+        return statistics.changed();
+    }
+};
+
+class GvnPass : public Pass {
+public:
+    const char *name() const override {
+        return "gvn";
+    }
+
+    int required() const override {
+        return ANALYSIS_DOMINATORS;
+    }
+
+    int preserved() const override {
+        return CFG_ANALYSES;
+    }
+
+    bool run(AnalysisCache &analyses) override {
+        auto statistics = Gvn().run(analyses);
+        statistics.print(analyses.function().name);
+        return statistics.changed();
+    }
+};
+
+class StrengthReductionPass : public Pass {
+public:
+    explicit StrengthReductionPass(bool multiply_high) : _multiply_high(multiply_high) {
+    }
+
+    const char *name() const override {
+        return "strength-reduction";
+    }
+
+    int preserved() const override {
+        return CFG_ANALYSES;
+    }
+
+    bool run(AnalysisCache &analyses) override {
+        auto statistics = StrengthReduction(_multiply_high).run(analyses);
+        statistics.print(analyses.function().name);
+        return statistics.changed();
+    }
+
+private:
+    bool _multiply_high;
+};
+
+class AdcePass : public Pass {
+public:
+    const char *name() const override {
+        return "adce";
+    }
+
+    int required() const override {
+        return ANALYSIS_POST_DOMINATORS;
+    }
+
+    bool run(AnalysisCache &analyses) override {
+        auto statistics = Adce().run(analyses);
+        statistics.print(analyses.function().name);
+        return statistics.changed();
+    }
+};
+
+class SimplifyCfgPass : public Pass {
+public:
+    const char *name() const override {
+        return "simplify-cfg";
+    }
+
+    bool run(AnalysisCache &analyses) override {
+        auto statistics = SimplifyCfg().run(analyses);
+        statistics.print(analyses.function().name);
+        return statistics.changed();
+    }
+};
+
+// endregion
+
+void PassManager::add(std::unique_ptr<Pass> pass) {
+    PassTiming timing;
+    timing.name = pass->name();
+    _timings.push_back(timing);
+    _passes.push_back(std::move(pass));
+}
+
+void PassManager::run(IrModule &module) {
+    for (auto &function: module.functions) {
+        run(*function);
+    }
+}
+
+void PassManager::run(IrFunction &function) {
+    AnalysisCache analyses(function);
+    for (size_t i = 0; i < _passes.size(); i++) {
+        auto &pass = *_passes[i];
+        auto start = std::chrono::steady_clock::now();
+        // computed up front so that analysis time is charged to the pass that wants it
+        auto required = pass.required();
+        if (required & ANALYSIS_CFG) {
+            analyses.cfg();
+        }
+        if (required & ANALYSIS_DOMINATORS) {
+            analyses.dominators();
+        }
+        if (required & ANALYSIS_POST_DOMINATORS) {
+            analyses.post_dominators();
+        }
+        if (required & ANALYSIS_LOOPS) {
+            analyses.loops();
+        }
+        if (required & ANALYSIS_LIVENESS) {
+            analyses.liveness();
+        }
+        auto changed = pass.run(analyses);
+        if (changed) {
+            analyses.invalidate(ANALYSIS_ALL & ~pass.preserved());
+        }
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+        auto &timing = _timings[i];
+        timing.runs++;
+        timing.changes += changed;
+        timing.milliseconds += elapsed.count();
+        std::cout << "  " << pass.name() << " @" << function.name << ": " << std::fixed << std::setprecision(3)
+                  << elapsed.count() << " ms" << (changed ? ", changed" : "") << std::endl;
+        std::cout.unsetf(std::ios::floatfield);
+    }
+}
+
+void PassManager::print_timings() const {
+    std::cout << "pass timings:" << std::endl;
+    double total = 0;
+    for (auto &timing: _timings) {
+        std::cout << "  " << std::left << std::setw(20) << timing.name << std::right << std::fixed
+                  << std::setprecision(3) << std::setw(10) << timing.milliseconds << " ms, changed "
+                  << timing.changes << " of " << timing.runs << " functions" << std::endl;
+        total += timing.milliseconds;
+    }
+    std::cout << "  " << std::left << std::setw(20) << "total" << std::right << std::setw(10) << total << " ms"
+              << std::endl;
+    std::cout.unsetf(std::ios::floatfield);
+}
+
+std::unique_ptr<PassManager> PassManager::for_level(int level, OptimizationTarget target) {
+    auto manager = std::make_unique<PassManager>();
+    if (level <= 0) {
+        return manager;
+    }
+    manager->add(std::make_unique<Mem2RegPass>());
+    manager->add(std::make_unique<SccpPass>());
+    if (level >= 2) {
+        manager->add(std::make_unique<ReassociatePass>());
+        manager->add(std::make_unique<GvnPass>());
+        manager->add(std::make_unique<StrengthReductionPass>(target == TARGET_NATIVE));
+    }
+    manager->add(std::make_unique<AdcePass>());
+    manager->add(std::make_unique<SimplifyCfgPass>());
+    return manager;
+}
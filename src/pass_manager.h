@@ -0,0 +1,70 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "analysis_cache.h"
+#include "ir.h"
+
+/**
+ * One transformation of a function as the PassManager sees it. required() analyses are
+ * computed before the pass runs; when the pass reports a change, everything cached that
+ * is not in preserved() is dropped.
+ */
+class Pass {
+public:
+    virtual ~Pass() = default;
+
+    virtual const char *name() const = 0;
+
+    // bitmask of IrAnalysis
+    virtual int required() const {
+        return 0;
+    }
+
+    virtual int preserved() const {
+        return 0;
+    }
+
+    // prints what it changed; true if the function is different now
+    virtual bool run(AnalysisCache &analyses) = 0;
+};
+
+class PassTiming {
+public:
+    std::string name;
+    size_t runs = 0;
+    size_t changes = 0;
+    double milliseconds = 0;
+};
+
+// what the pipeline is for: Koopa has no high multiply, so division by magic numbers is out
+enum OptimizationTarget {
+    TARGET_KOOPA,
+    TARGET_NATIVE
+};
+
+class PassManager {
+public:
+    void add(std::unique_ptr<Pass> pass);
+
+    // every pass over each function in turn, one analysis cache per function
+    void run(IrModule &module);
+
+    void run(IrFunction &function);
+
+    const std::vector<PassTiming> &timings() const {
+        return _timings;
+    }
+
+    // per pass totals over all functions
+    void print_timings() const;
+
+    // -O1: promotion, constant propagation and clean-up; -O2 adds value numbering and
+    // arithmetic rewrites. Level 0 is an empty pipeline.
+    static std::unique_ptr<PassManager> for_level(int level, OptimizationTarget target);
+
+private:
+    std::vector<std::unique_ptr<Pass>> _passes;
+    std::vector<PassTiming> _timings;
+};
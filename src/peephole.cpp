@@ -0,0 +1,211 @@
+#include "peephole.h"
+
+#include <cstdint>
+#include <iostream>
+#include "machine_liveness.h"
+
+const char *peephole_pattern_name(PeepholePattern pattern) {
+    static const char *names[] = {
+            "redundant move", "load after store", "add zero", "branch over jump", "fold immediate"
+    };
+    return names[pattern];
+}
+
+void PeepholeStatistics::print(const std::string &function) const {
+    std::cout << "peephole @" << function << ":";
+    for (int pattern = 0; pattern < PEEPHOLE_PATTERN_COUNT; pattern++) {
+        std::cout << (pattern == 0 ? " " : ", ") << hits[pattern] << " "
+                  << peephole_pattern_name(static_cast<PeepholePattern>(pattern));
+    }
+    std::cout << std::endl;
+}
+
+// the block a pattern is tried in
+struct PeepholeContext {
+    const MachineLiveness &liveness;
+    MachineBlockId block;
+};
+
+// `reg` is read from `index` on, before it is written again, or on leaving the block
+static bool read_from(const PeepholeContext &context, const std::vector<MachineInstruction> &instructions,
+                      size_t index, MachineRegister reg) {
+    for (; index < instructions.size(); index++) {
+        MachineRegister uses[2];
+        auto count = riscv_uses(instructions[index], uses);
+        for (int i = 0; i < count; i++) {
+            if (uses[i] == reg) {
+                return true;
+            }
+        }
+        if (riscv_has_def(instructions[index].opcode) && instructions[index].rd == reg) {
+            return false;
+        }
+    }
+    return context.liveness.live_out(context.block).contains(reg);
+}
+
+// region: patterns
+
+static bool redundant_move(const PeepholeContext &context, std::vector<MachineInstruction> &instructions,
+                           size_t index) {
+    auto &inst = instructions[index];
+    if (inst.opcode != RV_MV) {
+        return false;
+    }
+    auto &previous = instructions[index > 0 ? index - 1 : index];
+    auto back = index > 0 && previous.opcode == RV_MV && previous.rd == inst.rs1 && previous.rs1 == inst.rd;
+    if (inst.rd != inst.rs1 && !back) {
+        return false;
+    }
+    instructions.erase(instructions.begin() + static_cast<long>(index));
+    return true;
+}
+
+static bool load_after_store(const PeepholeContext &context, std::vector<MachineInstruction> &instructions,
+                             size_t index) {
+    auto &inst = instructions[index];
+    if (inst.opcode != RV_LW || index == 0) {
+        return false;
+    }
+    auto &store = instructions[index - 1];
+    if (store.opcode != RV_SW || store.rs1 != inst.rs1 || store.imm != inst.imm || store.slot != inst.slot) {
+        return false;
+    }
+    if (inst.rd == store.rs2) {
+        instructions.erase(instructions.begin() + static_cast<long>(index));
+        return true;
+    }
+    auto rd = inst.rd;
+    inst = MachineInstruction();
+    inst.opcode = RV_MV;
+    inst.rd = rd;
+    inst.rs1 = store.rs2;
+    return true;
+}
+
+static bool add_zero(const PeepholeContext &context, std::vector<MachineInstruction> &instructions,
+                     size_t index) {
+    auto &inst = instructions[index];
+    MachineRegister source;
+    if (inst.opcode == RV_ADDI && inst.imm == 0 && inst.slot < 0) {
+        source = inst.rs1;
+    } else if (inst.opcode == RV_ADD && (inst.rs1 == RV_ZERO || inst.rs2 == RV_ZERO)) {
+        source = inst.rs1 == RV_ZERO ? inst.rs2 : inst.rs1;
+    } else {
+        return false;
+    }
+    auto rd = inst.rd;
+    inst = MachineInstruction();
+    inst.opcode = RV_MV;
+    inst.rd = rd;
+    inst.rs1 = source;
+    return true;
+}
+
+static bool branch_over_jump(const PeepholeContext &context, std::vector<MachineInstruction> &instructions,
+                             size_t index) {
+    auto &inst = instructions[index];
+    auto format = riscv_format(inst.opcode);
+    if ((format != RV_FORMAT_BRANCH && format != RV_FORMAT_COMPARE_BRANCH) || index + 2 != instructions.size()
+        || instructions[index + 1].opcode != RV_J || inst.target != context.block + 1) {
+        return false;
+    }
+    riscv_invert_branch(inst);
+    inst.target = instructions[index + 1].target;
+    instructions.pop_back();
+    return true;
+}
+
+static bool fold_immediate(const PeepholeContext &context, std::vector<MachineInstruction> &instructions,
+                           size_t index) {
+    auto &inst = instructions[index];
+    // by register opcode, li where there is no immediate form
+    static const RiscvOpcode immediates[] = {
+            RV_ADDI, RV_ADDI, RV_LI, RV_LI, RV_LI, RV_LI, RV_ANDI, RV_ORI, RV_XORI, RV_SLLI, RV_SRLI, RV_SRAI,
+            RV_SLTI, RV_SLTIU
+    };
+    if (riscv_format(inst.opcode) != RV_FORMAT_REGISTER || immediates[inst.opcode] == RV_LI) {
+        return false;
+    }
+    auto commutative = inst.opcode == RV_ADD || inst.opcode == RV_AND || inst.opcode == RV_OR
+                       || inst.opcode == RV_XOR;
+    // the li behind either operand that may take its place
+    for (int operand = 1; operand >= (commutative ? 0 : 1); operand--) {
+        auto reg = operand == 1 ? inst.rs2 : inst.rs1;
+        auto other = operand == 1 ? inst.rs1 : inst.rs2;
+        if (reg == RV_ZERO || reg == other) {
+            continue;
+        }
+        auto definition = index;
+        while (definition > 0) {
+            auto &earlier = instructions[--definition];
+            if (riscv_has_def(earlier.opcode) && earlier.rd == reg) {
+                break;
+            }
+        }
+        auto &li = instructions[definition];
+        if (li.opcode != RV_LI || li.rd != reg || definition == index) {
+            continue;
+        }
+        auto value = li.imm;
+        if (inst.opcode == RV_SUB) {
+            if (value == INT32_MIN) {
+                continue;
+            }
+            value = -value;
+        } else if (inst.opcode == RV_SLL || inst.opcode == RV_SRL || inst.opcode == RV_SRA) {
+            value &= 31;
+        }
+        if (!riscv_fits_immediate(value)) {
+            continue;
+        }
+        inst.opcode = immediates[inst.opcode];
+        inst.rs1 = other;
+        inst.rs2 = RV_ZERO;
+        inst.imm = value;
+        // the li goes too when nothing else reads what it loaded
+        bool read = inst.rd != reg && read_from(context, instructions, index + 1, reg);
+        for (auto between = definition + 1; between < index && !read; between++) {
+            MachineRegister uses[2];
+            auto count = riscv_uses(instructions[between], uses);
+            for (int i = 0; i < count; i++) {
+                read = read || uses[i] == reg;
+            }
+        }
+        if (!read) {
+            instructions.erase(instructions.begin() + static_cast<long>(definition));
+        }
+        return true;
+    }
+    return false;
+}
+
+// endregion
+
+PeepholeStatistics Peephole::run(MachineFunction &function) {
+    // by PeepholePattern
+    typedef bool (*Rewrite)(const PeepholeContext &, std::vector<MachineInstruction> &, size_t);
+    static const Rewrite table[PEEPHOLE_PATTERN_COUNT] = {
+            redundant_move, load_after_store, add_zero, branch_over_jump, fold_immediate
+    };
+    PeepholeStatistics statistics;
+    // rewrites only ever shorten live ranges, so this stays on the safe side
+    MachineLiveness liveness(function);
+    for (MachineBlockId block = 0; block < function.blocks.size(); block++) {
+        PeepholeContext context = {liveness, block};
+        auto &instructions = function.blocks[block].instructions;
+        for (size_t index = 0; index < instructions.size();) {
+            bool hit = false;
+            for (int pattern = 0; pattern < PEEPHOLE_PATTERN_COUNT && !hit; pattern++) {
+                hit = table[pattern](context, instructions, index);
+                statistics.hits[pattern] += hit;
+            }
+            if (!hit) {
+                index++;
+            } else if (index > 0) {
+                index--;
+            }
+        }
+    }
+    return statistics;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <string>
+#include "riscv.h"
+
+enum PeepholePattern {
+    PEEPHOLE_REDUNDANT_MOVE,
+    PEEPHOLE_LOAD_AFTER_STORE,
+    PEEPHOLE_ADD_ZERO,
+    PEEPHOLE_BRANCH_OVER_JUMP,
+    PEEPHOLE_FOLD_IMMEDIATE,
+    PEEPHOLE_PATTERN_COUNT
+};
+
+const char *peephole_pattern_name(PeepholePattern pattern);
+
+class PeepholeStatistics {
+public:
+    // by PeepholePattern
+    size_t hits[PEEPHOLE_PATTERN_COUNT] = {};
+
+    void print(const std::string &function) const;
+};
+
+/**
+ * Rewrites short instruction sequences in place, trying each pattern of a table at every
+ * instruction and stepping back one after a hit, since a rewrite may complete a pattern
+ * just before it:
+ *
+ *   mv a, a                      ->  (gone)
+ *   mv a, b; mv b, a             ->  mv a, b
+ *   sw a, slot; lw b, slot       ->  sw a, slot; mv b, a
+ *   addi a, b, 0 / add a, b, x0  ->  mv a, b
+ *   bnez a, next; j other        ->  beqz a, other, falling through to the next block
+ *   li t, 5; ... add a, b, t     ->  addi a, b, 5, without the li once t is not read again
+ *
+ * The last works for every operator with an immediate form, and for subtraction by adding
+ * the negated constant.
+ */
+class Peephole {
+public:
+    PeepholeStatistics run(MachineFunction &function);
+};
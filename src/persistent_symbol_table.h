@@ -0,0 +1,249 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "symbol_table.h"
+
+/**
+ * An immutable hash array mapped trie from names to symbols.
+ *
+ * insert() copies only the O(log32 n) nodes on the path to the key and shares everything
+ * else with the old version, so keeping a version around (a scope snapshot) is one
+ * shared_ptr copy.
+ */
+class PersistentSymbolMap {
+private:
+    static constexpr int BITS_PER_LEVEL = 5;
+    static constexpr int HASH_BITS = 64;
+
+    struct Node;
+    using NodePtr = std::shared_ptr<const Node>;
+
+    // either a leaf (key and value) or a link to a sub-trie (child)
+    struct Slot {
+        uint64_t hash = 0;
+        std::string key;
+        std::shared_ptr<SymbolInformation> value;
+        NodePtr child;
+    };
+
+    // once the hash bits run out, a node is a plain collision list with bitmap 0
+    struct Node {
+        uint32_t bitmap = 0;
+        std::vector<Slot> slots;
+    };
+
+    NodePtr _root;
+    size_t _size = 0;
+
+    static uint64_t hash_of(const std::string &key) {
+        return std::hash<std::string>()(key);
+    }
+
+    static uint32_t bit_of(uint64_t hash, int shift) {
+        return 1u << ((hash >> shift) & 31u);
+    }
+
+    static int index_of(uint32_t bitmap, uint32_t bit) {
+        return __builtin_popcount(bitmap & (bit - 1));
+    }
+
+    // a node holding two leaves whose hashes agree below `shift`
+    static NodePtr merge(const Slot &first, const Slot &second, int shift) {
+        auto node = std::make_shared<Node>();
+        if (shift >= HASH_BITS) {
+            node->slots = {first, second};
+            return node;
+        }
+        auto first_bit = bit_of(first.hash, shift);
+        auto second_bit = bit_of(second.hash, shift);
+        if (first_bit == second_bit) {
+            Slot link;
+            link.child = merge(first, second, shift + BITS_PER_LEVEL);
+            node->bitmap = first_bit;
+            node->slots = {link};
+        } else {
+            node->bitmap = first_bit | second_bit;
+            node->slots = first_bit < second_bit ? std::vector<Slot>{first, second} : std::vector<Slot>{second, first};
+        }
+        return node;
+    }
+
+    static NodePtr insert(const NodePtr &node, const Slot &leaf, int shift, bool &added) {
+        if (node == nullptr) {
+            auto created = std::make_shared<Node>();
+            created->bitmap = bit_of(leaf.hash, shift);
+            created->slots = {leaf};
+            added = true;
+            return created;
+        }
+
+        auto copy = std::make_shared<Node>(*node);
+        if (shift >= HASH_BITS) {
+            for (auto &slot: copy->slots) {
+                if (slot.key == leaf.key) {
+                    slot.value = leaf.value;
+                    return copy;
+                }
+            }
+            copy->slots.push_back(leaf);
+            added = true;
+            return copy;
+        }
+
+        auto bit = bit_of(leaf.hash, shift);
+        auto index = index_of(node->bitmap, bit);
+        if ((node->bitmap & bit) == 0) {
+            copy->bitmap |= bit;
+            copy->slots.insert(copy->slots.begin() + index, leaf);
+            added = true;
+            return copy;
+        }
+
+        auto &slot = copy->slots[index];
+        if (slot.child != nullptr) {
+            slot.child = insert(slot.child, leaf, shift + BITS_PER_LEVEL, added);
+        } else if (slot.key == leaf.key) {
+            // an inner declaration shadows the outer one
+            slot.value = leaf.value;
+        } else {
+            Slot link;
+            link.child = merge(slot, leaf, shift + BITS_PER_LEVEL);
+            slot = link;
+            added = true;
+        }
+        return copy;
+    }
+
+    static void for_each(const NodePtr &node,
+                         const std::function<void(const std::string &, const std::shared_ptr<SymbolInformation> &)> &visit) {
+        if (node == nullptr) {
+            return;
+        }
+        for (auto &slot: node->slots) {
+            if (slot.child != nullptr) {
+                for_each(slot.child, visit);
+            } else {
+                visit(slot.key, slot.value);
+            }
+        }
+    }
+
+public:
+
+    // a new version with `name` bound to `symbol_information`; this version is unchanged
+    PersistentSymbolMap insert(const std::string &name, std::shared_ptr<SymbolInformation> symbol_information) const {
+        Slot leaf;
+        leaf.hash = hash_of(name);
+        leaf.key = name;
+        leaf.value = symbol_information;
+
+        bool added = false;
+        PersistentSymbolMap result;
+        result._root = insert(_root, leaf, 0, added);
+        result._size = _size + (added ? 1 : 0);
+        return result;
+    }
+
+    // nullptr if the name is not bound in this version
+    SymbolInformation *find(const std::string &name) const {
+        auto hash = hash_of(name);
+        auto node = _root.get();
+        for (int shift = 0; node != nullptr; shift += BITS_PER_LEVEL) {
+            if (shift >= HASH_BITS) {
+                for (auto &slot: node->slots) {
+                    if (slot.key == name) {
+                        return slot.value.get();
+                    }
+                }
+                return nullptr;
+            }
+            auto bit = bit_of(hash, shift);
+            if ((node->bitmap & bit) == 0) {
+                return nullptr;
+            }
+            auto &slot = node->slots[index_of(node->bitmap, bit)];
+            if (slot.child == nullptr) {
+                return slot.key == name ? slot.value.get() : nullptr;
+            }
+            node = slot.child.get();
+        }
+        return nullptr;
+    }
+
+    std::shared_ptr<SymbolInformation> lookup(const std::string &name) const {
+        auto hash = hash_of(name);
+        NodePtr node = _root;
+        for (int shift = 0; node != nullptr; shift += BITS_PER_LEVEL) {
+            if (shift >= HASH_BITS) {
+                for (auto &slot: node->slots) {
+                    if (slot.key == name) {
+                        return slot.value;
+                    }
+                }
+                return nullptr;
+            }
+            auto bit = bit_of(hash, shift);
+            if ((node->bitmap & bit) == 0) {
+                return nullptr;
+            }
+            auto &slot = node->slots[index_of(node->bitmap, bit)];
+            if (slot.child == nullptr) {
+                return slot.key == name ? slot.value : nullptr;
+            }
+            node = slot.child;
+        }
+        return nullptr;
+    }
+
+    size_t size() const {
+        return _size;
+    }
+
+    // visits every binding in hash order
+    void for_each(const std::function<void(const std::string &, const std::shared_ptr<SymbolInformation> &)> &visit) const {
+        for_each(_root, visit);
+    }
+};
+
+/**
+ * A SymbolTable on top of PersistentSymbolMap. Entering a block takes a snapshot(),
+ * leaving it restore()s the snapshot; both are O(1) and nothing is copied.
+ */
+class PersistentSymbolTableImpl : public SymbolTable {
+
+private:
+    PersistentSymbolMap _current;
+
+public:
+
+    void insert(const std::string &name, std::shared_ptr<SymbolInformation> symbol_information) override {
+        this->_current = this->_current.insert(name, symbol_information);
+    }
+
+    std::shared_ptr<SymbolInformation> lookup(const std::string &name) override {
+        return this->_current.lookup(name);
+    }
+
+    PersistentSymbolMap snapshot() const {
+        return this->_current;
+    }
+
+    void restore(const PersistentSymbolMap &snapshot) {
+        this->_current = snapshot;
+    }
+
+    void print() override {
+        std::cout << "PersistentSymbolTable with " << this->_current.size() << " visible symbols" << std::endl;
+        this->_current.for_each([](const std::string &name, const std::shared_ptr<SymbolInformation> &info) {
+            std::cout << "name: " << name << "; " << " type: ";
+            if (info->if_const()) {
+                std::cout << "const" << " ";
+            }
+            std::cout << info->type() << "; " << std::endl;
+        });
+    }
+};
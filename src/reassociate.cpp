@@ -0,0 +1,166 @@
+#include "reassociate.h"
+
+#include <algorithm>
+#include <iostream>
+
+void ReassociateStatistics::print(const std::string &function) const {
+    std::cout << "reassociate @" << function << ": " << expressions_rewritten << " expressions rewritten, "
+              << constants_folded << " constants folded" << std::endl;
+}
+
+static bool is_associative(IrOpcode opcode) {
+    return opcode == IR_ADD || opcode == IR_MUL || opcode == IR_AND || opcode == IR_OR || opcode == IR_XOR;
+}
+
+ReassociateStatistics Reassociate::run(AnalysisCache &analyses) {
+    auto &function = analyses.function();
+    _function = &function;
+    _statistics = ReassociateStatistics();
+
+    // blocks get ranks far apart, so a value computed in a block ranks below the next block
+    auto &cfg = analyses.cfg();
+    _ranks.assign(function.instructions.size(), 0);
+    for (size_t i = 0; i < cfg.reverse_postorder.size(); i++) {
+        auto block_rank = static_cast<uint64_t>(i + 1) << 32;
+        for (auto inst = function.blocks[cfg.reverse_postorder[i]].first; inst != 0; inst = function[inst].next) {
+            if (!ir_is_binary(function[inst].opcode)) {
+                _ranks[inst] = block_rank;
+                continue;
+            }
+            _ranks[inst] = std::max({block_rank, rank_of(function.operand(inst, 0)),
+                                     rank_of(function.operand(inst, 1))}) + 1;
+        }
+    }
+
+    for (auto block: cfg.reverse_postorder) {
+        for (auto inst: function.block_instructions(block)) {
+            // x - c is x + (-c), which can then join an addition tree
+            if (function[inst].opcode == IR_SUB && function.is_constant(function.operand(inst, 1))) {
+                auto negated = static_cast<int32_t>(0u - static_cast<uint32_t>(function.constant_value(function.operand(inst, 1))));
+                auto add = create(IR_ADD, function.operand(inst, 0), function.constant(negated), inst);
+                function.replace_all_uses(inst, add);
+                function.erase(inst);
+            }
+        }
+    }
+    for (auto block: cfg.reverse_postorder) {
+        for (auto inst: function.block_instructions(block)) {
+            auto opcode = function[inst].opcode;
+            // erased as part of an earlier tree, or interior and rewritten with its root
+            if (function[inst].block == 0 || !is_associative(opcode) || is_interior(inst, opcode)) {
+                continue;
+            }
+            rewrite(inst);
+        }
+    }
+    return _statistics;
+}
+
+uint64_t Reassociate::rank_of(IrValueId value) const {
+    return value < _ranks.size() ? _ranks[value] : 0;
+}
+
+IrValueId Reassociate::create(IrOpcode opcode, IrValueId lhs, IrValueId rhs, IrValueId position) {
+    auto inst = _function->create(opcode, {lhs, rhs});
+    _function->insert_before(position, inst);
+    _ranks.resize(_function->instructions.size(), 0);
+    _ranks[inst] = std::max(rank_of(lhs), rank_of(rhs)) + 1;
+    return inst;
+}
+
+bool Reassociate::is_interior(IrValueId inst, IrOpcode opcode) const {
+    auto &function = *_function;
+    if (function[inst].opcode != opcode || function.use_count(inst) != 1) {
+        return false;
+    }
+    auto user = function.users(inst).front();
+    return function[user].opcode == opcode && function[user].block == function[inst].block;
+}
+
+void Reassociate::collect(IrValueId root, std::vector<IrValueId> &leaves, std::vector<IrValueId> &nodes,
+                          bool &left_linear) const {
+    auto &function = *_function;
+    auto opcode = function[root].opcode;
+    nodes.push_back(root);
+    for (uint32_t i = 0; i < 2; i++) {
+        auto operand = function.operand(root, i);
+        if (is_interior(operand, opcode)) {
+            left_linear = left_linear && i == 0;
+            collect(operand, leaves, nodes, left_linear);
+        } else {
+            leaves.push_back(operand);
+        }
+    }
+}
+
+void Reassociate::rewrite(IrValueId root) {
+    auto &function = *_function;
+    auto opcode = function[root].opcode;
+    std::vector<IrValueId> leaves;
+    std::vector<IrValueId> nodes;
+    bool left_linear = true;
+    collect(root, leaves, nodes, left_linear);
+
+    // fold the constants, the identity and the absorbing element then drop out
+    std::vector<IrValueId> values;
+    size_t constant_count = 0;
+    bool has_constant = false;
+    int32_t constant = 0;
+    for (auto leaf: leaves) {
+        if (!function.is_constant(leaf)) {
+            values.push_back(leaf);
+            continue;
+        }
+        auto value = function.constant_value(leaf);
+        constant_count++;
+        if (has_constant) {
+            ir_evaluate(opcode, constant, value, constant);
+        } else {
+            constant = value;
+            has_constant = true;
+        }
+    }
+    int32_t identity = opcode == IR_MUL ? 1 : opcode == IR_AND ? -1 : 0;
+    bool absorbed = has_constant && ((constant == 0 && (opcode == IR_MUL || opcode == IR_AND))
+                                     || (constant == -1 && opcode == IR_OR));
+    bool dropped = has_constant && constant == identity;
+
+    std::sort(values.begin(), values.end(), [this](IrValueId a, IrValueId b) {
+        auto rank_a = rank_of(a);
+        auto rank_b = rank_of(b);
+        return rank_a != rank_b ? rank_a < rank_b : a < b;
+    });
+
+    // the same tree again, no point in rebuilding it
+    std::vector<IrValueId> expected = values;
+    if (has_constant) {
+        expected.push_back(function.constant(constant));
+    }
+    if (!absorbed && !dropped && left_linear && constant_count <= 1 && expected == leaves) {
+        return;
+    }
+
+    IrValueId result;
+    if (absorbed) {
+        result = function.constant(constant);
+    } else {
+        if (dropped) {
+            expected.pop_back();
+        }
+        if (expected.empty()) {
+            result = function.constant(identity);
+        } else {
+            result = expected.front();
+            for (size_t i = 1; i < expected.size(); i++) {
+                result = create(opcode, result, expected[i], root);
+            }
+        }
+    }
+    function.replace_all_uses(root, result);
+    // root first, which leaves each child without its only use
+    for (auto node: nodes) {
+        function.erase(node);
+    }
+    _statistics.expressions_rewritten++;
+    _statistics.constants_folded += constant_count - (has_constant && !absorbed && !dropped ? 1 : 0);
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "analysis_cache.h"
+#include "ir.h"
+
+class ReassociateStatistics {
+public:
+    size_t expressions_rewritten = 0;
+    size_t constants_folded = 0;
+
+    bool changed() const {
+        return expressions_rewritten != 0;
+    }
+
+    void print(const std::string &function) const;
+};
+
+/**
+ * Reassociation by operand rank (Briggs and Cooper). A tree of one associative and
+ * commutative opcode is flattened into its leaves, the constant leaves are folded into one
+ * and the rest are sorted by rank, then the tree is rebuilt left-linear with the lowest
+ * ranks innermost and the constant outermost. `a + 1 + 2` becomes `a + 3`, and `b + a + c`
+ * and `a + c + b` are built the same way so GVN sees their common part.
+ *
+ * A rank orders values by how late they become available: constants first, then blocks in
+ * reverse postorder, and a computed value after its operands.
+ */
+class Reassociate {
+public:
+    ReassociateStatistics run(AnalysisCache &analyses);
+
+private:
+    IrFunction *_function = nullptr;
+    std::vector<uint64_t> _ranks;
+    ReassociateStatistics _statistics;
+
+    uint64_t rank_of(IrValueId value) const;
+
+    IrValueId create(IrOpcode opcode, IrValueId lhs, IrValueId rhs, IrValueId position);
+
+    // true if `inst` is an interior node of the tree of `opcode` that uses it
+    bool is_interior(IrValueId inst, IrOpcode opcode) const;
+
+    void collect(IrValueId root, std::vector<IrValueId> &leaves, std::vector<IrValueId> &nodes,
+                 bool &left_linear) const;
+
+    void rewrite(IrValueId root);
+};
@@ -0,0 +1,227 @@
+#include "register_allocation.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <iostream>
+#include "machine_liveness.h"
+
+void RegisterAllocationStatistics::print(const std::string &allocator, const std::string &function) const {
+    std::cout << allocator << " @" << function << ": " << virtual_registers << " virtual registers, " << spilled
+              << " spilled, " << spill_loads << " spill loads, " << spill_stores << " spill stores, " << rematerialized
+              << " rematerialized (" << spill_loads_avoided << " loads, " << spill_stores_avoided
+              << " stores avoided), " << ranges_split << " ranges split, " << moves << " moves, " << moves_removed
+              << " moves removed" << std::endl;
+}
+
+std::vector<std::optional<MachineInstruction>> find_rematerializable(const MachineFunction &function) {
+    std::vector<std::optional<MachineInstruction>> result(function.register_count());
+    std::vector<int> definitions(function.register_count(), 0);
+    for (auto &block: function.blocks) {
+        for (auto &inst: block.instructions) {
+            if (!riscv_has_def(inst.opcode) || !riscv_is_virtual(inst.rd)) {
+                continue;
+            }
+            definitions[inst.rd]++;
+            auto address = inst.opcode == RV_ADDI && inst.rs1 == RV_SP && inst.slot >= 0;
+            if (inst.opcode == RV_LI || inst.opcode == RV_LUI || address) {
+                result[inst.rd] = inst;
+            }
+        }
+    }
+    for (MachineRegister reg = RV_FIRST_VIRTUAL; reg < result.size(); reg++) {
+        if (definitions[reg] != 1) {
+            result[reg].reset();
+        }
+    }
+    return result;
+}
+
+size_t split_live_ranges(MachineFunction &function, const std::vector<MachineRegister> &registers,
+                         std::vector<MachineRegister> &split_from) {
+    auto size = function.register_count();
+    MachineLiveness liveness(function);
+    std::vector<bool> crowded(function.blocks.size());
+    for (MachineBlockId id = 0; id < function.blocks.size(); id++) {
+        auto pressure = register_pressure(function.blocks[id].instructions, liveness.live_out(id));
+        crowded[id] = pressure > riscv_allocatable_registers().size();
+    }
+    // reads and writes weighted by 10 to the power of the loop depth, as the spill costs are;
+    // and whether a block with a register to spare reads or writes the register
+    std::vector<double> cost(size, 0);
+    std::vector<bool> used_in_room(size, false);
+    for (MachineBlockId id = 0; id < function.blocks.size(); id++) {
+        auto &block = function.blocks[id];
+        auto weight = std::pow(10.0, std::min(block.loop_depth, 8));
+        auto reference = [&](MachineRegister reg) {
+            cost[reg] += weight;
+            used_in_room[reg] = used_in_room[reg] || !crowded[id];
+        };
+        for (auto &inst: block.instructions) {
+            if (riscv_has_def(inst.opcode)) {
+                reference(inst.rd);
+            }
+            MachineRegister uses[2];
+            auto count = riscv_uses(inst, uses);
+            for (int i = 0; i < count; i++) {
+                reference(uses[i]);
+            }
+        }
+    }
+    // a constant is better off rematerialized than split
+    auto rematerializable = find_rematerializable(function);
+    RegisterSet splittable(size);
+    for (auto reg: registers) {
+        // split nowhere else, a register only used under pressure is as well off spilled
+        if (riscv_is_virtual(reg) && used_in_room[reg] && !rematerializable[reg]) {
+            splittable.add(reg);
+        }
+    }
+
+    split_from.assign(size, RV_ZERO);
+    size_t split = 0;
+    for (MachineBlockId id = 0; id < function.blocks.size(); id++) {
+        auto &block = function.blocks[id];
+        // the copies go into the block itself, which would put them in the loop
+        if (block.loop_depth > 0 || !crowded[id]) {
+            continue;
+        }
+        RegisterSet referenced(size);
+        for (auto &inst: block.instructions) {
+            if (riscv_has_def(inst.opcode)) {
+                referenced.add(inst.rd);
+            }
+            MachineRegister uses[2];
+            auto count = riscv_uses(inst, uses);
+            for (int i = 0; i < count; i++) {
+                referenced.add(uses[i]);
+            }
+        }
+
+        auto &live_out = liveness.live_out(id);
+        std::vector<MachineRegister> candidates;
+        for (auto reg: liveness.live_in(id).members()) {
+            if (splittable.contains(reg) && live_out.contains(reg) && !referenced.contains(reg)) {
+                candidates.push_back(reg);
+            }
+        }
+        // no more stand-ins than registers must go to memory here, for the values dearest to
+        // spill everywhere else
+        auto excess = register_pressure(block.instructions, live_out) - riscv_allocatable_registers().size();
+        std::stable_sort(candidates.begin(), candidates.end(), [&cost](MachineRegister a, MachineRegister b) {
+            return cost[a] > cost[b];
+        });
+        candidates.resize(std::min(candidates.size(), excess));
+
+        std::vector<MachineInstruction> head;
+        std::vector<MachineInstruction> tail;
+        for (auto reg: candidates) {
+            MachineInstruction copy;
+            copy.opcode = RV_MV;
+            copy.rd = function.new_register();
+            copy.rs1 = reg;
+            split_from.resize(function.register_count(), RV_ZERO);
+            split_from[copy.rd] = reg;
+            head.push_back(copy);
+            std::swap(copy.rd, copy.rs1);
+            tail.push_back(copy);
+            split++;
+        }
+        auto &instructions = block.instructions;
+        auto branch = instructions.end();
+        while (branch != instructions.begin() && riscv_is_terminator((branch - 1)->opcode)) {
+            --branch;
+        }
+        instructions.insert(branch, tail.begin(), tail.end());
+        instructions.insert(instructions.begin(), head.begin(), head.end());
+    }
+    return split;
+}
+
+void assign_registers(MachineFunction &function, const RegisterAssignment &assignment,
+                      RegisterAllocationStatistics &statistics) {
+    auto spill = [](RiscvOpcode opcode, MachineRegister reg, int32_t slot) {
+        MachineInstruction inst;
+        inst.opcode = opcode;
+        inst.rs1 = RV_SP;
+        inst.slot = slot;
+        if (opcode == RV_LW) {
+            inst.rd = reg;
+        } else {
+            inst.rs2 = reg;
+        }
+        return inst;
+    };
+
+    std::vector<std::optional<MachineInstruction>> definitions;
+    if (std::find(assignment.rematerialized.begin(), assignment.rematerialized.end(), true)
+        != assignment.rematerialized.end()) {
+        definitions = find_rematerializable(function);
+    }
+
+    for (auto &block: function.blocks) {
+        std::vector<MachineInstruction> rewritten;
+        rewritten.reserve(block.instructions.size());
+        for (auto inst: block.instructions) {
+            if (riscv_has_def(inst.opcode) && riscv_is_virtual(inst.rd) && assignment.rematerialized[inst.rd]) {
+                // every use computes the value itself
+                statistics.spill_stores_avoided++;
+                continue;
+            }
+            MachineRegister *operands[2];
+            auto count = riscv_use_operands(inst, operands);
+            // the scratch register each spilled operand was reloaded into, so a register
+            // read twice is reloaded once
+            MachineRegister reloaded[2] = {RV_ZERO, RV_ZERO};
+            MachineRegister scratch[2] = {RV_T5, RV_T6};
+            for (int i = 0; i < count; i++) {
+                auto reg = *operands[i];
+                if (!riscv_is_virtual(reg)) {
+                    continue;
+                }
+                if (assignment.slots[reg] < 0 && !assignment.rematerialized[reg]) {
+                    assert(assignment.registers[reg] != RV_ZERO);
+                    *operands[i] = assignment.registers[reg];
+                } else if (i == 1 && reloaded[0] == reg) {
+                    *operands[i] = scratch[0];
+                } else if (assignment.rematerialized[reg]) {
+                    assert(definitions[reg].has_value());
+                    auto recomputed = *definitions[reg];
+                    recomputed.rd = scratch[i];
+                    rewritten.push_back(recomputed);
+                    statistics.spill_loads_avoided++;
+                    reloaded[i] = reg;
+                    *operands[i] = scratch[i];
+                } else {
+                    rewritten.push_back(spill(RV_LW, scratch[i], assignment.slots[reg]));
+                    statistics.spill_loads++;
+                    reloaded[i] = reg;
+                    *operands[i] = scratch[i];
+                }
+            }
+
+            int32_t store_slot = -1;
+            if (riscv_has_def(inst.opcode) && riscv_is_virtual(inst.rd)) {
+                if (assignment.slots[inst.rd] < 0) {
+                    assert(assignment.registers[inst.rd] != RV_ZERO);
+                    inst.rd = assignment.registers[inst.rd];
+                } else {
+                    store_slot = assignment.slots[inst.rd];
+                    inst.rd = RV_T5;
+                }
+            }
+
+            if (inst.opcode == RV_MV && inst.rd == inst.rs1) {
+                statistics.moves_removed++;
+            } else {
+                statistics.moves += inst.opcode == RV_MV;
+                rewritten.push_back(inst);
+            }
+            if (store_slot >= 0) {
+                rewritten.push_back(spill(RV_SW, RV_T5, store_slot));
+                statistics.spill_stores++;
+            }
+        }
+        block.instructions = std::move(rewritten);
+    }
+}
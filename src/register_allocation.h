@@ -0,0 +1,62 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <vector>
+#include "riscv.h"
+
+class RegisterAllocationStatistics {
+public:
+    size_t virtual_registers = 0;
+    size_t spilled = 0;
+    size_t spill_loads = 0;
+    size_t spill_stores = 0;
+    // registers computed again at each use instead of spilled, and the memory traffic saved
+    size_t rematerialized = 0;
+    size_t spill_loads_avoided = 0;
+    size_t spill_stores_avoided = 0;
+    size_t ranges_split = 0;
+    // register to register moves left in the code, and those that became no-ops
+    size_t moves = 0;
+    size_t moves_removed = 0;
+
+    void print(const std::string &allocator, const std::string &function) const;
+};
+
+/**
+ * Where each virtual register ended up: a physical register, a stack slot when it was
+ * spilled, or nowhere when it is rematerialized. Indexed by register number.
+ */
+class RegisterAssignment {
+public:
+    std::vector<MachineRegister> registers;
+    std::vector<int32_t> slots;
+    std::vector<bool> rematerialized;
+
+    explicit RegisterAssignment(const MachineFunction &function)
+            : registers(function.register_count(), RV_ZERO), slots(function.register_count(), -1),
+              rematerialized(function.register_count(), false) {
+    }
+};
+
+// For each register written by a single instruction that reads nothing but x0 and sp, that
+// instruction: li (lui and addi once assembled), lui, or addi forming the address of a
+// stack slot. Repeating it right before a use is cheaper than a reload from the stack.
+std::vector<std::optional<MachineInstruction>> find_rematerializable(const MachineFunction &function);
+
+// Splits the live ranges of `registers` around blocks outside loops where more registers are
+// live than can be allocated, if they are read or written in some block with room to spare.
+// Of those live through such a block without being read or written there, as many as the
+// block has too many are split, those most expensive to spill first: a copy takes over at
+// the top of the block and hands the value back before its branch. The copy is a cheap
+// spill candidate, and it coalesces away again where the pressure allows. `split_from` maps
+// each copy to the register it was split from. Returns the number of ranges split.
+size_t split_live_ranges(MachineFunction &function, const std::vector<MachineRegister> &registers,
+                         std::vector<MachineRegister> &split_from);
+
+// Rewrites the function to physical registers. A spilled operand is reloaded into t5 or t6
+// right before its instruction and a spilled result is stored from t5 right after it; a
+// rematerialized operand is computed into t5 or t6 instead, and its definition dropped.
+// Moves that end up from a register to itself are deleted.
+void assign_registers(MachineFunction &function, const RegisterAssignment &assignment,
+                      RegisterAllocationStatistics &statistics);
@@ -0,0 +1,196 @@
+#include "riscv.h"
+
+#include <algorithm>
+#include <cassert>
+
+// region: opcode and register properties
+
+const char *riscv_opcode_name(RiscvOpcode opcode) {
+    static const char *names[] = {
+            "add", "sub", "mul", "mulh", "div", "rem", "and", "or", "xor", "sll", "srl", "sra", "slt", "sltu",
+            "addi", "andi", "ori", "xori", "slli", "srli", "srai", "slti", "sltiu",
+            "mv", "neg", "seqz", "snez",
+            "li", "lui",
+            "lw", "sw",
+            "bnez", "beq", "bne", "blt", "bge", "j", "ret"
+    };
+    return names[opcode];
+}
+
+RiscvFormat riscv_format(RiscvOpcode opcode) {
+    if (opcode <= RV_SLTU) {
+        return RV_FORMAT_REGISTER;
+    } else if (opcode <= RV_SLTIU) {
+        return RV_FORMAT_IMMEDIATE;
+    } else if (opcode <= RV_SNEZ) {
+        return RV_FORMAT_UNARY;
+    }
+    switch (opcode) {
+        case RV_LI:
+        case RV_LUI:
+            return RV_FORMAT_LOAD_IMMEDIATE;
+        case RV_LW:
+            return RV_FORMAT_LOAD;
+        case RV_SW:
+            return RV_FORMAT_STORE;
+        case RV_BNEZ:
+            return RV_FORMAT_BRANCH;
+        case RV_BEQ:
+        case RV_BNE:
+        case RV_BLT:
+        case RV_BGE:
+            return RV_FORMAT_COMPARE_BRANCH;
+        case RV_J:
+            return RV_FORMAT_JUMP;
+        default:
+            return RV_FORMAT_RETURN;
+    }
+}
+
+bool riscv_is_terminator(RiscvOpcode opcode) {
+    auto format = riscv_format(opcode);
+    return format == RV_FORMAT_BRANCH || format == RV_FORMAT_COMPARE_BRANCH || format == RV_FORMAT_JUMP
+           || format == RV_FORMAT_RETURN;
+}
+
+bool riscv_has_def(RiscvOpcode opcode) {
+    auto format = riscv_format(opcode);
+    return format != RV_FORMAT_STORE && !riscv_is_terminator(opcode);
+}
+
+void riscv_invert_branch(MachineInstruction &inst) {
+    switch (inst.opcode) {
+        case RV_BNEZ:
+            inst.opcode = RV_BEQ;
+            inst.rs2 = RV_ZERO;
+            break;
+        case RV_BEQ:
+            inst.opcode = RV_BNE;
+            break;
+        case RV_BNE:
+            inst.opcode = RV_BEQ;
+            break;
+        case RV_BLT:
+            inst.opcode = RV_BGE;
+            break;
+        case RV_BGE:
+            inst.opcode = RV_BLT;
+            break;
+        default:
+            assert(false);
+    }
+}
+
+int riscv_use_operands(MachineInstruction &inst, MachineRegister *operands[2]) {
+    switch (riscv_format(inst.opcode)) {
+        case RV_FORMAT_REGISTER:
+        case RV_FORMAT_STORE:
+        case RV_FORMAT_COMPARE_BRANCH:
+            operands[0] = &inst.rs1;
+            operands[1] = &inst.rs2;
+            return 2;
+        case RV_FORMAT_IMMEDIATE:
+        case RV_FORMAT_UNARY:
+        case RV_FORMAT_LOAD:
+        case RV_FORMAT_BRANCH:
+            operands[0] = &inst.rs1;
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+int riscv_uses(const MachineInstruction &inst, MachineRegister uses[2]) {
+    if (inst.opcode == RV_RET) {
+        uses[0] = RV_A0;
+        return 1;
+    }
+    MachineRegister *operands[2];
+    auto count = riscv_use_operands(const_cast<MachineInstruction &>(inst), operands);
+    int result = 0;
+    for (int i = 0; i < count; i++) {
+        if (*operands[i] != RV_ZERO) {
+            uses[result++] = *operands[i];
+        }
+    }
+    return result;
+}
+
+std::string riscv_register_name(MachineRegister reg) {
+    static const char *names[] = {
+            "zero", "ra", "sp", "gp", "tp", "t0", "t1", "t2", "s0", "s1",
+            "a0", "a1", "a2", "a3", "a4", "a5", "a6", "a7",
+            "s2", "s3", "s4", "s5", "s6", "s7", "s8", "s9", "s10", "s11",
+            "t3", "t4", "t5", "t6"
+    };
+    if (reg < RV_FIRST_VIRTUAL) {
+        return names[reg];
+    }
+    return "%" + std::to_string(reg - RV_FIRST_VIRTUAL);
+}
+
+bool riscv_is_virtual(MachineRegister reg) {
+    return reg >= RV_FIRST_VIRTUAL;
+}
+
+bool riscv_is_callee_saved(MachineRegister reg) {
+    return reg == RV_S0 || reg == RV_S1 || (reg >= RV_S2 && reg <= RV_S11);
+}
+
+bool riscv_fits_immediate(int32_t value) {
+    return value >= -2048 && value <= 2047;
+}
+
+const std::vector<MachineRegister> &riscv_allocatable_registers() {
+    static const std::vector<MachineRegister> registers = [] {
+        std::vector<MachineRegister> result = {RV_T0, RV_T1, RV_T2, RV_T3, RV_T4};
+        for (MachineRegister reg = RV_A0; reg <= RV_A7; reg++) {
+            result.push_back(reg);
+        }
+        result.push_back(RV_S0);
+        result.push_back(RV_S1);
+        for (MachineRegister reg = RV_S2; reg <= RV_S11; reg++) {
+            result.push_back(reg);
+        }
+        return result;
+    }();
+    return registers;
+}
+
+// endregion
+
+MachineBlockId MachineFunction::add_block(const std::string &block_name) {
+    MachineBlock block;
+    block.name = block_name;
+    blocks.push_back(std::move(block));
+    return static_cast<MachineBlockId>(blocks.size() - 1);
+}
+
+int32_t MachineFunction::add_slot(int32_t size) {
+    StackSlot slot;
+    slot.size = size;
+    slots.push_back(slot);
+    return static_cast<int32_t>(slots.size() - 1);
+}
+
+std::vector<MachineBlockId> MachineFunction::successors(MachineBlockId block) const {
+    std::vector<MachineBlockId> result;
+    for (auto &inst: blocks[block].instructions) {
+        if (riscv_is_terminator(inst.opcode) && inst.opcode != RV_RET) {
+            bool seen = false;
+            for (auto successor: result) {
+                seen = seen || successor == inst.target;
+            }
+            if (!seen) {
+                result.push_back(inst.target);
+            }
+        }
+    }
+    auto &instructions = blocks[block].instructions;
+    auto ends = !instructions.empty() && (instructions.back().opcode == RV_J || instructions.back().opcode == RV_RET);
+    if (!ends && block + 1 < blocks.size()
+        && std::find(result.begin(), result.end(), block + 1) == result.end()) {
+        result.push_back(block + 1);
+    }
+    return result;
+}
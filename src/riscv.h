@@ -0,0 +1,202 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// x0 to x31 are the physical registers, from RV_FIRST_VIRTUAL on they are virtual
+typedef uint32_t MachineRegister;
+// Index of a block in its machine function, in layout order; block 0 is the entry.
+typedef uint32_t MachineBlockId;
+
+enum RiscvRegister : MachineRegister {
+    RV_ZERO = 0,
+    RV_RA = 1,
+    RV_SP = 2,
+    RV_T0 = 5,
+    RV_T1 = 6,
+    RV_T2 = 7,
+    RV_S0 = 8,
+    RV_S1 = 9,
+    RV_A0 = 10,
+    RV_A7 = 17,
+    RV_S2 = 18,
+    RV_S11 = 27,
+    RV_T3 = 28,
+    RV_T4 = 29,
+    // never allocated: spilled operands are reloaded into them, and t6 also addresses
+    // stack slots beyond the reach of a 12-bit offset
+    RV_T5 = 30,
+    RV_T6 = 31,
+    RV_FIRST_VIRTUAL = 32
+};
+
+enum RiscvOpcode : uint8_t {
+    // rd, rs1, rs2
+    RV_ADD,
+    RV_SUB,
+    RV_MUL,
+    RV_MULH,
+    RV_DIV,
+    RV_REM,
+    RV_AND,
+    RV_OR,
+    RV_XOR,
+    RV_SLL,
+    RV_SRL,
+    RV_SRA,
+    RV_SLT,
+    RV_SLTU,
+
+    // rd, rs1, imm
+    RV_ADDI,
+    RV_ANDI,
+    RV_ORI,
+    RV_XORI,
+    RV_SLLI,
+    RV_SRLI,
+    RV_SRAI,
+    RV_SLTI,
+    RV_SLTIU,
+
+    // rd, rs1
+    RV_MV,
+    RV_NEG,
+    RV_SEQZ,
+    RV_SNEZ,
+
+    // rd, imm
+    RV_LI,
+    RV_LUI,
+
+    // rd, imm(rs1) and rs2, imm(rs1); addressing a stack slot until the frame is laid out
+    RV_LW,
+    RV_SW,
+
+    // rs1, target; falls through to the next instruction otherwise
+    RV_BNEZ,
+    // rs1, rs2, target; likewise
+    RV_BEQ,
+    RV_BNE,
+    RV_BLT,
+    RV_BGE,
+    RV_J,       // target
+    RV_RET      // returns a0
+};
+
+// how the operands of an opcode are used and printed
+enum RiscvFormat {
+    RV_FORMAT_REGISTER,
+    RV_FORMAT_IMMEDIATE,
+    RV_FORMAT_UNARY,
+    RV_FORMAT_LOAD_IMMEDIATE,
+    RV_FORMAT_LOAD,
+    RV_FORMAT_STORE,
+    RV_FORMAT_BRANCH,
+    RV_FORMAT_COMPARE_BRANCH,
+    RV_FORMAT_JUMP,
+    RV_FORMAT_RETURN
+};
+
+struct MachineInstruction {
+    RiscvOpcode opcode;
+    MachineRegister rd = RV_ZERO;
+    MachineRegister rs1 = RV_ZERO;
+    MachineRegister rs2 = RV_ZERO;
+    int32_t imm = 0;
+    // RV_LW and RV_SW: the stack slot behind imm(sp), -1 once the frame is laid out
+    int32_t slot = -1;
+    // branches and RV_J
+    MachineBlockId target = 0;
+};
+
+struct MachineBlock {
+    std::string name;
+    std::vector<MachineInstruction> instructions;
+    // how many loops of the source it is in, for weighing spill costs
+    int loop_depth = 0;
+};
+
+struct StackSlot {
+    int32_t size = 4;
+    // from sp, known once the frame is laid out
+    int32_t offset = -1;
+};
+
+/**
+ * A function as RISC-V instructions, on virtual registers until register allocation
+ * rewrites them. Control leaves a block through its trailing branches, jump or return;
+ * only block layout, the last step, lets a block without a jump or return at its end
+ * fall through to the next one.
+ */
+class MachineFunction {
+public:
+    std::string name;
+    std::vector<MachineBlock> blocks;
+    std::vector<StackSlot> slots;
+    // bytes below the caller's sp, 0 until the frame is laid out
+    int32_t frame_size = 0;
+
+    explicit MachineFunction(const std::string &name) : name(name) {
+    }
+
+    MachineBlockId add_block(const std::string &block_name);
+
+    MachineRegister new_register() {
+        return _next_register++;
+    }
+
+    // one past the highest register in use, physical ones included
+    MachineRegister register_count() const {
+        return _next_register;
+    }
+
+    int32_t add_slot(int32_t size = 4);
+
+    std::vector<MachineBlockId> successors(MachineBlockId block) const;
+
+private:
+    MachineRegister _next_register = RV_FIRST_VIRTUAL;
+};
+
+class MachineModule {
+public:
+    std::vector<std::unique_ptr<MachineFunction>> functions;
+};
+
+// region: opcode and register properties
+
+const char *riscv_opcode_name(RiscvOpcode opcode);
+
+RiscvFormat riscv_format(RiscvOpcode opcode);
+
+bool riscv_is_terminator(RiscvOpcode opcode);
+
+// rd is written
+bool riscv_has_def(RiscvOpcode opcode);
+
+// turns a conditional branch into the one taken exactly when it is not; bnez becomes beq
+// against x0
+void riscv_invert_branch(MachineInstruction &inst);
+
+// the registers an instruction reads, at most two, x0 left out; a return reads a0
+int riscv_uses(const MachineInstruction &inst, MachineRegister uses[2]);
+
+// pointers to the register operands it reads, for rewriting them in place
+int riscv_use_operands(MachineInstruction &inst, MachineRegister *operands[2]);
+
+// ABI name, or %N for a virtual register
+std::string riscv_register_name(MachineRegister reg);
+
+bool riscv_is_virtual(MachineRegister reg);
+
+bool riscv_is_callee_saved(MachineRegister reg);
+
+// fits the 12-bit signed immediate of the I-type and S-type formats
+bool riscv_fits_immediate(int32_t value);
+
+// the registers handed out by the allocators, caller-saved ones first
+const std::vector<MachineRegister> &riscv_allocatable_registers();
+
+// endregion
@@ -0,0 +1,46 @@
+#include "riscv_backend.h"
+
+#include <iostream>
+#include "block_layout.h"
+#include "constant_materialization.h"
+#include "graph_coloring.h"
+#include "linear_scan.h"
+#include "peephole.h"
+#include "riscv_frame.h"
+#include "riscv_isel.h"
+
+std::unique_ptr<MachineModule> RiscvBackend::generate(const IrModule &module) {
+    auto result = std::make_unique<MachineModule>();
+    for (auto &function: module.functions) {
+        result->functions.push_back(std::make_unique<MachineFunction>(function->name));
+        generate(*function, *result->functions.back());
+    }
+    return result;
+}
+
+void RiscvBackend::generate(const IrFunction &function, MachineFunction &machine) {
+    RiscvSelector().run(function, machine).print(function.name);
+    RiscvScheduler scheduler(_latencies);
+    if (_level >= 1) {
+        scheduler.run(machine).print("schedule", function.name);
+    }
+    if (_level < 2) {
+        LinearScan().run(machine).print("linear-scan", function.name);
+    } else {
+        auto copy = machine;
+        auto before = LinearScan().run(copy);
+        auto after = GraphColoring().run(machine);
+        after.print("irc", function.name);
+        std::cout << "register allocation @" << function.name << ": spills " << before.spilled << " -> "
+                  << after.spilled << ", moves " << before.moves << " -> " << after.moves << std::endl;
+    }
+    if (_level >= 1) {
+        scheduler.run(machine).print("post-ra-schedule", function.name);
+    }
+    lower_frame(machine).print(function.name);
+    if (_level >= 1) {
+        BlockLayout().run(machine).print(function.name);
+        Peephole().run(machine).print(function.name);
+        ConstantMaterialization().run(machine).print(function.name);
+    }
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <memory>
+#include "ir.h"
+#include "riscv.h"
+#include "riscv_scheduler.h"
+
+/**
+ * From optimised IR to finished RISC-V functions: instruction selection, register
+ * allocation and the stack frame, printing what each step did. From -O1 on, instructions
+ * are scheduled for `latencies` before and after register allocation, the blocks are laid
+ * out to fall through along likely paths, a peephole pass tidies up what is left, and
+ * constants are built in as few instructions as their values and their neighbours allow.
+ *
+ * Registers are allocated by linear scan, and from -O2 on by graph colouring; there the
+ * spills and moves linear scan would have left are reported next to what colouring left.
+ */
+class RiscvBackend {
+public:
+    explicit RiscvBackend(int level = 1, const RiscvLatencyModel &latencies = RiscvLatencyModel())
+            : _level(level), _latencies(latencies) {
+    }
+
+    std::unique_ptr<MachineModule> generate(const IrModule &module);
+
+    void generate(const IrFunction &function, MachineFunction &machine);
+
+private:
+    int _level;
+    RiscvLatencyModel _latencies;
+};
@@ -0,0 +1,244 @@
+#include "riscv_frame.h"
+
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+#include <vector>
+
+void FrameStatistics::print(const std::string &function) const {
+    std::cout << "frame @" << function << ": " << slots_dropped << " slots dropped, " << slots_shared
+              << " slots shared, " << bytes_before << " -> " << bytes_after << " bytes" << std::endl;
+}
+
+static MachineInstruction make(RiscvOpcode opcode, MachineRegister rd, MachineRegister rs1, MachineRegister rs2,
+                               int32_t imm) {
+    MachineInstruction inst;
+    inst.opcode = opcode;
+    inst.rd = rd;
+    inst.rs1 = rs1;
+    inst.rs2 = rs2;
+    inst.imm = imm;
+    return inst;
+}
+
+// sp += amount
+static void adjust_stack(std::vector<MachineInstruction> &code, int32_t amount) {
+    if (riscv_fits_immediate(amount)) {
+        code.push_back(make(RV_ADDI, RV_SP, RV_SP, RV_ZERO, amount));
+    } else {
+        code.push_back(make(RV_LI, RV_T6, RV_ZERO, RV_ZERO, amount));
+        code.push_back(make(RV_ADD, RV_SP, RV_SP, RV_T6, 0));
+    }
+}
+
+// region: slot coloring
+
+// stores to all of a slot, ending its lifetime above
+static bool kills_slot(const MachineFunction &function, const MachineInstruction &inst) {
+    return inst.opcode == RV_SW && inst.slot >= 0 && inst.imm == 0 && function.slots[inst.slot].size == 4;
+}
+
+// loads, and addresses taken
+static bool reads_slot(const MachineInstruction &inst) {
+    return inst.slot >= 0 && inst.opcode != RV_SW;
+}
+
+// live slots before `inst`, given those after it
+static void step_back(const MachineFunction &function, const MachineInstruction &inst, std::vector<bool> &live) {
+    if (kills_slot(function, inst)) {
+        live[inst.slot] = false;
+    }
+    if (reads_slot(inst)) {
+        live[inst.slot] = true;
+    }
+}
+
+static std::vector<std::vector<bool>> slot_live_out(const MachineFunction &function) {
+    auto count = function.slots.size();
+    std::vector<std::vector<bool>> live_in(function.blocks.size(), std::vector<bool>(count, false));
+    auto live_out = live_in;
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (auto block = function.blocks.size(); block-- > 0;) {
+            std::vector<bool> live(count, false);
+            for (auto successor: function.successors(block)) {
+                for (size_t slot = 0; slot < count; slot++) {
+                    live[slot] = live[slot] || live_in[successor][slot];
+                }
+            }
+            live_out[block] = live;
+            auto &instructions = function.blocks[block].instructions;
+            for (auto inst = instructions.rbegin(); inst != instructions.rend(); inst++) {
+                step_back(function, *inst, live);
+            }
+            if (live != live_in[block]) {
+                live_in[block] = std::move(live);
+                changed = true;
+            }
+        }
+    }
+    return live_out;
+}
+
+// gives each slot an offset from `base` on, returning where the highest one ends
+static int32_t color_slots(MachineFunction &function, int32_t base, FrameStatistics &statistics) {
+    auto count = function.slots.size();
+    std::vector<bool> read(count, false);
+    std::vector<bool> address_taken(count, false);
+    for (auto &block: function.blocks) {
+        for (auto &inst: block.instructions) {
+            if (reads_slot(inst)) {
+                read[inst.slot] = true;
+                address_taken[inst.slot] = address_taken[inst.slot] || inst.opcode == RV_ADDI;
+            }
+        }
+    }
+    auto unread = [&read](const MachineInstruction &inst) {
+        return inst.opcode == RV_SW && inst.slot >= 0 && !read[inst.slot];
+    };
+    for (auto &block: function.blocks) {
+        auto &instructions = block.instructions;
+        instructions.erase(std::remove_if(instructions.begin(), instructions.end(), unread), instructions.end());
+    }
+
+    // region: interference
+    std::vector<std::vector<bool>> interferes(count, std::vector<bool>(count, false));
+    auto add_edge = [&interferes](size_t a, size_t b) {
+        interferes[a][b] = interferes[b][a] = a != b;
+    };
+    auto live_out = slot_live_out(function);
+    for (MachineBlockId block = 0; block < function.blocks.size(); block++) {
+        auto live = live_out[block];
+        auto &instructions = function.blocks[block].instructions;
+        for (auto inst = instructions.rbegin(); inst != instructions.rend(); inst++) {
+            if (inst->opcode == RV_SW && inst->slot >= 0) {
+                for (size_t slot = 0; slot < count; slot++) {
+                    if (live[slot]) {
+                        add_edge(inst->slot, slot);
+                    }
+                }
+            }
+            step_back(function, *inst, live);
+        }
+    }
+    // where its address goes is not followed, so it keeps its storage to itself
+    for (size_t slot = 0; slot < count; slot++) {
+        for (size_t other = 0; other < count && address_taken[slot]; other++) {
+            add_edge(slot, other);
+        }
+    }
+    // endregion
+
+    std::vector<size_t> order;
+    for (size_t slot = 0; slot < count; slot++) {
+        if (read[slot]) {
+            order.push_back(slot);
+        } else {
+            statistics.slots_dropped++;
+        }
+    }
+    std::stable_sort(order.begin(), order.end(), [&function](size_t a, size_t b) {
+        return function.slots[a].size > function.slots[b].size;
+    });
+    int32_t end = base;
+    std::vector<size_t> placed;
+    for (auto slot: order) {
+        auto size = function.slots[slot].size;
+        std::vector<std::pair<int32_t, int32_t>> taken;
+        for (auto other: placed) {
+            auto &range = function.slots[other];
+            if (interferes[slot][other]) {
+                taken.emplace_back(range.offset, range.offset + range.size);
+            }
+        }
+        std::sort(taken.begin(), taken.end());
+        auto offset = base;
+        for (auto &range: taken) {
+            if (offset + size <= range.first) {
+                break;
+            }
+            offset = std::max(offset, range.second);
+        }
+        function.slots[slot].offset = offset;
+        statistics.slots_shared += offset < end;
+        end = std::max(end, offset + size);
+        placed.push_back(slot);
+    }
+    return end;
+}
+
+// endregion
+
+FrameStatistics lower_frame(MachineFunction &function) {
+    FrameStatistics statistics;
+    std::vector<bool> written(RV_FIRST_VIRTUAL, false);
+    for (auto &block: function.blocks) {
+        for (auto &inst: block.instructions) {
+            assert(!riscv_has_def(inst.opcode) || !riscv_is_virtual(inst.rd));
+            if (riscv_has_def(inst.opcode)) {
+                written[inst.rd] = true;
+            }
+        }
+    }
+    std::vector<MachineRegister> saved;
+    for (MachineRegister reg = 0; reg < RV_FIRST_VIRTUAL; reg++) {
+        if (written[reg] && riscv_is_callee_saved(reg)) {
+            saved.push_back(reg);
+        }
+    }
+
+    auto base = 4 * static_cast<int32_t>(saved.size());
+    auto naive = base;
+    for (auto &slot: function.slots) {
+        naive += slot.size;
+    }
+    statistics.bytes_before = (naive + 15) & ~15;
+    function.frame_size = (color_slots(function, base, statistics) + 15) & ~15;
+    statistics.bytes_after = function.frame_size;
+    auto frame = function.frame_size;
+
+    for (MachineBlockId block = 0; block < function.blocks.size(); block++) {
+        std::vector<MachineInstruction> code;
+        if (block == 0 && frame != 0) {
+            adjust_stack(code, -frame);
+            for (size_t i = 0; i < saved.size(); i++) {
+                code.push_back(make(RV_SW, RV_ZERO, RV_SP, saved[i], static_cast<int32_t>(4 * i)));
+            }
+        }
+        for (auto &inst: function.blocks[block].instructions) {
+            if (inst.opcode == RV_RET && frame != 0) {
+                for (size_t i = 0; i < saved.size(); i++) {
+                    code.push_back(make(RV_LW, saved[i], RV_SP, RV_ZERO, static_cast<int32_t>(4 * i)));
+                }
+                adjust_stack(code, frame);
+            }
+            if (inst.slot < 0) {
+                code.push_back(inst);
+                continue;
+            }
+            auto offset = function.slots[inst.slot].offset + inst.imm;
+            if (riscv_fits_immediate(offset)) {
+                auto resolved = inst;
+                resolved.slot = -1;
+                resolved.imm = offset;
+                code.push_back(resolved);
+            } else if (inst.opcode == RV_LW) {
+                // the loaded register is free to hold the address first
+                code.push_back(make(RV_LI, inst.rd, RV_ZERO, RV_ZERO, offset));
+                code.push_back(make(RV_ADD, inst.rd, inst.rd, RV_SP, 0));
+                code.push_back(make(RV_LW, inst.rd, inst.rd, RV_ZERO, 0));
+            } else if (inst.opcode == RV_ADDI) {
+                // the address of a slot itself
+                code.push_back(make(RV_LI, inst.rd, RV_ZERO, RV_ZERO, offset));
+                code.push_back(make(RV_ADD, inst.rd, inst.rd, RV_SP, 0));
+            } else {
+                assert(inst.rs2 != RV_T6);
+                code.push_back(make(RV_LI, RV_T6, RV_ZERO, RV_ZERO, offset));
+                code.push_back(make(RV_ADD, RV_T6, RV_T6, RV_SP, 0));
+                code.push_back(make(RV_SW, RV_ZERO, RV_T6, inst.rs2, 0));
+            }
+        }
+        function.blocks[block].instructions = std::move(code);
+    }
+    return statistics;
+}
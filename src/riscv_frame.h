@@ -0,0 +1,34 @@
+#pragma once
+
+#include <string>
+#include "riscv.h"
+
+class FrameStatistics {
+public:
+    // never read, so gone along with their stores
+    size_t slots_dropped = 0;
+    // placed over the storage of another slot with a disjoint lifetime
+    size_t slots_shared = 0;
+    // with a slot of its own for every stack slot
+    int32_t bytes_before = 0;
+    int32_t bytes_after = 0;
+
+    void print(const std::string &function) const;
+};
+
+/**
+ * Lays out the stack frame once registers are allocated and makes it explicit in the code.
+ *
+ * The callee-saved registers the function writes go at the bottom of the frame, so their
+ * offsets are always small, and the stack slots above them; the total is rounded up to the
+ * 16 bytes the ABI keeps sp aligned to, and no further. Slots are colored like registers:
+ * two slots interfere when one is stored to while the other is live, and each goes at the
+ * lowest offset clear of the slots it interferes with, largest first, so slots with
+ * disjoint lifetimes share storage. Slots never read take no storage at all.
+ *
+ * The prologue goes at the start of the entry block and an epilogue before every return,
+ * and stack slot operands become offsets from sp, through t6 where the offset needs more
+ * than 12 bits. A function without slots or saved registers, as most leaves end up, gets
+ * no frame at all.
+ */
+FrameStatistics lower_frame(MachineFunction &function);
@@ -0,0 +1,346 @@
+#include "riscv_isel.h"
+
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+#include "cfg.h"
+
+void RiscvSelectionStatistics::print(const std::string &function) const {
+    std::cout << "isel @" << function << ": " << instructions << " instructions, " << phi_copies
+              << " phi copies, " << edges_split << " edges split, " << branches_fused << " branches fused"
+              << std::endl;
+}
+
+RiscvSelectionStatistics RiscvSelector::run(const IrFunction &function, MachineFunction &machine) {
+    _function = &function;
+    _machine = &machine;
+    _statistics = RiscvSelectionStatistics();
+    _registers.assign(function.instructions.size(), 0);
+    _slots.assign(function.instructions.size(), -1);
+    _blocks.assign(function.blocks.size(), 0);
+
+    // every block exists before any branch needs it as a target
+    ControlFlowGraph cfg(function);
+    DominatorTree dominators(cfg);
+    LoopForest loops(cfg, dominators);
+    for (auto block: function.layout) {
+        _blocks[block] = machine.add_block(function.blocks[block].name);
+        machine.blocks[_blocks[block]].loop_depth = cfg.reachable(block) ? loops.depth(block) : 0;
+    }
+    for (auto block: function.layout) {
+        _block = _blocks[block];
+        for (auto inst = function.blocks[block].first; inst != 0; inst = function[inst].next) {
+            select(inst);
+        }
+    }
+
+    for (auto &block: machine.blocks) {
+        _statistics.instructions += block.instructions.size();
+    }
+    return _statistics;
+}
+
+// region: helpers
+
+MachineInstruction &RiscvSelector::emit(RiscvOpcode opcode, MachineRegister rd, MachineRegister rs1,
+                                        MachineRegister rs2, int32_t imm) {
+    MachineInstruction inst;
+    inst.opcode = opcode;
+    inst.rd = rd;
+    inst.rs1 = rs1;
+    inst.rs2 = rs2;
+    inst.imm = imm;
+    auto &instructions = _machine->blocks[_block].instructions;
+    instructions.push_back(inst);
+    return instructions.back();
+}
+
+MachineRegister RiscvSelector::result(IrValueId value) {
+    if (_registers[value] == 0) {
+        _registers[value] = _machine->new_register();
+    }
+    return _registers[value];
+}
+
+MachineRegister RiscvSelector::operand(IrValueId value) {
+    auto &inst = (*_function)[value];
+    if (inst.opcode == IR_UNDEF || (inst.opcode == IR_CONST && inst.immediate == 0)) {
+        return RV_ZERO;
+    } else if (inst.opcode == IR_CONST) {
+        auto reg = _machine->new_register();
+        emit(RV_LI, reg).imm = inst.immediate;
+        return reg;
+    }
+    // the address of a slot is never a value of its own
+    assert(inst.opcode != IR_ALLOCA);
+    return result(value);
+}
+
+// endregion
+
+void RiscvSelector::select(IrValueId inst) {
+    auto &function = *_function;
+    auto &record = function[inst];
+    switch (record.opcode) {
+        case IR_ALLOCA:
+            _slots[inst] = _machine->add_slot();
+            break;
+        case IR_LOAD: {
+            auto address = function.operand(inst, 0);
+            assert(_slots[address] >= 0);
+            emit(RV_LW, result(inst), RV_SP).slot = _slots[address];
+            break;
+        }
+        case IR_STORE: {
+            auto address = function.operand(inst, 1);
+            assert(_slots[address] >= 0);
+            auto value = operand(function.operand(inst, 0));
+            emit(RV_SW, RV_ZERO, RV_SP, value).slot = _slots[address];
+            break;
+        }
+        case IR_PHI:
+            // defined by the copies on the incoming edges
+            result(inst);
+            break;
+        case IR_BR: {
+            auto condition = function.operand(inst, 0);
+            auto if_true = edge(record.block, record.targets[0]);
+            auto if_false = edge(record.block, record.targets[1]);
+            if (fused(condition)) {
+                select_compare_branch(condition, if_true);
+            } else {
+                emit(RV_BNEZ, RV_ZERO, operand(condition)).target = if_true;
+            }
+            emit(RV_J).target = if_false;
+            break;
+        }
+        case IR_JUMP:
+            copy_phis(record.block, record.targets[0]);
+            emit(RV_J).target = _blocks[record.targets[0]];
+            break;
+        case IR_RET: {
+            auto value = function.operand(inst, 0);
+            if (function.is_constant(value)) {
+                emit(RV_LI, RV_A0).imm = function.constant_value(value);
+            } else if (function[value].opcode != IR_UNDEF) {
+                emit(RV_MV, RV_A0, operand(value));
+            }
+            emit(RV_RET);
+            break;
+        }
+        default:
+            assert(ir_is_binary(record.opcode));
+            if (!fused(inst)) {
+                select_binary(inst);
+            }
+            break;
+    }
+}
+
+void RiscvSelector::select_binary(IrValueId inst) {
+    auto &function = *_function;
+    auto opcode = function[inst].opcode;
+    auto lhs = function.operand(inst, 0);
+    auto rhs = function.operand(inst, 1);
+    // a constant on the left of a commutative operator is as good as on the right
+    if (ir_is_commutative(opcode) && function.is_constant(lhs) && !function.is_constant(rhs)) {
+        std::swap(lhs, rhs);
+    }
+    auto rd = result(inst);
+    auto constant = function.is_constant(rhs);
+    auto value = constant ? function.constant_value(rhs) : 0;
+    auto immediate = constant && riscv_fits_immediate(value);
+
+    switch (opcode) {
+        case IR_ADD:
+        case IR_AND:
+        case IR_OR:
+        case IR_XOR: {
+            static const RiscvOpcode registers[] = {RV_ADD, RV_AND, RV_OR, RV_XOR};
+            static const RiscvOpcode immediates[] = {RV_ADDI, RV_ANDI, RV_ORI, RV_XORI};
+            auto index = opcode == IR_ADD ? 0 : opcode - IR_AND + 1;
+            if (immediate) {
+                emit(immediates[index], rd, operand(lhs), RV_ZERO, value);
+            } else {
+                emit(registers[index], rd, operand(lhs), operand(rhs));
+            }
+            break;
+        }
+        case IR_SUB:
+            if (constant && value != INT32_MIN && riscv_fits_immediate(-value)) {
+                emit(RV_ADDI, rd, operand(lhs), RV_ZERO, -value);
+            } else if (function.is_constant(lhs) && function.constant_value(lhs) == 0) {
+                emit(RV_NEG, rd, operand(rhs));
+            } else {
+                emit(RV_SUB, rd, operand(lhs), operand(rhs));
+            }
+            break;
+        case IR_MUL:
+        case IR_MULH:
+        case IR_DIV:
+        case IR_REM: {
+            static const RiscvOpcode registers[] = {RV_MUL, RV_MULH, RV_DIV, RV_REM};
+            emit(registers[opcode - IR_MUL], rd, operand(lhs), operand(rhs));
+            break;
+        }
+        case IR_SHL:
+        case IR_SHR:
+        case IR_SAR: {
+            static const RiscvOpcode registers[] = {RV_SLL, RV_SRL, RV_SRA};
+            static const RiscvOpcode immediates[] = {RV_SLLI, RV_SRLI, RV_SRAI};
+            if (constant) {
+                emit(immediates[opcode - IR_SHL], rd, operand(lhs), RV_ZERO, value & 31);
+            } else {
+                emit(registers[opcode - IR_SHL], rd, operand(lhs), operand(rhs));
+            }
+            break;
+        }
+        case IR_LT:
+            select_less(rd, lhs, rhs);
+            break;
+        case IR_GT:
+            select_less(rd, rhs, lhs);
+            break;
+        case IR_LE:
+        case IR_GE: {
+            // the negation of the strict comparison the other way round
+            auto less = _machine->new_register();
+            if (opcode == IR_LE) {
+                select_less(less, rhs, lhs);
+            } else {
+                select_less(less, lhs, rhs);
+            }
+            emit(RV_XORI, rd, less, RV_ZERO, 1);
+            break;
+        }
+        case IR_EQ:
+        case IR_NE: {
+            auto test = opcode == IR_EQ ? RV_SEQZ : RV_SNEZ;
+            if (constant && value == 0) {
+                emit(test, rd, operand(lhs));
+                break;
+            }
+            auto difference = _machine->new_register();
+            if (immediate) {
+                emit(RV_XORI, difference, operand(lhs), RV_ZERO, value);
+            } else {
+                emit(RV_XOR, difference, operand(lhs), operand(rhs));
+            }
+            emit(test, rd, difference);
+            break;
+        }
+        default:
+            assert(false);
+    }
+}
+
+void RiscvSelector::select_less(MachineRegister rd, IrValueId lhs, IrValueId rhs) {
+    auto &function = *_function;
+    if (function.is_constant(rhs) && riscv_fits_immediate(function.constant_value(rhs))) {
+        emit(RV_SLTI, rd, operand(lhs), RV_ZERO, function.constant_value(rhs));
+    } else {
+        emit(RV_SLT, rd, operand(lhs), operand(rhs));
+    }
+}
+
+bool RiscvSelector::fused(IrValueId value) const {
+    auto &function = *_function;
+    auto &record = function[value];
+    if (record.opcode < IR_EQ || record.opcode > IR_GE || function.use_count(value) != 1) {
+        return false;
+    }
+    auto last = function.blocks[record.block].last;
+    return function[last].opcode == IR_BR && function.operand(last, 0) == value;
+}
+
+void RiscvSelector::select_compare_branch(IrValueId comparison, MachineBlockId target) {
+    auto &function = *_function;
+    auto opcode = function[comparison].opcode;
+    auto lhs = function.operand(comparison, 0);
+    auto rhs = function.operand(comparison, 1);
+    // a > b is b < a, and a <= b is b >= a
+    if (opcode == IR_GT || opcode == IR_LE) {
+        std::swap(lhs, rhs);
+    }
+    static const RiscvOpcode branches[] = {RV_BEQ, RV_BNE, RV_BLT, RV_BLT, RV_BGE, RV_BGE};
+    emit(branches[opcode - IR_EQ], RV_ZERO, operand(lhs), operand(rhs)).target = target;
+    _statistics.branches_fused++;
+}
+
+// region: out of SSA
+
+MachineBlockId RiscvSelector::edge(IrBlockId from, IrBlockId to) {
+    auto &function = *_function;
+    auto first = function.blocks[to].first;
+    if (first == 0 || function[first].opcode != IR_PHI) {
+        return _blocks[to];
+    }
+    auto block = _block;
+    auto split = _machine->add_block(function.blocks[from].name + "_" + function.blocks[to].name);
+    // in a loop only if both ends are
+    _machine->blocks[split].loop_depth = std::min(_machine->blocks[_blocks[from]].loop_depth,
+                                                  _machine->blocks[_blocks[to]].loop_depth);
+    _statistics.edges_split++;
+    _block = split;
+    copy_phis(from, to);
+    emit(RV_J).target = _blocks[to];
+    _block = block;
+    return split;
+}
+
+void RiscvSelector::copy_phis(IrBlockId from, IrBlockId to) {
+    auto &function = *_function;
+    // destination and source registers of the parallel copy, and phis set to constants
+    std::vector<std::pair<MachineRegister, MachineRegister>> pending;
+    std::vector<std::pair<MachineRegister, IrValueId>> constants;
+    for (auto phi = function.blocks[to].first; phi != 0 && function[phi].opcode == IR_PHI; phi = function[phi].next) {
+        for (uint32_t i = 0; i < function[phi].operand_count; i++) {
+            if (function.incoming_block(phi, i) != from) {
+                continue;
+            }
+            auto value = function.operand(phi, i);
+            if (function.is_constant(value)) {
+                constants.emplace_back(result(phi), value);
+            } else if (function[value].opcode != IR_UNDEF && result(value) != result(phi)) {
+                pending.emplace_back(result(phi), result(value));
+            }
+        }
+    }
+
+    while (!pending.empty()) {
+        // a copy whose destination no other copy still has to read
+        size_t ready = pending.size();
+        for (size_t i = 0; i < pending.size() && ready == pending.size(); i++) {
+            bool read = false;
+            for (auto &copy: pending) {
+                read = read || copy.second == pending[i].first;
+            }
+            if (!read) {
+                ready = i;
+            }
+        }
+        if (ready == pending.size()) {
+            // only cycles are left: save one destination and let its readers use the copy
+            auto saved = _machine->new_register();
+            auto destination = pending.front().first;
+            emit(RV_MV, saved, destination);
+            _statistics.phi_copies++;
+            for (auto &copy: pending) {
+                if (copy.second == destination) {
+                    copy.second = saved;
+                }
+            }
+            ready = 0;
+        }
+        emit(RV_MV, pending[ready].first, pending[ready].second);
+        _statistics.phi_copies++;
+        pending.erase(pending.begin() + static_cast<long>(ready));
+    }
+    // they read no register, so they can go last
+    for (auto &copy: constants) {
+        emit(RV_LI, copy.first).imm = function.constant_value(copy.second);
+        _statistics.phi_copies++;
+    }
+}
+
+// endregion
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+#include "ir.h"
+#include "riscv.h"
+
+class RiscvSelectionStatistics {
+public:
+    size_t instructions = 0;
+    size_t phi_copies = 0;
+    size_t edges_split = 0;
+    // comparisons selected as part of a branch, never held in a register
+    size_t branches_fused = 0;
+
+    void print(const std::string &function) const;
+};
+
+/**
+ * Lowers an SSA function to RISC-V instructions on virtual registers, one IR value to
+ * one register.
+ *
+ * Constants that fit go into the immediate forms, 0 is read from x0 and any other constant
+ * is loaded with li right where it is used. Allocas become stack slots, which only loads
+ * and stores address.
+ *
+ * Phis are taken out of SSA on the way: every edge into a block with phis gets the copies
+ * for them, sequentialised from the parallel copy so that a cycle among phis goes through
+ * one temporary. Edges from a branch are split for this, copies on a jump sit right before it.
+ */
+class RiscvSelector {
+public:
+    RiscvSelectionStatistics run(const IrFunction &function, MachineFunction &machine);
+
+private:
+    const IrFunction *_function = nullptr;
+    MachineFunction *_machine = nullptr;
+    MachineBlockId _block = 0;
+    // per IR value, 0 until the value is first needed
+    std::vector<MachineRegister> _registers;
+    // per alloca
+    std::vector<int32_t> _slots;
+    std::vector<MachineBlockId> _blocks;
+    RiscvSelectionStatistics _statistics;
+
+    MachineInstruction &emit(RiscvOpcode opcode, MachineRegister rd = RV_ZERO, MachineRegister rs1 = RV_ZERO,
+                             MachineRegister rs2 = RV_ZERO, int32_t imm = 0);
+
+    // the register defined by an instruction
+    MachineRegister result(IrValueId value);
+
+    // a register holding `value`, loading constants on the spot
+    MachineRegister operand(IrValueId value);
+
+    void select(IrValueId inst);
+
+    void select_binary(IrValueId inst);
+
+    // rd = lhs < rhs, with the immediate form when rhs allows it
+    void select_less(MachineRegister rd, IrValueId lhs, IrValueId rhs);
+
+    // a comparison whose only use is the branch ending its block
+    bool fused(IrValueId value) const;
+
+    // branches to `target` if the comparison holds: blt, bge, beq or bne on its operands
+    void select_compare_branch(IrValueId comparison, MachineBlockId target);
+
+    // the block a branch from `from` to `to` goes to, a new one holding the copies if `to` has phis
+    MachineBlockId edge(IrBlockId from, IrBlockId to);
+
+    // the copies for the phis of `to` along the edge from `from`, into the current block
+    void copy_phis(IrBlockId from, IrBlockId to);
+};
@@ -0,0 +1,234 @@
+#include "riscv_scheduler.h"
+
+#include <algorithm>
+#include <iostream>
+#include <unordered_map>
+#include "machine_liveness.h"
+
+int RiscvLatencyModel::latency(RiscvOpcode opcode) const {
+    switch (opcode) {
+        case RV_LW:
+            return load;
+        case RV_MUL:
+        case RV_MULH:
+            return multiply;
+        case RV_DIV:
+        case RV_REM:
+            return divide;
+        default:
+            return 1;
+    }
+}
+
+void SchedulingStatistics::print(const std::string &phase, const std::string &function) const {
+    std::cout << phase << " @" << function << ": " << blocks_reordered << " blocks reordered, "
+              << blocks_kept_for_pressure << " kept for register pressure, stalls " << stalls_before << " -> "
+              << stalls_after << std::endl;
+}
+
+// before register allocation, when some register is still virtual
+static bool has_virtual_registers(const MachineFunction &function) {
+    for (auto &block: function.blocks) {
+        for (auto &inst: block.instructions) {
+            MachineRegister uses[2];
+            auto count = riscv_uses(inst, uses);
+            for (int k = 0; k < count; k++) {
+                if (riscv_is_virtual(uses[k])) {
+                    return true;
+                }
+            }
+            if (riscv_has_def(inst.opcode) && riscv_is_virtual(inst.rd)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+SchedulingStatistics RiscvScheduler::run(MachineFunction &function) const {
+    SchedulingStatistics statistics;
+    MachineLiveness liveness(function);
+    auto pin_physical = has_virtual_registers(function);
+    for (MachineBlockId id = 0; id < function.blocks.size(); id++) {
+        auto &block = function.blocks[id];
+        auto before = stalls(block);
+        statistics.stalls_before += before;
+        MachineBlock scheduled = block;
+        scheduled.instructions = schedule(block.instructions, pin_physical);
+        auto after = stalls(scheduled);
+        if (after >= before) {
+            statistics.stalls_after += before;
+            continue;
+        }
+        auto pressure = register_pressure(scheduled.instructions, liveness.live_out(id));
+        if (pressure > riscv_allocatable_registers().size()
+            && pressure > register_pressure(block.instructions, liveness.live_out(id))) {
+            statistics.blocks_kept_for_pressure++;
+            statistics.stalls_after += before;
+            continue;
+        }
+        block.instructions = std::move(scheduled.instructions);
+        statistics.blocks_reordered++;
+        statistics.stalls_after += after;
+    }
+    return statistics;
+}
+
+size_t RiscvScheduler::stalls(const MachineBlock &block) const {
+    // the cycle each register written in the block can be read from
+    std::unordered_map<MachineRegister, size_t> ready;
+    size_t cycle = 0;
+    size_t result = 0;
+    for (auto &inst: block.instructions) {
+        auto issue = cycle;
+        MachineRegister uses[2];
+        auto count = riscv_uses(inst, uses);
+        for (int i = 0; i < count; i++) {
+            auto found = ready.find(uses[i]);
+            if (found != ready.end()) {
+                issue = std::max(issue, found->second);
+            }
+        }
+        result += issue - cycle;
+        if (riscv_has_def(inst.opcode) && inst.rd != RV_ZERO) {
+            ready[inst.rd] = issue + _latencies.latency(inst.opcode);
+        }
+        cycle = issue + 1;
+    }
+    return result;
+}
+
+// two stack accesses that may touch the same word
+static bool may_alias(const MachineInstruction &a, const MachineInstruction &b) {
+    if (a.slot >= 0 && b.slot >= 0) {
+        return a.slot == b.slot && a.imm == b.imm;
+    }
+    if (a.slot < 0 && b.slot < 0 && a.rs1 == RV_SP && b.rs1 == RV_SP) {
+        return a.imm == b.imm;
+    }
+    return true;
+}
+
+std::vector<MachineInstruction> RiscvScheduler::schedule(const std::vector<MachineInstruction> &instructions,
+                                                         bool pin_physical) const {
+    auto size = instructions.size();
+    while (size > 0 && riscv_is_terminator(instructions[size - 1].opcode)) {
+        size--;
+    }
+
+    // region: dependence DAG
+    struct Edge {
+        size_t to;
+        int latency;
+    };
+    std::vector<std::vector<Edge>> successors(size);
+    std::vector<int> predecessors(size, 0);
+    auto depend = [&](size_t from, size_t to, int latency) {
+        successors[from].push_back({to, latency});
+        predecessors[to]++;
+    };
+    std::unordered_map<MachineRegister, size_t> last_write;
+    std::unordered_map<MachineRegister, std::vector<size_t>> reads;
+    std::vector<size_t> memory;
+    for (size_t i = 0; i < size; i++) {
+        auto &inst = instructions[i];
+        MachineRegister uses[2];
+        auto count = riscv_uses(inst, uses);
+        for (int k = 0; k < count; k++) {
+            auto write = last_write.find(uses[k]);
+            if (write != last_write.end()) {
+                depend(write->second, i, _latencies.latency(instructions[write->second].opcode));
+            }
+            reads[uses[k]].push_back(i);
+        }
+        if (riscv_has_def(inst.opcode) && inst.rd != RV_ZERO) {
+            for (auto read: reads[inst.rd]) {
+                if (read != i) {
+                    depend(read, i, 0);
+                }
+            }
+            reads[inst.rd].clear();
+            auto write = last_write.find(inst.rd);
+            if (write != last_write.end()) {
+                depend(write->second, i, 0);
+            }
+            last_write[inst.rd] = i;
+        }
+        if (inst.opcode == RV_LW || inst.opcode == RV_SW) {
+            for (auto earlier: memory) {
+                auto &other = instructions[earlier];
+                if ((inst.opcode == RV_SW || other.opcode == RV_SW) && may_alias(inst, other)) {
+                    depend(earlier, i, 0);
+                }
+            }
+            memory.push_back(i);
+        }
+    }
+    if (pin_physical) {
+        // the allocator only sees virtual registers live, a physical one written earlier than
+        // isel put it could be handed out while it still holds the value
+        for (size_t i = 0; i < size; i++) {
+            auto &inst = instructions[i];
+            if (!riscv_has_def(inst.opcode) || inst.rd == RV_ZERO || riscv_is_virtual(inst.rd)) {
+                continue;
+            }
+            for (size_t other = 0; other < size; other++) {
+                if (other < i) {
+                    depend(other, i, 0);
+                } else if (other > i) {
+                    depend(i, other, 0);
+                }
+            }
+        }
+    }
+
+    // the longest latency path from each instruction to the end of the block
+    std::vector<int> height(size, 0);
+    for (size_t i = size; i-- > 0;) {
+        height[i] = _latencies.latency(instructions[i].opcode);
+        for (auto &edge: successors[i]) {
+            height[i] = std::max(height[i], edge.latency + height[edge.to]);
+        }
+    }
+    // endregion
+
+    std::vector<MachineInstruction> result;
+    result.reserve(instructions.size());
+    std::vector<size_t> earliest(size, 0);
+    std::vector<size_t> available;
+    for (size_t i = 0; i < size; i++) {
+        if (predecessors[i] == 0) {
+            available.push_back(i);
+        }
+    }
+    size_t cycle = 0;
+    while (!available.empty()) {
+        // nothing ready this cycle: stall until something is
+        auto first = *std::min_element(available.begin(), available.end(), [&earliest](size_t a, size_t b) {
+            return earliest[a] < earliest[b];
+        });
+        cycle = std::max(cycle, earliest[first]);
+        auto chosen = available.end();
+        for (auto candidate = available.begin(); candidate != available.end(); ++candidate) {
+            if (earliest[*candidate] > cycle) {
+                continue;
+            }
+            if (chosen == available.end() || height[*candidate] > height[*chosen]
+                || (height[*candidate] == height[*chosen] && *candidate < *chosen)) {
+                chosen = candidate;
+            }
+        }
+        auto index = *chosen;
+        available.erase(chosen);
+        result.push_back(instructions[index]);
+        for (auto &edge: successors[index]) {
+            earliest[edge.to] = std::max(earliest[edge.to], cycle + static_cast<size_t>(edge.latency));
+            if (--predecessors[edge.to] == 0) {
+                available.push_back(edge.to);
+            }
+        }
+        cycle++;
+    }
+    result.insert(result.end(), instructions.begin() + static_cast<long>(size), instructions.end());
+    return result;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "riscv.h"
+
+// Cycles from issuing an instruction until its result can be read without a stall, as on
+// a simple in-order core. Everything not listed takes one.
+class RiscvLatencyModel {
+public:
+    int load = 3;
+    int multiply = 3;
+    int divide = 20;
+
+    int latency(RiscvOpcode opcode) const;
+};
+
+class SchedulingStatistics {
+public:
+    size_t blocks_reordered = 0;
+    // blocks left as they were because the new order needed more registers than there are
+    size_t blocks_kept_for_pressure = 0;
+    // cycles spent waiting for operands, one instruction issued per cycle
+    size_t stalls_before = 0;
+    size_t stalls_after = 0;
+
+    void print(const std::string &phase, const std::string &function) const;
+};
+
+/**
+ * List scheduling of each block on its dependence DAG: reads after writes wait for the
+ * latency of the write, and writes stay behind earlier reads and writes of the register.
+ * Stack accesses are ordered unless they touch different slots or offsets. The terminators
+ * stay at the end. Before allocation, writes of physical registers such as the return value
+ * in a0 stay where they are and nothing moves across them, as the allocator only tracks
+ * virtual registers.
+ *
+ * Every cycle the ready instruction with the longest latency path to the end of the block
+ * issues, earliest in the old order on a tie. On virtual registers that may keep more
+ * values live at once; a block whose new order needs more registers than can be allocated,
+ * and more than before, is left alone.
+ */
+class RiscvScheduler {
+public:
+    explicit RiscvScheduler(const RiscvLatencyModel &latencies = RiscvLatencyModel()) : _latencies(latencies) {
+    }
+
+    SchedulingStatistics run(MachineFunction &function) const;
+
+    // the stall cycles of a block issued in order
+    size_t stalls(const MachineBlock &block) const;
+
+private:
+    RiscvLatencyModel _latencies;
+
+    // `pin_physical` keeps writes of physical registers where they are, as barriers
+    std::vector<MachineInstruction> schedule(const std::vector<MachineInstruction> &instructions,
+                                             bool pin_physical) const;
+};
@@ -0,0 +1,79 @@
+#include "riscv_writer.h"
+
+void RiscvWriter::write(const MachineModule &module, BufferedWriter &out) {
+    out << "  .text\n";
+    for (auto &function: module.functions) {
+        write_function(*function, out);
+    }
+}
+
+std::string RiscvWriter::dump(const MachineFunction &function) {
+    std::string text;
+    {
+        BufferedWriter out(&text);
+        RiscvWriter().write_function(function, out);
+    }
+    return text;
+}
+
+void RiscvWriter::write_label(const MachineFunction &function, MachineBlockId block, BufferedWriter &out) {
+    if (block == 0) {
+        out << function.name;
+    } else {
+        out << ".L" << function.name << '_' << function.blocks[block].name;
+    }
+}
+
+void RiscvWriter::write_function(const MachineFunction &function, BufferedWriter &out) {
+    out << "  .globl " << function.name << '\n';
+    for (MachineBlockId block = 0; block < function.blocks.size(); block++) {
+        write_label(function, block, out);
+        out << ":\n";
+        for (auto &inst: function.blocks[block].instructions) {
+            out << "  " << riscv_opcode_name(inst.opcode);
+            switch (riscv_format(inst.opcode)) {
+                case RV_FORMAT_REGISTER:
+                    out << ' ' << riscv_register_name(inst.rd) << ", " << riscv_register_name(inst.rs1) << ", "
+                        << riscv_register_name(inst.rs2);
+                    break;
+                case RV_FORMAT_IMMEDIATE:
+                    out << ' ' << riscv_register_name(inst.rd) << ", " << riscv_register_name(inst.rs1) << ", "
+                        << inst.imm;
+                    break;
+                case RV_FORMAT_UNARY:
+                    out << ' ' << riscv_register_name(inst.rd) << ", " << riscv_register_name(inst.rs1);
+                    break;
+                case RV_FORMAT_LOAD_IMMEDIATE:
+                    out << ' ' << riscv_register_name(inst.rd) << ", " << inst.imm;
+                    break;
+                case RV_FORMAT_LOAD:
+                case RV_FORMAT_STORE:
+                    out << ' ' << riscv_register_name(inst.opcode == RV_LW ? inst.rd : inst.rs2) << ", ";
+                    if (inst.slot >= 0) {
+                        out << "slot" << inst.slot;
+                        if (inst.imm != 0) {
+                            out << '+' << inst.imm;
+                        }
+                    } else {
+                        out << inst.imm << '(' << riscv_register_name(inst.rs1) << ')';
+                    }
+                    break;
+                case RV_FORMAT_BRANCH:
+                    out << ' ' << riscv_register_name(inst.rs1) << ", ";
+                    write_label(function, inst.target, out);
+                    break;
+                case RV_FORMAT_COMPARE_BRANCH:
+                    out << ' ' << riscv_register_name(inst.rs1) << ", " << riscv_register_name(inst.rs2) << ", ";
+                    write_label(function, inst.target, out);
+                    break;
+                case RV_FORMAT_JUMP:
+                    out << ' ';
+                    write_label(function, inst.target, out);
+                    break;
+                case RV_FORMAT_RETURN:
+                    break;
+            }
+            out << '\n';
+        }
+    }
+}
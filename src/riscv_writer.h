@@ -0,0 +1,22 @@
+#pragma once
+
+#include <string>
+#include "buffered_writer.h"
+#include "riscv.h"
+
+/**
+ * Prints machine functions as RISC-V assembly. The entry block is labelled with the
+ * function name and the others get local .L labels; stack slots not yet resolved to
+ * offsets print as `slotN`, which only appears in dumps.
+ */
+class RiscvWriter {
+public:
+    void write(const MachineModule &module, BufferedWriter &out);
+
+    void write_function(const MachineFunction &function, BufferedWriter &out);
+
+    static std::string dump(const MachineFunction &function);
+
+private:
+    void write_label(const MachineFunction &function, MachineBlockId block, BufferedWriter &out);
+};
@@ -0,0 +1,189 @@
+#include "sccp.h"
+
+#include <iostream>
+#include "simplify_cfg.h"
+
+void SccpStatistics::print(const std::string &function) const {
+    std::cout << "sccp @" << function << ": " << constants_found << " constants found, "
+              << branches_folded << " branches folded, " << blocks_removed << " blocks removed" << std::endl;
+}
+
+SccpStatistics Sccp::run(AnalysisCache &analyses) {
+    auto &function = analyses.function();
+    _function = &function;
+    _values.assign(function.instructions.size(), Lattice());
+    _executable_blocks.assign(function.blocks.size(), false);
+    _executable_edges.clear();
+    _edge_worklist.clear();
+    _value_worklist.clear();
+
+    mark_edge(0, function.entry());
+    while (!_edge_worklist.empty() || !_value_worklist.empty()) {
+        while (!_edge_worklist.empty()) {
+            auto edge = _edge_worklist.back();
+            _edge_worklist.pop_back();
+            auto block = edge.second;
+            bool first_visit = !_executable_blocks[block];
+            _executable_blocks[block] = true;
+            // phis see a new incoming edge; everything else only needs to run once
+            for (auto inst = function.blocks[block].first; inst != 0; inst = function[inst].next) {
+                if (first_visit || function[inst].opcode == IR_PHI) {
+                    visit(inst);
+                }
+            }
+        }
+        while (!_value_worklist.empty()) {
+            auto value = _value_worklist.back();
+            _value_worklist.pop_back();
+            for (auto user: function.users(value)) {
+                auto block = function[user].block;
+                if (block != 0 && _executable_blocks[block]) {
+                    visit(user);
+                }
+            }
+        }
+    }
+
+    SccpStatistics statistics;
+    std::vector<IrValueId> constants;
+    for (auto block: function.layout) {
+        if (!_executable_blocks[block]) {
+            continue;
+        }
+        for (auto inst = function.blocks[block].first; inst != 0; inst = function[inst].next) {
+            if (_values[inst].kind == LATTICE_CONSTANT) {
+                constants.push_back(inst);
+            }
+        }
+    }
+    for (auto inst: constants) {
+        function.replace_all_uses(inst, function.constant(_values[inst].value));
+        function.erase(inst);
+        statistics.constants_found++;
+    }
+
+    IrBuilder builder(&function);
+    for (auto block: function.layout) {
+        auto terminator = function.terminator(block);
+        if (!_executable_blocks[block] || terminator == 0 || function[terminator].opcode != IR_BR) {
+            continue;
+        }
+        auto condition = lattice_of(function.operand(terminator, 0));
+        if (condition.kind != LATTICE_CONSTANT) {
+            continue;
+        }
+        auto taken = function[terminator].targets[condition.value != 0 ? 0 : 1];
+        auto not_taken = function[terminator].targets[condition.value != 0 ? 1 : 0];
+        if (not_taken != taken) {
+            for (auto inst: function.block_instructions(not_taken)) {
+                if (function[inst].opcode == IR_PHI) {
+                    function.remove_incoming(inst, block);
+                }
+            }
+        }
+        function.erase(terminator);
+        builder.set_block(block);
+        builder.jump(taken);
+        statistics.branches_folded++;
+    }
+
+    statistics.blocks_removed = remove_unreachable_blocks(function);
+    if (statistics.branches_folded + statistics.blocks_removed != 0) {
+        analyses.invalidate(ANALYSIS_CFG);
+    }
+    return statistics;
+}
+
+void Sccp::mark_edge(IrBlockId from, IrBlockId to) {
+    if (_executable_edges.insert({from, to}).second) {
+        _edge_worklist.emplace_back(from, to);
+    }
+}
+
+void Sccp::set_value(IrValueId inst, const Lattice &lattice) {
+    auto &current = _values[inst];
+    // values only ever move down the lattice
+    if (current.kind == lattice.kind && (lattice.kind != LATTICE_CONSTANT || current.value == lattice.value)) {
+        return;
+    }
+    current = lattice;
+    _value_worklist.push_back(inst);
+}
+
+Sccp::Lattice Sccp::lattice_of(IrValueId value) {
+    auto &inst = (*_function)[value];
+    Lattice result;
+    if (inst.opcode == IR_CONST) {
+        result.kind = LATTICE_CONSTANT;
+        result.value = inst.immediate;
+    } else if (inst.opcode == IR_UNDEF) {
+        // could be assumed to be anything, but branching on it must keep both arms
+        result.kind = LATTICE_BOTTOM;
+    } else {
+        result = _values[value];
+    }
+    return result;
+}
+
+Sccp::Lattice Sccp::evaluate(IrValueId inst) {
+    auto &record = (*_function)[inst];
+    Lattice result;
+    if (record.opcode == IR_PHI) {
+        for (uint32_t i = 0; i < record.operand_count; i++) {
+            if (_executable_edges.count({_function->incoming_block(inst, i), record.block}) == 0) {
+                continue;
+            }
+            auto operand = lattice_of(_function->operand(inst, i));
+            if (operand.kind == LATTICE_TOP) {
+                continue;
+            }
+            if (operand.kind == LATTICE_BOTTOM
+                || (result.kind == LATTICE_CONSTANT && result.value != operand.value)) {
+                result.kind = LATTICE_BOTTOM;
+                return result;
+            }
+            result = operand;
+        }
+        return result;
+    }
+    if (!ir_is_binary(record.opcode)) {
+        // memory
+        result.kind = LATTICE_BOTTOM;
+        return result;
+    }
+    auto lhs = lattice_of(_function->operand(inst, 0));
+    auto rhs = lattice_of(_function->operand(inst, 1));
+    if (lhs.kind == LATTICE_BOTTOM || rhs.kind == LATTICE_BOTTOM) {
+        result.kind = LATTICE_BOTTOM;
+    } else if (lhs.kind == LATTICE_CONSTANT && rhs.kind == LATTICE_CONSTANT) {
+        // a division that would trap is left for run time
+        result.kind = ir_evaluate(record.opcode, lhs.value, rhs.value, result.value) ? LATTICE_CONSTANT
+                                                                                     : LATTICE_BOTTOM;
+    }
+    return result;
+}
+
+void Sccp::visit(IrValueId inst) {
+    auto &record = (*_function)[inst];
+    switch (record.opcode) {
+        case IR_BR: {
+            auto condition = lattice_of(_function->operand(inst, 0));
+            if (condition.kind == LATTICE_CONSTANT) {
+                mark_edge(record.block, record.targets[condition.value != 0 ? 0 : 1]);
+            } else if (condition.kind == LATTICE_BOTTOM) {
+                mark_edge(record.block, record.targets[0]);
+                mark_edge(record.block, record.targets[1]);
+            }
+            break;
+        }
+        case IR_JUMP:
+            mark_edge(record.block, record.targets[0]);
+            break;
+        case IR_RET:
+        case IR_STORE:
+            break;
+        default:
+            set_value(inst, evaluate(inst));
+            break;
+    }
+}
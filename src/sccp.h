@@ -0,0 +1,63 @@
+#pragma once
+
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+#include "analysis_cache.h"
+#include "ir.h"
+
+class SccpStatistics {
+public:
+    size_t constants_found = 0;
+    size_t branches_folded = 0;
+    size_t blocks_removed = 0;
+
+    bool changed() const {
+        return constants_found + branches_folded + blocks_removed != 0;
+    }
+
+    void print(const std::string &function) const;
+};
+
+/**
+ * Sparse conditional constant propagation (Wegman and Zadeck). Values and CFG edges are
+ * discovered together, so a phi only merges the edges that can actually execute and a
+ * branch on a constant never makes its other arm reachable.
+ *
+ * Afterwards constant values replace their instructions, branches on constants become
+ * jumps and blocks that never execute are deleted.
+ */
+class Sccp {
+public:
+    SccpStatistics run(AnalysisCache &analyses);
+
+private:
+    enum LatticeKind {
+        LATTICE_TOP,        // no value seen yet
+        LATTICE_CONSTANT,
+        LATTICE_BOTTOM      // not a constant
+    };
+
+    struct Lattice {
+        LatticeKind kind = LATTICE_TOP;
+        int32_t value = 0;
+    };
+
+    IrFunction *_function = nullptr;
+    std::vector<Lattice> _values;
+    std::vector<bool> _executable_blocks;
+    std::set<std::pair<IrBlockId, IrBlockId>> _executable_edges;
+    std::vector<std::pair<IrBlockId, IrBlockId>> _edge_worklist;
+    std::vector<IrValueId> _value_worklist;
+
+    Lattice evaluate(IrValueId inst);
+
+    Lattice lattice_of(IrValueId value);
+
+    void visit(IrValueId inst);
+
+    void mark_edge(IrBlockId from, IrBlockId to);
+
+    void set_value(IrValueId inst, const Lattice &lattice);
+};
@@ -0,0 +1,73 @@
+#include "scope_index.h"
+
+#include <algorithm>
+
+std::shared_ptr<ScopeIndex> ScopeIndex::build(BaseAST *root) {
+    auto index = std::make_shared<ScopeIndex>();
+    index->visit(root);
+    return index;
+}
+
+void ScopeIndex::visit(BaseAST *node) {
+    if (node == nullptr) {
+        return;
+    }
+    if (auto block = dynamic_cast<BlockAST *>(node)) {
+        enter_block();
+        visit(block->block_item_list.get());
+        // past the closing brace
+        exit_block(block->location->end_line(), block->location->end_column() + 1);
+        return;
+    }
+    // locations are inclusive, hence the + 1 below
+    if (auto const_def = dynamic_cast<ConstDefinitionAST *>(node)) {
+        declare(const_def->ident,
+                SymbolTableFactory::wrap_symbol_info(true, "int", const_def->ident, "", const_def->location),
+                const_def->location->end_line(), const_def->location->end_column() + 1);
+    } else if (auto var_def = dynamic_cast<VarDefinitionAST *>(node)) {
+        // as in C, the name is in scope from the end of its declarator, initializer included
+        declare(var_def->ident,
+                SymbolTableFactory::wrap_symbol_info(false, "int", var_def->ident, "", var_def->location),
+                var_def->location->end_line(), var_def->location->end_column() + 1);
+    }
+    for (auto child: node->children()) {
+        visit(child);
+    }
+}
+
+void ScopeIndex::record(int line, int column) {
+    // nested blocks can end on the same position, the outermost state wins
+    if (!_events.empty() && _events.back().line == line && _events.back().column == column) {
+        _events.back().visible = _table.snapshot();
+        return;
+    }
+    _events.push_back({line, column, _table.snapshot()});
+}
+
+void ScopeIndex::enter_block() {
+    _open_blocks.push_back(_table.snapshot());
+}
+
+void ScopeIndex::declare(const std::string &name, std::shared_ptr<SymbolInformation> symbol_information,
+                         int line, int column) {
+    _table.insert(name, symbol_information);
+    record(line, column);
+}
+
+void ScopeIndex::exit_block(int line, int column) {
+    _table.restore(_open_blocks.back());
+    _open_blocks.pop_back();
+    record(line, column);
+}
+
+const PersistentSymbolMap &ScopeIndex::visible_at(int line, int column) const {
+    static const PersistentSymbolMap nothing_visible;
+    auto after = std::upper_bound(_events.begin(), _events.end(), std::make_pair(line, column),
+                                  [](const std::pair<int, int> &position, const ScopeEvent &event) {
+                                      return position < std::make_pair(event.line, event.column);
+                                  });
+    if (after == _events.begin()) {
+        return nothing_visible;
+    }
+    return std::prev(after)->visible;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "Ast.h"
+#include "persistent_symbol_table.h"
+
+/**
+ * Answers "which symbols are visible at line:column" after parsing, for editor style queries.
+ *
+ * Every point where the visible set changes (a declaration, the end of a block) records a
+ * snapshot of the persistent scope in source order. A query is a binary search over those
+ * points and returns the shared snapshot itself, so it costs O(log n) and copies nothing.
+ *
+ * A library for tools such as an editor integration: the compiler itself never queries it,
+ * no mode of the compiler builds one.
+ */
+class ScopeIndex {
+private:
+    struct ScopeEvent {
+        int line;
+        int column;
+        PersistentSymbolMap visible;
+    };
+
+    std::vector<ScopeEvent> _events;
+    PersistentSymbolTableImpl _table;
+    std::vector<PersistentSymbolMap> _open_blocks;
+
+    void visit(BaseAST *node);
+
+    void record(int line, int column);
+
+public:
+
+    static std::shared_ptr<ScopeIndex> build(BaseAST *root);
+
+    void enter_block();
+
+    // `name` is visible from line:column on
+    void declare(const std::string &name, std::shared_ptr<SymbolInformation> symbol_information, int line, int column);
+
+    // the block's declarations are gone from line:column on
+    void exit_block(int line, int column);
+
+    const PersistentSymbolMap &visible_at(int line, int column) const;
+
+    size_t size() const {
+        return _events.size();
+    }
+};
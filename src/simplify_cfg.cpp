@@ -0,0 +1,108 @@
+#include "simplify_cfg.h"
+
+#include <iostream>
+#include "cfg.h"
+
+void SimplifyCfgStatistics::print(const std::string &function) const {
+    std::cout << "simplify-cfg @" << function << ": " << blocks_merged << " blocks merged, "
+              << blocks_removed << " unreachable blocks removed, " << branches_simplified
+              << " branches simplified" << std::endl;
+}
+
+size_t remove_unreachable_blocks(IrFunction &function) {
+    ControlFlowGraph cfg(function);
+    std::vector<IrBlockId> unreachable;
+    for (auto block: function.layout) {
+        if (!cfg.reachable(block)) {
+            unreachable.push_back(block);
+        }
+    }
+    for (auto block: unreachable) {
+        for (auto successor: function.successors(block)) {
+            for (auto inst: function.block_instructions(successor)) {
+                if (function[inst].opcode == IR_PHI) {
+                    function.remove_incoming(inst, block);
+                }
+            }
+        }
+    }
+    for (auto block: unreachable) {
+        function.remove_block(block);
+    }
+    return unreachable.size();
+}
+
+SimplifyCfgStatistics SimplifyCfg::run(AnalysisCache &analyses) {
+    auto &function = analyses.function();
+    SimplifyCfgStatistics statistics;
+    statistics.blocks_removed = remove_unreachable_blocks(function);
+
+    IrBuilder builder(&function);
+    for (auto block: function.layout) {
+        auto terminator = function.terminator(block);
+        if (terminator != 0 && function[terminator].opcode == IR_BR
+            && function[terminator].targets[0] == function[terminator].targets[1]) {
+            auto target = function[terminator].targets[0];
+            function.erase(terminator);
+            builder.set_block(block);
+            builder.jump(target);
+            statistics.branches_simplified++;
+        }
+    }
+
+    // predecessor counts do not change by merging, the merged edge simply disappears
+    ControlFlowGraph cfg(function);
+    auto layout = function.layout;
+    for (auto block: layout) {
+        if (function.blocks[block].removed) {
+            continue;
+        }
+        while (true) {
+            auto terminator = function.terminator(block);
+            if (terminator == 0 || function[terminator].opcode != IR_JUMP) {
+                break;
+            }
+            auto successor = function[terminator].targets[0];
+            if (successor == block || successor == function.entry() || cfg.predecessors[successor].size() != 1) {
+                break;
+            }
+
+            // a single predecessor makes every phi trivial
+            for (auto inst: function.block_instructions(successor)) {
+                if (function[inst].opcode == IR_PHI) {
+                    function.replace_all_uses(inst, function.operand(inst, 0));
+                    function.erase(inst);
+                }
+            }
+            function.erase(terminator);
+            for (auto inst: function.block_instructions(successor)) {
+                function.unlink(inst);
+                function.append(block, inst);
+            }
+            for (auto next: function.successors(block)) {
+                for (auto inst: function.block_instructions(next)) {
+                    if (function[inst].opcode != IR_PHI) {
+                        continue;
+                    }
+                    for (uint32_t i = 0; i < function[inst].operand_count; i++) {
+                        if (function.incoming_block(inst, i) == successor) {
+                            function.set_incoming_block(inst, i, block);
+                        }
+                    }
+                }
+                for (auto &predecessor: cfg.predecessors[next]) {
+                    if (predecessor == successor) {
+                        predecessor = block;
+                    }
+                }
+            }
+            function.remove_block(successor);
+            statistics.blocks_merged++;
+        }
+    }
+
+    if (statistics.changed()) {
+        analyses.invalidate(ANALYSIS_CFG);
+    }
+    return statistics;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <string>
+#include "analysis_cache.h"
+#include "ir.h"
+
+class SimplifyCfgStatistics {
+public:
+    size_t blocks_merged = 0;
+    size_t blocks_removed = 0;
+    size_t branches_simplified = 0;
+
+    bool changed() const {
+        return blocks_merged + blocks_removed + branches_simplified != 0;
+    }
+
+    void print(const std::string &function) const;
+};
+
+/**
+ * Cleans up the CFG after other passes: deletes unreachable blocks, turns branches with
+ * identical targets into jumps, and merges a block into its predecessor when that edge is
+ * the only way in and out.
+ */
+class SimplifyCfg {
+public:
+    SimplifyCfgStatistics run(AnalysisCache &analyses);
+};
+
+// deletes the blocks not reachable from the entry, dropping their phi operands; returns how many
+size_t remove_unreachable_blocks(IrFunction &function);
@@ -0,0 +1,222 @@
+#include "strength_reduction.h"
+
+#include <iostream>
+#include <utility>
+#include <vector>
+
+void StrengthReductionStatistics::print(const std::string &function) const {
+    std::cout << "strength-reduction @" << function << ": " << multiplies_reduced << " multiplies, "
+              << divisions_reduced << " divisions and " << remainders_reduced << " remainders reduced" << std::endl;
+}
+
+DivisionMagic division_magic(int32_t divisor) {
+    const uint32_t two31 = 0x80000000u;
+    auto d = static_cast<uint32_t>(divisor);
+    uint32_t ad = divisor < 0 ? 0u - d : d;
+    uint32_t t = two31 + (d >> 31);
+    uint32_t anc = t - 1 - t % ad;
+    int32_t p = 31;
+    uint32_t q1 = two31 / anc;
+    uint32_t r1 = two31 - q1 * anc;
+    uint32_t q2 = two31 / ad;
+    uint32_t r2 = two31 - q2 * ad;
+    uint32_t delta;
+    do {
+        p++;
+        q1 = 2 * q1;
+        r1 = 2 * r1;
+        if (r1 >= anc) {
+            q1++;
+            r1 -= anc;
+        }
+        q2 = 2 * q2;
+        r2 = 2 * r2;
+        if (r2 >= ad) {
+            q2++;
+            r2 -= ad;
+        }
+        delta = ad - r2;
+    } while (q1 < delta || (q1 == delta && r1 == 0));
+
+    DivisionMagic magic;
+    auto multiplier = q2 + 1;
+    magic.multiplier = static_cast<int32_t>(divisor < 0 ? 0u - multiplier : multiplier);
+    magic.shift = p - 32;
+    return magic;
+}
+
+// k if value is 2^k, -1 otherwise
+static int log2_exact(uint32_t value) {
+    if (value == 0 || (value & (value - 1)) != 0) {
+        return -1;
+    }
+    return __builtin_ctz(value);
+}
+
+StrengthReductionStatistics StrengthReduction::run(AnalysisCache &analyses) {
+    auto &function = analyses.function();
+    _function = &function;
+    StrengthReductionStatistics statistics;
+    for (auto block: function.layout) {
+        for (auto inst: function.block_instructions(block)) {
+            auto opcode = function[inst].opcode;
+            if (opcode != IR_MUL && opcode != IR_DIV && opcode != IR_REM) {
+                continue;
+            }
+            auto x = function.operand(inst, 0);
+            auto y = function.operand(inst, 1);
+            if (opcode == IR_MUL && function.is_constant(x)) {
+                std::swap(x, y);
+            }
+            if (!function.is_constant(y)) {
+                continue;
+            }
+            auto constant = function.constant_value(y);
+
+            _position = inst;
+            IrValueId result = 0;
+            if (opcode == IR_MUL) {
+                result = multiply(x, constant);
+                statistics.multiplies_reduced += result != 0;
+            } else if (opcode == IR_DIV) {
+                result = divide(x, constant);
+                statistics.divisions_reduced += result != 0;
+            } else {
+                result = remainder(x, constant);
+                statistics.remainders_reduced += result != 0;
+            }
+            if (result != 0) {
+                function.replace_all_uses(inst, result);
+                function.erase(inst);
+            }
+        }
+    }
+    return statistics;
+}
+
+IrValueId StrengthReduction::emit(IrOpcode opcode, IrValueId lhs, IrValueId rhs) {
+    auto inst = _function->create(opcode, {lhs, rhs});
+    _function->insert_before(_position, inst);
+    return inst;
+}
+
+IrValueId StrengthReduction::emit(IrOpcode opcode, IrValueId lhs, int32_t rhs) {
+    return emit(opcode, lhs, _function->constant(rhs));
+}
+
+IrValueId StrengthReduction::multiply(IrValueId x, int32_t factor) {
+    if (factor == 0) {
+        return _function->constant(0);
+    } else if (factor == 1) {
+        return x;
+    }
+
+    // non-adjacent form: digits of -1, 0 and 1, no two adjacent ones non-zero. Digits from
+    // bit 32 up are multiples of 2^32 and vanish in 32-bit arithmetic.
+    std::vector<std::pair<int, bool>> terms;    // shift, negative
+    uint64_t value = static_cast<uint32_t>(factor);
+    for (int bit = 0; value != 0 && bit < 32; bit++, value >>= 1) {
+        if ((value & 1) == 0) {
+            continue;
+        }
+        bool negative = (value & 3) == 3;
+        terms.emplace_back(bit, negative);
+        value = negative ? value + 1 : value - 1;
+    }
+
+    // a positive term goes first, so no negation is needed unless all are negative
+    size_t first = 0;
+    while (first < terms.size() && terms[first].second) {
+        first++;
+    }
+    int cost = static_cast<int>(terms.size()) - 1 + (first == terms.size() ? 1 : 0);
+    for (auto &term: terms) {
+        cost += term.first != 0;
+    }
+    if (cost > MAX_SHIFT_ADD_COST) {
+        return 0;
+    }
+
+    auto shifted = [this, x](int shift) {
+        return shift == 0 ? x : emit(IR_SHL, x, shift);
+    };
+    IrValueId result;
+    if (first == terms.size()) {
+        result = emit(IR_SUB, _function->constant(0), shifted(terms[0].first));
+        first = 0;
+    } else {
+        result = shifted(terms[first].first);
+    }
+    for (size_t i = 0; i < terms.size(); i++) {
+        if (i != first) {
+            result = emit(terms[i].second ? IR_SUB : IR_ADD, result, shifted(terms[i].first));
+        }
+    }
+    return result;
+}
+
+IrValueId StrengthReduction::divide(IrValueId x, int32_t divisor) {
+    if (divisor == 0) {
+        // traps at run time, leave it be
+        return 0;
+    } else if (divisor == 1) {
+        return x;
+    } else if (divisor == -1) {
+        return emit(IR_SUB, _function->constant(0), x);
+    }
+
+    auto magnitude = divisor < 0 ? 0u - static_cast<uint32_t>(divisor) : static_cast<uint32_t>(divisor);
+    auto k = log2_exact(magnitude);
+    IrValueId quotient;
+    if (k > 0) {
+        // an arithmetic shift rounds down, adding 2^k - 1 to a negative x first rounds towards zero
+        auto sign = emit(IR_SAR, x, 31);
+        auto bias = emit(IR_SHR, sign, 32 - k);
+        quotient = emit(IR_SAR, emit(IR_ADD, x, bias), k);
+        if (divisor < 0) {
+            quotient = emit(IR_SUB, _function->constant(0), quotient);
+        }
+        return quotient;
+    }
+
+    if (!_multiply_high) {
+        return 0;
+    }
+    auto magic = division_magic(divisor);
+    quotient = emit(IR_MULH, x, magic.multiplier);
+    if (divisor > 0 && magic.multiplier < 0) {
+        quotient = emit(IR_ADD, quotient, x);
+    } else if (divisor < 0 && magic.multiplier > 0) {
+        quotient = emit(IR_SUB, quotient, x);
+    }
+    if (magic.shift != 0) {
+        quotient = emit(IR_SAR, quotient, magic.shift);
+    }
+    // the estimate is one too low for negative quotients
+    return emit(IR_ADD, quotient, emit(IR_SHR, quotient, 31));
+}
+
+IrValueId StrengthReduction::remainder(IrValueId x, int32_t divisor) {
+    if (divisor == 1 || divisor == -1) {
+        return _function->constant(0);
+    }
+    auto magnitude = divisor < 0 ? 0u - static_cast<uint32_t>(divisor) : static_cast<uint32_t>(divisor);
+    auto k = log2_exact(magnitude);
+    if (k > 0) {
+        // x minus x rounded towards zero to a multiple of 2^k, whatever the sign of the divisor
+        auto sign = emit(IR_SAR, x, 31);
+        auto bias = emit(IR_SHR, sign, 32 - k);
+        auto rounded = emit(IR_AND, emit(IR_ADD, x, bias), static_cast<int32_t>(0u - magnitude));
+        return emit(IR_SUB, x, rounded);
+    }
+
+    auto quotient = divide(x, divisor);
+    if (quotient == 0) {
+        return 0;
+    }
+    auto product = multiply(quotient, divisor);
+    if (product == 0) {
+        product = emit(IR_MUL, quotient, divisor);
+    }
+    return emit(IR_SUB, x, product);
+}
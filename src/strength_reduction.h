@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include "analysis_cache.h"
+#include "ir.h"
+
+class StrengthReductionStatistics {
+public:
+    size_t multiplies_reduced = 0;
+    size_t divisions_reduced = 0;
+    size_t remainders_reduced = 0;
+
+    bool changed() const {
+        return multiplies_reduced + divisions_reduced + remainders_reduced != 0;
+    }
+
+    void print(const std::string &function) const;
+};
+
+// magic multiplier and shift for signed division by a constant, Hacker's Delight 10-1
+struct DivisionMagic {
+    int32_t multiplier;
+    int32_t shift;
+};
+
+// `divisor` must not be -1, 0 or 1
+DivisionMagic division_magic(int32_t divisor);
+
+/**
+ * Replaces multiplication, division and remainder by constants with cheaper sequences.
+ *
+ * A multiplication becomes shifts and adds along the non-adjacent form of the constant
+ * when that takes at most MAX_SHIFT_ADD_COST instructions. Division by a power of two is
+ * an arithmetic shift with a fix-up that rounds negative dividends towards zero; any other
+ * divisor becomes a multiply-high by a magic number (Granlund and Montgomery), which is
+ * only done for targets that have IR_MULH. A remainder is x - q * d on top of either.
+ */
+class StrengthReduction {
+public:
+    static constexpr int MAX_SHIFT_ADD_COST = 3;
+
+    explicit StrengthReduction(bool multiply_high = true) : _multiply_high(multiply_high) {
+    }
+
+    StrengthReductionStatistics run(AnalysisCache &analyses);
+
+private:
+    bool _multiply_high;
+    IrFunction *_function = nullptr;
+    // new instructions go right before this one
+    IrValueId _position = 0;
+
+    IrValueId emit(IrOpcode opcode, IrValueId lhs, IrValueId rhs);
+
+    IrValueId emit(IrOpcode opcode, IrValueId lhs, int32_t rhs);
+
+    // 0 if the multiplication is cheaper left as it is
+    IrValueId multiply(IrValueId x, int32_t factor);
+
+    // 0 if there is no cheaper sequence
+    IrValueId divide(IrValueId x, int32_t divisor);
+
+    IrValueId remainder(IrValueId x, int32_t divisor);
+};
@@ -1,3 +1,10 @@
 #include "symbol_table.h"
+#include "persistent_symbol_table.h"
 
-std::shared_ptr<SymbolTable> SymbolTableFactory::symbol_table = new_symbol_table();
\ No newline at end of file
+std::shared_ptr<SymbolTable> SymbolTableFactory::symbol_table = new_symbol_table();
+
+std::shared_ptr<GlobalSymbolTable> SymbolTableFactory::global_symbol_table = new_global_symbol_table();
+
+std::shared_ptr<PersistentSymbolTableImpl> SymbolTableFactory::new_persistent_symbol_table() {
+    return std::make_shared<PersistentSymbolTableImpl>();
+}
\ No newline at end of file
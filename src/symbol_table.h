@@ -1,9 +1,14 @@
 #pragma once
 
+#include "cassert"
+#include "cstdlib"
 #include "memory"
 #include "iostream"
 #include "string"
 #include "map"
+#include "unordered_map"
+#include "atomic"
+#include "mutex"
 
 class Location {
 public:
@@ -65,15 +70,15 @@ public:
 
 class SymbolInformation {
 public:
-    virtual bool if_const() = 0;
+    virtual bool if_const() const = 0;
 
-    virtual std::string type() = 0;
+    virtual std::string type() const = 0;
 
-    virtual std::string name() = 0;
+    virtual std::string name() const = 0;
 
-    virtual std::string value() = 0;
+    virtual std::string value() const = 0;
 
-    virtual std::shared_ptr<Location> location() = 0;
+    virtual std::shared_ptr<Location> location() const = 0;
 
     virtual void change_type(std::string type) = 0;
 
@@ -103,23 +108,23 @@ public:
         this->_if_const = _if_const;
     }
 
-    std::string type() override {
+    std::string type() const override {
         return this->_type;
     }
 
-    std::string name() override {
+    std::string name() const override {
         return this->_name;
     }
 
-    std::string value() override {
+    std::string value() const override {
         return this->_value;
     }
 
-    std::shared_ptr<Location> location() override {
+    std::shared_ptr<Location> location() const override {
         return this->_location;
     }
 
-    bool if_const() override {
+    bool if_const() const override {
         return _if_const;
     }
 
@@ -207,6 +212,138 @@ public:
     }
 };
 
+/**
+ * The global scope shared by worker threads that compile different functions.
+ *
+ * Globals are inserted during the declaration phase, which may already look them up.
+ * freeze() ends that phase; from then on the map is never modified, so any number of
+ * threads may look symbols up concurrently without taking a lock. Symbols are handed out
+ * read only either way: every thread sees the same objects.
+ */
+class GlobalSymbolTable {
+public:
+    // a hard error once frozen
+    virtual void insert(const std::string &name, std::shared_ptr<SymbolInformation>) = 0;
+
+    virtual std::shared_ptr<const SymbolInformation> lookup(const std::string &name) const = 0;
+
+    // lookup without shared_ptr reference counting, for hot read paths; valid as long as the table lives
+    virtual const SymbolInformation *find(const std::string &name) const = 0;
+
+    virtual void freeze() = 0;
+
+    virtual bool frozen() const = 0;
+
+    virtual void print() const = 0;
+
+    virtual ~GlobalSymbolTable() = default;
+};
+
+class GlobalSymbolTableImpl : public GlobalSymbolTable {
+
+private:
+    std::unordered_map<std::string, std::shared_ptr<SymbolInformation>> _symbol_map;
+    // guards writers against each other, readers take it only before freeze()
+    mutable std::mutex _writer_mutex;
+    std::atomic<bool> _frozen{false};
+
+    // before freeze() the caller holds the writer mutex
+    const std::shared_ptr<SymbolInformation> *search(const std::string &name) const {
+        auto found = this->_symbol_map.find(name);
+        return found == this->_symbol_map.end() ? nullptr : &found->second;
+    }
+
+public:
+
+    void insert(const std::string &name, std::shared_ptr<SymbolInformation> symbol_information) override {
+        std::lock_guard<std::mutex> guard(_writer_mutex);
+        if (_frozen.load(std::memory_order_relaxed)) {
+            // workers may be reading the map without a lock
+            std::cerr << "GlobalSymbolTableImpl::insert(): global scope is frozen, cannot declare " << name
+                      << std::endl;
+            std::abort();
+        }
+        this->_symbol_map.emplace(name, symbol_information);
+    }
+
+    std::shared_ptr<const SymbolInformation> lookup(const std::string &name) const override {
+        std::unique_lock<std::mutex> guard(_writer_mutex, std::defer_lock);
+        if (!frozen()) {
+            guard.lock();
+        }
+        auto found = search(name);
+        return found == nullptr ? nullptr : *found;
+    }
+
+    const SymbolInformation *find(const std::string &name) const override {
+        std::unique_lock<std::mutex> guard(_writer_mutex, std::defer_lock);
+        if (!frozen()) {
+            guard.lock();
+        }
+        auto found = search(name);
+        return found == nullptr ? nullptr : found->get();
+    }
+
+    void freeze() override {
+        std::lock_guard<std::mutex> guard(_writer_mutex);
+        // release pairs with the acquire in frozen(): a thread that sees the flag sees every insert
+        _frozen.store(true, std::memory_order_release);
+    }
+
+    bool frozen() const override {
+        return _frozen.load(std::memory_order_acquire);
+    }
+
+    void print() const override {
+        std::cout << "GlobalSymbolTable (" << (frozen() ? "frozen" : "open") << ") with "
+                  << this->_symbol_map.size() << " symbols" << std::endl;
+        for (auto &it: this->_symbol_map) {
+            std::cout << "name: " << it.first << "; " << " type: " << it.second->type() << "; " << std::endl;
+        }
+    }
+};
+
+/**
+ * A local scope owned by a single worker thread. Misses fall through to the frozen global
+ * scope, so no lookup ever needs a lock; like the global scope it hands symbols out read only.
+ */
+class ScopedSymbolTableImpl {
+
+private:
+    std::unordered_map<std::string, std::shared_ptr<SymbolInformation>> _symbol_map;
+    std::shared_ptr<const GlobalSymbolTable> _parent;
+
+public:
+
+    explicit ScopedSymbolTableImpl(std::shared_ptr<const GlobalSymbolTable> parent) {
+        this->_parent = parent;
+    }
+
+    void insert(const std::string &name, std::shared_ptr<SymbolInformation> symbol_information) {
+        this->_symbol_map.emplace(name, symbol_information);
+    }
+
+    std::shared_ptr<const SymbolInformation> lookup(const std::string &name) const {
+        auto found = this->_symbol_map.find(name);
+        if (found != this->_symbol_map.end()) {
+            return found->second;
+        }
+        return this->_parent == nullptr ? nullptr : this->_parent->lookup(name);
+    }
+
+    void print() const {
+        std::cout << "ScopedSymbolTable with " << this->_symbol_map.size() << " local symbols" << std::endl;
+        for (auto &it: this->_symbol_map) {
+            std::cout << "name: " << it.first << "; " << " type: " << it.second->type() << "; " << std::endl;
+        }
+        if (this->_parent != nullptr) {
+            this->_parent->print();
+        }
+    }
+};
+
+class PersistentSymbolTableImpl;
+
 class SymbolTableFactory {
 public:
     static std::shared_ptr<SymbolInformation> wrap_symbol_info(
@@ -223,7 +360,24 @@ public:
         return std::make_shared<SymbolTableImpl>();
     }
 
+    static std::shared_ptr<GlobalSymbolTable> new_global_symbol_table() {
+        return std::make_shared<GlobalSymbolTableImpl>();
+    }
+
+    // a worker's local scope on top of `parent`
+    static std::shared_ptr<ScopedSymbolTableImpl> new_scoped_symbol_table(
+            std::shared_ptr<const GlobalSymbolTable> parent) {
+        return std::make_shared<ScopedSymbolTableImpl>(parent);
+    }
+
+    // structurally shared scopes, see persistent_symbol_table.h
+    static std::shared_ptr<PersistentSymbolTableImpl> new_persistent_symbol_table();
+
     // singleton
     static std::shared_ptr<SymbolTable> symbol_table;
+
+    // singleton for the global scope once functions are compiled on worker threads; nothing
+    // declares into it yet, the parser still records every symbol in `symbol_table`
+    static std::shared_ptr<GlobalSymbolTable> global_symbol_table;
 };
 
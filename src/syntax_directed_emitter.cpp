@@ -0,0 +1,251 @@
+#include "syntax_directed_emitter.h"
+
+#include <cassert>
+#include <iostream>
+
+SyntaxDirectedEmitter *syntax_directed_emitter = nullptr;
+
+SyntaxDirectedEmitter::SyntaxDirectedEmitter() : _module(std::make_unique<IrModule>()) {
+}
+
+std::unique_ptr<IrModule> SyntaxDirectedEmitter::finish() {
+    return std::move(_module);
+}
+
+// region: helpers
+
+void SyntaxDirectedEmitter::push(IrValueId value) {
+    _values.push_back(value);
+    if (_values.size() > _peak_depth) {
+        _peak_depth = _values.size();
+    }
+}
+
+IrValueId SyntaxDirectedEmitter::pop() {
+    assert(!_values.empty());
+    auto value = _values.back();
+    _values.pop_back();
+    return value;
+}
+
+IrBlockId SyntaxDirectedEmitter::new_block(const std::string &prefix) {
+    return _function->add_block(prefix + "_" + std::to_string(_block_counter++));
+}
+
+void SyntaxDirectedEmitter::ensure_open() {
+    if (_builder->closed()) {
+        // code after a return, it still needs a block of its own
+        _builder->set_block(new_block("unreachable"));
+    }
+}
+
+IrValueId SyntaxDirectedEmitter::emit_binary(IrOpcode opcode, IrValueId lhs, IrValueId rhs) {
+    ensure_open();
+    return _builder->binary(opcode, lhs, rhs);
+}
+
+IrValueId SyntaxDirectedEmitter::lookup(const std::string &name) {
+    for (auto scope = _scopes.rbegin(); scope != _scopes.rend(); ++scope) {
+        auto found = scope->find(name);
+        if (found != scope->end()) {
+            return found->second;
+        }
+    }
+    std::cerr << "undefined identifier: " << name << std::endl;
+    assert(false);
+    return 0;
+}
+
+// endregion
+
+// region: functions and scopes
+
+void SyntaxDirectedEmitter::begin_function(const std::string &name) {
+    _module->functions.push_back(std::make_unique<IrFunction>(name));
+    _function = _module->functions.back().get();
+    _builder = std::make_unique<IrBuilder>(_function);
+    _block_counter = 0;
+    _last_alloca = 0;
+    _builder->set_block(_function->add_block("entry"));
+}
+
+void SyntaxDirectedEmitter::end_function() {
+    // falling off the end of int main() returns 0
+    if (!_builder->closed()) {
+        _builder->ret(_function->constant(0));
+    }
+}
+
+void SyntaxDirectedEmitter::enter_scope() {
+    _scopes.emplace_back();
+}
+
+void SyntaxDirectedEmitter::exit_scope() {
+    _scopes.pop_back();
+}
+
+// endregion
+
+// region: expressions
+
+void SyntaxDirectedEmitter::push_constant(int value) {
+    push(_function->constant(value));
+}
+
+void SyntaxDirectedEmitter::push_name(const std::string &name) {
+    _names.push_back(name);
+}
+
+void SyntaxDirectedEmitter::load_name() {
+    auto value = lookup(_names.back());
+    _names.pop_back();
+    if ((*_function)[value].opcode != IR_ALLOCA) {
+        push(value);
+        return;
+    }
+    ensure_open();
+    push(_builder->load(value));
+}
+
+void SyntaxDirectedEmitter::binary(IrOpcode opcode) {
+    auto rhs = pop();
+    auto lhs = pop();
+    push(emit_binary(opcode, lhs, rhs));
+}
+
+void SyntaxDirectedEmitter::unary(const std::string &op) {
+    auto operand = pop();
+    if (op == "-") {
+        operand = emit_binary(IR_SUB, _function->constant(0), operand);
+    } else if (op == "!") {
+        operand = emit_binary(IR_EQ, operand, _function->constant(0));
+    }
+    push(operand);
+}
+
+void SyntaxDirectedEmitter::logical_head(const std::string &op) {
+    auto is_and = op == "&&";
+    auto left = pop();
+    ensure_open();
+    auto rhs_block = new_block(is_and ? "and_rhs" : "or_rhs");
+    PendingLogical pending;
+    pending.left_exit = _builder->block();
+    // the target skipping the right operand is patched by logical()
+    pending.branch = is_and ? _builder->branch(left, rhs_block, 0) : _builder->branch(left, 0, rhs_block);
+    _logicals.push_back(pending);
+    _builder->set_block(rhs_block);
+}
+
+void SyntaxDirectedEmitter::logical(const std::string &op) {
+    auto is_and = op == "&&";
+    auto pending = _logicals.back();
+    _logicals.pop_back();
+    auto right = emit_binary(IR_NE, pop(), _function->constant(0));
+    auto right_exit = _builder->block();
+    auto end_block = new_block(is_and ? "and_end" : "or_end");
+    (*_function)[pending.branch].targets[is_and ? 1 : 0] = end_block;
+    _builder->jump(end_block);
+
+    _builder->set_block(end_block);
+    auto result = _builder->phi();
+    _function->add_incoming(result, _function->constant(is_and ? 0 : 1), pending.left_exit);
+    _function->add_incoming(result, right, right_exit);
+    push(result);
+}
+
+// endregion
+
+// region: statements and declarations
+
+void SyntaxDirectedEmitter::assign() {
+    auto value = pop();
+    auto slot = lookup(_names.back());
+    _names.pop_back();
+    ensure_open();
+    _builder->store(value, slot);
+}
+
+void SyntaxDirectedEmitter::discard() {
+    pop();
+}
+
+void SyntaxDirectedEmitter::ret() {
+    auto value = pop();
+    ensure_open();
+    _builder->ret(value);
+}
+
+void SyntaxDirectedEmitter::define_const(const std::string &name) {
+    // a const needs no storage, uses refer to its value directly
+    _scopes.back()[name] = pop();
+}
+
+void SyntaxDirectedEmitter::define_var(const std::string &name) {
+    auto value = pop();
+    auto slot = _function->create(IR_ALLOCA, {});
+    if (_last_alloca == 0) {
+        auto entry = _function->entry();
+        auto first = _function->blocks[entry].first;
+        if (first != 0) {
+            _function->insert_before(first, slot);
+        } else {
+            _function->append(entry, slot);
+        }
+    } else {
+        _function->insert_after(_last_alloca, slot);
+    }
+    _last_alloca = slot;
+    _function->set_name(slot, name);
+
+    ensure_open();
+    _builder->store(value, slot);
+    _scopes.back()[name] = slot;
+}
+
+void SyntaxDirectedEmitter::if_head() {
+    auto condition = pop();
+    ensure_open();
+    auto then_block = new_block("then");
+    PendingIf pending;
+    // the false target is patched by else_head() or end_if()
+    pending.branch = _builder->branch(condition, then_block, 0);
+    _ifs.push_back(pending);
+    _builder->set_block(then_block);
+}
+
+void SyntaxDirectedEmitter::else_head() {
+    auto &pending = _ifs.back();
+    if (!_builder->closed()) {
+        // target patched by end_if_else()
+        pending.then_exit = _builder->jump(0);
+    }
+    auto else_block = new_block("else");
+    (*_function)[pending.branch].targets[1] = else_block;
+    _builder->set_block(else_block);
+}
+
+void SyntaxDirectedEmitter::end_if() {
+    auto pending = _ifs.back();
+    _ifs.pop_back();
+    auto end_block = new_block("end");
+    (*_function)[pending.branch].targets[1] = end_block;
+    if (!_builder->closed()) {
+        _builder->jump(end_block);
+    }
+    _builder->set_block(end_block);
+}
+
+void SyntaxDirectedEmitter::end_if_else() {
+    auto pending = _ifs.back();
+    _ifs.pop_back();
+    auto end_block = new_block("end");
+    if (pending.then_exit != 0) {
+        (*_function)[pending.then_exit].targets[0] = end_block;
+    }
+    if (!_builder->closed()) {
+        _builder->jump(end_block);
+    }
+    _builder->set_block(end_block);
+}
+
+// endregion
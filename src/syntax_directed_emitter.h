@@ -0,0 +1,125 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "ir.h"
+
+/**
+ * Emits IR straight from the parser actions, without building the AST first (-O0).
+ *
+ * Reductions arrive bottom-up and left to right, so operands are kept on a value stack:
+ * an expression action pops its operands and pushes its result. An if statement emits its
+ * branch before the targets exist and patches them once the arms are reduced, and so does
+ * the left operand of && and ||, which skips the right one where it already decides the
+ * result. What is kept besides the IR itself is proportional to the nesting depth of the
+ * source.
+ */
+class SyntaxDirectedEmitter {
+public:
+    SyntaxDirectedEmitter();
+
+    // region: called from the grammar actions
+
+    void begin_function(const std::string &name);
+
+    void end_function();
+
+    void enter_scope();
+
+    void exit_scope();
+
+    void push_constant(int value);
+
+    // an LVal, resolved once it is known whether it is read or assigned
+    void push_name(const std::string &name);
+
+    // LVal used as a PrimaryExp
+    void load_name();
+
+    void binary(IrOpcode opcode);
+
+    // "+", "-" or "!"
+    void unary(const std::string &op);
+
+    // "&&" or "||" with the left operand reduced: branch past the right one, to a block yet to be created
+    void logical_head(const std::string &op);
+
+    // the right operand has been reduced, join both ways with a phi
+    void logical(const std::string &op);
+
+    void assign();
+
+    void discard();
+
+    void ret();
+
+    void define_const(const std::string &name);
+
+    void define_var(const std::string &name);
+
+    // the condition has been reduced, branch to a then block and an else/end block yet to be created
+    void if_head();
+
+    // the then arm has been reduced and an else follows
+    void else_head();
+
+    void end_if();
+
+    void end_if_else();
+
+    // endregion
+
+    // the module emitted so far; the emitter is spent afterwards
+    std::unique_ptr<IrModule> finish();
+
+    // largest depth the value stack reached
+    size_t peak_stack_depth() const {
+        return _peak_depth;
+    }
+
+private:
+    // an if statement whose targets are not known yet
+    struct PendingIf {
+        IrValueId branch = 0;
+        // jump closing the then arm, 0 if the arm ended in a return
+        IrValueId then_exit = 0;
+    };
+
+    // an && or || whose end block is not known yet
+    struct PendingLogical {
+        IrValueId branch = 0;
+        // where the branch skipping the right operand leaves from
+        IrBlockId left_exit = 0;
+    };
+
+    std::unique_ptr<IrModule> _module;
+    IrFunction *_function = nullptr;
+    std::unique_ptr<IrBuilder> _builder;
+    IrValueId _last_alloca = 0;
+
+    std::vector<IrValueId> _values;
+    std::vector<std::string> _names;
+    std::vector<PendingIf> _ifs;
+    std::vector<PendingLogical> _logicals;
+    // name -> alloca of a variable, or the value of a const
+    std::vector<std::map<std::string, IrValueId>> _scopes;
+    int _block_counter = 0;
+    size_t _peak_depth = 0;
+
+    void push(IrValueId value);
+
+    IrValueId pop();
+
+    IrBlockId new_block(const std::string &prefix);
+
+    void ensure_open();
+
+    IrValueId emit_binary(IrOpcode opcode, IrValueId lhs, IrValueId rhs);
+
+    IrValueId lookup(const std::string &name);
+};
+
+// set while parsing in syntax-directed mode, nullptr when the parser builds the AST
+extern SyntaxDirectedEmitter *syntax_directed_emitter;
@@ -6,6 +6,7 @@
 #include <string>
 #include "Ast.h"
 #include "symbol_table.h"
+#include "syntax_directed_emitter.h"
 
 #define YYERROR_VERBOSE 1
 // 声明 lexer 函数和错误处理函数
@@ -61,7 +62,7 @@ KEY_WORD_IF KEY_WORD_ELSE RETURN
 
 
 // 非终结符的类型定义
-%type <ast_val> FuncDef FuncType Block BlockItems BlockItem Stmt
+%type <ast_val> FuncDef FuncType Block BlockItems BlockItem Stmt IfHead ElseHead
 UnaryOp UnaryExp PrimaryExp Exp LVal
 AddExp MulExp
 LOrExp LAndExp EqExp RelExp
@@ -84,9 +85,11 @@ VarDecl   VarDefList      VarDef   VarInitVal   VarExp
 
 CompUnit
   : FuncDef {
-    auto comp_unit = make_unique<CompUnitAST>();
-    comp_unit->func_def = unique_ptr<BaseAST>($1);
-    ast = move(comp_unit);
+    if (syntax_directed_emitter == nullptr) {
+      auto comp_unit = make_unique<CompUnitAST>();
+      comp_unit->func_def = unique_ptr<BaseAST>($1);
+      ast = move(comp_unit);
+    }
   }
   ;
 
@@ -101,222 +104,353 @@ CompUnit
 // 虽然此处你看不出用 unique_ptr 和手动 delete 的区别, 但当我们定义了 AST 之后
 // 这种写法会省下很多内存管理的负担
 FuncDef
-  : FuncType IDENT '(' ')' Block {
-    printf("FuncType IDENT '(' ')' Block => FuncDef\n");
-    auto ast = new FuncDefAST();
-    ast->func_type = unique_ptr<BaseAST>($1);
-    logoutString(std::string() + "func name: " + *$2);
-    ast->ident = *unique_ptr<string>($2);
-    ast->block = unique_ptr<BaseAST>($5);
-    $$ = ast;
+  : FuncType IDENT '(' ')' {
+    if (syntax_directed_emitter != nullptr) {
+      syntax_directed_emitter->begin_function(*$2);
+    }
+  } Block {
+    if (syntax_directed_emitter != nullptr) {
+      syntax_directed_emitter->end_function();
+      delete $2;
+      $$ = nullptr;
+    } else {
+      printf("FuncType IDENT '(' ')' Block => FuncDef\n");
+      auto ast = new FuncDefAST();
+      ast->func_type = unique_ptr<BaseAST>($1);
+      logoutString(std::string() + "func name: " + *$2);
+      ast->ident = *unique_ptr<string>($2);
+      ast->block = unique_ptr<BaseAST>($6);
+      $$ = ast;
+    }
   }
   ;
 
 
 FuncType
   	:INT {
-  		  auto func_type = new FuncTypeAST();
-  		  func_type->type_name = std::string("int");
-  		  $$ = func_type;
-        }
+      if (syntax_directed_emitter != nullptr) {
+        $$ = nullptr;
+      } else {
+        auto func_type = new FuncTypeAST();
+        func_type->type_name = std::string("int");
+        $$ = func_type;
+      }
+    }
   ;
 
 Block
-  : '{' BlockItems '}' {
-    printf("{ BlockItems } => Block\n");
-    auto block = new BlockAST();
-    block->block_item_list = unique_ptr<BaseAST>($2);
-    $$ = block;
+  : '{' {
+    if (syntax_directed_emitter != nullptr) {
+      syntax_directed_emitter->enter_scope();
+    }
+  } BlockItems '}' {
+    if (syntax_directed_emitter != nullptr) {
+      syntax_directed_emitter->exit_scope();
+      $$ = nullptr;
+    } else {
+      printf("{ BlockItems } => Block\n");
+      auto block = new BlockAST();
+      block->block_item_list = unique_ptr<BaseAST>($3);
+      block->location = std::make_shared<LocationImpl>(@1.first_line, @1.first_column, @4.last_line, @4.last_column);
+      $$ = block;
+    }
   }
   ;
 
 BlockItems: /* Empty production */
   {
-	printf("Empty Block => BlockItems\n");
-	auto block_items = new BlockItemListAST();
-	block_items->choice = EMPTY;
-	$$ = block_items;
+	if (syntax_directed_emitter != nullptr) {
+		$$ = nullptr;
+	} else {
+		printf("Empty Block => BlockItems\n");
+		auto block_items = new BlockItemListAST();
+		block_items->choice = EMPTY;
+		$$ = block_items;
+	}
   }
   | BlockItems BlockItem {
-	printf("BlockItems BlockItem => BlockItems\n");
-	auto block_items = new BlockItemListAST();
-	block_items->choice = BLOCK_LIST;
-	printf("far\n");
-	block_items->list.insert(block_items->list.end(),
-					 std::make_move_iterator(((BlockItemListAST *)$1)->list.begin()),
-					 std::make_move_iterator(((BlockItemListAST *)$1)->list.end()));
-	printf("almost there\n");
-	block_items->list.push_back(unique_ptr<BaseAST>($2));
-	printf("you got it\n");
-	$$ = block_items;
+	if (syntax_directed_emitter != nullptr) {
+		$$ = nullptr;
+	} else {
+		printf("BlockItems BlockItem => BlockItems\n");
+		auto block_items = new BlockItemListAST();
+		block_items->choice = BLOCK_LIST;
+		printf("far\n");
+		block_items->list.insert(block_items->list.end(),
+						 std::make_move_iterator(((BlockItemListAST *)$1)->list.begin()),
+						 std::make_move_iterator(((BlockItemListAST *)$1)->list.end()));
+		printf("almost there\n");
+		block_items->list.push_back(unique_ptr<BaseAST>($2));
+		printf("you got it\n");
+		$$ = block_items;
+	}
   }
   ;
 
 BlockItem
 : Decl
  {
-   	printf("Decl => BlockItem\n");
-   	auto block_item = new BlockItemAST();
-   	block_item->choice = DECLARATION;
-   	block_item->declaration = unique_ptr<BaseAST>($1);
-   	$$ = block_item;
+   if (syntax_directed_emitter != nullptr) {
+     $$ = nullptr;
+   } else {
+     printf("Decl => BlockItem\n");
+     auto block_item = new BlockItemAST();
+     block_item->choice = DECLARATION;
+     block_item->declaration = unique_ptr<BaseAST>($1);
+     $$ = block_item;
+   }
  }
  |
  Stmt
  {
- 	printf("Stmt => BlockItem\n");
-   	auto block_item = new BlockItemAST();
-   	block_item->choice = STATEMENT;
-   	block_item->statement = unique_ptr<BaseAST>($1);
-   	$$ = block_item;
+   if (syntax_directed_emitter != nullptr) {
+     $$ = nullptr;
+   } else {
+     printf("Stmt => BlockItem\n");
+     auto block_item = new BlockItemAST();
+     block_item->choice = STATEMENT;
+     block_item->statement = unique_ptr<BaseAST>($1);
+     $$ = block_item;
+   }
  }
  ;
 
 Stmt:
   // assignment statement
   LVal '=' Exp ';' {
-    printf("LVal = Exp ; => Stmt\n");
-    auto stmt = new StmtAST();
-    stmt->choice = ASSIGNMENT_STATEMENT;
-    stmt->left_value = unique_ptr<BaseAST>($1);
-    stmt->exp = unique_ptr<BaseAST>($3);
-    $$ = stmt;
+    if (syntax_directed_emitter != nullptr) {
+      syntax_directed_emitter->assign();
+      $$ = nullptr;
+    } else {
+      printf("LVal = Exp ; => Stmt\n");
+      auto stmt = new StmtAST();
+      stmt->choice = ASSIGNMENT_STATEMENT;
+      stmt->left_value = unique_ptr<BaseAST>($1);
+      stmt->exp = unique_ptr<BaseAST>($3);
+      $$ = stmt;
+    }
   }
   // expression statement
   | Exp ';' {
-    printf("Exp ; => Stmt\n");
-    auto stmt = new StmtAST();
-    stmt->choice = EXPRESSION_STATEMENT;
-    stmt->exp = unique_ptr<BaseAST>($1);
-    $$ = stmt;
+    if (syntax_directed_emitter != nullptr) {
+      syntax_directed_emitter->discard();
+      $$ = nullptr;
+    } else {
+      printf("Exp ; => Stmt\n");
+      auto stmt = new StmtAST();
+      stmt->choice = EXPRESSION_STATEMENT;
+      stmt->exp = unique_ptr<BaseAST>($1);
+      $$ = stmt;
+    }
   }
   |
   // empty statement
   ';' {
-    printf("; => Stmt\n");
-    auto stmt = new StmtAST();
-    stmt->choice = EMPTY_STATEMENT;
-    $$ = stmt;
+    if (syntax_directed_emitter != nullptr) {
+      $$ = nullptr;
+    } else {
+      printf("; => Stmt\n");
+      auto stmt = new StmtAST();
+      stmt->choice = EMPTY_STATEMENT;
+      $$ = stmt;
+    }
   }
   |
   // block statement
   Block {
-    printf("Block => Stmt\n");
-    auto stmt = new StmtAST();
-    stmt->choice = BLOCK_STATEMENT;
-    stmt->block = unique_ptr<BaseAST>($1);
-    $$ = stmt;
+    if (syntax_directed_emitter != nullptr) {
+      $$ = nullptr;
+    } else {
+      printf("Block => Stmt\n");
+      auto stmt = new StmtAST();
+      stmt->choice = BLOCK_STATEMENT;
+      stmt->block = unique_ptr<BaseAST>($1);
+      $$ = stmt;
+    }
   }
   |
   // if statement
-  KEY_WORD_IF '(' Exp ')' Stmt {
-    printf("if ( Exp ) Stmt => Stmt\n");
-    auto stmt = new StmtAST();
-    stmt->choice = IF_STATEMENT;
-    stmt->exp = unique_ptr<BaseAST>($3);
-    stmt->if_statement = unique_ptr<BaseAST>($5);
-    $$ = stmt;
+  IfHead Stmt {
+    if (syntax_directed_emitter != nullptr) {
+      syntax_directed_emitter->end_if();
+      $$ = nullptr;
+    } else {
+      printf("if ( Exp ) Stmt => Stmt\n");
+      auto stmt = new StmtAST();
+      stmt->choice = IF_STATEMENT;
+      stmt->exp = unique_ptr<BaseAST>($1);
+      stmt->if_statement = unique_ptr<BaseAST>($2);
+      $$ = stmt;
+    }
   }
   |
   // if else statement
-  KEY_WORD_IF '(' Exp ')' Stmt KEY_WORD_ELSE Stmt {
-    printf("if ( Exp ) Stmt else Stmt => Stmt\n");
-    auto stmt = new StmtAST();
-    stmt->choice = IF_ELSE_STATEMENT;
-    stmt->exp = unique_ptr<BaseAST>($3);
-    stmt->if_statement = unique_ptr<BaseAST>($5);
-    stmt->else_statement = unique_ptr<BaseAST>($7);
-    $$ = stmt;
+  IfHead Stmt ElseHead Stmt {
+    if (syntax_directed_emitter != nullptr) {
+      syntax_directed_emitter->end_if_else();
+      $$ = nullptr;
+    } else {
+      printf("if ( Exp ) Stmt else Stmt => Stmt\n");
+      auto stmt = new StmtAST();
+      stmt->choice = IF_ELSE_STATEMENT;
+      stmt->exp = unique_ptr<BaseAST>($1);
+      stmt->if_statement = unique_ptr<BaseAST>($2);
+      stmt->else_statement = unique_ptr<BaseAST>($4);
+      $$ = stmt;
+    }
   }
   |
   // return statement
   RETURN Exp ';' {
-    printf("return Exp ; => Stmt\n");
-    auto stmt = new StmtAST();
-    stmt->choice = RETURN_STATEMENT;
-    stmt->exp = unique_ptr<BaseAST>($2);
-    $$ = stmt;
+    if (syntax_directed_emitter != nullptr) {
+      syntax_directed_emitter->ret();
+      $$ = nullptr;
+    } else {
+      printf("return Exp ; => Stmt\n");
+      auto stmt = new StmtAST();
+      stmt->choice = RETURN_STATEMENT;
+      stmt->exp = unique_ptr<BaseAST>($2);
+      $$ = stmt;
+    }
+  }
+  ;
+
+// The heads of an if statement are reduced before the arms, which is where the
+// syntax-directed mode emits the branch and later patches its targets.
+IfHead
+  : KEY_WORD_IF '(' Exp ')' {
+    if (syntax_directed_emitter != nullptr) {
+      syntax_directed_emitter->if_head();
+    }
+    // the condition, picked up by the if statement
+    $$ = $3;
+  }
+  ;
+
+ElseHead
+  : KEY_WORD_ELSE {
+    if (syntax_directed_emitter != nullptr) {
+      syntax_directed_emitter->else_head();
+    }
+    $$ = nullptr;
   }
   ;
 
 //Exp         ::= LOrExp;
 Exp
 : LOrExp {
-	printf("LOrExp => Exp\n");
-	auto exp = new ExpAST();
-	exp->lor_exp = unique_ptr<BaseAST>($1);
-	$$ = exp;
+	if (syntax_directed_emitter != nullptr) {
+		$$ = nullptr;
+	} else {
+		printf("LOrExp => Exp\n");
+		auto exp = new ExpAST();
+		exp->lor_exp = unique_ptr<BaseAST>($1);
+		$$ = exp;
+	}
 }
 ;
 
 //MulExp      ::= UnaryExp | MulExp ("*" | "/" | "%") UnaryExp;
 MulExp
 : UnaryExp {
-	printf(" UnaryExp => MulExp\n");
-	auto mul_exp = new MulExpAST();
-	mul_exp->choice = UNARYEXP;
-	mul_exp->unary_exp = unique_ptr<BaseAST>($1);
-	$$ = mul_exp;
+	if (syntax_directed_emitter != nullptr) {
+		$$ = nullptr;
+	} else {
+		printf(" UnaryExp => MulExp\n");
+		auto mul_exp = new MulExpAST();
+		mul_exp->choice = UNARYEXP;
+		mul_exp->unary_exp = unique_ptr<BaseAST>($1);
+		$$ = mul_exp;
+	}
 }
 |
 MulExp '*' UnaryExp {
-	printf(" MulExp * UnaryExp => MulExp\n");
-	auto mul_exp = new MulExpAST();
-	mul_exp->choice = MUL_OP_UNARYEXP;
-	mul_exp->mul_op = "*";
-	mul_exp->mul_exp = unique_ptr<BaseAST>($1);
-	mul_exp->unary_exp = unique_ptr<BaseAST>($3);
-	$$ = mul_exp;
+	if (syntax_directed_emitter != nullptr) {
+		syntax_directed_emitter->binary(IR_MUL);
+		$$ = nullptr;
+	} else {
+		printf(" MulExp * UnaryExp => MulExp\n");
+		auto mul_exp = new MulExpAST();
+		mul_exp->choice = MUL_OP_UNARYEXP;
+		mul_exp->mul_op = "*";
+		mul_exp->mul_exp = unique_ptr<BaseAST>($1);
+		mul_exp->unary_exp = unique_ptr<BaseAST>($3);
+		$$ = mul_exp;
+	}
 }
 |
 MulExp '/' UnaryExp {
-	printf(" MulExp / UnaryExp => MulExp\n");
-	auto mul_exp = new MulExpAST();
-	mul_exp->choice = MUL_OP_UNARYEXP;
-	mul_exp->mul_op = "/";
-	mul_exp->mul_exp = unique_ptr<BaseAST>($1);
-	mul_exp->unary_exp = unique_ptr<BaseAST>($3);
-	$$ = mul_exp;
+	if (syntax_directed_emitter != nullptr) {
+		syntax_directed_emitter->binary(IR_DIV);
+		$$ = nullptr;
+	} else {
+		printf(" MulExp / UnaryExp => MulExp\n");
+		auto mul_exp = new MulExpAST();
+		mul_exp->choice = MUL_OP_UNARYEXP;
+		mul_exp->mul_op = "/";
+		mul_exp->mul_exp = unique_ptr<BaseAST>($1);
+		mul_exp->unary_exp = unique_ptr<BaseAST>($3);
+		$$ = mul_exp;
+	}
 }
 |
 MulExp '%' UnaryExp {
-	printf(" MulExp mod UnaryExp => MulExp\n");
-	auto mul_exp = new MulExpAST();
-	mul_exp->choice = MUL_OP_UNARYEXP;
-	mul_exp->mul_op = "%";
-	mul_exp->mul_exp = unique_ptr<BaseAST>($1);
-	mul_exp->unary_exp = unique_ptr<BaseAST>($3);
-	$$ = mul_exp;
+	if (syntax_directed_emitter != nullptr) {
+		syntax_directed_emitter->binary(IR_REM);
+		$$ = nullptr;
+	} else {
+		printf(" MulExp mod UnaryExp => MulExp\n");
+		auto mul_exp = new MulExpAST();
+		mul_exp->choice = MUL_OP_UNARYEXP;
+		mul_exp->mul_op = "%";
+		mul_exp->mul_exp = unique_ptr<BaseAST>($1);
+		mul_exp->unary_exp = unique_ptr<BaseAST>($3);
+		$$ = mul_exp;
+	}
 }
 
 //AddExp      ::= MulExp | AddExp ("+" | "-") MulExp;
 AddExp
 : MulExp {
-	printf("MulExp => AddExp\n");
-	auto add_exp = new AddExpAST();
-	add_exp->choice = MULEXP;
-	add_exp->mul_exp = unique_ptr<BaseAST>($1);
-	$$ = add_exp;
+	if (syntax_directed_emitter != nullptr) {
+		$$ = nullptr;
+	} else {
+		printf("MulExp => AddExp\n");
+		auto add_exp = new AddExpAST();
+		add_exp->choice = MULEXP;
+		add_exp->mul_exp = unique_ptr<BaseAST>($1);
+		$$ = add_exp;
+	}
 }
 |
 AddExp '+' MulExp {
-	printf("AddExp + MulExp => AddExp\n");
-	auto add_exp = new AddExpAST();
-	add_exp->choice = ADD_OP_MULEXP;
-	add_exp->add_op = "+";
-	add_exp->add_exp = unique_ptr<BaseAST>($1);
-	add_exp->mul_exp = unique_ptr<BaseAST>($3);
-	$$ = add_exp;
+	if (syntax_directed_emitter != nullptr) {
+		syntax_directed_emitter->binary(IR_ADD);
+		$$ = nullptr;
+	} else {
+		printf("AddExp + MulExp => AddExp\n");
+		auto add_exp = new AddExpAST();
+		add_exp->choice = ADD_OP_MULEXP;
+		add_exp->add_op = "+";
+		add_exp->add_exp = unique_ptr<BaseAST>($1);
+		add_exp->mul_exp = unique_ptr<BaseAST>($3);
+		$$ = add_exp;
+	}
 }
 |
 AddExp '-' MulExp {
-	printf("AddExp - MulExp => AddExp\n");
-	auto add_exp = new AddExpAST();
-	add_exp->choice = ADD_OP_MULEXP;
-	add_exp->add_op = "-";
-	add_exp->add_exp = unique_ptr<BaseAST>($1);
-	add_exp->mul_exp = unique_ptr<BaseAST>($3);
-	$$ = add_exp;
+	if (syntax_directed_emitter != nullptr) {
+		syntax_directed_emitter->binary(IR_SUB);
+		$$ = nullptr;
+	} else {
+		printf("AddExp - MulExp => AddExp\n");
+		auto add_exp = new AddExpAST();
+		add_exp->choice = ADD_OP_MULEXP;
+		add_exp->add_op = "-";
+		add_exp->add_exp = unique_ptr<BaseAST>($1);
+		add_exp->mul_exp = unique_ptr<BaseAST>($3);
+		$$ = add_exp;
+	}
 }
 
 
@@ -324,20 +458,29 @@ AddExp '-' MulExp {
 //UnaryExp    ::= PrimaryExp | UnaryOp UnaryExp;
 UnaryExp
   : PrimaryExp {
-  		printf("PrimaryExp => UnaryExp  \n");
-		auto unary_exp = new UnaryExpAST();
-		unary_exp->choice = PRIMARY;
-		unary_exp->primary_exp = unique_ptr<BaseAST>($1);
-		$$ = unary_exp;
+    if (syntax_directed_emitter != nullptr) {
+      $$ = nullptr;
+    } else {
+      printf("PrimaryExp => UnaryExp  \n");
+      auto unary_exp = new UnaryExpAST();
+      unary_exp->choice = PRIMARY;
+      unary_exp->primary_exp = unique_ptr<BaseAST>($1);
+      $$ = unary_exp;
+    }
   }
   |
   UnaryOp UnaryExp {
-  	  printf("UnaryOp UnaryExp => UnaryExp  \n");
-	  auto unary_exp = new UnaryExpAST();
-	  unary_exp->choice = UNARYOP_UNARYEXP;
-	  unary_exp->unary_op =  unique_ptr<BaseAST>($1);
-	  unary_exp->unary_exp =  unique_ptr<BaseAST>($2);
-	  $$ = unary_exp;
+    if (syntax_directed_emitter != nullptr) {
+      syntax_directed_emitter->unary(unique_ptr<UnaryOpAST>((UnaryOpAST *)$1)->op);
+      $$ = nullptr;
+    } else {
+      printf("UnaryOp UnaryExp => UnaryExp  \n");
+      auto unary_exp = new UnaryExpAST();
+      unary_exp->choice = UNARYOP_UNARYEXP;
+      unary_exp->unary_op =  unique_ptr<BaseAST>($1);
+      unary_exp->unary_exp =  unique_ptr<BaseAST>($2);
+      $$ = unary_exp;
+    }
   }
   ;
 
@@ -365,36 +508,55 @@ UnaryOp:
 
 LVal
 : IDENT {
-	printf("LDENT => LVal\n");
-	auto lval = new LValAST();
-	lval->ident = *$1;
-	$$ = lval;
+	if (syntax_directed_emitter != nullptr) {
+		syntax_directed_emitter->push_name(*unique_ptr<string>($1));
+		$$ = nullptr;
+	} else {
+		printf("LDENT => LVal\n");
+		auto lval = new LValAST();
+		lval->ident = *$1;
+		$$ = lval;
+	}
 }
 
 //PrimaryExp  ::= "(" Exp ")" | Number;
 PrimaryExp
   : '(' Exp ')'  {
-  		printf("(Exp) => PrimaryExp\n");
-		auto primary_exp = new PrimaryExpAST();
-		primary_exp->choice = EXP;
-		primary_exp->exp = unique_ptr<BaseAST>($2);
-		$$ = primary_exp;
+    if (syntax_directed_emitter != nullptr) {
+      $$ = nullptr;
+    } else {
+      printf("(Exp) => PrimaryExp\n");
+      auto primary_exp = new PrimaryExpAST();
+      primary_exp->choice = EXP;
+      primary_exp->exp = unique_ptr<BaseAST>($2);
+      $$ = primary_exp;
+    }
   }
   | LVal
   {
-	  	printf("LVal => PrimaryExp\n");
-  		auto primary_exp = new PrimaryExpAST();
-  		primary_exp->choice = LEFT_VALUE;
-  		primary_exp->left_value = unique_ptr<BaseAST>($1);
-  		$$ = primary_exp;
+    if (syntax_directed_emitter != nullptr) {
+      syntax_directed_emitter->load_name();
+      $$ = nullptr;
+    } else {
+      printf("LVal => PrimaryExp\n");
+      auto primary_exp = new PrimaryExpAST();
+      primary_exp->choice = LEFT_VALUE;
+      primary_exp->left_value = unique_ptr<BaseAST>($1);
+      $$ = primary_exp;
+    }
   }
   |
   Number {
-  		printf("Number => PrimaryExp\n");
-  		auto primary_exp = new PrimaryExpAST();
-  		primary_exp->choice = NUMBER;
-  		primary_exp->number = $1;
-  		$$ = primary_exp;
+    if (syntax_directed_emitter != nullptr) {
+      syntax_directed_emitter->push_constant($1);
+      $$ = nullptr;
+    } else {
+      printf("Number => PrimaryExp\n");
+      auto primary_exp = new PrimaryExpAST();
+      primary_exp->choice = NUMBER;
+      primary_exp->number = $1;
+      $$ = primary_exp;
+    }
   }
 
 
@@ -415,227 +577,344 @@ Number
 
 RelExp
 : AddExp {
-	printf(" AddExp=>RelExp \n");
-	auto rel_exp = new RelExpAST();
-	rel_exp->choice = ADDEXP;
-	rel_exp->add_exp = unique_ptr<BaseAST>($1);
-	$$ = rel_exp;
+	if (syntax_directed_emitter != nullptr) {
+		$$ = nullptr;
+	} else {
+		printf(" AddExp=>RelExp \n");
+		auto rel_exp = new RelExpAST();
+		rel_exp->choice = ADDEXP;
+		rel_exp->add_exp = unique_ptr<BaseAST>($1);
+		$$ = rel_exp;
+	}
 }
 |
 RelExp '<' AddExp {
-	printf(" RelExp < AddExp=>RelExp \n");
-	auto rel_exp = new RelExpAST();
-	rel_exp->choice = REL_OP_ADDEXP;
-	rel_exp->rel_op = "<";
-	rel_exp->rel_exp = unique_ptr<BaseAST>($1);
-	rel_exp->add_exp = unique_ptr<BaseAST>($3);
-	$$ = rel_exp;
+	if (syntax_directed_emitter != nullptr) {
+		syntax_directed_emitter->binary(IR_LT);
+		$$ = nullptr;
+	} else {
+		printf(" RelExp < AddExp=>RelExp \n");
+		auto rel_exp = new RelExpAST();
+		rel_exp->choice = REL_OP_ADDEXP;
+		rel_exp->rel_op = "<";
+		rel_exp->rel_exp = unique_ptr<BaseAST>($1);
+		rel_exp->add_exp = unique_ptr<BaseAST>($3);
+		$$ = rel_exp;
+	}
 }
 |
 RelExp '>' AddExp {
-	printf(" RelExp > AddExp=>RelExp \n");
-	auto rel_exp = new RelExpAST();
-	rel_exp->choice = REL_OP_ADDEXP;
-	rel_exp->rel_op = ">";
-	rel_exp->rel_exp = unique_ptr<BaseAST>($1);
-	rel_exp->add_exp = unique_ptr<BaseAST>($3);
-	$$ = rel_exp;
+	if (syntax_directed_emitter != nullptr) {
+		syntax_directed_emitter->binary(IR_GT);
+		$$ = nullptr;
+	} else {
+		printf(" RelExp > AddExp=>RelExp \n");
+		auto rel_exp = new RelExpAST();
+		rel_exp->choice = REL_OP_ADDEXP;
+		rel_exp->rel_op = ">";
+		rel_exp->rel_exp = unique_ptr<BaseAST>($1);
+		rel_exp->add_exp = unique_ptr<BaseAST>($3);
+		$$ = rel_exp;
+	}
 }
 |
 RelExp '<''=' AddExp {
-	printf(" RelExp <= AddExp => RelExp \n");
-	auto rel_exp = new RelExpAST();
-	rel_exp->choice = REL_OP_ADDEXP;
-	rel_exp->rel_op = "<=";
-	rel_exp->rel_exp = unique_ptr<BaseAST>($1);
-	rel_exp->add_exp = unique_ptr<BaseAST>($4);
-	$$ = rel_exp;
+	if (syntax_directed_emitter != nullptr) {
+		syntax_directed_emitter->binary(IR_LE);
+		$$ = nullptr;
+	} else {
+		printf(" RelExp <= AddExp => RelExp \n");
+		auto rel_exp = new RelExpAST();
+		rel_exp->choice = REL_OP_ADDEXP;
+		rel_exp->rel_op = "<=";
+		rel_exp->rel_exp = unique_ptr<BaseAST>($1);
+		rel_exp->add_exp = unique_ptr<BaseAST>($4);
+		$$ = rel_exp;
+	}
 }
 |
 RelExp '>''=' AddExp {
-	printf(" RelExp >= AddExp => RelExp \n");
-	auto rel_exp = new RelExpAST();
-	rel_exp->choice = REL_OP_ADDEXP;
-	rel_exp->rel_op = ">=";
-	rel_exp->rel_exp = unique_ptr<BaseAST>($1);
-	rel_exp->add_exp = unique_ptr<BaseAST>($4);
-	$$ = rel_exp;
+	if (syntax_directed_emitter != nullptr) {
+		syntax_directed_emitter->binary(IR_GE);
+		$$ = nullptr;
+	} else {
+		printf(" RelExp >= AddExp => RelExp \n");
+		auto rel_exp = new RelExpAST();
+		rel_exp->choice = REL_OP_ADDEXP;
+		rel_exp->rel_op = ">=";
+		rel_exp->rel_exp = unique_ptr<BaseAST>($1);
+		rel_exp->add_exp = unique_ptr<BaseAST>($4);
+		$$ = rel_exp;
+	}
 }
 
 
 EqExp
 : RelExp {
-	printf("RelExp => EqExp\n");
-	auto eq_exp = new EqExpAST();
-	eq_exp->choice = RELEXP;
-	eq_exp->rel_exp = unique_ptr<BaseAST>($1);
-	$$ = eq_exp;
+	if (syntax_directed_emitter != nullptr) {
+		$$ = nullptr;
+	} else {
+		printf("RelExp => EqExp\n");
+		auto eq_exp = new EqExpAST();
+		eq_exp->choice = RELEXP;
+		eq_exp->rel_exp = unique_ptr<BaseAST>($1);
+		$$ = eq_exp;
+	}
 }
 |
 EqExp '=''=' RelExp {
-	printf(" EqExp == RelExp => EqExp \n");
-	auto eq_exp = new EqExpAST();
-	eq_exp->choice = EQ_OP_RELEXP;
-	eq_exp->eq_op = "==";
-	eq_exp->eq_exp = unique_ptr<BaseAST>($1);
-	eq_exp->rel_exp = unique_ptr<BaseAST>($4);
-	$$ = eq_exp;
+	if (syntax_directed_emitter != nullptr) {
+		syntax_directed_emitter->binary(IR_EQ);
+		$$ = nullptr;
+	} else {
+		printf(" EqExp == RelExp => EqExp \n");
+		auto eq_exp = new EqExpAST();
+		eq_exp->choice = EQ_OP_RELEXP;
+		eq_exp->eq_op = "==";
+		eq_exp->eq_exp = unique_ptr<BaseAST>($1);
+		eq_exp->rel_exp = unique_ptr<BaseAST>($4);
+		$$ = eq_exp;
+	}
 }
 |
 EqExp '!''=' RelExp {
-	printf(" EqExp != RelExp => EqExp \n");
-	auto eq_exp = new EqExpAST();
-	eq_exp->choice = EQ_OP_RELEXP;
-	eq_exp->eq_op = "!=";
-	eq_exp->eq_exp = unique_ptr<BaseAST>($1);
-	eq_exp->rel_exp = unique_ptr<BaseAST>($4);
-	$$ = eq_exp;
+	if (syntax_directed_emitter != nullptr) {
+		syntax_directed_emitter->binary(IR_NE);
+		$$ = nullptr;
+	} else {
+		printf(" EqExp != RelExp => EqExp \n");
+		auto eq_exp = new EqExpAST();
+		eq_exp->choice = EQ_OP_RELEXP;
+		eq_exp->eq_op = "!=";
+		eq_exp->eq_exp = unique_ptr<BaseAST>($1);
+		eq_exp->rel_exp = unique_ptr<BaseAST>($4);
+		$$ = eq_exp;
+	}
 }
 
 LAndExp
 : EqExp {
-	printf("EqExp => LAndExp\n");
-	auto land_exp = new LAndExpAST();
-	land_exp->choice = EQEXP;
-	land_exp->eq_exp = unique_ptr<BaseAST>($1);
-	$$ = land_exp;
+	if (syntax_directed_emitter != nullptr) {
+		$$ = nullptr;
+	} else {
+		printf("EqExp => LAndExp\n");
+		auto land_exp = new LAndExpAST();
+		land_exp->choice = EQEXP;
+		land_exp->eq_exp = unique_ptr<BaseAST>($1);
+		$$ = land_exp;
+	}
 }
 |
-LAndExp '&''&' EqExp {
-	printf("LAndExp && EqExp => LAndExp  \n");
-	auto land_exp = new LAndExpAST();
-	land_exp->choice = LAND_OP_EQEXP;
-	land_exp->land_op = "&&";
-	land_exp->land_exp = unique_ptr<BaseAST>($1);
-	land_exp->eq_exp = unique_ptr<BaseAST>($4);
-	$$ = land_exp;
+LAndExp '&''&' {
+	// the left operand decides whether the right one runs at all
+	if (syntax_directed_emitter != nullptr) {
+		syntax_directed_emitter->logical_head("&&");
+	}
+} EqExp {
+	if (syntax_directed_emitter != nullptr) {
+		syntax_directed_emitter->logical("&&");
+		$$ = nullptr;
+	} else {
+		printf("LAndExp && EqExp => LAndExp  \n");
+		auto land_exp = new LAndExpAST();
+		land_exp->choice = LAND_OP_EQEXP;
+		land_exp->land_op = "&&";
+		land_exp->land_exp = unique_ptr<BaseAST>($1);
+		land_exp->eq_exp = unique_ptr<BaseAST>($5);
+		$$ = land_exp;
+	}
 }
 |
-LAndExp '|''|' EqExp {
-	printf(" LAndExp || EqExp => LAndExp\n");
-	auto land_exp = new LAndExpAST();
-	land_exp->choice = LAND_OP_EQEXP;
-	land_exp->land_op = "||";
-	land_exp->land_exp = unique_ptr<BaseAST>($1);
-	land_exp->eq_exp = unique_ptr<BaseAST>($4);
-	$$ = land_exp;
+LAndExp '|''|' {
+	if (syntax_directed_emitter != nullptr) {
+		syntax_directed_emitter->logical_head("||");
+	}
+} EqExp {
+	if (syntax_directed_emitter != nullptr) {
+		syntax_directed_emitter->logical("||");
+		$$ = nullptr;
+	} else {
+		printf(" LAndExp || EqExp => LAndExp\n");
+		auto land_exp = new LAndExpAST();
+		land_exp->choice = LAND_OP_EQEXP;
+		land_exp->land_op = "||";
+		land_exp->land_exp = unique_ptr<BaseAST>($1);
+		land_exp->eq_exp = unique_ptr<BaseAST>($5);
+		$$ = land_exp;
+	}
 }
 
 LOrExp
 : LAndExp {
-	printf(" LAndExp => LOrExp \n");
-	auto lor_exp = new LOrExpAST();
-	lor_exp->choice = LAND_EXP;
-	lor_exp->land_exp = unique_ptr<BaseAST>($1);
-	$$ = lor_exp;
+	if (syntax_directed_emitter != nullptr) {
+		$$ = nullptr;
+	} else {
+		printf(" LAndExp => LOrExp \n");
+		auto lor_exp = new LOrExpAST();
+		lor_exp->choice = LAND_EXP;
+		lor_exp->land_exp = unique_ptr<BaseAST>($1);
+		$$ = lor_exp;
+	}
 }
 |
-LOrExp '|''|' LAndExp {
-	printf(" LOrExp || LAndExp => LOrExp\n");
-	auto lor_exp = new LOrExpAST();
-	lor_exp->choice = LOR_OP_LAND_EXP;
-	lor_exp->lor_op = "||";
-	lor_exp->lor_exp = unique_ptr<BaseAST>($1);
-	lor_exp->land_exp = unique_ptr<BaseAST>($4);
-	$$ = lor_exp;
+LOrExp '|''|' {
+	if (syntax_directed_emitter != nullptr) {
+		syntax_directed_emitter->logical_head("||");
+	}
+} LAndExp {
+	if (syntax_directed_emitter != nullptr) {
+		syntax_directed_emitter->logical("||");
+		$$ = nullptr;
+	} else {
+		printf(" LOrExp || LAndExp => LOrExp\n");
+		auto lor_exp = new LOrExpAST();
+		lor_exp->choice = LOR_OP_LAND_EXP;
+		lor_exp->lor_op = "||";
+		lor_exp->lor_exp = unique_ptr<BaseAST>($1);
+		lor_exp->land_exp = unique_ptr<BaseAST>($5);
+		$$ = lor_exp;
+	}
 }
 
 BType:
 INT {
-	printf("INT => BType\n");
-	auto b_type = new BTypeAST();
-	b_type->type = "int";
-	$$ = b_type;
+	if (syntax_directed_emitter != nullptr) {
+		$$ = nullptr;
+	} else {
+		printf("INT => BType\n");
+		auto b_type = new BTypeAST();
+		b_type->type = "int";
+		$$ = b_type;
+	}
 }
 
 Decl:
 ConstDecl {
-	printf("ConstDecl => Decl\n");
-	auto decl = new DeclarationAST();
-	decl->const_declaration = unique_ptr<BaseAST>($1);
-	decl->choice = CONST_DECLARATION;
-	$$ = decl;
+	if (syntax_directed_emitter != nullptr) {
+		$$ = nullptr;
+	} else {
+		printf("ConstDecl => Decl\n");
+		auto decl = new DeclarationAST();
+		decl->const_declaration = unique_ptr<BaseAST>($1);
+		decl->choice = CONST_DECLARATION;
+		$$ = decl;
+	}
 }
 | VarDecl {
-	printf("VarDecl => Decl\n");
-	auto decl = new DeclarationAST();
-	decl->var_declaration = unique_ptr<BaseAST>($1);
-	decl->choice = VAR_DECLARATION;
-	$$ = decl;
+	if (syntax_directed_emitter != nullptr) {
+		$$ = nullptr;
+	} else {
+		printf("VarDecl => Decl\n");
+		auto decl = new DeclarationAST();
+		decl->var_declaration = unique_ptr<BaseAST>($1);
+		decl->choice = VAR_DECLARATION;
+		$$ = decl;
+	}
 }
 
 // region: const declaration
 
 ConstDecl:
 CONST_MODIFIER BType ConstDefList ';' {
-	printf("CONST_MODIFIER BType ConstDefList => ConstDecl\n");
-	auto const_decl = new ConstDeclarationAST();
-	const_decl->b_type = unique_ptr<BaseAST>($2);
-	const_decl->const_definition_list = unique_ptr<BaseAST>($3);
-	$$ = const_decl;
+	if (syntax_directed_emitter != nullptr) {
+		$$ = nullptr;
+	} else {
+		printf("CONST_MODIFIER BType ConstDefList => ConstDecl\n");
+		auto const_decl = new ConstDeclarationAST();
+		const_decl->b_type = unique_ptr<BaseAST>($2);
+		const_decl->const_definition_list = unique_ptr<BaseAST>($3);
+		$$ = const_decl;
+	}
 }
 
 ConstDefList:
 ConstDef
 {
-	printf("ConstDef => ConstDefList\n");
-	auto const_def_list = new ConstDefinitionListAST();
-	const_def_list->choice = CONST_DEFINITION;
-	const_def_list->const_definition = unique_ptr<BaseAST>($1);
-	$$ = const_def_list;
+	if (syntax_directed_emitter != nullptr) {
+		$$ = nullptr;
+	} else {
+		printf("ConstDef => ConstDefList\n");
+		auto const_def_list = new ConstDefinitionListAST();
+		const_def_list->choice = CONST_DEFINITION;
+		const_def_list->const_definition = unique_ptr<BaseAST>($1);
+		$$ = const_def_list;
+	}
 }
 | ConstDefList ',' ConstDef
 {
-	printf("ConstDefList , ConstDef => ConstDefList\n");
-	auto const_def_list = new ConstDefinitionListAST();
-	const_def_list->choice = CONST_DEFINITION_LIST;
-	const_def_list->list.insert(const_def_list->list.end(),
-				 std::make_move_iterator(((ConstDefinitionListAST *)$1)->list.begin()),
-				 std::make_move_iterator(((ConstDefinitionListAST *)$1)->list.end()));
-	const_def_list->list.push_back(unique_ptr<BaseAST>($3));
-	$$ = const_def_list;
+	if (syntax_directed_emitter != nullptr) {
+		$$ = nullptr;
+	} else {
+		printf("ConstDefList , ConstDef => ConstDefList\n");
+		auto const_def_list = new ConstDefinitionListAST();
+		const_def_list->choice = CONST_DEFINITION_LIST;
+		// the first definition of the list still sits in the single definition slot
+		if (((ConstDefinitionListAST *)$1)->choice == CONST_DEFINITION) {
+			const_def_list->list.push_back(move(((ConstDefinitionListAST *)$1)->const_definition));
+		}
+		const_def_list->list.insert(const_def_list->list.end(),
+					 std::make_move_iterator(((ConstDefinitionListAST *)$1)->list.begin()),
+					 std::make_move_iterator(((ConstDefinitionListAST *)$1)->list.end()));
+		const_def_list->list.push_back(unique_ptr<BaseAST>($3));
+		$$ = const_def_list;
+	}
 }
 
 ConstDef:
 IDENT '=' ConstInitVal {
-	printf("IDENT = ConstInitVal => ConstDef\n");
-
-	printf("const variable definition encountered\n");
-
-
-	// first we check if the const has been defined in the previous context
-
-
-	auto var_ident = std::string(*$1);
-	SymbolTableFactory::symbol_table->insert(var_ident, SymbolTableFactory::wrap_symbol_info(
-						   true,
-						   "int",
-						   var_ident,
-						   "",
-						   std::make_shared<LocationImpl>(@1.first_line, @1.first_column, @1.last_line, @1.last_column)
-					   )
-			   );
-
-	auto const_def = new ConstDefinitionAST();
-	const_def->ident = *$1;
-	const_def->const_initialization_expression = unique_ptr<BaseAST>($3);
-	$$ = const_def;
+	if (syntax_directed_emitter != nullptr) {
+		syntax_directed_emitter->define_const(*unique_ptr<string>($1));
+		$$ = nullptr;
+	} else {
+		printf("IDENT = ConstInitVal => ConstDef\n");
+
+		printf("const variable definition encountered\n");
+
+
+		// first we check if the const has been defined in the previous context
+
+
+		auto var_ident = std::string(*$1);
+		auto location = std::make_shared<LocationImpl>(@1.first_line, @1.first_column, @1.last_line, @1.last_column);
+		SymbolTableFactory::symbol_table->insert(var_ident, SymbolTableFactory::wrap_symbol_info(
+							   true,
+							   "int",
+							   var_ident,
+							   "",
+							   location
+						   )
+				   );
+
+		auto const_def = new ConstDefinitionAST();
+		const_def->ident = *$1;
+		const_def->location = location;
+		const_def->const_initialization_expression = unique_ptr<BaseAST>($3);
+		$$ = const_def;
+	}
 }
 
 ConstInitVal:
 ConstExp {
-	printf("ConstExp => ConstInitVal\n");
-	auto const_init_val = new ConstInitializationExpressionAST();
-	const_init_val->const_expression = unique_ptr<BaseAST>($1);
-	$$ = const_init_val;
+	if (syntax_directed_emitter != nullptr) {
+		$$ = nullptr;
+	} else {
+		printf("ConstExp => ConstInitVal\n");
+		auto const_init_val = new ConstInitializationExpressionAST();
+		const_init_val->const_expression = unique_ptr<BaseAST>($1);
+		$$ = const_init_val;
+	}
 }
 
 ConstExp:
 Exp {
-	printf("Exp => ConstExp\n");
-	auto const_exp = new ConstExpressionAST();
-	const_exp->expression = unique_ptr<BaseAST>($1);
-	$$ = const_exp;
+	if (syntax_directed_emitter != nullptr) {
+		$$ = nullptr;
+	} else {
+		printf("Exp => ConstExp\n");
+		auto const_exp = new ConstExpressionAST();
+		const_exp->expression = unique_ptr<BaseAST>($1);
+		$$ = const_exp;
+	}
 }
 
 // endregion
@@ -645,76 +924,104 @@ Exp {
 
 VarDecl:
 BType VarDefList ';' {
-
-	printf("BType VarDefList ;=> VarDecl\n");
-	auto var_decl = new VarDeclarationAST();
-	var_decl->b_type = unique_ptr<BaseAST>($1);
-	var_decl->var_definition_list = unique_ptr<BaseAST>($2);
-	$$ = var_decl;
+	if (syntax_directed_emitter != nullptr) {
+		$$ = nullptr;
+	} else {
+		printf("BType VarDefList ;=> VarDecl\n");
+		auto var_decl = new VarDeclarationAST();
+		var_decl->b_type = unique_ptr<BaseAST>($1);
+		var_decl->var_definition_list = unique_ptr<BaseAST>($2);
+		$$ = var_decl;
+	}
 }
 
 VarDefList:
 VarDef
 {
-
-	printf("VarDef => VarDefList\n");
-	auto var_def_list = new VarDefinitionListAST();
-	var_def_list->choice = VAR_DEFINITION;
-	var_def_list->var_definition = unique_ptr<BaseAST>($1);
-	$$ = var_def_list;
+	if (syntax_directed_emitter != nullptr) {
+		$$ = nullptr;
+	} else {
+		printf("VarDef => VarDefList\n");
+		auto var_def_list = new VarDefinitionListAST();
+		var_def_list->choice = VAR_DEFINITION;
+		var_def_list->var_definition = unique_ptr<BaseAST>($1);
+		$$ = var_def_list;
+	}
 }
 | VarDefList ',' VarDef
 {
-	printf("VarDefList , VarDef => VarDefList\n");
-	auto
-	var_def_list = new VarDefinitionListAST();
-	var_def_list->choice = VAR_DEFINITION_LIST;
-	var_def_list->list.insert(var_def_list->list.end(),
-				 std::make_move_iterator(((VarDefinitionListAST *)$1)->list.begin()),
-				 std::make_move_iterator(((VarDefinitionListAST *)$1)->list.end()));
-	var_def_list->list.push_back(unique_ptr<BaseAST>($3));
-	$$ = var_def_list;
+	if (syntax_directed_emitter != nullptr) {
+		$$ = nullptr;
+	} else {
+		printf("VarDefList , VarDef => VarDefList\n");
+		auto
+		var_def_list = new VarDefinitionListAST();
+		var_def_list->choice = VAR_DEFINITION_LIST;
+		// the first definition of the list still sits in the single definition slot
+		if (((VarDefinitionListAST *)$1)->choice == VAR_DEFINITION) {
+			var_def_list->list.push_back(move(((VarDefinitionListAST *)$1)->var_definition));
+		}
+		var_def_list->list.insert(var_def_list->list.end(),
+					 std::make_move_iterator(((VarDefinitionListAST *)$1)->list.begin()),
+					 std::make_move_iterator(((VarDefinitionListAST *)$1)->list.end()));
+		var_def_list->list.push_back(unique_ptr<BaseAST>($3));
+		$$ = var_def_list;
+	}
 }
 
 VarDef:
 IDENT '=' VarInitVal {
-
-	printf("IDENT = VarInitVal => VarDef\n");
-
-	printf("variable definition encountered\n");
-
-	auto var_ident = std::string(*$1);
-	SymbolTableFactory::symbol_table->insert(var_ident, SymbolTableFactory::wrap_symbol_info(
-						   false,
-						   "int",
-						   var_ident,
-						   "",
-						   std::make_shared<LocationImpl>(@1.first_line, @1.first_column, @1.last_line, @1.last_column)
-					   )
-			   );
-	auto
-	var_def = new VarDefinitionAST();
-	var_def->ident = *$1;
-	var_def->var_initialization_expression = unique_ptr<BaseAST>($3);
-	$$ = var_def;
+	if (syntax_directed_emitter != nullptr) {
+		syntax_directed_emitter->define_var(*unique_ptr<string>($1));
+		$$ = nullptr;
+	} else {
+		printf("IDENT = VarInitVal => VarDef\n");
+
+		printf("variable definition encountered\n");
+
+		auto var_ident = std::string(*$1);
+		auto location = std::make_shared<LocationImpl>(@1.first_line, @1.first_column, @1.last_line, @1.last_column);
+		SymbolTableFactory::symbol_table->insert(var_ident, SymbolTableFactory::wrap_symbol_info(
+							   false,
+							   "int",
+							   var_ident,
+							   "",
+							   location
+						   )
+				   );
+		auto
+		var_def = new VarDefinitionAST();
+		var_def->ident = *$1;
+		var_def->location = location;
+		var_def->var_initialization_expression = unique_ptr<BaseAST>($3);
+		$$ = var_def;
+	}
 }
 
 VarInitVal:
 VarExp {
-	printf("VarExp => VarInitVal\n");
-	auto
-	var_init_val = new VarInitializationExpressionAST();
-	var_init_val->var_expression = unique_ptr<BaseAST>($1);
-	$$ = var_init_val;
+	if (syntax_directed_emitter != nullptr) {
+		$$ = nullptr;
+	} else {
+		printf("VarExp => VarInitVal\n");
+		auto
+		var_init_val = new VarInitializationExpressionAST();
+		var_init_val->var_expression = unique_ptr<BaseAST>($1);
+		$$ = var_init_val;
+	}
 }
 
 VarExp:
 Exp {
-	printf("Exp => VarExp\n");
-	auto
-	var_exp = new VarExpressionAST();
-	var_exp->expression = unique_ptr<BaseAST>($1);
-	$$ = var_exp;
+	if (syntax_directed_emitter != nullptr) {
+		$$ = nullptr;
+	} else {
+		printf("Exp => VarExp\n");
+		auto
+		var_exp = new VarExpressionAST();
+		var_exp->expression = unique_ptr<BaseAST>($1);
+		$$ = var_exp;
+	}
 }
 
 // endregion
@@ -0,0 +1,378 @@
+#include "x86_backend.h"
+
+#include <algorithm>
+#include <cassert>
+#include <climits>
+#include <iostream>
+
+void X86Statistics::print(const std::string &function) const {
+    std::cout << "x86 @" << function << ": " << instructions << " instructions, " << lea << " lea, "
+              << branches_fused << " branches fused, " << branches_converted << " branches converted, " << cmov
+              << " cmov, " << frame_size << " bytes of frame" << std::endl;
+}
+
+void X86Backend::write(const IrModule &module, BufferedWriter &out) {
+    out << "  .text\n";
+    for (auto &function: module.functions) {
+        write_function(*function, out).print(function->name);
+    }
+    // no executable stack wanted
+    out << "  .section .note.GNU-stack,\"\",@progbits\n";
+}
+
+X86Statistics X86Backend::write_function(const IrFunction &function, BufferedWriter &out) {
+    _function = &function;
+    _out = &out;
+    _statistics = X86Statistics();
+    _offsets.assign(function.instructions.size(), 0);
+    _staging.assign(function.instructions.size(), 0);
+    _predecessors.assign(function.blocks.size(), 0);
+
+    int32_t size = 0;
+    for (auto block: function.layout) {
+        for (auto successor: function.successors(block)) {
+            _predecessors[successor]++;
+        }
+        for (auto inst = function.blocks[block].first; inst != 0; inst = function[inst].next) {
+            auto opcode = function[inst].opcode;
+            if (opcode == IR_STORE || opcode == IR_BR || opcode == IR_JUMP || opcode == IR_RET || fused(inst)) {
+                continue;
+            }
+            _offsets[inst] = size += 4;
+            if (opcode == IR_PHI) {
+                _staging[inst] = size += 4;
+            }
+        }
+    }
+    _statistics.frame_size = (size + 15) & ~15;
+
+    auto symbol = "sysy_" + function.name;
+    out << "  .globl " << symbol << "\n  .type " << symbol << ", @function\n" << symbol << ":\n";
+    emit("pushq %rbp");
+    emit("movq %rsp, %rbp");
+    if (_statistics.frame_size != 0) {
+        emit("subq $" + std::to_string(_statistics.frame_size) + ", %rsp");
+    }
+    for (size_t i = 0; i < function.layout.size(); i++) {
+        auto block = function.layout[i];
+        auto next = i + 1 < function.layout.size() ? function.layout[i + 1] : 0;
+        out << label(block) << ":\n";
+        auto inst = function.blocks[block].first;
+        // phis all take their operands from staging before any of them is overwritten
+        for (; inst != 0 && function[inst].opcode == IR_PHI; inst = function[inst].next) {
+            emit("movl " + slot(_staging[inst]) + ", %eax");
+            emit("movl %eax, " + slot(_offsets[inst]));
+        }
+        for (; inst != 0; inst = function[inst].next) {
+            select(inst, next);
+        }
+    }
+    return _statistics;
+}
+
+// region: helpers
+
+void X86Backend::emit(const std::string &text) {
+    *_out << "  " << text << '\n';
+    _statistics.instructions++;
+}
+
+std::string X86Backend::label(IrBlockId block) const {
+    return ".L" + _function->name + "_" + std::to_string(block);
+}
+
+std::string X86Backend::slot(int32_t offset) const {
+    assert(offset > 0);
+    return "-" + std::to_string(offset) + "(%rbp)";
+}
+
+std::string X86Backend::operand(IrValueId value) const {
+    auto &function = *_function;
+    if (function.is_constant(value)) {
+        return "$" + std::to_string(function.constant_value(value));
+    } else if (function[value].opcode == IR_UNDEF) {
+        return "$0";
+    }
+    return slot(_offsets[value]);
+}
+
+// endregion
+
+void X86Backend::select(IrValueId inst, IrBlockId next) {
+    auto &function = *_function;
+    auto &record = function[inst];
+    switch (record.opcode) {
+        case IR_PHI:
+            // read from staging on entry
+            break;
+        case IR_ALLOCA:
+            // as zeroed as the interpreters have it
+            emit("movl $0, " + slot(_offsets[inst]));
+            break;
+        case IR_LOAD:
+            emit("movl " + slot(_offsets[function.operand(inst, 0)]) + ", %eax");
+            emit("movl %eax, " + slot(_offsets[inst]));
+            break;
+        case IR_STORE: {
+            auto value = function.operand(inst, 0);
+            auto address = slot(_offsets[function.operand(inst, 1)]);
+            if (function.is_constant(value) || function[value].opcode == IR_UNDEF) {
+                emit("movl " + operand(value) + ", " + address);
+            } else {
+                emit("movl " + operand(value) + ", %eax");
+                emit("movl %eax, " + address);
+            }
+            break;
+        }
+        case IR_BR:
+            select_branch(inst, next);
+            break;
+        case IR_JUMP:
+            copy_phis(record.block, record.targets[0]);
+            if (record.targets[0] != next) {
+                emit("jmp " + label(record.targets[0]));
+            }
+            break;
+        case IR_RET:
+            emit("movl " + operand(function.operand(inst, 0)) + ", %eax");
+            emit("leave");
+            emit("ret");
+            break;
+        default:
+            assert(ir_is_binary(record.opcode));
+            if (!fused(inst)) {
+                select_binary(inst);
+            }
+            break;
+    }
+}
+
+void X86Backend::select_binary(IrValueId inst) {
+    auto &function = *_function;
+    auto opcode = function[inst].opcode;
+    auto lhs = function.operand(inst, 0);
+    auto rhs = function.operand(inst, 1);
+    if (ir_is_commutative(opcode) && function.is_constant(lhs) && !function.is_constant(rhs)) {
+        std::swap(lhs, rhs);
+    }
+    auto constant = function.is_constant(rhs);
+    auto value = constant ? function.constant_value(rhs) : 0;
+    auto result = slot(_offsets[inst]);
+
+    if (opcode >= IR_EQ && opcode <= IR_GE) {
+        emit("set" + compare(inst) + " %al");
+        emit("movzbl %al, %eax");
+        emit("movl %eax, " + result);
+        return;
+    }
+    emit("movl " + operand(lhs) + ", %eax");
+    switch (opcode) {
+        case IR_ADD:
+            if (constant) {
+                emit("leal " + std::to_string(value) + "(%rax), %eax");
+            } else {
+                emit("movl " + operand(rhs) + ", %ecx");
+                emit("leal (%rax,%rcx), %eax");
+            }
+            _statistics.lea++;
+            break;
+        case IR_SUB:
+            if (constant && value != INT_MIN) {
+                emit("leal " + std::to_string(-value) + "(%rax), %eax");
+                _statistics.lea++;
+            } else {
+                emit("subl " + operand(rhs) + ", %eax");
+            }
+            break;
+        case IR_AND:
+        case IR_OR:
+        case IR_XOR: {
+            static const char *names[] = {"andl ", "orl ", "xorl "};
+            emit(names[opcode - IR_AND] + operand(rhs) + ", %eax");
+            break;
+        }
+        case IR_MUL: {
+            // by 2, 3, 4, 5, 8 and 9
+            static const char *scaled[] = {
+                    nullptr, nullptr, "(%rax,%rax)", "(%rax,%rax,2)", "0(,%rax,4)", "(%rax,%rax,4)", nullptr,
+                    nullptr, "0(,%rax,8)", "(%rax,%rax,8)"
+            };
+            if (constant && value >= 0 && value <= 9 && scaled[value] != nullptr) {
+                emit(std::string("leal ") + scaled[value] + ", %eax");
+                _statistics.lea++;
+            } else if (constant) {
+                emit("imull $" + std::to_string(value) + ", %eax, %eax");
+            } else {
+                emit("imull " + operand(rhs) + ", %eax");
+            }
+            break;
+        }
+        case IR_MULH:
+        case IR_DIV:
+        case IR_REM:
+            // neither takes an immediate; the results land in edx:eax
+            emit("movl " + operand(rhs) + ", %ecx");
+            if (opcode == IR_MULH) {
+                emit("imull %ecx");
+            } else {
+                emit("cltd");
+                emit("idivl %ecx");
+            }
+            if (opcode != IR_DIV) {
+                emit("movl %edx, %eax");
+            }
+            break;
+        case IR_SHL:
+        case IR_SHR:
+        case IR_SAR: {
+            static const char *names[] = {"shll ", "shrl ", "sarl "};
+            if (constant) {
+                emit(names[opcode - IR_SHL] + ("$" + std::to_string(value & 31)) + ", %eax");
+            } else {
+                emit("movl " + operand(rhs) + ", %ecx");
+                emit(names[opcode - IR_SHL] + std::string("%cl, %eax"));
+            }
+            break;
+        }
+        default:
+            assert(false);
+    }
+    emit("movl %eax, " + result);
+}
+
+// region: branches
+
+bool X86Backend::fused(IrValueId value) const {
+    auto &function = *_function;
+    auto &record = function[value];
+    if (record.opcode < IR_EQ || record.opcode > IR_GE || function.use_count(value) != 1) {
+        return false;
+    }
+    auto last = function.blocks[record.block].last;
+    return function[last].opcode == IR_BR && function.operand(last, 0) == value;
+}
+
+std::string X86Backend::compare(IrValueId condition) {
+    auto &function = *_function;
+    auto opcode = function[condition].opcode;
+    if (opcode < IR_EQ || opcode > IR_GE) {
+        emit("movl " + operand(condition) + ", %eax");
+        emit("testl %eax, %eax");
+        return "ne";
+    }
+    static const char *codes[] = {"e", "ne", "l", "g", "le", "ge"};
+    emit("movl " + operand(function.operand(condition, 0)) + ", %eax");
+    emit("cmpl " + operand(function.operand(condition, 1)) + ", %eax");
+    return codes[opcode - IR_EQ];
+}
+
+void X86Backend::select_branch(IrValueId inst, IrBlockId next) {
+    auto &function = *_function;
+    auto &record = function[inst];
+    if (convert_branch(inst, next)) {
+        return;
+    }
+    auto if_true = record.targets[0];
+    auto if_false = record.targets[1];
+    copy_phis(record.block, if_true);
+    if (if_false != if_true) {
+        copy_phis(record.block, if_false);
+    }
+    auto condition = function.operand(inst, 0);
+    _statistics.branches_fused += fused(condition);
+    auto code = compare(condition);
+    if (if_true == next) {
+        static const std::pair<std::string, std::string> inverses[] = {
+                {"e", "ne"}, {"ne", "e"}, {"l", "ge"}, {"g", "le"}, {"le", "g"}, {"ge", "l"}
+        };
+        for (auto &inverse: inverses) {
+            if (inverse.first == code) {
+                emit("j" + inverse.second + " " + label(if_false));
+                return;
+            }
+        }
+    }
+    emit("j" + code + " " + label(if_true));
+    if (if_false != next) {
+        emit("jmp " + label(if_false));
+    }
+}
+
+void X86Backend::copy_phis(IrBlockId from, IrBlockId to) {
+    auto &function = *_function;
+    for (auto phi = function.blocks[to].first; phi != 0 && function[phi].opcode == IR_PHI; phi = function[phi].next) {
+        for (uint32_t i = 0; i < function[phi].operand_count; i++) {
+            auto value = function.operand(phi, i);
+            if (function.incoming_block(phi, i) != from || function[value].opcode == IR_UNDEF) {
+                continue;
+            }
+            if (function.is_constant(value)) {
+                emit("movl " + operand(value) + ", " + slot(_staging[phi]));
+            } else {
+                emit("movl " + operand(value) + ", %eax");
+                emit("movl %eax, " + slot(_staging[phi]));
+            }
+            break;
+        }
+    }
+}
+
+IrBlockId X86Backend::arm_destination(IrBlockId from, IrBlockId arm) const {
+    auto &function = *_function;
+    auto first = function.blocks[arm].first;
+    if (arm == from || _predecessors[arm] != 1 || function[first].opcode != IR_JUMP) {
+        return arm;
+    }
+    return function[first].targets[0];
+}
+
+bool X86Backend::convert_branch(IrValueId inst, IrBlockId next) {
+    auto &function = *_function;
+    auto &record = function[inst];
+    auto block = record.block;
+    auto if_true = record.targets[0];
+    auto if_false = record.targets[1];
+    auto join = arm_destination(block, if_true);
+    if (if_true == if_false || arm_destination(block, if_false) != join) {
+        return false;
+    }
+    // the block each way enters the join from
+    auto via_true = join == if_true ? block : if_true;
+    auto via_false = join == if_false ? block : if_false;
+
+    // phi, operand on the true side, operand on the false side
+    std::vector<std::vector<IrValueId>> choices;
+    for (auto phi = function.blocks[join].first; phi != 0 && function[phi].opcode == IR_PHI;
+         phi = function[phi].next) {
+        std::vector<IrValueId> choice = {phi, 0, 0};
+        for (uint32_t i = 0; i < function[phi].operand_count; i++) {
+            auto from = function.incoming_block(phi, i);
+            if (from == via_true || from == via_false) {
+                choice[from == via_true ? 1 : 2] = function.operand(phi, i);
+            }
+        }
+        if (choice[1] == 0 || choice[2] == 0) {
+            return false;
+        }
+        choices.push_back(choice);
+    }
+
+    auto condition = function.operand(inst, 0);
+    _statistics.branches_fused += fused(condition);
+    auto code = compare(condition);
+    // moves leave the flags alone, and cmov takes no immediate
+    for (auto &choice: choices) {
+        emit("movl " + operand(choice[2]) + ", %eax");
+        emit("movl " + operand(choice[1]) + ", %ecx");
+        emit("cmov" + code + "l %ecx, %eax");
+        emit("movl %eax, " + slot(_staging[choice[0]]));
+        _statistics.cmov++;
+    }
+    if (join != next) {
+        emit("jmp " + label(join));
+    }
+    _statistics.branches_converted++;
+    return true;
+}
+
+// endregion
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "buffered_writer.h"
+#include "ir.h"
+
+class X86Statistics {
+public:
+    size_t instructions = 0;
+    // additions, subtractions of constants and small multiplications done by lea
+    size_t lea = 0;
+    // comparisons selected as part of a branch or cmov, never held in a register
+    size_t branches_fused = 0;
+    // branches around empty blocks that only pick phi operands, replaced by cmov
+    size_t branches_converted = 0;
+    size_t cmov = 0;
+    int32_t frame_size = 0;
+
+    void print(const std::string &function) const;
+};
+
+/**
+ * Compiles SSA functions straight to x86-64 assembly for the System V ABI, in AT&T
+ * syntax, to be linked with runtime/x86_runtime.c into a native executable. A function
+ * `f` becomes the global symbol `sysy_f`, so the runtime can call `sysy_main` from the C
+ * `main`.
+ *
+ * Every value lives in its own 4-byte slot below rbp and goes through eax, ecx and edx
+ * only as long as one instruction needs it; constants are immediates. Additions,
+ * subtractions of constants and multiplications by 2, 3, 4, 5, 8 and 9 use lea, other
+ * multiplications imul, division cltd and idiv, and comparisons setcc unless the branch
+ * ending their block is their only use, where cmp goes straight into a jcc.
+ *
+ * Phis are written by their predecessors into a staging slot per phi and read from there
+ * on entry to their block, which keeps a cycle among phis from clobbering itself. A branch
+ * whose arms are empty blocks, or the join itself, only choosing between phi operands
+ * becomes one cmov per phi and a jump to the join.
+ */
+class X86Backend {
+public:
+    void write(const IrModule &module, BufferedWriter &out);
+
+    X86Statistics write_function(const IrFunction &function, BufferedWriter &out);
+
+private:
+    const IrFunction *_function = nullptr;
+    BufferedWriter *_out = nullptr;
+    // per IR value, below rbp; 0 for constants and values that are never held
+    std::vector<int32_t> _offsets;
+    // per phi, where its predecessors leave the operand for it
+    std::vector<int32_t> _staging;
+    std::vector<size_t> _predecessors;
+    X86Statistics _statistics;
+
+    void emit(const std::string &text);
+
+    std::string label(IrBlockId block) const;
+
+    std::string slot(int32_t offset) const;
+
+    // an immediate for constants and undef, the value's slot otherwise
+    std::string operand(IrValueId value) const;
+
+    void select(IrValueId inst, IrBlockId next);
+
+    void select_binary(IrValueId inst);
+
+    // a comparison whose only use is the branch ending its block
+    bool fused(IrValueId value) const;
+
+    // sets the flags for `condition`, returning the condition code that holds when it is true
+    std::string compare(IrValueId condition);
+
+    void select_branch(IrValueId inst, IrBlockId next);
+
+    // the copies into the staging slots of the phis of `to` along the edge from `from`
+    void copy_phis(IrBlockId from, IrBlockId to);
+
+    // the block an arm of a branch from `from` leads to, skipping an empty one only `from` reaches
+    IrBlockId arm_destination(IrBlockId from, IrBlockId arm) const;
+
+    // the branch ending `block` as cmovs into the phis of the join its arms meet at, if it can be
+    bool convert_branch(IrValueId inst, IrBlockId next);
+};
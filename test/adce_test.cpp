@@ -0,0 +1,134 @@
+#include "gtest/gtest.h"
+#include "memory"
+#include "adce.h"
+#include "mem2reg.h"
+#include "ir_generator.h"
+#include "ast_builder.h"
+#include "ir_interpreter.h"
+
+static size_t count_opcode(const IrFunction &function, IrOpcode opcode) {
+    size_t count = 0;
+    for (auto block: function.layout) {
+        for (auto inst: function.block_instructions(block)) {
+            count += function[inst].opcode == opcode;
+        }
+    }
+    return count;
+}
+
+TEST(adce, removes_discarded_expressions) {
+    // int a = 5; a * 7; int b = a + 2; return a;
+    auto ast = program(items(
+            var_def("a", arith(term(num(5)))),
+            expression_statement(arith(term(mul(mul(nullptr, "", var("a")), "*", num(7))))),
+            var_def("b", arith(add(term(var("a")), "+", mul(nullptr, "", num(2))))),
+            ret(arith(term(var("a"))))));
+    auto module = IrGenerator().generate(ast.get());
+    auto &function = *module->functions.front();
+    Mem2Reg().run(function);
+    ASSERT_EQ(count_opcode(function, IR_MUL), 1);
+    AnalysisCache analyses(function);
+
+    auto statistics = Adce().run(analyses);
+
+    EXPECT_EQ(ir_interpret(function), 5);
+    EXPECT_EQ(statistics.instructions_removed, 2);
+    EXPECT_EQ(count_opcode(function, IR_MUL), 0);
+    EXPECT_EQ(count_opcode(function, IR_ADD), 0);
+}
+
+TEST(adce, drops_statements_after_return) {
+    // int a = 1; return a; a = 2; int b = 3; return b;
+    auto ast = program(items(
+            var_def("a", arith(term(num(1)))),
+            ret(arith(term(var("a")))),
+            assign("a", arith(term(num(2)))),
+            var_def("b", arith(term(num(3)))),
+            ret(arith(term(var("b"))))));
+    auto module = IrGenerator().generate(ast.get());
+    auto &function = *module->functions.front();
+
+    EXPECT_EQ(function.layout.size(), 1);
+    EXPECT_EQ(count_opcode(function, IR_RET), 1);
+    EXPECT_EQ(count_opcode(function, IR_STORE), 1);
+    EXPECT_EQ(ir_interpret(function), 1);
+}
+
+TEST(adce, removes_branches_nothing_depends_on) {
+    // entry: x = load; br x < 3, then, end
+    // then:  y = x + 1; br y, inner, end      (nothing uses y or the inner block)
+    // inner: jump end
+    // end:   br x, store, exit
+    // store: store x, slot; jump exit          (a side effect keeps this branch)
+    // exit:  ret x
+    IrFunction function("f");
+    IrBuilder builder(&function);
+    auto entry = function.add_block("entry");
+    auto then_block = function.add_block("then");
+    auto inner = function.add_block("inner");
+    auto end = function.add_block("end");
+    auto store = function.add_block("store");
+    auto exit = function.add_block("exit");
+    builder.set_block(entry);
+    auto slot = builder.alloca_slot();
+    builder.store(function.constant(2), slot);
+    auto x = builder.load(slot);
+    builder.branch(builder.binary(IR_LT, x, function.constant(3)), then_block, end);
+    builder.set_block(then_block);
+    auto y = builder.binary(IR_ADD, x, function.constant(1));
+    builder.branch(y, inner, end);
+    builder.set_block(inner);
+    builder.jump(end);
+    builder.set_block(end);
+    builder.branch(x, store, exit);
+    builder.set_block(store);
+    builder.store(x, slot);
+    builder.jump(exit);
+    builder.set_block(exit);
+    builder.ret(x);
+    AnalysisCache analyses(function);
+
+    auto statistics = Adce().run(analyses);
+
+    EXPECT_EQ(ir_interpret(function), 2);
+    // the comparison and y
+    EXPECT_EQ(statistics.instructions_removed, 2);
+    EXPECT_EQ(statistics.branches_removed, 2);
+    EXPECT_EQ(statistics.blocks_removed, 2);
+    EXPECT_EQ(count_opcode(function, IR_BR), 1);
+    EXPECT_EQ(function[function.terminator(entry)].opcode, IR_JUMP);
+    EXPECT_EQ(function[function.terminator(entry)].targets[0], end);
+    EXPECT_TRUE(function.blocks[then_block].removed);
+    EXPECT_TRUE(function.blocks[inner].removed);
+    EXPECT_EQ(analyses.cached(), 0);
+}
+
+TEST(adce, keeps_branches_feeding_phis) {
+    // the arms of a diamond choose the returned value
+    IrFunction function("f");
+    IrBuilder builder(&function);
+    auto entry = function.add_block("entry");
+    auto then_block = function.add_block("then");
+    auto end = function.add_block("end");
+    builder.set_block(entry);
+    auto slot = builder.alloca_slot();
+    builder.store(function.constant(4), slot);
+    auto x = builder.load(slot);
+    builder.branch(x, then_block, end);
+    builder.set_block(then_block);
+    auto doubled = builder.binary(IR_ADD, x, x);
+    builder.jump(end);
+    builder.set_block(end);
+    auto merged = builder.phi();
+    function.add_incoming(merged, x, entry);
+    function.add_incoming(merged, doubled, then_block);
+    builder.ret(merged);
+    AnalysisCache analyses(function);
+
+    auto statistics = Adce().run(analyses);
+
+    EXPECT_EQ(ir_interpret(function), 8);
+    EXPECT_EQ(statistics.instructions_removed, 0);
+    EXPECT_EQ(statistics.branches_removed, 0);
+    EXPECT_EQ(count_opcode(function, IR_BR), 1);
+}
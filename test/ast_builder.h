@@ -0,0 +1,266 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "Ast.h"
+
+// Hand-built ASTs for tests, one builder per grammar level.
+
+// region: AST builders
+
+inline std::unique_ptr<BaseAST> num(int value) {
+    auto primary = std::make_unique<PrimaryExpAST>();
+    primary->choice = NUMBER;
+    primary->number = value;
+    auto unary = std::make_unique<UnaryExpAST>();
+    unary->choice = PRIMARY;
+    unary->primary_exp = std::move(primary);
+    return unary;
+}
+
+inline std::unique_ptr<BaseAST> var(const std::string &ident) {
+    auto lval = std::make_unique<LValAST>();
+    lval->ident = ident;
+    auto primary = std::make_unique<PrimaryExpAST>();
+    primary->choice = LEFT_VALUE;
+    primary->left_value = std::move(lval);
+    auto unary = std::make_unique<UnaryExpAST>();
+    unary->choice = PRIMARY;
+    unary->primary_exp = std::move(primary);
+    return unary;
+}
+
+inline std::unique_ptr<BaseAST> unary(const std::string &op, std::unique_ptr<BaseAST> operand) {
+    auto unary_op = std::make_unique<UnaryOpAST>();
+    unary_op->op = op;
+    auto unary = std::make_unique<UnaryExpAST>();
+    unary->choice = UNARYOP_UNARYEXP;
+    unary->unary_op = std::move(unary_op);
+    unary->unary_exp = std::move(operand);
+    return unary;
+}
+
+inline std::unique_ptr<BaseAST> mul(std::unique_ptr<BaseAST> lhs, const std::string &op, std::unique_ptr<BaseAST> rhs) {
+    auto mul_exp = std::make_unique<MulExpAST>();
+    mul_exp->unary_exp = std::move(rhs);
+    if (lhs == nullptr) {
+        mul_exp->choice = UNARYEXP;
+    } else {
+        mul_exp->choice = MUL_OP_UNARYEXP;
+        mul_exp->mul_op = op;
+        mul_exp->mul_exp = std::move(lhs);
+    }
+    return mul_exp;
+}
+
+inline std::unique_ptr<BaseAST> add(std::unique_ptr<BaseAST> lhs, const std::string &op, std::unique_ptr<BaseAST> rhs) {
+    auto add_exp = std::make_unique<AddExpAST>();
+    add_exp->mul_exp = std::move(rhs);
+    if (lhs == nullptr) {
+        add_exp->choice = MULEXP;
+    } else {
+        add_exp->choice = ADD_OP_MULEXP;
+        add_exp->add_op = op;
+        add_exp->add_exp = std::move(lhs);
+    }
+    return add_exp;
+}
+
+inline std::unique_ptr<BaseAST> rel(std::unique_ptr<BaseAST> lhs, const std::string &op, std::unique_ptr<BaseAST> rhs) {
+    auto rel_exp = std::make_unique<RelExpAST>();
+    rel_exp->add_exp = std::move(rhs);
+    if (lhs == nullptr) {
+        rel_exp->choice = ADDEXP;
+    } else {
+        rel_exp->choice = REL_OP_ADDEXP;
+        rel_exp->rel_op = op;
+        rel_exp->rel_exp = std::move(lhs);
+    }
+    return rel_exp;
+}
+
+// wraps a RelExp into a complete Exp
+inline std::unique_ptr<BaseAST> exp(std::unique_ptr<BaseAST> rel_exp) {
+    auto eq = std::make_unique<EqExpAST>();
+    eq->choice = RELEXP;
+    eq->rel_exp = std::move(rel_exp);
+    auto land = std::make_unique<LAndExpAST>();
+    land->choice = EQEXP;
+    land->eq_exp = std::move(eq);
+    auto lor = std::make_unique<LOrExpAST>();
+    lor->choice = LAND_EXP;
+    lor->land_exp = std::move(land);
+    auto exp = std::make_unique<ExpAST>();
+    exp->lor_exp = std::move(lor);
+    return exp;
+}
+
+// `(exp)` as a UnaryExp
+inline std::unique_ptr<BaseAST> paren(std::unique_ptr<BaseAST> exp) {
+    auto primary = std::make_unique<PrimaryExpAST>();
+    primary->choice = EXP;
+    primary->exp = std::move(exp);
+    auto unary = std::make_unique<UnaryExpAST>();
+    unary->choice = PRIMARY;
+    unary->primary_exp = std::move(primary);
+    return unary;
+}
+
+// `(lhs) && (rhs)` or `(lhs) || (rhs)` of two complete Exps
+inline std::unique_ptr<BaseAST> logical(std::unique_ptr<BaseAST> lhs, const std::string &op, std::unique_ptr<BaseAST> rhs) {
+    auto as_eq = [](std::unique_ptr<BaseAST> exp) {
+        auto eq = std::make_unique<EqExpAST>();
+        eq->choice = RELEXP;
+        eq->rel_exp = rel(nullptr, "", add(nullptr, "", mul(nullptr, "", paren(std::move(exp)))));
+        return eq;
+    };
+    auto as_land = [&as_eq](std::unique_ptr<BaseAST> exp) {
+        auto land = std::make_unique<LAndExpAST>();
+        land->choice = EQEXP;
+        land->eq_exp = as_eq(std::move(exp));
+        return land;
+    };
+    auto lor = std::make_unique<LOrExpAST>();
+    if (op == "&&") {
+        auto land = std::make_unique<LAndExpAST>();
+        land->choice = LAND_OP_EQEXP;
+        land->land_op = op;
+        land->land_exp = as_land(std::move(lhs));
+        land->eq_exp = as_eq(std::move(rhs));
+        lor->choice = LAND_EXP;
+        lor->land_exp = std::move(land);
+    } else {
+        auto left = std::make_unique<LOrExpAST>();
+        left->choice = LAND_EXP;
+        left->land_exp = as_land(std::move(lhs));
+        lor->choice = LOR_OP_LAND_EXP;
+        lor->lor_op = op;
+        lor->lor_exp = std::move(left);
+        lor->land_exp = as_land(std::move(rhs));
+    }
+    auto exp = std::make_unique<ExpAST>();
+    exp->lor_exp = std::move(lor);
+    return exp;
+}
+
+inline std::unique_ptr<BaseAST> arith(std::unique_ptr<BaseAST> add_exp) {
+    return exp(rel(nullptr, "", std::move(add_exp)));
+}
+
+inline std::unique_ptr<BaseAST> term(std::unique_ptr<BaseAST> unary_exp) {
+    return add(nullptr, "", mul(nullptr, "", std::move(unary_exp)));
+}
+
+// endregion
+
+// region: statement builders
+
+// a list of block items, since a braced list cannot hold move-only elements
+template<typename... Items>
+std::vector<std::unique_ptr<BaseAST>> items(Items... list) {
+    std::vector<std::unique_ptr<BaseAST>> result;
+    (result.push_back(std::move(list)), ...);
+    return result;
+}
+
+inline std::unique_ptr<BaseAST> lval(const std::string &ident) {
+    auto left_value = std::make_unique<LValAST>();
+    left_value->ident = ident;
+    return left_value;
+}
+
+inline std::unique_ptr<BaseAST> statement(StmtChoice choice) {
+    auto stmt = std::make_unique<StmtAST>();
+    stmt->choice = choice;
+    return stmt;
+}
+
+inline std::unique_ptr<BaseAST> assign(const std::string &ident, std::unique_ptr<BaseAST> value) {
+    auto stmt = statement(ASSIGNMENT_STATEMENT);
+    auto raw = dynamic_cast<StmtAST *>(stmt.get());
+    raw->left_value = lval(ident);
+    raw->exp = std::move(value);
+    return stmt;
+}
+
+inline std::unique_ptr<BaseAST> ret(std::unique_ptr<BaseAST> value) {
+    auto stmt = statement(RETURN_STATEMENT);
+    dynamic_cast<StmtAST *>(stmt.get())->exp = std::move(value);
+    return stmt;
+}
+
+inline std::unique_ptr<BaseAST> expression_statement(std::unique_ptr<BaseAST> value) {
+    auto stmt = statement(EXPRESSION_STATEMENT);
+    dynamic_cast<StmtAST *>(stmt.get())->exp = std::move(value);
+    return stmt;
+}
+
+inline std::unique_ptr<BaseAST> if_else(std::unique_ptr<BaseAST> condition, std::unique_ptr<BaseAST> then_stmt,
+                                        std::unique_ptr<BaseAST> else_stmt = nullptr) {
+    auto stmt = statement(else_stmt == nullptr ? IF_STATEMENT : IF_ELSE_STATEMENT);
+    auto raw = dynamic_cast<StmtAST *>(stmt.get());
+    raw->exp = std::move(condition);
+    raw->if_statement = std::move(then_stmt);
+    raw->else_statement = std::move(else_stmt);
+    return stmt;
+}
+
+inline std::unique_ptr<BaseAST> var_def(const std::string &ident, std::unique_ptr<BaseAST> value) {
+    auto var_exp = std::make_unique<VarExpressionAST>();
+    var_exp->expression = std::move(value);
+    auto init = std::make_unique<VarInitializationExpressionAST>();
+    init->var_expression = std::move(var_exp);
+    auto def = std::make_unique<VarDefinitionAST>();
+    def->ident = ident;
+    def->var_initialization_expression = std::move(init);
+    auto list = std::make_unique<VarDefinitionListAST>();
+    list->choice = VAR_DEFINITION;
+    list->var_definition = std::move(def);
+    auto var_decl = std::make_unique<VarDeclarationAST>();
+    var_decl->var_definition_list = std::move(list);
+    auto declaration = std::make_unique<DeclarationAST>();
+    declaration->choice = VAR_DECLARATION;
+    declaration->var_declaration = std::move(var_decl);
+    return declaration;
+}
+
+inline std::unique_ptr<BaseAST> block(std::vector<std::unique_ptr<BaseAST>> items) {
+    auto list = std::make_unique<BlockItemListAST>();
+    list->choice = items.empty() ? EMPTY : BLOCK_LIST;
+    for (auto &item: items) {
+        auto block_item = std::make_unique<BlockItemAST>();
+        if (dynamic_cast<StmtAST *>(item.get()) != nullptr) {
+            block_item->choice = STATEMENT;
+            block_item->statement = std::move(item);
+        } else {
+            block_item->choice = DECLARATION;
+            block_item->declaration = std::move(item);
+        }
+        list->list.push_back(std::move(block_item));
+    }
+    auto result = std::make_unique<BlockAST>();
+    result->block_item_list = std::move(list);
+    return result;
+}
+
+inline std::unique_ptr<BaseAST> block_statement(std::vector<std::unique_ptr<BaseAST>> items) {
+    auto stmt = statement(BLOCK_STATEMENT);
+    dynamic_cast<StmtAST *>(stmt.get())->block = block(std::move(items));
+    return stmt;
+}
+
+// int main() { ... }
+inline std::unique_ptr<BaseAST> program(std::vector<std::unique_ptr<BaseAST>> items) {
+    auto func_type = std::make_unique<FuncTypeAST>();
+    func_type->type_name = "int";
+    auto func_def = std::make_unique<FuncDefAST>();
+    func_def->func_type = std::move(func_type);
+    func_def->ident = "main";
+    func_def->block = block(std::move(items));
+    auto comp_unit = std::make_unique<CompUnitAST>();
+    comp_unit->func_def = std::move(func_def);
+    return comp_unit;
+}
+
+// endregion
@@ -0,0 +1,132 @@
+#include "gtest/gtest.h"
+#include "block_layout.h"
+#include "riscv_isel.h"
+#include "riscv_writer.h"
+#include "ir_interpreter.h"
+#include "riscv_interpreter.h"
+
+static size_t count_jumps(const MachineFunction &function) {
+    size_t count = 0;
+    for (auto &block: function.blocks) {
+        for (auto &inst: block.instructions) {
+            count += inst.opcode == RV_J;
+        }
+    }
+    return count;
+}
+
+// if (x < 0) return 1; y = x * x; return y; with the arms of the branch in either order
+static IrFunction early_return(bool early_on_true) {
+    IrFunction function("main");
+    IrBuilder builder(&function);
+    auto entry = function.add_block("entry");
+    auto early = function.add_block("early");
+    auto late = function.add_block("late");
+    auto rest = function.add_block("rest");
+    builder.set_block(entry);
+    auto slot = builder.alloca_slot();
+    builder.store(function.constant(-4), slot);
+    auto x = builder.load(slot);
+    auto negative = builder.binary(IR_LT, x, function.constant(0));
+    builder.branch(negative, early_on_true ? early : late, early_on_true ? late : early);
+    builder.set_block(early);
+    builder.ret(function.constant(1));
+    builder.set_block(late);
+    auto y = builder.binary(IR_MUL, x, x);
+    builder.jump(rest);
+    builder.set_block(rest);
+    builder.ret(y);
+    return function;
+}
+
+TEST(block_layout, threads_jumps_through_empty_blocks) {
+    // entry branches to a and jumps to b, both of which only jump on to c
+    MachineFunction function("main");
+    for (auto name: {"entry", "a", "b", "c"}) {
+        function.add_block(name);
+    }
+    auto emit = [&function](MachineBlockId block, RiscvOpcode opcode, MachineBlockId target) {
+        MachineInstruction inst;
+        inst.opcode = opcode;
+        inst.target = target;
+        function.blocks[block].instructions.push_back(inst);
+        return &function.blocks[block].instructions.back();
+    };
+    emit(0, RV_LI, 0)->rd = RV_T0;
+    emit(0, RV_BNEZ, 1)->rs1 = RV_T0;
+    emit(0, RV_J, 2);
+    emit(1, RV_J, 3);
+    emit(2, RV_J, 3);
+    emit(3, RV_LI, 0)->rd = RV_A0;
+    function.blocks[3].instructions.back().imm = 7;
+    emit(3, RV_RET, 0);
+
+    auto statistics = BlockLayout().run(function);
+
+    EXPECT_EQ(statistics.jumps_threaded, 2);
+    EXPECT_EQ(statistics.branches_removed, 1);
+    EXPECT_EQ(statistics.blocks_removed, 2);
+    EXPECT_EQ(statistics.jumps_removed, 1);
+    ASSERT_EQ(function.blocks.size(), 2);
+    EXPECT_EQ(function.blocks[1].name, "c");
+    EXPECT_EQ(function.blocks[0].instructions.size(), 1);
+    EXPECT_EQ(riscv_interpret(function), 7);
+}
+
+TEST(block_layout, falls_through_past_early_returns) {
+    for (auto early_on_true: {true, false}) {
+        auto function = early_return(early_on_true);
+        MachineFunction machine("main");
+        RiscvSelector().run(function, machine);
+
+        auto statistics = BlockLayout().run(machine);
+
+        ASSERT_EQ(machine.blocks.size(), 4);
+        EXPECT_EQ(machine.blocks[1].name, "late");
+        EXPECT_EQ(machine.blocks[2].name, "rest");
+        EXPECT_EQ(machine.blocks[3].name, "early");
+        EXPECT_EQ(count_jumps(machine), 0) << RiscvWriter::dump(machine);
+        EXPECT_EQ(statistics.branches_inverted, early_on_true ? 0 : 1);
+        EXPECT_EQ(riscv_interpret(machine), ir_interpret(function));
+    }
+}
+
+TEST(block_layout, keeps_loops_together) {
+    // s = 0; i = 0; do { s += i * i; i++ } while (i < 10); return s
+    IrFunction function("main");
+    IrBuilder builder(&function);
+    auto entry = function.add_block("entry");
+    auto loop = function.add_block("loop");
+    auto exit = function.add_block("exit");
+    builder.set_block(entry);
+    builder.jump(loop);
+    builder.set_block(loop);
+    auto i = builder.phi();
+    auto s = builder.phi();
+    auto sum = builder.binary(IR_ADD, s, builder.binary(IR_MUL, i, i));
+    auto next = builder.binary(IR_ADD, i, function.constant(1));
+    function.add_incoming(i, function.constant(0), entry);
+    function.add_incoming(i, next, loop);
+    function.add_incoming(s, function.constant(0), entry);
+    function.add_incoming(s, sum, loop);
+    builder.branch(builder.binary(IR_LT, next, function.constant(10)), loop, exit);
+    builder.set_block(exit);
+    builder.ret(sum);
+
+    MachineFunction machine("main");
+    RiscvSelector().run(function, machine);
+    auto jumps = count_jumps(machine);
+
+    BlockLayout().run(machine);
+
+    // the loop ends in the branch back to its copies, and leaves by falling through
+    EXPECT_LT(count_jumps(machine), jumps);
+    MachineBlockId body = 0;
+    while (body < machine.blocks.size() && machine.blocks[body].name != "loop") {
+        body++;
+    }
+    ASSERT_LT(body, machine.blocks.size());
+    EXPECT_EQ(machine.blocks[body].instructions.back().opcode, RV_BLT) << RiscvWriter::dump(machine);
+    EXPECT_EQ(machine.blocks[body + 1].name, "exit");
+    EXPECT_EQ(riscv_interpret(machine), ir_interpret(function));
+}
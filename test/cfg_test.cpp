@@ -0,0 +1,162 @@
+#include "gtest/gtest.h"
+#include <algorithm>
+#include <chrono>
+#include "memory"
+#include "analysis_cache.h"
+#include "cfg.h"
+
+// entry -> outer <-> inner loop, outer -> (left | right) -> join -> exit
+class CfgTest : public ::testing::Test {
+protected:
+    IrFunction function{"f"};
+    IrBlockId entry = 0, outer = 0, inner = 0, left = 0, right = 0, join = 0, exit = 0, dead = 0;
+
+    void SetUp() override {
+        IrBuilder builder(&function);
+        entry = function.add_block("entry");
+        outer = function.add_block("outer");
+        inner = function.add_block("inner");
+        left = function.add_block("left");
+        right = function.add_block("right");
+        join = function.add_block("join");
+        exit = function.add_block("exit");
+        dead = function.add_block("dead");
+        auto condition = function.constant(1);
+        builder.set_block(entry);
+        builder.jump(outer);
+        builder.set_block(outer);
+        builder.branch(condition, inner, left);
+        builder.set_block(inner);
+        builder.branch(condition, inner, outer);
+        builder.set_block(left);
+        builder.branch(condition, join, right);
+        builder.set_block(right);
+        builder.jump(join);
+        builder.set_block(join);
+        builder.branch(condition, outer, exit);
+        builder.set_block(exit);
+        builder.ret(condition);
+        builder.set_block(dead);
+        builder.jump(exit);
+    }
+};
+
+TEST_F(CfgTest, numbers_reachable_blocks_in_reverse_postorder) {
+    ControlFlowGraph cfg(function);
+
+    EXPECT_EQ(cfg.size(), 7);
+    EXPECT_EQ(cfg.entry(), entry);
+    EXPECT_FALSE(cfg.reachable(dead));
+    // the unreachable block is no predecessor
+    EXPECT_EQ(cfg.predecessors[exit], std::vector<IrBlockId>{join});
+    for (auto block: cfg.reverse_postorder) {
+        for (auto successor: cfg.successors[block]) {
+            // only back edges go up in reverse postorder
+            if (cfg.rpo_number[successor] <= cfg.rpo_number[block]) {
+                EXPECT_TRUE(successor == outer || successor == inner);
+            }
+        }
+    }
+}
+
+TEST_F(CfgTest, computes_dominators_and_frontiers) {
+    ControlFlowGraph cfg(function);
+    DominatorTree dominators(cfg);
+
+    EXPECT_EQ(dominators.idom(outer), entry);
+    EXPECT_EQ(dominators.idom(inner), outer);
+    EXPECT_EQ(dominators.idom(join), left);
+    EXPECT_EQ(dominators.idom(exit), join);
+    EXPECT_TRUE(dominators.dominates(outer, exit));
+    EXPECT_FALSE(dominators.dominates(right, join));
+    EXPECT_FALSE(dominators.contains(dead));
+    EXPECT_EQ(dominators.frontier(right), std::vector<IrBlockId>{join});
+    auto frontier = dominators.frontier(inner);
+    std::sort(frontier.begin(), frontier.end());
+    EXPECT_EQ(frontier, (std::vector<IrBlockId>{outer, inner}));
+    EXPECT_EQ(dominators.frontier(join), std::vector<IrBlockId>{outer});
+
+    DominatorTree post_dominators(cfg, true);
+    EXPECT_EQ(post_dominators.idom(left), join);
+    EXPECT_EQ(post_dominators.idom(outer), left);
+    EXPECT_TRUE(post_dominators.dominates(exit, entry));
+    // right is control dependent on the branch in left
+    EXPECT_EQ(post_dominators.frontier(right), std::vector<IrBlockId>{left});
+}
+
+TEST_F(CfgTest, nests_loops) {
+    ControlFlowGraph cfg(function);
+    DominatorTree dominators(cfg);
+    LoopForest forest(cfg, dominators);
+
+    ASSERT_EQ(forest.loops.size(), 2);
+    auto &outer_loop = forest.loops[forest.loop_of(join)];
+    EXPECT_EQ(outer_loop.header, outer);
+    EXPECT_EQ(outer_loop.blocks.size(), 5);
+    EXPECT_EQ(forest.depth(inner), 2);
+    EXPECT_EQ(forest.loops[forest.loop_of(inner)].parent, forest.loop_of(join));
+    EXPECT_EQ(forest.depth(exit), 0);
+}
+
+TEST_F(CfgTest, caches_until_invalidated) {
+    AnalysisCache cache(function);
+    auto &cfg = cache.cfg();
+    EXPECT_EQ(&cache.cfg(), &cfg);
+    cache.loops();
+    EXPECT_EQ(cache.cached(), ANALYSIS_CFG | ANALYSIS_DOMINATORS | ANALYSIS_LOOPS);
+
+    cache.invalidate(ANALYSIS_DOMINATORS);
+    EXPECT_EQ(cache.cached(), ANALYSIS_CFG);
+    cache.invalidate(ANALYSIS_CFG);
+    EXPECT_EQ(cache.cached(), 0);
+}
+
+TEST(cfg_benchmark, hundred_thousand_blocks) {
+    // a chain of diamonds; every tenth join loops back nine diamonds
+    const int diamonds = 25000;
+    IrFunction function("big");
+    IrBuilder builder(&function);
+    std::vector<IrBlockId> heads, joins;
+    for (int i = 0; i < diamonds; i++) {
+        heads.push_back(function.add_block("head"));
+        auto left = function.add_block("left");
+        auto right = function.add_block("right");
+        joins.push_back(function.add_block("join"));
+        builder.set_block(heads.back());
+        builder.branch(function.constant(i), left, right);
+        builder.set_block(left);
+        builder.jump(joins.back());
+        builder.set_block(right);
+        builder.jump(joins.back());
+    }
+    auto exit = function.add_block("exit");
+    for (int i = 0; i < diamonds; i++) {
+        builder.set_block(joins[i]);
+        auto next = i + 1 < diamonds ? heads[i + 1] : exit;
+        if (i % 10 == 9) {
+            builder.branch(function.constant(i), heads[i - 9], next);
+        } else {
+            builder.jump(next);
+        }
+    }
+    builder.set_block(exit);
+    builder.ret(function.constant(0));
+    ASSERT_GE(function.layout.size(), 100000);
+
+    auto start = std::chrono::steady_clock::now();
+    AnalysisCache cache(function);
+    auto &dominators = cache.dominators();
+    auto &post_dominators = cache.post_dominators();
+    auto &forest = cache.loops();
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    std::cout << "cfg, dominators, post-dominators and loops of " << function.layout.size() << " blocks: "
+              << elapsed.count() << " ms" << std::endl;
+
+    EXPECT_EQ(cache.cfg().size(), function.layout.size());
+    EXPECT_EQ(dominators.idom(joins[12345]), heads[12345]);
+    EXPECT_EQ(post_dominators.idom(heads[12345]), joins[12345]);
+    EXPECT_TRUE(dominators.dominates(heads[0], exit));
+    EXPECT_EQ(forest.loops.size(), diamonds / 10);
+    EXPECT_EQ(forest.depth(heads[5]), 1);
+    EXPECT_LT(elapsed.count(), 10000);
+}
@@ -0,0 +1,67 @@
+#include "gtest/gtest.h"
+#include "memory"
+#include "Ast.h"
+#include "constant_folding.h"
+#include "ast_builder.h"
+
+TEST(constant_folding, folds_constant_subtrees) {
+    // 1 + 2
+    auto ast = arith(add(term(num(1)), "+", mul(nullptr, "", num(2))));
+
+    auto statistics = ConstantFolder().fold(ast);
+
+    EXPECT_EQ(ConstantFolder::constant_value(ast.get()), 3);
+    EXPECT_EQ(statistics.constants_folded, 1);
+    EXPECT_EQ(statistics.nodes_removed, 4);
+
+    // 1 > 3
+    ast = exp(rel(rel(nullptr, "", term(num(1))), ">", term(num(3))));
+    ConstantFolder().fold(ast);
+    EXPECT_EQ(ConstantFolder::constant_value(ast.get()), 0);
+}
+
+TEST(constant_folding, keeps_division_by_zero_for_run_time) {
+    auto ast = arith(add(nullptr, "", mul(mul(nullptr, "", num(1)), "/", num(0))));
+
+    auto statistics = ConstantFolder().fold(ast);
+
+    EXPECT_FALSE(ConstantFolder::constant_value(ast.get()).has_value());
+    EXPECT_EQ(statistics.nodes_removed, 0);
+}
+
+TEST(constant_folding, applies_algebraic_identities) {
+    // a * 1 + 0
+    auto ast = arith(add(add(nullptr, "", mul(mul(nullptr, "", var("a")), "*", num(1))), "+", mul(nullptr, "", num(0))));
+    auto statistics = ConstantFolder().fold(ast);
+    EXPECT_EQ(ast->dump(), "a");
+    EXPECT_EQ(statistics.identities_applied, 2);
+
+    // a * 0
+    ast = arith(add(nullptr, "", mul(mul(nullptr, "", var("a")), "*", num(0))));
+    ConstantFolder().fold(ast);
+    EXPECT_EQ(ConstantFolder::constant_value(ast.get()), 0);
+
+    // a - a
+    ast = arith(add(term(var("a")), "-", mul(nullptr, "", var("a"))));
+    ConstantFolder().fold(ast);
+    EXPECT_EQ(ConstantFolder::constant_value(ast.get()), 0);
+
+    // --a
+    ast = arith(term(unary("-", unary("-", var("a")))));
+    ConstantFolder().fold(ast);
+    EXPECT_EQ(ast->dump(), "a");
+}
+
+TEST(constant_folding, double_negation_only_drops_for_booleans) {
+    // !!a is a != 0, not a
+    auto ast = arith(term(unary("!", unary("!", var("a")))));
+    ConstantFolder().fold(ast);
+    EXPECT_EQ(ast->dump(), "!!a");
+
+    // !!!a is !a
+    ast = arith(term(unary("!", unary("!", unary("!", var("a"))))));
+    auto statistics = ConstantFolder().fold(ast);
+    EXPECT_EQ(ast->dump(), "!a");
+    EXPECT_EQ(statistics.identities_applied, 1);
+    EXPECT_EQ(statistics.nodes_removed, 4);
+}
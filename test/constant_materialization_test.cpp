@@ -0,0 +1,68 @@
+#include "gtest/gtest.h"
+#include <climits>
+#include "constant_materialization.h"
+#include "riscv_writer.h"
+#include "riscv_interpreter.h"
+
+static MachineInstruction make(RiscvOpcode opcode, MachineRegister rd, MachineRegister rs1, MachineRegister rs2,
+                               int32_t imm) {
+    MachineInstruction inst;
+    inst.opcode = opcode;
+    inst.rd = rd;
+    inst.rs1 = rs1;
+    inst.rs2 = rs2;
+    inst.imm = imm;
+    return inst;
+}
+
+TEST(constant_materialization, picks_the_shortest_sequence) {
+    // with how many instructions each should take
+    std::pair<int32_t, size_t> constants[] = {
+            {0, 1}, {2047, 1}, {-2048, 1}, {2048, 2}, {0x12345000, 1}, {0x12345678, 2},
+            // the lower part is negative, so the upper one is rounded up
+            {0x12345800, 2}, {0x7ffff800, 2}, {INT_MAX, 2}, {INT_MIN, 1}, {-1, 1}, {-2049, 2}
+    };
+    for (auto &constant: constants) {
+        MachineFunction function("main");
+        function.add_block("entry");
+        auto &instructions = function.blocks[0].instructions;
+        instructions.push_back(make(RV_LI, RV_A0, RV_ZERO, RV_ZERO, constant.first));
+        instructions.push_back(make(RV_RET, RV_ZERO, RV_ZERO, RV_ZERO, 0));
+
+        auto statistics = ConstantMaterialization().run(function);
+
+        EXPECT_EQ(instructions.size(), constant.second + 1) << RiscvWriter::dump(function);
+        EXPECT_EQ(statistics.instructions_after, constant.second + 1);
+        EXPECT_EQ(riscv_interpret(function), constant.first) << RiscvWriter::dump(function);
+        for (auto &inst: instructions) {
+            EXPECT_TRUE(inst.opcode != RV_LI || riscv_fits_immediate(inst.imm));
+        }
+    }
+}
+
+TEST(constant_materialization, reuses_nearby_constants) {
+    MachineFunction function("main");
+    function.add_block("entry");
+    auto &instructions = function.blocks[0].instructions;
+    instructions.push_back(make(RV_LI, RV_T0, RV_ZERO, RV_ZERO, 100000));
+    instructions.push_back(make(RV_LI, RV_T1, RV_ZERO, RV_ZERO, 100004));
+    instructions.push_back(make(RV_LI, RV_T2, RV_ZERO, RV_ZERO, 400000));
+    instructions.push_back(make(RV_ADD, RV_T0, RV_T0, RV_T1, 0));
+    // t0 no longer holds 100000
+    instructions.push_back(make(RV_LI, RV_T1, RV_ZERO, RV_ZERO, 100008));
+    instructions.push_back(make(RV_ADD, RV_T0, RV_T0, RV_T1, 0));
+    instructions.push_back(make(RV_ADD, RV_A0, RV_T0, RV_T2, 0));
+    instructions.push_back(make(RV_RET, RV_ZERO, RV_ZERO, RV_ZERO, 0));
+    auto expected = riscv_interpret(function);
+
+    auto statistics = ConstantMaterialization().run(function);
+
+    // 100008 still comes from t1, which held 100004
+    EXPECT_EQ(statistics.reused, 3);
+    EXPECT_EQ(statistics.expanded, 1);
+    EXPECT_EQ(statistics.instructions_before, 12);
+    EXPECT_EQ(statistics.instructions_after, 9);
+    EXPECT_EQ(instructions[2].opcode, RV_ADDI);
+    EXPECT_EQ(instructions[3].opcode, RV_SLLI);
+    EXPECT_EQ(riscv_interpret(function), expected) << RiscvWriter::dump(function);
+}
@@ -0,0 +1,270 @@
+#include "gtest/gtest.h"
+#include <chrono>
+#include <random>
+#include "memory"
+#include "graph_coloring.h"
+#include "linear_scan.h"
+#include "mem2reg.h"
+#include "riscv_backend.h"
+#include "riscv_frame.h"
+#include "riscv_isel.h"
+#include "riscv_writer.h"
+#include "ir_interpreter.h"
+#include "riscv_interpreter.h"
+
+// entry: values k*k - 300 for k < count, kept in memory so nothing folds
+static std::vector<IrValueId> loaded_values(IrFunction &function, IrBuilder &builder, int count) {
+    std::vector<IrValueId> values;
+    for (int k = 0; k < count; k++) {
+        auto slot = builder.alloca_slot();
+        builder.store(function.constant(k * k - 300), slot);
+        values.push_back(builder.load(slot));
+    }
+    return values;
+}
+
+static size_t count_opcode(const MachineBlock &block, RiscvOpcode opcode) {
+    size_t count = 0;
+    for (auto &inst: block.instructions) {
+        count += inst.opcode == opcode;
+    }
+    return count;
+}
+
+TEST(graph_coloring, bit_matrix_and_adjacency_lists_agree) {
+    InterferenceGraph small(200);
+    InterferenceGraph large(InterferenceGraph::BIT_MATRIX_LIMIT + 200);
+    EXPECT_TRUE(small.uses_bit_matrix());
+    EXPECT_FALSE(large.uses_bit_matrix());
+
+    std::mt19937 random(42);
+    for (int i = 0; i < 2000; i++) {
+        auto u = static_cast<MachineRegister>(random() % 200);
+        auto v = static_cast<MachineRegister>(random() % 200);
+        EXPECT_EQ(small.add_edge(u, v), large.add_edge(u, v));
+    }
+    for (MachineRegister u = 0; u < 200; u++) {
+        for (MachineRegister v = 0; v < 200; v++) {
+            ASSERT_EQ(small.interferes(u, v), large.interferes(u, v)) << u << ", " << v;
+        }
+        EXPECT_EQ(small.neighbours(u).size(), large.neighbours(u).size());
+    }
+}
+
+TEST(graph_coloring, keeps_the_result_under_pressure) {
+    IrFunction function("main");
+    IrBuilder builder(&function);
+    builder.set_block(function.add_block("entry"));
+    auto values = loaded_values(function, builder, 40);
+    auto sum = values.back();
+    for (int k = 38; k >= 0; k--) {
+        sum = builder.binary(k % 3 == 0 ? IR_SUB : IR_ADD, values[k], sum);
+    }
+    builder.ret(sum);
+
+    MachineFunction machine("main");
+    RiscvBackend(2).generate(function, machine);
+
+    lower_frame(machine);
+    EXPECT_EQ(riscv_interpret(machine), ir_interpret(function)) << RiscvWriter::dump(machine);
+}
+
+TEST(graph_coloring, coalesces_phi_copies) {
+    // i and s through a loop; every phi copy can share a register with its source
+    IrFunction function("main");
+    IrBuilder builder(&function);
+    auto entry = function.add_block("entry");
+    auto loop = function.add_block("loop");
+    auto exit = function.add_block("exit");
+    builder.set_block(entry);
+    auto start = loaded_values(function, builder, 1).front();
+    builder.jump(loop);
+    builder.set_block(loop);
+    auto i = builder.phi();
+    auto s = builder.phi();
+    auto sum = builder.binary(IR_ADD, s, builder.binary(IR_MUL, i, i));
+    auto next = builder.binary(IR_ADD, i, function.constant(1));
+    function.add_incoming(i, start, entry);
+    function.add_incoming(i, next, loop);
+    function.add_incoming(s, function.constant(0), entry);
+    function.add_incoming(s, sum, loop);
+    builder.branch(builder.binary(IR_LT, next, function.constant(10)), loop, exit);
+    builder.set_block(exit);
+    builder.ret(sum);
+
+    MachineFunction linear("main");
+    RiscvSelector().run(function, linear);
+    auto colored = linear;
+    auto before = LinearScan().run(linear);
+    auto after = GraphColoring().run(colored);
+
+    EXPECT_GT(before.moves, 0);
+    EXPECT_EQ(after.moves, 0) << RiscvWriter::dump(colored);
+    EXPECT_EQ(after.spilled, 0);
+    lower_frame(colored);
+    EXPECT_EQ(riscv_interpret(colored), ir_interpret(function));
+}
+
+TEST(graph_coloring, spills_outside_loops_first) {
+    // 30 values live across a loop that works on two others
+    IrFunction function("main");
+    IrBuilder builder(&function);
+    auto entry = function.add_block("entry");
+    auto loop = function.add_block("loop");
+    auto exit = function.add_block("exit");
+    builder.set_block(entry);
+    auto values = loaded_values(function, builder, 32);
+    builder.jump(loop);
+    builder.set_block(loop);
+    auto i = builder.phi();
+    auto next = builder.binary(IR_ADD, i, builder.binary(IR_MUL, values[0], values[1]));
+    function.add_incoming(i, function.constant(0), entry);
+    function.add_incoming(i, next, loop);
+    builder.branch(builder.binary(IR_LT, next, function.constant(100000)), loop, exit);
+    builder.set_block(exit);
+    auto result = next;
+    for (int k = 2; k < 32; k++) {
+        result = builder.binary(IR_XOR, result, values[k]);
+    }
+    builder.ret(result);
+
+    MachineFunction machine("main");
+    RiscvSelector().run(function, machine);
+    auto statistics = GraphColoring().run(machine);
+
+    EXPECT_GT(statistics.spilled, 0);
+    for (auto &block: machine.blocks) {
+        if (block.loop_depth > 0) {
+            EXPECT_EQ(count_opcode(block, RV_LW), 0) << block.name;
+            EXPECT_EQ(count_opcode(block, RV_SW), 0) << block.name;
+        }
+    }
+    lower_frame(machine);
+    EXPECT_EQ(riscv_interpret(machine), ir_interpret(function)) << RiscvWriter::dump(machine);
+}
+
+TEST(graph_coloring, rematerializes_constants) {
+    // 40 constants made up front and all summed at the end
+    MachineFunction function("main");
+    function.add_block("entry");
+    auto emit = [&function](RiscvOpcode opcode, MachineRegister rd, MachineRegister rs1, int32_t imm) {
+        MachineInstruction inst;
+        inst.opcode = opcode;
+        inst.rd = rd;
+        inst.rs1 = rs1;
+        inst.rs2 = rd;
+        inst.imm = imm;
+        function.blocks[0].instructions.push_back(inst);
+    };
+    std::vector<MachineRegister> constants;
+    for (int k = 0; k < 40; k++) {
+        constants.push_back(function.new_register());
+        emit(RV_LI, constants.back(), RV_ZERO, k * 100003);
+    }
+    auto sum = constants.back();
+    for (int k = 38; k >= 0; k--) {
+        auto next = function.new_register();
+        emit(RV_ADD, next, constants[k], 0);
+        function.blocks[0].instructions.back().rs2 = sum;
+        sum = next;
+    }
+    emit(RV_MV, RV_A0, sum, 0);
+    emit(RV_RET, RV_ZERO, RV_ZERO, 0);
+    auto expected = riscv_interpret(function);
+    ASSERT_TRUE(expected.has_value());
+
+    auto colored = function;
+    auto linear = LinearScan().run(function);
+    auto irc = GraphColoring().run(colored);
+    for (auto statistics: {linear, irc}) {
+        EXPECT_EQ(statistics.spilled, 0);
+        EXPECT_GT(statistics.rematerialized, 0);
+        EXPECT_EQ(statistics.spill_stores_avoided, statistics.rematerialized);
+        EXPECT_GE(statistics.spill_loads_avoided, statistics.rematerialized);
+    }
+    EXPECT_TRUE(function.slots.empty());
+    EXPECT_TRUE(colored.slots.empty());
+    lower_frame(function);
+    lower_frame(colored);
+    EXPECT_EQ(riscv_interpret(function), expected) << RiscvWriter::dump(function);
+    EXPECT_EQ(riscv_interpret(colored), expected) << RiscvWriter::dump(colored);
+}
+
+TEST(graph_coloring, splits_ranges_around_pressure) {
+    // x lives through a block that needs every register, without being used there
+    IrFunction function("main");
+    IrBuilder builder(&function);
+    auto entry = function.add_block("entry");
+    auto busy = function.add_block("busy");
+    auto exit = function.add_block("exit");
+    builder.set_block(entry);
+    auto x = builder.binary(IR_MUL, loaded_values(function, builder, 1).front(), function.constant(3));
+    builder.jump(busy);
+    builder.set_block(busy);
+    auto values = loaded_values(function, builder, 30);
+    auto sum = values.back();
+    for (int k = 28; k >= 0; k--) {
+        sum = builder.binary(IR_ADD, values[k], sum);
+    }
+    builder.jump(exit);
+    builder.set_block(exit);
+    builder.ret(builder.binary(IR_SUB, x, sum));
+
+    MachineFunction machine("main");
+    RiscvSelector().run(function, machine);
+    auto statistics = GraphColoring().run(machine);
+
+    EXPECT_GT(statistics.ranges_split, 0);
+    // x itself stays in a register, only its stand-in over the busy block may spill
+    EXPECT_EQ(count_opcode(machine.blocks[0], RV_SW), 1);
+    EXPECT_EQ(count_opcode(machine.blocks[2], RV_LW), 0);
+    lower_frame(machine);
+    EXPECT_EQ(riscv_interpret(machine), ir_interpret(function)) << RiscvWriter::dump(machine);
+}
+
+TEST(graph_coloring, spills_no_more_than_linear_scan_across_blocks) {
+    // 80 variables updated through a chain of ifs and summed at the end, the way mem2reg
+    // leaves them when nothing is folded: every block is over pressure
+    const int count = 80;
+    IrFunction function("main");
+    IrBuilder builder(&function);
+    builder.set_block(function.add_block("entry"));
+    std::vector<IrValueId> slots;
+    for (int k = 0; k < count; k++) {
+        slots.push_back(builder.alloca_slot());
+        auto previous = k == 0 ? function.constant(7) : builder.load(slots[k - 1]);
+        builder.store(builder.binary(IR_ADD, builder.binary(IR_MUL, previous, function.constant(3)),
+                                     function.constant(k)), slots[k]);
+    }
+    for (int k = 0; k + 1 < count; k += 4) {
+        auto then = function.add_block("then");
+        auto join = function.add_block("join");
+        builder.branch(builder.binary(IR_GT, builder.load(slots[k]), builder.load(slots[k + 1])), then, join);
+        builder.set_block(then);
+        builder.store(builder.binary(IR_SUB, builder.load(slots[k]), builder.load(slots[k + 1])), slots[k]);
+        builder.jump(join);
+        builder.set_block(join);
+    }
+    IrValueId sum = function.constant(0);
+    for (int k = 0; k < count; k++) {
+        sum = builder.binary(k % 2 == 0 ? IR_ADD : IR_XOR, sum, builder.load(slots[k]));
+    }
+    builder.ret(sum);
+    Mem2Reg().run(function);
+    auto expected = ir_interpret(function);
+    ASSERT_TRUE(expected.has_value());
+
+    MachineFunction linear("main");
+    RiscvSelector().run(function, linear);
+    auto colored = linear;
+    auto start = std::chrono::steady_clock::now();
+    auto irc = GraphColoring().run(colored);
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    auto scan = LinearScan().run(linear);
+
+    EXPECT_LE(irc.spilled, scan.spilled);
+    EXPECT_LE(irc.spill_loads, scan.spill_loads);
+    EXPECT_LT(std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count(), 2000);
+    lower_frame(colored);
+    EXPECT_EQ(riscv_interpret(colored), expected) << RiscvWriter::dump(colored);
+}
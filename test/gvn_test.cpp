@@ -0,0 +1,117 @@
+#include "gtest/gtest.h"
+#include "memory"
+#include "gvn.h"
+#include "mem2reg.h"
+#include "ir_generator.h"
+#include "ast_builder.h"
+#include "ir_interpreter.h"
+
+static size_t count_opcode(const IrFunction &function, IrOpcode opcode) {
+    size_t count = 0;
+    for (auto block: function.layout) {
+        for (auto inst: function.block_instructions(block)) {
+            count += function[inst].opcode == opcode;
+        }
+    }
+    return count;
+}
+
+TEST(gvn, removes_commuted_subexpressions) {
+    // int a = 3; int b = 4; return a * b + b * a;
+    auto ast = program(items(
+            var_def("a", arith(term(num(3)))),
+            var_def("b", arith(term(num(4)))),
+            ret(arith(add(add(nullptr, "", mul(mul(nullptr, "", var("a")), "*", var("b"))),
+                          "+", mul(mul(nullptr, "", var("b")), "*", var("a")))))));
+    auto module = IrGenerator().generate(ast.get());
+    auto &function = *module->functions.front();
+    Mem2Reg().run(function);
+    AnalysisCache analyses(function);
+
+    auto statistics = Gvn().run(analyses);
+
+    EXPECT_EQ(ir_interpret(function), 24);
+    EXPECT_EQ(statistics.instructions_eliminated, 1);
+    EXPECT_EQ(count_opcode(function, IR_MUL), 1);
+}
+
+TEST(gvn, reuses_values_from_dominating_blocks) {
+    // entry: s = x + y; c = x < y; br c, then, else
+    // then:  t = y + x; d = y > x; u = x * y          (t and d are redundant)
+    // else:  v = x * y                                 (then does not dominate else)
+    // end:   w = x + y; r = phi(t + d + u, v) + w    (w is redundant)
+    IrFunction function("f");
+    IrBuilder builder(&function);
+    auto entry = function.add_block("entry");
+    auto then_block = function.add_block("then");
+    auto else_block = function.add_block("else");
+    auto end = function.add_block("end");
+    builder.set_block(entry);
+    auto slot = builder.alloca_slot();
+    builder.store(function.constant(5), slot);
+    auto x = builder.load(slot);
+    auto y = builder.load(slot);
+    auto s = builder.binary(IR_ADD, x, y);
+    builder.branch(builder.binary(IR_LT, x, y), then_block, else_block);
+    builder.set_block(then_block);
+    auto t = builder.binary(IR_ADD, y, x);
+    auto d = builder.binary(IR_GT, y, x);
+    auto u = builder.binary(IR_MUL, x, y);
+    auto then_value = builder.binary(IR_ADD, builder.binary(IR_ADD, t, d), u);
+    builder.jump(end);
+    builder.set_block(else_block);
+    auto v = builder.binary(IR_MUL, x, y);
+    builder.jump(end);
+    builder.set_block(end);
+    auto merged = builder.phi();
+    function.add_incoming(merged, then_value, then_block);
+    function.add_incoming(merged, v, else_block);
+    auto w = builder.binary(IR_ADD, x, y);
+    builder.ret(builder.binary(IR_ADD, merged, w));
+    AnalysisCache analyses(function);
+
+    auto statistics = Gvn().run(analyses);
+
+    // x == y, so the else arm runs: 25 + 10
+    EXPECT_EQ(ir_interpret(function), 35);
+    EXPECT_EQ(statistics.instructions_eliminated, 3);
+    EXPECT_EQ(count_opcode(function, IR_MUL), 2);
+    auto sum = function.operand(then_value, 0);
+    EXPECT_EQ(function.operand(sum, 0), s);
+    EXPECT_EQ(function[function.operand(sum, 1)].opcode, IR_LT);
+    // the loads are not pure, both stay
+    EXPECT_EQ(count_opcode(function, IR_LOAD), 2);
+}
+
+TEST(gvn, merges_identical_phis) {
+    IrFunction function("f");
+    IrBuilder builder(&function);
+    auto entry = function.add_block("entry");
+    auto then_block = function.add_block("then");
+    auto end = function.add_block("end");
+    builder.set_block(entry);
+    auto slot = builder.alloca_slot();
+    builder.store(function.constant(1), slot);
+    auto x = builder.load(slot);
+    builder.branch(x, then_block, end);
+    builder.set_block(then_block);
+    builder.jump(end);
+    builder.set_block(end);
+    auto first = builder.phi();
+    function.add_incoming(first, function.constant(2), then_block);
+    function.add_incoming(first, x, entry);
+    auto second = builder.phi();
+    function.add_incoming(second, x, entry);
+    function.add_incoming(second, function.constant(2), then_block);
+    auto trivial = builder.phi();
+    function.add_incoming(trivial, x, entry);
+    function.add_incoming(trivial, x, then_block);
+    builder.ret(builder.binary(IR_ADD, builder.binary(IR_ADD, first, second), trivial));
+    AnalysisCache analyses(function);
+
+    auto statistics = Gvn().run(analyses);
+
+    EXPECT_EQ(ir_interpret(function), 5);
+    EXPECT_EQ(statistics.phis_eliminated, 2);
+    EXPECT_EQ(count_opcode(function, IR_PHI), 1);
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <map>
+#include <optional>
+#include "ir.h"
+
+/**
+ * Runs an IrFunction directly, so tests can check that a transformation keeps the result.
+ * nullopt when a division traps or the step limit runs out.
+ */
+inline std::optional<int32_t> ir_interpret(const IrFunction &function, size_t step_limit = 1000000) {
+    std::map<IrValueId, int32_t> values;
+    std::map<IrValueId, int32_t> memory;
+    auto value_of = [&](IrValueId value) -> int32_t {
+        if (function.is_constant(value)) {
+            return function.constant_value(value);
+        }
+        auto found = values.find(value);
+        return found == values.end() ? 0 : found->second;
+    };
+
+    IrBlockId previous = 0;
+    IrBlockId block = function.entry();
+    size_t steps = 0;
+    while (block != 0) {
+        // phis read their operands all at once, on entry to the block
+        std::map<IrValueId, int32_t> phi_values;
+        auto inst = function.blocks[block].first;
+        for (; inst != 0 && function[inst].opcode == IR_PHI; inst = function[inst].next) {
+            for (uint32_t i = 0; i < function[inst].operand_count; i++) {
+                if (function.incoming_block(inst, i) == previous) {
+                    phi_values[inst] = value_of(function.operand(inst, i));
+                }
+            }
+        }
+        for (auto &entry: phi_values) {
+            values[entry.first] = entry.second;
+        }
+
+        IrBlockId next = 0;
+        for (; inst != 0; inst = function[inst].next) {
+            if (++steps > step_limit) {
+                return std::nullopt;
+            }
+            auto &record = function[inst];
+            if (record.opcode == IR_ALLOCA) {
+                memory[inst] = 0;
+            } else if (record.opcode == IR_LOAD) {
+                values[inst] = memory[function.operand(inst, 0)];
+            } else if (record.opcode == IR_STORE) {
+                memory[function.operand(inst, 1)] = value_of(function.operand(inst, 0));
+            } else if (ir_is_binary(record.opcode)) {
+                int32_t result;
+                if (!ir_evaluate(record.opcode, value_of(function.operand(inst, 0)),
+                                 value_of(function.operand(inst, 1)), result)) {
+                    return std::nullopt;
+                }
+                values[inst] = result;
+            } else if (record.opcode == IR_BR) {
+                next = value_of(function.operand(inst, 0)) != 0 ? record.targets[0] : record.targets[1];
+                break;
+            } else if (record.opcode == IR_JUMP) {
+                next = record.targets[0];
+                break;
+            } else if (record.opcode == IR_RET) {
+                return value_of(function.operand(inst, 0));
+            }
+        }
+        previous = block;
+        block = next;
+    }
+    // fell off a block without a terminator
+    return std::nullopt;
+}
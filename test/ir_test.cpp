@@ -0,0 +1,193 @@
+#include "gtest/gtest.h"
+#include "memory"
+#include "ir.h"
+#include "ir_generator.h"
+#include "ast_builder.h"
+#include "ir_interpreter.h"
+
+TEST(ir, instructions_are_compact) {
+    EXPECT_EQ(sizeof(IrInstruction), 32);
+    EXPECT_EQ(sizeof(IrUse), 16);
+}
+
+TEST(ir, use_lists_follow_operand_updates) {
+    IrFunction function("f");
+    IrBuilder builder(&function);
+    builder.set_block(function.add_block("entry"));
+    auto slot = builder.alloca_slot();
+    auto x = builder.load(slot);
+    auto y = builder.binary(IR_ADD, x, x);
+    auto z = builder.binary(IR_MUL, y, x);
+    builder.ret(z);
+
+    EXPECT_EQ(function.use_count(x), 3);
+    EXPECT_EQ(function.use_count(function.constant(2)), 0);
+    EXPECT_EQ(function.constant(2), function.constant(2));
+
+    function.set_operand(z, 1, function.constant(2));
+    EXPECT_EQ(function.use_count(x), 2);
+    EXPECT_EQ(function.users(function.constant(2)), std::vector<IrValueId>{z});
+
+    function.replace_all_uses(x, function.constant(5));
+    EXPECT_FALSE(function.has_uses(x));
+    EXPECT_EQ(function.use_count(function.constant(5)), 2);
+    function.erase(x);
+    EXPECT_EQ(function.block_instructions(function.entry()).size(), 4);
+    EXPECT_EQ(ir_interpret(function), 20);
+}
+
+TEST(ir, phis_track_incoming_blocks) {
+    IrFunction function("f");
+    IrBuilder builder(&function);
+    auto entry = function.add_block("entry");
+    auto left = function.add_block("left");
+    auto right = function.add_block("right");
+    auto join = function.add_block("join");
+    builder.set_block(entry);
+    builder.branch(function.constant(0), left, right);
+    builder.set_block(left);
+    builder.jump(join);
+    builder.set_block(right);
+    builder.jump(join);
+    builder.set_block(join);
+    auto phi = builder.phi();
+    builder.ret(phi);
+
+    function.add_incoming(phi, function.constant(1), left);
+    // grows after other operands were allocated, the run is moved to the end of the arena
+    function.create(IR_ADD, {phi, phi});
+    function.add_incoming(phi, function.constant(2), right);
+
+    EXPECT_EQ(function[phi].operand_count, 2);
+    EXPECT_EQ(function.incoming_block(phi, 1), right);
+    EXPECT_EQ(ir_interpret(function), 2);
+
+    function.remove_incoming(phi, left);
+    EXPECT_EQ(function[phi].operand_count, 1);
+    EXPECT_EQ(function.operand(phi, 0), function.constant(2));
+    EXPECT_EQ(function.successors(entry), (std::vector<IrBlockId>{left, right}));
+}
+
+TEST(ir, lowers_assignments_branches_and_nested_blocks) {
+    // int a = 1; if (a > 3) { a = 3; } else { a = a + 1; } { int a = 7; a = a * 2; } return a;
+    auto ast = program(items(
+            var_def("a", arith(term(num(1)))),
+            if_else(exp(rel(rel(nullptr, "", term(var("a"))), ">", term(num(3)))),
+                    block_statement(items(assign("a", arith(term(num(3)))))),
+                    block_statement(items(assign("a", arith(add(term(var("a")), "+", mul(nullptr, "", num(1)))))))),
+            block_statement(items(
+                    var_def("a", arith(term(num(7)))),
+                    assign("a", arith(add(nullptr, "", mul(mul(nullptr, "", var("a")), "*", num(2))))))),
+            ret(arith(term(var("a"))))));
+
+    auto module = IrGenerator().generate(ast.get());
+    auto &function = *module->functions.front();
+
+    EXPECT_EQ(ir_interpret(function), 2);
+    EXPECT_EQ(function.layout.size(), 4);
+    // both allocas sit at the top of the entry block
+    auto entry = function.block_instructions(function.entry());
+    EXPECT_EQ(function[entry[0]].opcode, IR_ALLOCA);
+    EXPECT_EQ(function[entry[1]].opcode, IR_ALLOCA);
+    EXPECT_EQ(function.value_name(entry[1]), "@a_1");
+
+    auto statistics = module->statistics();
+    EXPECT_GT(statistics.instructions, 0);
+    EXPECT_LT(statistics.bytes_per_instruction(), 128);
+}
+
+TEST(ir, names_shadowing_variables_apart_from_source_names) {
+    // int a_1 = 5; { int a = 1; { int a = 2; a_1 = a_1 + a; } } return a_1;
+    auto ast = program(items(
+            var_def("a_1", arith(term(num(5)))),
+            block_statement(items(
+                    var_def("a", arith(term(num(1)))),
+                    block_statement(items(
+                            var_def("a", arith(term(num(2)))),
+                            assign("a_1", arith(add(term(var("a_1")), "+", mul(nullptr, "", var("a"))))))))),
+            ret(arith(term(var("a_1"))))));
+
+    auto module = IrGenerator().generate(ast.get());
+    auto &function = *module->functions.front();
+
+    EXPECT_EQ(ir_interpret(function), 7);
+    auto entry = function.block_instructions(function.entry());
+    EXPECT_EQ(function.value_name(entry[0]), "@a_1");
+    EXPECT_EQ(function.value_name(entry[1]), "@a");
+    EXPECT_EQ(function.value_name(entry[2]), "@a_2");
+}
+
+static size_t count_opcode(const IrFunction &function, IrOpcode opcode) {
+    size_t count = 0;
+    for (auto block: function.layout) {
+        for (auto inst: function.block_instructions(block)) {
+            count += function[inst].opcode == opcode;
+        }
+    }
+    return count;
+}
+
+// `(lhs) || (rhs)` the way the parser builds `a && b || c`: an LAndExp carrying "||"
+static std::unique_ptr<BaseAST> or_at_and_precedence(std::unique_ptr<BaseAST> lhs, std::unique_ptr<BaseAST> rhs) {
+    auto expression = logical(std::move(lhs), "&&", std::move(rhs));
+    auto lor = dynamic_cast<LOrExpAST *>(dynamic_cast<ExpAST *>(expression.get())->lor_exp.get());
+    dynamic_cast<LAndExpAST *>(lor->land_exp.get())->land_op = "||";
+    return expression;
+}
+
+TEST(ir, short_circuits_conditions_into_branches) {
+    for (int a: {0, 1, 5}) {
+        for (int b: {0, 2}) {
+            // int a = A; int b = B; int r = 0; if ((a < b && b) || !a) { r = 1; } return r;
+            auto ast = program(items(
+                    var_def("a", arith(term(num(a)))),
+                    var_def("b", arith(term(num(b)))),
+                    var_def("r", arith(term(num(0)))),
+                    if_else(or_at_and_precedence(logical(exp(rel(rel(nullptr, "", term(var("a"))), "<", term(var("b")))),
+                                                         "&&", arith(term(var("b")))),
+                                                 arith(term(unary("!", var("a"))))),
+                            block_statement(items(assign("r", arith(term(num(1))))))),
+                    ret(arith(term(var("r"))))));
+            auto module = IrGenerator().generate(ast.get());
+            auto &function = *module->functions.front();
+
+            EXPECT_EQ(ir_interpret(function), (a < b && b) || !a);
+            // one branch per operand and no 0/1 values in between
+            EXPECT_EQ(count_opcode(function, IR_BR), 3);
+            EXPECT_EQ(count_opcode(function, IR_NE), 0);
+            EXPECT_EQ(count_opcode(function, IR_EQ), 0);
+            EXPECT_EQ(count_opcode(function, IR_AND), 0);
+            EXPECT_EQ(count_opcode(function, IR_OR), 0);
+            EXPECT_EQ(count_opcode(function, IR_PHI), 0);
+        }
+    }
+}
+
+TEST(ir, short_circuits_logical_values) {
+    for (int a: {0, 3}) {
+        for (int b: {0, 4}) {
+            // int a = A; int b = B; return (a && b) + (b || 12 / a);
+            auto ast = program(items(
+                    var_def("a", arith(term(num(a)))),
+                    var_def("b", arith(term(num(b)))),
+                    ret(arith(add(add(nullptr, "", mul(nullptr, "", paren(logical(arith(term(var("a"))), "&&",
+                                                                                    arith(term(var("b"))))))),
+                                  "+", mul(nullptr, "", paren(logical(
+                                          arith(term(var("b"))), "||",
+                                          arith(add(nullptr, "", mul(mul(nullptr, "", num(12)), "/", var("a"))))))))))));
+            auto module = IrGenerator().generate(ast.get());
+            auto &function = *module->functions.front();
+
+            // 12 / a traps for a == 0 unless b already decided the ||
+            if (a == 0 && b == 0) {
+                EXPECT_EQ(ir_interpret(function), std::nullopt);
+            } else {
+                EXPECT_EQ(ir_interpret(function), (a && b) + (b || 12 / a));
+            }
+            EXPECT_EQ(count_opcode(function, IR_PHI), 2);
+            EXPECT_EQ(count_opcode(function, IR_BR), 2);
+            EXPECT_EQ(count_opcode(function, IR_AND), 0);
+            EXPECT_EQ(count_opcode(function, IR_OR), 0);
+        }
+    }
+}
@@ -0,0 +1,166 @@
+#include "gtest/gtest.h"
+#include "memory"
+#include "koopa_raw_builder.h"
+#include "ir_generator.h"
+#include "ast_builder.h"
+
+static const void *item(const koopa_raw_slice_t &slice, uint32_t index) {
+    EXPECT_LT(index, slice.len);
+    return slice.buffer[index];
+}
+
+static koopa_raw_value_t value(const koopa_raw_slice_t &slice, uint32_t index) {
+    EXPECT_EQ(slice.kind, KOOPA_RSIK_VALUE);
+    return static_cast<koopa_raw_value_t>(item(slice, index));
+}
+
+static koopa_raw_basic_block_t block(const koopa_raw_function_t function, uint32_t index) {
+    EXPECT_EQ(function->bbs.kind, KOOPA_RSIK_BASIC_BLOCK);
+    return static_cast<koopa_raw_basic_block_t>(item(function->bbs, index));
+}
+
+static koopa_raw_function_t only_function(const koopa_raw_program_t &program) {
+    EXPECT_EQ(program.values.len, 0);
+    EXPECT_EQ(program.funcs.len, 1);
+    EXPECT_EQ(program.funcs.kind, KOOPA_RSIK_FUNCTION);
+    return static_cast<koopa_raw_function_t>(item(program.funcs, 0));
+}
+
+static void expect_integer(koopa_raw_value_t raw, int32_t expected) {
+    ASSERT_EQ(raw->kind.tag, KOOPA_RVT_INTEGER);
+    EXPECT_EQ(raw->ty->tag, KOOPA_RTT_INT32);
+    EXPECT_EQ(raw->kind.data.integer.value, expected);
+}
+
+// int a = 6; a = a + 1; return a;
+TEST(koopa_raw_builder, keeps_source_names_of_allocas) {
+    auto ast = program(items(
+            var_def("a", arith(term(num(6)))),
+            assign("a", arith(add(term(var("a")), "+", mul(nullptr, "", num(1))))),
+            ret(arith(term(var("a"))))));
+    auto module = IrGenerator().generate(ast.get());
+    KoopaRawBuilder builder;
+
+    auto main = only_function(builder.build(*module));
+
+    EXPECT_STREQ(main->name, "@main");
+    ASSERT_EQ(main->ty->tag, KOOPA_RTT_FUNCTION);
+    EXPECT_EQ(main->ty->data.function.params.len, 0);
+    EXPECT_EQ(main->ty->data.function.ret->tag, KOOPA_RTT_INT32);
+    ASSERT_EQ(main->bbs.len, 1);
+    auto entry = block(main, 0);
+    EXPECT_STREQ(entry->name, "%entry");
+    EXPECT_EQ(entry->params.len, 0);
+
+    auto alloc = value(entry->insts, 0);
+    ASSERT_EQ(alloc->kind.tag, KOOPA_RVT_ALLOC);
+    EXPECT_STREQ(alloc->name, "@a");
+    ASSERT_EQ(alloc->ty->tag, KOOPA_RTT_POINTER);
+    EXPECT_EQ(alloc->ty->data.pointer.base->tag, KOOPA_RTT_INT32);
+
+    auto store = value(entry->insts, 1);
+    ASSERT_EQ(store->kind.tag, KOOPA_RVT_STORE);
+    EXPECT_EQ(store->ty->tag, KOOPA_RTT_UNIT);
+    expect_integer(store->kind.data.store.value, 6);
+    EXPECT_EQ(store->kind.data.store.dest, alloc);
+
+    auto load = value(entry->insts, 2);
+    ASSERT_EQ(load->kind.tag, KOOPA_RVT_LOAD);
+    EXPECT_EQ(load->kind.data.load.src, alloc);
+    EXPECT_EQ(load->name, nullptr);
+
+    auto add = value(entry->insts, 3);
+    ASSERT_EQ(add->kind.tag, KOOPA_RVT_BINARY);
+    EXPECT_EQ(add->kind.data.binary.op, KOOPA_RBO_ADD);
+    EXPECT_EQ(add->kind.data.binary.lhs, load);
+    expect_integer(add->kind.data.binary.rhs, 1);
+
+    auto ret = value(entry->insts, entry->insts.len - 1);
+    ASSERT_EQ(ret->kind.tag, KOOPA_RVT_RETURN);
+    EXPECT_EQ(ret->kind.data.ret.value->kind.tag, KOOPA_RVT_LOAD);
+}
+
+// i counts from 0 while i + 1 < 10, a phi in the loop header
+static std::unique_ptr<IrModule> counting_loop() {
+    IrFunction function("main");
+    IrBuilder builder(&function);
+    auto entry = function.add_block("entry");
+    auto loop = function.add_block("loop");
+    auto exit = function.add_block("exit");
+    builder.set_block(entry);
+    builder.jump(loop);
+    builder.set_block(loop);
+    auto i = builder.phi();
+    auto next = builder.binary(IR_ADD, i, function.constant(1));
+    function.add_incoming(i, function.constant(0), entry);
+    function.add_incoming(i, next, loop);
+    builder.branch(builder.binary(IR_LT, next, function.constant(10)), loop, exit);
+    builder.set_block(exit);
+    builder.ret(i);
+    auto module = std::make_unique<IrModule>();
+    module->functions.push_back(std::make_unique<IrFunction>(std::move(function)));
+    return module;
+}
+
+TEST(koopa_raw_builder, passes_phis_as_block_arguments) {
+    auto module = counting_loop();
+    KoopaRawBuilder builder;
+
+    auto main = only_function(builder.build(*module));
+
+    ASSERT_EQ(main->bbs.len, 3);
+    auto raw_entry = block(main, 0), raw_loop = block(main, 1), raw_exit = block(main, 2);
+    EXPECT_STREQ(raw_loop->name, "%loop");
+    ASSERT_EQ(raw_loop->params.len, 1);
+    auto parameter = value(raw_loop->params, 0);
+    ASSERT_EQ(parameter->kind.tag, KOOPA_RVT_BLOCK_ARG_REF);
+    EXPECT_EQ(parameter->kind.data.block_arg_ref.index, 0);
+    EXPECT_EQ(parameter->ty->tag, KOOPA_RTT_INT32);
+    EXPECT_EQ(raw_exit->params.len, 0);
+
+    ASSERT_EQ(raw_entry->insts.len, 1);
+    auto jump = value(raw_entry->insts, 0);
+    ASSERT_EQ(jump->kind.tag, KOOPA_RVT_JUMP);
+    EXPECT_EQ(jump->kind.data.jump.target, raw_loop);
+    ASSERT_EQ(jump->kind.data.jump.args.len, 1);
+    expect_integer(value(jump->kind.data.jump.args, 0), 0);
+
+    // the phi itself is not an instruction any more
+    ASSERT_EQ(raw_loop->insts.len, 3);
+    auto add = value(raw_loop->insts, 0);
+    EXPECT_EQ(add->kind.data.binary.lhs, parameter);
+    auto branch = value(raw_loop->insts, 2);
+    ASSERT_EQ(branch->kind.tag, KOOPA_RVT_BRANCH);
+    EXPECT_EQ(branch->kind.data.branch.cond, value(raw_loop->insts, 1));
+    EXPECT_EQ(branch->kind.data.branch.true_bb, raw_loop);
+    EXPECT_EQ(branch->kind.data.branch.false_bb, raw_exit);
+    ASSERT_EQ(branch->kind.data.branch.true_args.len, 1);
+    EXPECT_EQ(value(branch->kind.data.branch.true_args, 0), add);
+    EXPECT_EQ(branch->kind.data.branch.false_args.len, 0);
+
+    auto ret = value(raw_exit->insts, 0);
+    ASSERT_EQ(ret->kind.tag, KOOPA_RVT_RETURN);
+    EXPECT_EQ(ret->kind.data.ret.value, parameter);
+}
+
+// libkoopa takes the raw program, and reads back the text it prints for it
+TEST(koopa_raw_builder, round_trips_through_libkoopa) {
+    auto module = counting_loop();
+    KoopaRawBuilder builder;
+    auto &raw = builder.build(*module);
+
+    koopa_program_t program;
+    ASSERT_EQ(koopa_generate_raw_to_koopa(&raw, &program), KOOPA_EC_SUCCESS);
+    size_t length = 0;
+    ASSERT_EQ(koopa_dump_to_string(program, nullptr, &length), KOOPA_EC_SUCCESS);
+    std::string text(length + 1, '\0');
+    ASSERT_EQ(koopa_dump_to_string(program, &text[0], &length), KOOPA_EC_SUCCESS);
+    koopa_delete_program(program);
+    text.resize(length);
+
+    koopa_program_t parsed;
+    ASSERT_EQ(koopa_parse_from_string(text.c_str(), &parsed), KOOPA_EC_SUCCESS) << text;
+    koopa_delete_program(parsed);
+    EXPECT_NE(text.find("%loop("), std::string::npos) << text;
+    EXPECT_EQ(text.find("phi"), std::string::npos) << text;
+}
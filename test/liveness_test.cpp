@@ -0,0 +1,58 @@
+#include "gtest/gtest.h"
+#include "analysis_cache.h"
+#include "liveness.h"
+
+// entry: a, b; loop: i = phi(0, next), next = i + a; br -> loop | exit; exit: ret i + b
+class LivenessTest : public ::testing::Test {
+protected:
+    IrFunction function{"f"};
+    IrBlockId entry = 0, loop = 0, exit = 0;
+    IrValueId a = 0, b = 0, i = 0, next = 0;
+
+    void SetUp() override {
+        IrBuilder builder(&function);
+        entry = function.add_block("entry");
+        loop = function.add_block("loop");
+        exit = function.add_block("exit");
+        builder.set_block(entry);
+        auto slot = builder.alloca_slot();
+        a = builder.load(slot);
+        b = builder.load(slot);
+        builder.jump(loop);
+        builder.set_block(loop);
+        i = builder.phi();
+        function.add_incoming(i, function.constant(0), entry);
+        next = builder.binary(IR_ADD, i, a);
+        function.add_incoming(i, next, loop);
+        builder.branch(builder.binary(IR_LT, next, function.constant(10)), loop, exit);
+        builder.set_block(exit);
+        builder.ret(builder.binary(IR_ADD, i, b));
+    }
+};
+
+TEST_F(LivenessTest, values_stay_live_around_the_loop) {
+    AnalysisCache analyses(function);
+    auto &liveness = analyses.liveness();
+
+    // a is used in every iteration, b only after the loop but it has to get past it
+    EXPECT_EQ(liveness.live_in(loop), (std::vector<IrValueId>{a, b, i}));
+    EXPECT_EQ(liveness.live_out(entry), (std::vector<IrValueId>{a, b}));
+    EXPECT_EQ(liveness.live_in(exit), (std::vector<IrValueId>{b, i}));
+    EXPECT_TRUE(liveness.is_live_out(loop, i));
+    EXPECT_TRUE(liveness.is_live_out(loop, next));
+    // the phi operand from the back edge is live at the end of the loop, not at its start
+    EXPECT_FALSE(liveness.is_live_in(loop, next));
+    EXPECT_FALSE(liveness.is_live_out(exit, b));
+    EXPECT_TRUE(liveness.live_out(exit).empty());
+}
+
+TEST_F(LivenessTest, is_cached_until_invalidated) {
+    AnalysisCache analyses(function);
+    auto *first = &analyses.liveness();
+    analyses.dominators();
+    EXPECT_EQ(&analyses.liveness(), first);
+
+    analyses.invalidate(ANALYSIS_LIVENESS);
+    EXPECT_FALSE(analyses.cached() & ANALYSIS_LIVENESS);
+    EXPECT_TRUE(analyses.cached() & ANALYSIS_DOMINATORS);
+}
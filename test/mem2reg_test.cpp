@@ -0,0 +1,90 @@
+#include "gtest/gtest.h"
+#include "memory"
+#include "mem2reg.h"
+#include "ir_generator.h"
+#include "ast_builder.h"
+#include "ir_interpreter.h"
+
+static size_t count_opcode(const IrFunction &function, IrOpcode opcode) {
+    size_t count = 0;
+    for (auto block: function.layout) {
+        for (auto inst: function.block_instructions(block)) {
+            count += function[inst].opcode == opcode;
+        }
+    }
+    return count;
+}
+
+TEST(mem2reg, promotes_locals_across_branches) {
+    // int a = 1; int b = 2; if (a < b) { a = 3; } else { b = a + 1; } return a * 10 + b;
+    auto ast = program(items(
+            var_def("a", arith(term(num(1)))),
+            var_def("b", arith(term(num(2)))),
+            if_else(exp(rel(rel(nullptr, "", term(var("a"))), "<", term(var("b")))),
+                    block_statement(items(assign("a", arith(term(num(3)))))),
+                    block_statement(items(assign("b", arith(add(term(var("a")), "+", mul(nullptr, "", num(1)))))))),
+            ret(arith(add(add(nullptr, "", mul(mul(nullptr, "", var("a")), "*", num(10))), "+", mul(nullptr, "", var("b")))))));
+    auto module = IrGenerator().generate(ast.get());
+    auto &function = *module->functions.front();
+    auto expected = ir_interpret(function);
+
+    auto statistics = Mem2Reg().run(function);
+
+    EXPECT_EQ(ir_interpret(function), expected);
+    EXPECT_EQ(expected, 32);
+    EXPECT_EQ(count_opcode(function, IR_LOAD), 0);
+    EXPECT_EQ(count_opcode(function, IR_STORE), 0);
+    EXPECT_EQ(count_opcode(function, IR_ALLOCA), 0);
+    EXPECT_EQ(statistics.allocas_promoted, 2);
+    EXPECT_EQ(statistics.stores_removed, 4);
+    EXPECT_EQ(statistics.loads_removed, 5);
+    // a and b both differ between the arms
+    EXPECT_EQ(statistics.phis_inserted, 2);
+    EXPECT_EQ(count_opcode(function, IR_PHI), 2);
+}
+
+TEST(mem2reg, places_phis_in_loops) {
+    // i = 0; s = 0; do { s = s + i; i = i + 1; } while (i < 5); return s;
+    IrFunction function("f");
+    IrBuilder builder(&function);
+    auto entry = function.add_block("entry");
+    auto loop = function.add_block("loop");
+    auto exit = function.add_block("exit");
+    builder.set_block(entry);
+    auto i = builder.alloca_slot();
+    auto s = builder.alloca_slot();
+    builder.store(function.constant(0), i);
+    builder.store(function.constant(0), s);
+    builder.jump(loop);
+    builder.set_block(loop);
+    builder.store(builder.binary(IR_ADD, builder.load(s), builder.load(i)), s);
+    auto next = builder.binary(IR_ADD, builder.load(i), function.constant(1));
+    builder.store(next, i);
+    builder.branch(builder.binary(IR_LT, builder.load(i), function.constant(5)), loop, exit);
+    builder.set_block(exit);
+    builder.ret(builder.load(s));
+
+    auto statistics = Mem2Reg().run(function);
+
+    EXPECT_EQ(ir_interpret(function), 10);
+    EXPECT_EQ(statistics.phis_inserted, 2);
+    EXPECT_EQ(count_opcode(function, IR_LOAD), 0);
+}
+
+TEST(mem2reg, keeps_slots_whose_address_escapes) {
+    IrFunction function("f");
+    IrBuilder builder(&function);
+    builder.set_block(function.add_block("entry"));
+    auto a = builder.alloca_slot();
+    auto b = builder.alloca_slot();
+    builder.store(function.constant(7), a);
+    // the address of a is stored as a value
+    builder.store(a, b);
+    builder.ret(builder.load(a));
+
+    auto statistics = Mem2Reg().run(function);
+
+    EXPECT_EQ(statistics.allocas_promoted, 1);
+    EXPECT_EQ(count_opcode(function, IR_LOAD), 1);
+    EXPECT_EQ(ir_interpret(function), 7);
+}
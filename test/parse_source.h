@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdio>
+#include <memory>
+#include <string>
+#include "Ast.h"
+
+// The lexer and parser the compiler runs on its input, for tests that start from source.
+
+extern FILE *yyin;
+extern int yylineno;
+extern int yycolumn;
+
+void yyrestart(FILE *file);
+
+int yyparse(std::unique_ptr<BaseAST> &ast);
+
+// the AST of `source`, or nullptr on a syntax error
+inline std::unique_ptr<BaseAST> parse_source(const std::string &source) {
+    auto file = fmemopen(const_cast<char *>(source.data()), source.size(), "r");
+    yyrestart(file);
+    yylineno = 1;
+    yycolumn = 1;
+    std::unique_ptr<BaseAST> ast;
+    auto result = yyparse(ast);
+    fclose(file);
+    return result == 0 ? std::move(ast) : nullptr;
+}
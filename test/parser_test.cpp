@@ -0,0 +1,47 @@
+#include "gtest/gtest.h"
+#include "ir_generator.h"
+#include "parse_source.h"
+#include "ir_interpreter.h"
+#include "scope_index.h"
+
+TEST(parser, keeps_every_definition_of_a_declaration) {
+    auto ast = parse_source("int main() {\n"
+                            "  const int a = 1, b = 2, c = 4;\n"
+                            "  int d = 8, e = 16;\n"
+                            "  return a + b + c + d + e;\n"
+                            "}\n");
+    ASSERT_NE(ast, nullptr);
+
+    auto module = IrGenerator().generate(ast.get());
+
+    // each definition counted once, the first of a list as well
+    EXPECT_EQ(ir_interpret(*module->functions.front()), 31);
+}
+
+TEST(parser, locates_declarations_for_scope_queries) {
+    auto ast = parse_source("int main() {\n"
+                            "    int a = 1;\n"
+                            "    {\n"
+                            "        int bb = 2;\n"
+                            "        int a = 3;\n"
+                            "    }\n"
+                            "    return a;\n"
+                            "}\n");
+    ASSERT_NE(ast, nullptr);
+
+    auto index = ScopeIndex::build(ast.get());
+
+    // bb spans columns 13 and 14 and is in scope right after them
+    EXPECT_EQ(index->visible_at(4, 14).find("bb"), nullptr);
+    auto bb = index->visible_at(4, 15).lookup("bb");
+    ASSERT_NE(bb, nullptr);
+    EXPECT_EQ(bb->location()->start_column(), 13);
+    EXPECT_EQ(bb->location()->end_column(), 14);
+    EXPECT_EQ(index->visible_at(2, 9).size(), 0u);
+    EXPECT_EQ(index->visible_at(2, 10).lookup("a")->location()->start_line(), 2);
+    EXPECT_EQ(index->visible_at(5, 20).lookup("a")->location()->start_line(), 5);
+    // the closing brace at column 5 still belongs to the block
+    EXPECT_NE(index->visible_at(6, 5).find("bb"), nullptr);
+    EXPECT_EQ(index->visible_at(6, 6).find("bb"), nullptr);
+    EXPECT_EQ(index->visible_at(7, 12).lookup("a")->location()->start_line(), 2);
+}
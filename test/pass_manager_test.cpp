@@ -0,0 +1,114 @@
+#include "gtest/gtest.h"
+#include "memory"
+#include "pass_manager.h"
+#include "ir_generator.h"
+#include "koopa_raw_builder.h"
+#include "ast_builder.h"
+#include "ir_interpreter.h"
+
+// int a = 6; int b = a * 4; if (a < b) { a = b / 2; } else { a = a + 1; } return a - 1;
+static std::unique_ptr<IrModule> generate() {
+    auto ast = program(items(
+            var_def("a", arith(term(num(6)))),
+            var_def("b", arith(add(nullptr, "", mul(mul(nullptr, "", var("a")), "*", num(4))))),
+            if_else(exp(rel(rel(nullptr, "", term(var("a"))), "<", term(var("b")))),
+                    block_statement(items(assign("a", arith(add(nullptr, "", mul(mul(nullptr, "", var("b")), "/", num(2))))))),
+                    block_statement(items(assign("a", arith(add(term(var("a")), "+", mul(nullptr, "", num(1)))))))),
+            ret(arith(add(term(var("a")), "-", mul(nullptr, "", num(1)))))));
+    return IrGenerator().generate(ast.get());
+}
+
+// records what was cached when it ran, and changes the function only if asked to
+class ProbePass : public Pass {
+public:
+    int required_analyses;
+    int preserved_analyses;
+    bool changes;
+    int cached_before = -1;
+
+    ProbePass(int required_analyses, int preserved_analyses, bool changes)
+            : required_analyses(required_analyses), preserved_analyses(preserved_analyses), changes(changes) {
+    }
+
+    const char *name() const override {
+        return "probe";
+    }
+
+    int required() const override {
+        return required_analyses;
+    }
+
+    int preserved() const override {
+        return preserved_analyses;
+    }
+
+    bool run(AnalysisCache &analyses) override {
+        cached_before = analyses.cached();
+        return changes;
+    }
+};
+
+TEST(pass_manager, pipelines_keep_the_result) {
+    for (int level = 0; level <= 2; level++) {
+        auto module = generate();
+        auto &function = *module->functions.front();
+        auto passes = PassManager::for_level(level, TARGET_KOOPA);
+
+        passes->run(*module);
+
+        EXPECT_EQ(ir_interpret(function), 11) << "-O" << level;
+        EXPECT_EQ(passes->timings().size(), level == 0 ? 0 : level == 1 ? 4 : 7);
+        for (auto &timing: passes->timings()) {
+            EXPECT_EQ(timing.runs, 1) << timing.name;
+            EXPECT_GE(timing.milliseconds, 0) << timing.name;
+        }
+    }
+}
+
+TEST(pass_manager, folds_the_whole_program_at_o1) {
+    auto module = generate();
+    auto passes = PassManager::for_level(1, TARGET_KOOPA);
+
+    passes->run(*module);
+
+    // a single block that returns 11
+    KoopaRawBuilder builder;
+    auto &raw = builder.build(*module);
+    ASSERT_EQ(raw.funcs.len, 1);
+    auto main = static_cast<koopa_raw_function_t>(raw.funcs.buffer[0]);
+    ASSERT_EQ(main->bbs.len, 1);
+    auto entry = static_cast<koopa_raw_basic_block_t>(main->bbs.buffer[0]);
+    ASSERT_EQ(entry->insts.len, 1);
+    auto ret = static_cast<koopa_raw_value_t>(entry->insts.buffer[0]);
+    ASSERT_EQ(ret->kind.tag, KOOPA_RVT_RETURN);
+    ASSERT_EQ(ret->kind.data.ret.value->kind.tag, KOOPA_RVT_INTEGER);
+    EXPECT_EQ(ret->kind.data.ret.value->kind.data.integer.value, 11);
+    // mem2reg and sccp did the work
+    EXPECT_EQ(passes->timings()[0].changes, 1);
+    EXPECT_EQ(passes->timings()[1].changes, 1);
+}
+
+TEST(pass_manager, drops_analyses_a_change_does_not_preserve) {
+    IrFunction function("f");
+    IrBuilder builder(&function);
+    builder.set_block(function.add_block("entry"));
+    builder.ret(function.constant(0));
+
+    PassManager passes;
+    auto first = std::make_unique<ProbePass>(ANALYSIS_DOMINATORS | ANALYSIS_LIVENESS, ANALYSIS_CFG, true);
+    auto unchanged = std::make_unique<ProbePass>(0, 0, false);
+    auto last = std::make_unique<ProbePass>(0, 0, false);
+    auto *first_probe = first.get(), *unchanged_probe = unchanged.get(), *last_probe = last.get();
+    passes.add(std::move(first));
+    passes.add(std::move(unchanged));
+    passes.add(std::move(last));
+
+    passes.run(function);
+
+    EXPECT_EQ(first_probe->cached_before, ANALYSIS_CFG | ANALYSIS_DOMINATORS | ANALYSIS_LIVENESS);
+    // the change kept only the CFG, and a pass that changed nothing drops nothing
+    EXPECT_EQ(unchanged_probe->cached_before, ANALYSIS_CFG);
+    EXPECT_EQ(last_probe->cached_before, ANALYSIS_CFG);
+    EXPECT_EQ(passes.timings()[0].changes, 1);
+    EXPECT_EQ(passes.timings()[1].changes, 0);
+}
@@ -0,0 +1,134 @@
+#include "gtest/gtest.h"
+#include "peephole.h"
+#include "riscv_writer.h"
+#include "riscv_interpreter.h"
+
+// a function of one block, or more when blocks are asked for by the instructions
+class PeepholeTest : public ::testing::Test {
+protected:
+    MachineFunction function = MachineFunction("main");
+
+    void SetUp() override {
+        function.add_block("entry");
+    }
+
+    MachineInstruction &emit(RiscvOpcode opcode, MachineRegister rd = RV_ZERO, MachineRegister rs1 = RV_ZERO,
+                             MachineRegister rs2 = RV_ZERO, int32_t imm = 0) {
+        MachineInstruction inst;
+        inst.opcode = opcode;
+        inst.rd = rd;
+        inst.rs1 = rs1;
+        inst.rs2 = rs2;
+        inst.imm = imm;
+        auto &instructions = function.blocks.back().instructions;
+        instructions.push_back(inst);
+        return instructions.back();
+    }
+
+    size_t size(MachineBlockId block = 0) const {
+        return function.blocks[block].instructions.size();
+    }
+
+    // runs the pass, checking it keeps the result
+    PeepholeStatistics run() {
+        auto expected = riscv_interpret(function);
+        EXPECT_TRUE(expected.has_value());
+        auto statistics = Peephole().run(function);
+        EXPECT_EQ(riscv_interpret(function), expected) << RiscvWriter::dump(function);
+        return statistics;
+    }
+};
+
+TEST_F(PeepholeTest, removes_redundant_moves) {
+    emit(RV_LI, RV_T0, RV_ZERO, RV_ZERO, 7);
+    emit(RV_MV, RV_T0, RV_T0);
+    emit(RV_MV, RV_A0, RV_T0);
+    emit(RV_MV, RV_T0, RV_A0);
+    emit(RV_RET);
+
+    auto statistics = run();
+
+    EXPECT_EQ(statistics.hits[PEEPHOLE_REDUNDANT_MOVE], 2);
+    EXPECT_EQ(size(), 3);
+}
+
+TEST_F(PeepholeTest, forwards_stores_to_loads) {
+    emit(RV_LI, RV_T0, RV_ZERO, RV_ZERO, 7);
+    emit(RV_SW, RV_ZERO, RV_SP, RV_T0).slot = 0;
+    emit(RV_LW, RV_A0, RV_SP).slot = 0;
+    emit(RV_SW, RV_ZERO, RV_SP, RV_A0, 4).slot = 0;
+    emit(RV_LW, RV_A0, RV_SP, RV_ZERO, 4).slot = 0;
+    // another slot is left alone
+    emit(RV_SW, RV_ZERO, RV_SP, RV_A0).slot = 1;
+    emit(RV_LW, RV_T1, RV_SP).slot = 2;
+    emit(RV_RET);
+    function.add_slot(8);
+    function.add_slot();
+    function.add_slot();
+
+    auto statistics = run();
+
+    EXPECT_EQ(statistics.hits[PEEPHOLE_LOAD_AFTER_STORE], 2);
+    EXPECT_EQ(function.blocks[0].instructions[2].opcode, RV_MV);
+    EXPECT_EQ(size(), 7);
+}
+
+TEST_F(PeepholeTest, turns_adds_of_zero_into_moves) {
+    emit(RV_LI, RV_T0, RV_ZERO, RV_ZERO, 7);
+    emit(RV_ADDI, RV_T1, RV_T0, RV_ZERO, 0);
+    emit(RV_ADD, RV_T2, RV_ZERO, RV_T1);
+    // and a move to itself then goes too
+    emit(RV_ADDI, RV_T2, RV_T2, RV_ZERO, 0);
+    emit(RV_MV, RV_A0, RV_T2);
+    emit(RV_RET);
+
+    auto statistics = run();
+
+    EXPECT_EQ(statistics.hits[PEEPHOLE_ADD_ZERO], 3);
+    EXPECT_EQ(statistics.hits[PEEPHOLE_REDUNDANT_MOVE], 1);
+    EXPECT_EQ(function.blocks[0].instructions[1].opcode, RV_MV);
+}
+
+TEST_F(PeepholeTest, branches_over_jumps_the_other_way) {
+    emit(RV_LI, RV_T0, RV_ZERO, RV_ZERO, 3);
+    emit(RV_BLT, RV_ZERO, RV_T0, RV_ZERO).target = 1;
+    emit(RV_J).target = 2;
+    function.add_block("small");
+    emit(RV_LI, RV_A0, RV_ZERO, RV_ZERO, 1);
+    emit(RV_RET);
+    function.add_block("large");
+    emit(RV_LI, RV_A0, RV_ZERO, RV_ZERO, 2);
+    emit(RV_RET);
+
+    auto statistics = run();
+
+    EXPECT_EQ(statistics.hits[PEEPHOLE_BRANCH_OVER_JUMP], 1);
+    EXPECT_EQ(size(), 2);
+    EXPECT_EQ(function.blocks[0].instructions.back().opcode, RV_BGE);
+    EXPECT_EQ(function.blocks[0].instructions.back().target, 2);
+}
+
+TEST_F(PeepholeTest, folds_constants_into_immediate_forms) {
+    emit(RV_LI, RV_T0, RV_ZERO, RV_ZERO, 40);
+    emit(RV_LI, RV_T1, RV_ZERO, RV_ZERO, 5);
+    emit(RV_SUB, RV_T2, RV_T0, RV_T1);
+    emit(RV_LI, RV_T3, RV_ZERO, RV_ZERO, 12);
+    emit(RV_AND, RV_T2, RV_T3, RV_T2);
+    emit(RV_SLT, RV_T4, RV_T2, RV_T3);
+    emit(RV_ADD, RV_A0, RV_T2, RV_T4);
+    // too large for an immediate
+    emit(RV_LI, RV_T1, RV_ZERO, RV_ZERO, 100000);
+    emit(RV_XOR, RV_A0, RV_A0, RV_T1);
+    emit(RV_RET);
+
+    auto statistics = run();
+
+    // sub, and and slt; the li of 12 stays until slt has read it, and the li of 40 is still read
+    EXPECT_EQ(statistics.hits[PEEPHOLE_FOLD_IMMEDIATE], 3);
+    auto &instructions = function.blocks[0].instructions;
+    EXPECT_EQ(instructions[1].opcode, RV_ADDI);
+    EXPECT_EQ(instructions[1].imm, -5);
+    EXPECT_EQ(instructions[2].opcode, RV_ANDI);
+    EXPECT_EQ(instructions[3].opcode, RV_SLTI);
+    EXPECT_EQ(size(), 8) << RiscvWriter::dump(function);
+}
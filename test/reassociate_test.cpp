@@ -0,0 +1,96 @@
+#include "gtest/gtest.h"
+#include "memory"
+#include "reassociate.h"
+#include "gvn.h"
+#include "ir_interpreter.h"
+
+static size_t count_opcode(const IrFunction &function, IrOpcode opcode) {
+    size_t count = 0;
+    for (auto block: function.layout) {
+        for (auto inst: function.block_instructions(block)) {
+            count += function[inst].opcode == opcode;
+        }
+    }
+    return count;
+}
+
+class ReassociateTest : public ::testing::Test {
+protected:
+    IrFunction function{"f"};
+    IrBuilder builder{&function};
+    IrValueId slot = 0;
+
+    void SetUp() override {
+        builder.set_block(function.add_block("entry"));
+        slot = builder.alloca_slot();
+        builder.store(function.constant(6), slot);
+    }
+
+    // a value the pass cannot see through
+    IrValueId unknown() {
+        return builder.load(slot);
+    }
+};
+
+TEST_F(ReassociateTest, folds_constants_of_left_recursive_chains) {
+    // (a + 1) + 2, ((a - 5) + b) + 5, (a * 0) * b, (a & -1) | 0
+    auto a = unknown();
+    auto b = unknown();
+    auto first = builder.binary(IR_ADD, builder.binary(IR_ADD, a, function.constant(1)), function.constant(2));
+    auto second = builder.binary(IR_ADD, builder.binary(IR_ADD, builder.binary(IR_SUB, a, function.constant(5)), b),
+                                 function.constant(5));
+    auto third = builder.binary(IR_MUL, builder.binary(IR_MUL, a, function.constant(0)), b);
+    auto fourth = builder.binary(IR_OR, builder.binary(IR_AND, a, function.constant(-1)), function.constant(0));
+    auto sum = builder.binary(IR_ADD, builder.binary(IR_MUL, first, second), builder.binary(IR_ADD, third, fourth));
+    builder.ret(sum);
+    auto expected = ir_interpret(function);
+    AnalysisCache analyses(function);
+
+    auto statistics = Reassociate().run(analyses);
+
+    EXPECT_EQ(ir_interpret(function), expected);
+    EXPECT_EQ(expected, 9 * 12 + 6);
+    // the outer sum flattens to a + first * second, a ranking below the product
+    auto result = function.operand(function.terminator(function.entry()), 0);
+    ASSERT_EQ(function[result].opcode, IR_ADD);
+    EXPECT_EQ(function.operand(result, 0), a);
+    // a + 3
+    auto mul = function.operand(result, 1);
+    ASSERT_EQ(function[mul].opcode, IR_MUL);
+    auto folded = function.operand(mul, 0);
+    EXPECT_EQ(function[folded].opcode, IR_ADD);
+    EXPECT_EQ(function.operand(folded, 0), a);
+    EXPECT_TRUE(function.is_constant(function.operand(folded, 1)));
+    EXPECT_EQ(function.constant_value(function.operand(folded, 1)), 3);
+    // a + b with the -5 and the 5 gone
+    auto cancelled = function.operand(mul, 1);
+    EXPECT_EQ(function[cancelled].opcode, IR_ADD);
+    EXPECT_EQ(function.operand(cancelled, 0), a);
+    EXPECT_EQ(function.operand(cancelled, 1), b);
+    EXPECT_EQ(count_opcode(function, IR_SUB), 0);
+    EXPECT_EQ(count_opcode(function, IR_AND), 0);
+    EXPECT_EQ(count_opcode(function, IR_OR), 0);
+    EXPECT_EQ(statistics.constants_folded, 7);
+}
+
+TEST_F(ReassociateTest, sorts_operands_for_value_numbering) {
+    // (b + a) + c and (a + c) + b are the same sum
+    auto a = unknown();
+    auto b = unknown();
+    auto c = unknown();
+    auto first = builder.binary(IR_ADD, builder.binary(IR_ADD, b, a), c);
+    auto second = builder.binary(IR_ADD, builder.binary(IR_ADD, a, c), b);
+    builder.ret(builder.binary(IR_SUB, first, second));
+    AnalysisCache analyses(function);
+
+    auto statistics = Reassociate().run(analyses);
+    auto numbered = Gvn().run(analyses);
+
+    EXPECT_EQ(ir_interpret(function), 0);
+    EXPECT_EQ(statistics.expressions_rewritten, 2);
+    EXPECT_EQ(statistics.constants_folded, 0);
+    EXPECT_EQ(numbered.instructions_eliminated, 2);
+    EXPECT_EQ(count_opcode(function, IR_ADD), 2);
+    auto difference = function.operand(function.terminator(function.entry()), 0);
+    EXPECT_EQ(function.operand(difference, 0), function.operand(difference, 1));
+}
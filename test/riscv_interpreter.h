@@ -0,0 +1,175 @@
+#pragma once
+
+#include <climits>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include "riscv.h"
+
+/**
+ * Runs a MachineFunction, on virtual or physical registers, so tests can check that the
+ * backend keeps the result of the IR. Callee-saved registers start out holding junk that
+ * has to be back at the return, and sp has to be back where it started; nullopt when
+ * that fails, control falls off the last block or the step limit runs out.
+ */
+inline std::optional<int32_t> riscv_interpret(const MachineFunction &function, size_t step_limit = 1000000) {
+    const int32_t stack_top = 0x100000;
+    std::map<MachineRegister, int32_t> registers;
+    // by address, and by slot and offset for stack slots not yet laid out
+    std::map<int32_t, int32_t> memory;
+    std::map<std::pair<int32_t, int32_t>, int32_t> slots;
+    auto junk = [](MachineRegister reg) {
+        return static_cast<int32_t>(0x5a5a0000 + reg);
+    };
+    for (MachineRegister reg = 1; reg < RV_FIRST_VIRTUAL; reg++) {
+        registers[reg] = riscv_is_callee_saved(reg) ? junk(reg) : 0;
+    }
+    registers[RV_SP] = stack_top;
+    auto read = [&](MachineRegister reg) -> int32_t {
+        return reg == RV_ZERO ? 0 : registers[reg];
+    };
+    auto write = [&](MachineRegister reg, int32_t value) {
+        if (reg != RV_ZERO) {
+            registers[reg] = value;
+        }
+    };
+
+    MachineBlockId block = 0;
+    size_t index = 0;
+    for (size_t steps = 0; steps < step_limit; steps++) {
+        auto &instructions = function.blocks[block].instructions;
+        if (index >= instructions.size()) {
+            // falls through, once blocks are laid out
+            if (block + 1 >= function.blocks.size()) {
+                return std::nullopt;
+            }
+            block++;
+            index = 0;
+            continue;
+        }
+        auto &inst = instructions[index++];
+        auto a = read(inst.rs1);
+        auto b = inst.opcode <= RV_SLTU || riscv_format(inst.opcode) == RV_FORMAT_COMPARE_BRANCH ? read(inst.rs2)
+                                                                                                : inst.imm;
+        auto ua = static_cast<uint32_t>(a);
+        auto ub = static_cast<uint32_t>(b);
+        switch (inst.opcode) {
+            case RV_ADD:
+            case RV_ADDI:
+                write(inst.rd, static_cast<int32_t>(ua + ub));
+                break;
+            case RV_SUB:
+                write(inst.rd, static_cast<int32_t>(ua - ub));
+                break;
+            case RV_MUL:
+                write(inst.rd, static_cast<int32_t>(ua * ub));
+                break;
+            case RV_MULH:
+                write(inst.rd, static_cast<int32_t>((static_cast<int64_t>(a) * b) >> 32));
+                break;
+            case RV_DIV:
+                write(inst.rd, b == 0 ? -1 : (a == INT_MIN && b == -1) ? INT_MIN : a / b);
+                break;
+            case RV_REM:
+                write(inst.rd, b == 0 ? a : (a == INT_MIN && b == -1) ? 0 : a % b);
+                break;
+            case RV_AND:
+            case RV_ANDI:
+                write(inst.rd, a & b);
+                break;
+            case RV_OR:
+            case RV_ORI:
+                write(inst.rd, a | b);
+                break;
+            case RV_XOR:
+            case RV_XORI:
+                write(inst.rd, a ^ b);
+                break;
+            case RV_SLL:
+            case RV_SLLI:
+                write(inst.rd, static_cast<int32_t>(ua << (ub & 31)));
+                break;
+            case RV_SRL:
+            case RV_SRLI:
+                write(inst.rd, static_cast<int32_t>(ua >> (ub & 31)));
+                break;
+            case RV_SRA:
+            case RV_SRAI:
+                write(inst.rd, a >> (ub & 31));
+                break;
+            case RV_SLT:
+            case RV_SLTI:
+                write(inst.rd, a < b);
+                break;
+            case RV_SLTU:
+            case RV_SLTIU:
+                write(inst.rd, ua < ub);
+                break;
+            case RV_MV:
+                write(inst.rd, a);
+                break;
+            case RV_NEG:
+                write(inst.rd, static_cast<int32_t>(0u - ua));
+                break;
+            case RV_SEQZ:
+                write(inst.rd, a == 0);
+                break;
+            case RV_SNEZ:
+                write(inst.rd, a != 0);
+                break;
+            case RV_LI:
+                write(inst.rd, inst.imm);
+                break;
+            case RV_LUI:
+                write(inst.rd, static_cast<int32_t>(static_cast<uint32_t>(inst.imm) << 12));
+                break;
+            case RV_LW:
+                if (inst.slot >= 0) {
+                    write(inst.rd, slots[{inst.slot, inst.imm}]);
+                } else {
+                    write(inst.rd, memory[static_cast<int32_t>(ua + static_cast<uint32_t>(inst.imm))]);
+                }
+                break;
+            case RV_SW:
+                if (inst.slot >= 0) {
+                    slots[{inst.slot, inst.imm}] = read(inst.rs2);
+                } else {
+                    memory[static_cast<int32_t>(ua + static_cast<uint32_t>(inst.imm))] = read(inst.rs2);
+                }
+                break;
+            case RV_BNEZ:
+                if (a != 0) {
+                    block = inst.target;
+                    index = 0;
+                }
+                break;
+            case RV_BEQ:
+            case RV_BNE:
+            case RV_BLT:
+            case RV_BGE: {
+                auto taken = inst.opcode == RV_BEQ ? a == b : inst.opcode == RV_BNE ? a != b
+                                                         : inst.opcode == RV_BLT ? a < b : a >= b;
+                if (taken) {
+                    block = inst.target;
+                    index = 0;
+                }
+                break;
+            }
+            case RV_J:
+                block = inst.target;
+                index = 0;
+                break;
+            case RV_RET:
+                if (registers[RV_SP] != stack_top) {
+                    return std::nullopt;
+                }
+                for (MachineRegister reg = 1; reg < RV_FIRST_VIRTUAL; reg++) {
+                    if (riscv_is_callee_saved(reg) && registers[reg] != junk(reg)) {
+                        return std::nullopt;
+                    }
+                }
+                return read(RV_A0);
+        }
+    }
+    return std::nullopt;
+}
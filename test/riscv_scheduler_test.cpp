@@ -0,0 +1,169 @@
+#include "gtest/gtest.h"
+#include <random>
+#include "riscv_backend.h"
+#include "riscv_isel.h"
+#include "riscv_scheduler.h"
+#include "riscv_writer.h"
+#include "machine_liveness.h"
+#include "ir_interpreter.h"
+#include "riscv_interpreter.h"
+
+// sum of a[k] * b[k] for k < count, every element loaded from its own slot
+static IrFunction dot_product(int count) {
+    IrFunction function("main");
+    IrBuilder builder(&function);
+    builder.set_block(function.add_block("entry"));
+    IrValueId sum = function.constant(0);
+    for (int k = 0; k < count; k++) {
+        auto a = builder.alloca_slot();
+        auto b = builder.alloca_slot();
+        builder.store(function.constant(k + 3), a);
+        builder.store(function.constant(2 * k - 7), b);
+        sum = builder.binary(IR_ADD, sum, builder.binary(IR_MUL, builder.load(a), builder.load(b)));
+    }
+    builder.ret(sum);
+    return function;
+}
+
+TEST(riscv_scheduler, hides_load_and_multiply_latency) {
+    auto function = dot_product(4);
+    MachineFunction machine("main");
+    RiscvSelector().run(function, machine);
+
+    auto statistics = RiscvScheduler().run(machine);
+
+    EXPECT_EQ(statistics.blocks_reordered, 1);
+    EXPECT_LT(statistics.stalls_after, statistics.stalls_before);
+    EXPECT_EQ(RiscvScheduler().stalls(machine.blocks[0]), statistics.stalls_after);
+    EXPECT_EQ(riscv_interpret(machine), ir_interpret(function)) << RiscvWriter::dump(machine);
+}
+
+TEST(riscv_scheduler, leaves_blocks_without_stalls_alone) {
+    RiscvLatencyModel single_cycle;
+    single_cycle.load = 1;
+    single_cycle.multiply = 1;
+    single_cycle.divide = 1;
+    auto function = dot_product(4);
+    MachineFunction machine("main");
+    RiscvSelector().run(function, machine);
+    auto original = machine;
+
+    auto statistics = RiscvScheduler(single_cycle).run(machine);
+
+    EXPECT_EQ(statistics.stalls_before, 0);
+    EXPECT_EQ(statistics.blocks_reordered, 0);
+    EXPECT_EQ(RiscvWriter::dump(machine), RiscvWriter::dump(original));
+}
+
+TEST(riscv_scheduler, keeps_register_pressure_in_bounds) {
+    // hoisting all 80 loads would need 80 registers
+    auto function = dot_product(40);
+    MachineFunction machine("main");
+    RiscvSelector().run(function, machine);
+
+    auto statistics = RiscvScheduler().run(machine);
+
+    MachineLiveness liveness(machine);
+    EXPECT_LE(register_pressure(machine.blocks[0].instructions, liveness.live_out(0)),
+              riscv_allocatable_registers().size());
+    EXPECT_EQ(statistics.blocks_kept_for_pressure + statistics.blocks_reordered, 1);
+    EXPECT_EQ(riscv_interpret(machine), ir_interpret(function));
+}
+
+TEST(riscv_scheduler, keeps_dependences) {
+    // random straight-line code over a few slots, before and after both allocators
+    const IrOpcode opcodes[] = {IR_ADD, IR_SUB, IR_MUL, IR_DIV, IR_REM, IR_XOR, IR_LT};
+    std::mt19937 random(7);
+    int checked = 0;
+    for (int round = 0; round < 50; round++) {
+        IrFunction function("main");
+        IrBuilder builder(&function);
+        builder.set_block(function.add_block("entry"));
+        std::vector<IrValueId> slots;
+        std::vector<IrValueId> values;
+        for (int k = 0; k < 4; k++) {
+            slots.push_back(builder.alloca_slot());
+            builder.store(function.constant(static_cast<int32_t>(random() % 200) - 100), slots.back());
+        }
+        for (int k = 0; k < 40; k++) {
+            auto slot = slots[random() % slots.size()];
+            switch (random() % 3) {
+                case 0:
+                    values.push_back(builder.load(slot));
+                    break;
+                case 1:
+                    if (!values.empty()) {
+                        builder.store(values[random() % values.size()], slot);
+                    }
+                    break;
+                default:
+                    if (!values.empty()) {
+                        auto lhs = values[random() % values.size()];
+                        auto rhs = values[random() % values.size()];
+                        values.push_back(builder.binary(opcodes[random() % 7], lhs, rhs));
+                    }
+                    break;
+            }
+        }
+        auto result = builder.load(slots[0]);
+        for (auto value: values) {
+            result = builder.binary(IR_XOR, result, value);
+        }
+        builder.ret(result);
+        auto expected = ir_interpret(function);
+        if (!expected.has_value()) {
+            // divided by zero
+            continue;
+        }
+        checked++;
+
+        for (int level = 1; level <= 2; level++) {
+            MachineFunction machine("main");
+            RiscvBackend(level).generate(function, machine);
+            ASSERT_EQ(riscv_interpret(machine), expected) << "round " << round << " -O" << level << "\n"
+                                                          << RiscvWriter::dump(machine);
+        }
+    }
+    EXPECT_GT(checked, 20);
+}
+
+TEST(riscv_scheduler, keeps_physical_register_writes_in_place) {
+    // d = a / b; store d * 2 + d * 3 + ... + d * 8; return 1, where the li into a0 could
+    // fill the stall of the div, and more products are live at once than there are
+    // temporaries
+    IrFunction function("main");
+    IrBuilder builder(&function);
+    auto entry = function.add_block("entry");
+    auto body = function.add_block("body");
+    builder.set_block(entry);
+    auto a = builder.alloca_slot();
+    auto b = builder.alloca_slot();
+    builder.store(function.constant(91), a);
+    builder.store(function.constant(7), b);
+    builder.jump(body);
+    builder.set_block(body);
+    auto quotient = builder.binary(IR_DIV, builder.load(a), builder.load(b));
+    std::vector<IrValueId> products;
+    for (int k = 2; k <= 8; k++) {
+        products.push_back(builder.binary(IR_MUL, quotient, function.constant(k)));
+    }
+    auto sum = products[0];
+    for (size_t k = 1; k < products.size(); k++) {
+        sum = builder.binary(IR_ADD, sum, products[k]);
+    }
+    builder.store(sum, a);
+    builder.ret(function.constant(1));
+
+    MachineFunction selected("main");
+    RiscvSelector().run(function, selected);
+    RiscvScheduler().run(selected);
+    auto &instructions = selected.blocks[1].instructions;
+    ASSERT_GE(instructions.size(), 2);
+    auto &last = instructions[instructions.size() - 2];
+    EXPECT_EQ(last.opcode, RV_LI) << RiscvWriter::dump(selected);
+    EXPECT_EQ(last.rd, RV_A0);
+
+    MachineFunction machine("main");
+    RiscvBackend(1).generate(function, machine);
+    EXPECT_EQ(riscv_interpret(machine), 1) << RiscvWriter::dump(machine);
+}
@@ -0,0 +1,278 @@
+#include "gtest/gtest.h"
+#include <climits>
+#include "memory"
+#include "riscv_backend.h"
+#include "riscv_frame.h"
+#include "linear_scan.h"
+#include "riscv_isel.h"
+#include "riscv_writer.h"
+#include "ir_interpreter.h"
+#include "riscv_interpreter.h"
+
+// compiles `function` and checks the machine code against the IR
+static void expect_same_result(const IrFunction &function, MachineFunction &machine) {
+    auto expected = ir_interpret(function);
+    ASSERT_TRUE(expected.has_value());
+    RiscvBackend().generate(function, machine);
+    EXPECT_EQ(riscv_interpret(machine), expected) << RiscvWriter::dump(machine);
+}
+
+static size_t count_virtual(const MachineFunction &function) {
+    size_t count = 0;
+    for (auto &block: function.blocks) {
+        for (auto &inst: block.instructions) {
+            MachineRegister uses[2];
+            auto use_count = riscv_uses(inst, uses);
+            for (int i = 0; i < use_count; i++) {
+                count += riscv_is_virtual(uses[i]);
+            }
+            count += riscv_has_def(inst.opcode) && riscv_is_virtual(inst.rd);
+        }
+    }
+    return count;
+}
+
+TEST(riscv, selects_every_operator) {
+    const IrOpcode opcodes[] = {IR_ADD, IR_SUB, IR_MUL, IR_MULH, IR_DIV, IR_REM, IR_AND, IR_OR, IR_XOR,
+                                IR_SHL, IR_SHR, IR_SAR, IR_EQ, IR_NE, IR_LT, IR_GT, IR_LE, IR_GE};
+    const int32_t values[] = {0, 1, -1, 7, -9, 2047, 2048, -2048, -2049, 100000, INT_MIN, INT_MAX};
+    for (auto opcode: opcodes) {
+        for (auto x: values) {
+            for (auto y: values) {
+                int32_t folded;
+                if (!ir_evaluate(opcode, x, y, folded)) {
+                    continue;
+                }
+                // both operands in registers, and each of them a constant in turn
+                for (int shape = 0; shape < 3; shape++) {
+                    IrFunction function("main");
+                    IrBuilder builder(&function);
+                    builder.set_block(function.add_block("entry"));
+                    auto a = builder.alloca_slot();
+                    auto b = builder.alloca_slot();
+                    builder.store(function.constant(x), a);
+                    builder.store(function.constant(y), b);
+                    auto lhs = shape == 1 ? function.constant(x) : builder.load(a);
+                    auto rhs = shape == 2 ? function.constant(y) : builder.load(b);
+                    builder.ret(builder.binary(opcode, lhs, rhs));
+
+                    // by linear scan and by graph colouring
+                    for (int level = 1; level <= 2; level++) {
+                        MachineFunction machine("main");
+                        RiscvBackend(level).generate(function, machine);
+                        ASSERT_EQ(riscv_interpret(machine), folded)
+                                                    << ir_opcode_name(opcode) << " " << x << ", " << y << " shape "
+                                                    << shape << " -O" << level << "\n" << RiscvWriter::dump(machine);
+                    }
+                }
+            }
+        }
+    }
+}
+
+TEST(riscv, swaps_phis_through_a_temporary) {
+    // a, b = 1, 2; do { a, b = b, a; i++ } while (i < 5); return a * 10 + b
+    IrFunction function("main");
+    IrBuilder builder(&function);
+    auto entry = function.add_block("entry");
+    auto loop = function.add_block("loop");
+    auto exit = function.add_block("exit");
+    builder.set_block(entry);
+    builder.jump(loop);
+    builder.set_block(loop);
+    auto a = builder.phi();
+    auto b = builder.phi();
+    auto i = builder.phi();
+    auto next = builder.binary(IR_ADD, i, function.constant(1));
+    function.add_incoming(a, function.constant(1), entry);
+    function.add_incoming(a, b, loop);
+    function.add_incoming(b, function.constant(2), entry);
+    function.add_incoming(b, a, loop);
+    function.add_incoming(i, function.constant(0), entry);
+    function.add_incoming(i, next, loop);
+    builder.branch(builder.binary(IR_LT, next, function.constant(5)), loop, exit);
+    builder.set_block(exit);
+    builder.ret(builder.binary(IR_ADD, builder.binary(IR_MUL, a, function.constant(10)), b));
+
+    MachineFunction machine("main");
+    auto statistics = RiscvSelector().run(function, machine);
+
+    EXPECT_EQ(statistics.edges_split, 1);
+    // three copies on each edge in, and one more to break the swap
+    EXPECT_EQ(statistics.phi_copies, 7);
+    EXPECT_EQ(riscv_interpret(machine), ir_interpret(function));
+}
+
+TEST(riscv, fuses_comparisons_into_branches) {
+    const IrOpcode opcodes[] = {IR_EQ, IR_NE, IR_LT, IR_GT, IR_LE, IR_GE};
+    const int32_t values[] = {-5, 0, 3, INT_MIN};
+    for (auto opcode: opcodes) {
+        for (auto x: values) {
+            for (auto y: values) {
+                // if (x op y) return 1; else return 2; and the same keeping the comparison too
+                for (int kept = 0; kept < 2; kept++) {
+                    IrFunction function("main");
+                    IrBuilder builder(&function);
+                    auto entry = function.add_block("entry");
+                    auto then = function.add_block("then");
+                    auto otherwise = function.add_block("otherwise");
+                    builder.set_block(entry);
+                    auto a = builder.alloca_slot();
+                    builder.store(function.constant(x), a);
+                    auto condition = builder.binary(opcode, builder.load(a), function.constant(y));
+                    builder.branch(condition, then, otherwise);
+                    builder.set_block(then);
+                    builder.ret(kept ? condition : function.constant(1));
+                    builder.set_block(otherwise);
+                    builder.ret(function.constant(2));
+
+                    MachineFunction machine("main");
+                    auto statistics = RiscvSelector().run(function, machine);
+
+                    EXPECT_EQ(statistics.branches_fused, kept ? 0 : 1);
+                    for (auto &inst: machine.blocks[0].instructions) {
+                        EXPECT_TRUE(kept || riscv_is_terminator(inst.opcode) || inst.opcode == RV_LI
+                                    || inst.opcode == RV_LW || inst.opcode == RV_SW)
+                                            << RiscvWriter::dump(machine);
+                    }
+                    ASSERT_EQ(riscv_interpret(machine), ir_interpret(function))
+                                                << ir_opcode_name(opcode) << " " << x << ", " << y;
+                }
+            }
+        }
+    }
+}
+
+TEST(riscv, spills_when_registers_run_out) {
+    // 40 values, all live until they are summed up at the end
+    IrFunction function("main");
+    IrBuilder builder(&function);
+    builder.set_block(function.add_block("entry"));
+    std::vector<IrValueId> values;
+    for (int k = 0; k < 40; k++) {
+        auto slot = builder.alloca_slot();
+        builder.store(function.constant(k * k - 300), slot);
+        values.push_back(builder.load(slot));
+    }
+    auto sum = values.back();
+    for (int k = 38; k >= 0; k--) {
+        sum = builder.binary(k % 3 == 0 ? IR_SUB : IR_ADD, values[k], sum);
+    }
+    builder.ret(sum);
+
+    MachineFunction machine("main");
+    expect_same_result(function, machine);
+    EXPECT_EQ(count_virtual(machine), 0);
+    EXPECT_EQ(machine.frame_size % 16, 0);
+}
+
+TEST(riscv, reaches_slots_beyond_twelve_bit_offsets) {
+    IrFunction function("main");
+    IrBuilder builder(&function);
+    auto entry = function.add_block("entry");
+    auto sum_up = function.add_block("sum");
+    builder.set_block(entry);
+    std::vector<IrValueId> slots;
+    for (int k = 0; k < 600; k++) {
+        slots.push_back(builder.alloca_slot());
+        builder.store(function.constant(k), slots.back());
+    }
+    // every slot is read once all are written, out of the scheduler's reach, so none can share
+    builder.jump(sum_up);
+    builder.set_block(sum_up);
+    auto sum = builder.load(slots.front());
+    for (int k = 1; k < 600; k++) {
+        sum = builder.binary(IR_ADD, sum, builder.load(slots[k]));
+    }
+    builder.ret(sum);
+
+    MachineFunction machine("main");
+    expect_same_result(function, machine);
+    EXPECT_GT(machine.frame_size, 2047);
+}
+
+TEST(riscv, shares_slots_with_disjoint_lifetimes) {
+    // a = 5; b = a + 1; { c = b * 2; } d = b + 1 with c never read; return d
+    IrFunction function("main");
+    IrBuilder builder(&function);
+    builder.set_block(function.add_block("entry"));
+    auto a = builder.alloca_slot();
+    auto b = builder.alloca_slot();
+    auto c = builder.alloca_slot();
+    auto d = builder.alloca_slot();
+    builder.store(function.constant(5), a);
+    builder.store(builder.binary(IR_ADD, builder.load(a), function.constant(1)), b);
+    auto loaded = builder.load(b);
+    builder.store(builder.binary(IR_MUL, loaded, function.constant(2)), c);
+    builder.store(builder.binary(IR_ADD, loaded, function.constant(1)), d);
+    builder.ret(builder.load(d));
+    auto expected = ir_interpret(function);
+
+    MachineFunction machine("main");
+    RiscvSelector().run(function, machine);
+    LinearScan().run(machine);
+    auto statistics = lower_frame(machine);
+
+    // b goes where a was, and d where b was
+    EXPECT_EQ(statistics.slots_dropped, 1);
+    EXPECT_EQ(statistics.slots_shared, 2);
+    EXPECT_EQ(machine.slots[1].offset, machine.slots[0].offset);
+    EXPECT_EQ(machine.slots[3].offset, machine.slots[0].offset);
+    EXPECT_EQ(machine.frame_size, 16);
+    EXPECT_EQ(riscv_interpret(machine), expected) << RiscvWriter::dump(machine);
+}
+
+TEST(riscv, leaves_leaf_functions_without_a_frame) {
+    // int x = 3; return 4; the slot is never read
+    IrFunction function("main");
+    IrBuilder builder(&function);
+    builder.set_block(function.add_block("entry"));
+    builder.store(function.constant(3), builder.alloca_slot());
+    builder.ret(function.constant(4));
+
+    MachineFunction machine("main");
+    expect_same_result(function, machine);
+    EXPECT_EQ(machine.frame_size, 0);
+    for (auto &inst: machine.blocks[0].instructions) {
+        EXPECT_FALSE(inst.rd == RV_SP || inst.rs1 == RV_SP) << RiscvWriter::dump(machine);
+    }
+}
+
+TEST(riscv, writes_assembly) {
+    IrFunction function("main");
+    IrBuilder builder(&function);
+    auto entry = function.add_block("entry");
+    auto then = function.add_block("then");
+    auto end = function.add_block("end");
+    builder.set_block(entry);
+    auto slot = builder.alloca_slot();
+    auto x = builder.load(slot);
+    builder.branch(x, then, end);
+    builder.set_block(then);
+    builder.jump(end);
+    builder.set_block(end);
+    builder.ret(function.constant(3));
+    IrModule module;
+    module.functions.push_back(std::make_unique<IrFunction>(std::move(function)));
+
+    std::string text;
+    {
+        // without block layout, which would leave no jump to print
+        BufferedWriter out(&text);
+        RiscvWriter().write(*RiscvBackend(0).generate(module), out);
+    }
+
+    EXPECT_EQ(text, "  .text\n"
+                    "  .globl main\n"
+                    "main:\n"
+                    "  addi sp, sp, -16\n"
+                    "  lw t0, 0(sp)\n"
+                    "  bnez t0, .Lmain_then\n"
+                    "  j .Lmain_end\n"
+                    ".Lmain_then:\n"
+                    "  j .Lmain_end\n"
+                    ".Lmain_end:\n"
+                    "  li a0, 3\n"
+                    "  addi sp, sp, 16\n"
+                    "  ret\n");
+}
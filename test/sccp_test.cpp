@@ -0,0 +1,143 @@
+#include "gtest/gtest.h"
+#include "memory"
+#include "sccp.h"
+#include "simplify_cfg.h"
+#include "mem2reg.h"
+#include "ir_generator.h"
+#include "ast_builder.h"
+#include "ir_interpreter.h"
+
+static size_t count_opcode(const IrFunction &function, IrOpcode opcode) {
+    size_t count = 0;
+    for (auto block: function.layout) {
+        for (auto inst: function.block_instructions(block)) {
+            count += function[inst].opcode == opcode;
+        }
+    }
+    return count;
+}
+
+TEST(sccp, removes_arm_never_taken) {
+    // int a = 1; if (1 > 3) { a = 2; } else { a = a + 2; } return a;
+    auto ast = program(items(
+            var_def("a", arith(term(num(1)))),
+            if_else(exp(rel(rel(nullptr, "", term(num(1))), ">", term(num(3)))),
+                    block_statement(items(assign("a", arith(term(num(2)))))),
+                    block_statement(items(assign("a", arith(add(term(var("a")), "+", mul(nullptr, "", num(2)))))))),
+            ret(arith(term(var("a"))))));
+    auto module = IrGenerator().generate(ast.get());
+    auto &function = *module->functions.front();
+    Mem2Reg().run(function);
+    AnalysisCache analyses(function);
+
+    auto statistics = Sccp().run(analyses);
+
+    EXPECT_EQ(ir_interpret(function), 3);
+    EXPECT_EQ(statistics.branches_folded, 1);
+    EXPECT_EQ(statistics.blocks_removed, 1);
+    EXPECT_EQ(count_opcode(function, IR_BR), 0);
+    EXPECT_EQ(count_opcode(function, IR_PHI), 0);
+    EXPECT_EQ(analyses.cached(), 0);
+
+    auto simplified = SimplifyCfg().run(analyses);
+
+    EXPECT_EQ(ir_interpret(function), 3);
+    EXPECT_EQ(simplified.blocks_merged, 2);
+    EXPECT_EQ(function.layout.size(), 1);
+}
+
+TEST(sccp, propagates_through_phis) {
+    // entry: br x, then, else; both arms feed 7 into a phi; loop: i = phi(0, i + 1) stays variable
+    IrFunction function("f");
+    IrBuilder builder(&function);
+    auto entry = function.add_block("entry");
+    auto then_block = function.add_block("then");
+    auto else_block = function.add_block("else");
+    auto end = function.add_block("end");
+    builder.set_block(entry);
+    auto slot = builder.alloca_slot();
+    builder.store(function.constant(5), slot);
+    auto unknown = builder.load(slot);
+    builder.branch(unknown, then_block, else_block);
+    builder.set_block(then_block);
+    auto three = builder.binary(IR_ADD, function.constant(1), function.constant(2));
+    auto seven = builder.binary(IR_ADD, three, function.constant(4));
+    builder.jump(end);
+    builder.set_block(else_block);
+    builder.jump(end);
+    builder.set_block(end);
+    auto merged = builder.phi();
+    function.add_incoming(merged, seven, then_block);
+    function.add_incoming(merged, function.constant(7), else_block);
+    auto result = builder.binary(IR_MUL, merged, function.constant(6));
+    auto tested = builder.binary(IR_EQ, result, function.constant(42));
+    auto done = function.add_block("done");
+    auto never = function.add_block("never");
+    builder.branch(tested, done, never);
+    builder.set_block(never);
+    builder.ret(function.constant(0));
+    builder.set_block(done);
+    builder.ret(result);
+    AnalysisCache analyses(function);
+
+    auto statistics = Sccp().run(analyses);
+
+    EXPECT_EQ(ir_interpret(function), 42);
+    // three, seven, the phi, the product and the comparison
+    EXPECT_EQ(statistics.constants_found, 5);
+    EXPECT_EQ(statistics.branches_folded, 1);
+    EXPECT_EQ(statistics.blocks_removed, 1);
+    EXPECT_EQ(count_opcode(function, IR_PHI), 0);
+    // the unknown condition keeps both arms
+    EXPECT_EQ(count_opcode(function, IR_BR), 1);
+    auto exit = function.layout.back();
+    auto ret = function.terminator(exit);
+    ASSERT_EQ(function[ret].opcode, IR_RET);
+    EXPECT_TRUE(function.is_constant(function.operand(ret, 0)));
+    EXPECT_EQ(function.constant_value(function.operand(ret, 0)), 42);
+}
+
+TEST(simplify_cfg, merges_straight_line_blocks) {
+    // a chain of jumps with a phi at the end of a diamond
+    IrFunction function("f");
+    IrBuilder builder(&function);
+    auto entry = function.add_block("entry");
+    auto first = function.add_block("first");
+    auto second = function.add_block("second");
+    auto other = function.add_block("other");
+    auto end = function.add_block("end");
+    builder.set_block(entry);
+    auto slot = builder.alloca_slot();
+    builder.store(function.constant(1), slot);
+    auto condition = builder.load(slot);
+    builder.branch(condition, first, other);
+    builder.set_block(first);
+    auto doubled = builder.binary(IR_ADD, condition, condition);
+    builder.jump(second);
+    builder.set_block(second);
+    auto single = builder.phi();
+    function.add_incoming(single, doubled, first);
+    auto value = builder.binary(IR_ADD, single, function.constant(10));
+    builder.jump(end);
+    builder.set_block(other);
+    builder.branch(condition, end, end);
+    builder.set_block(end);
+    auto merged = builder.phi();
+    function.add_incoming(merged, value, second);
+    function.add_incoming(merged, function.constant(0), other);
+    builder.ret(merged);
+    AnalysisCache analyses(function);
+    analyses.dominators();
+
+    auto statistics = SimplifyCfg().run(analyses);
+
+    EXPECT_EQ(ir_interpret(function), 12);
+    EXPECT_EQ(statistics.blocks_merged, 1);
+    EXPECT_EQ(statistics.branches_simplified, 1);
+    EXPECT_EQ(statistics.blocks_removed, 0);
+    EXPECT_EQ(function.layout.size(), 4);
+    EXPECT_TRUE(function.blocks[second].removed);
+    // the phi in end now names the merged block
+    EXPECT_EQ(function.incoming_block(merged, 0), first);
+    EXPECT_EQ(analyses.cached(), 0);
+}
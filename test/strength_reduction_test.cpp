@@ -0,0 +1,168 @@
+#include "gtest/gtest.h"
+#include <climits>
+#include <random>
+#include <vector>
+#include "strength_reduction.h"
+
+// y = x op constant in a single block, with x a load standing for an unknown input
+struct ReducedFunction {
+    IrFunction function{"f"};
+    IrValueId input = 0;
+
+    StrengthReductionStatistics reduce(IrOpcode opcode, int32_t constant, bool multiply_high = true) {
+        IrBuilder builder(&function);
+        builder.set_block(function.add_block("entry"));
+        input = builder.load(builder.alloca_slot());
+        builder.ret(builder.binary(opcode, input, function.constant(constant)));
+        AnalysisCache analyses(function);
+        return StrengthReduction(multiply_high).run(analyses);
+    }
+
+    // runs the block for one input; far faster than the interpreter for millions of runs
+    int32_t evaluate(int32_t x) {
+        std::vector<int32_t> values(function.instructions.size(), 0);
+        auto value_of = [&](IrValueId value) {
+            return function.is_constant(value) ? function.constant_value(value) : values[value];
+        };
+        for (auto inst = function.blocks[function.entry()].first; inst != 0; inst = function[inst].next) {
+            auto &record = function[inst];
+            if (inst == input) {
+                values[inst] = x;
+            } else if (ir_is_binary(record.opcode)) {
+                EXPECT_TRUE(ir_evaluate(record.opcode, value_of(function.operand(inst, 0)),
+                                        value_of(function.operand(inst, 1)), values[inst]));
+            } else if (record.opcode == IR_RET) {
+                return value_of(function.operand(inst, 0));
+            }
+        }
+        return 0;
+    }
+
+    size_t count(IrOpcode opcode) {
+        size_t result = 0;
+        for (auto inst: function.block_instructions(function.entry())) {
+            result += function[inst].opcode == opcode;
+        }
+        return result;
+    }
+};
+
+// every small constant, every power of two and its neighbours, the extremes and random ones
+static std::vector<int32_t> sample_constants() {
+    std::vector<int32_t> constants;
+    for (int32_t c = -1100; c <= 1100; c++) {
+        constants.push_back(c);
+    }
+    for (int k = 10; k < 32; k++) {
+        auto power = static_cast<int32_t>(1u << k);
+        for (auto c: {power - 1, power, power + 1}) {
+            constants.push_back(c);
+            constants.push_back(static_cast<int32_t>(0u - static_cast<uint32_t>(c)));
+        }
+    }
+    constants.push_back(INT_MAX);
+    std::mt19937 random(39);
+    for (int i = 0; i < 200; i++) {
+        constants.push_back(static_cast<int32_t>(random()));
+    }
+    return constants;
+}
+
+static std::vector<int32_t> sample_inputs(int32_t constant) {
+    std::vector<int32_t> inputs = {0, 1, -1, 2, -2, INT_MAX, INT_MIN, INT_MAX - 1, INT_MIN + 1};
+    for (int32_t m = -3; m <= 3; m++) {
+        // around multiples of the constant, where rounding goes wrong first
+        auto multiple = static_cast<int32_t>(static_cast<uint32_t>(constant) * static_cast<uint32_t>(m));
+        for (int32_t delta = -1; delta <= 1; delta++) {
+            inputs.push_back(static_cast<int32_t>(static_cast<uint32_t>(multiple) + static_cast<uint32_t>(delta)));
+        }
+    }
+    std::mt19937 random(static_cast<uint32_t>(constant));
+    for (int i = 0; i < 40; i++) {
+        inputs.push_back(static_cast<int32_t>(random()));
+        inputs.push_back(static_cast<int32_t>(random()) >> (i % 31));
+    }
+    return inputs;
+}
+
+static void verify(IrOpcode opcode) {
+    size_t reduced = 0;
+    for (auto constant: sample_constants()) {
+        if (constant == 0 && opcode != IR_MUL) {
+            continue;
+        }
+        ReducedFunction test;
+        auto statistics = test.reduce(opcode, constant);
+        reduced += statistics.multiplies_reduced + statistics.divisions_reduced + statistics.remainders_reduced;
+        for (auto x: sample_inputs(constant)) {
+            int32_t expected;
+            if (!ir_evaluate(opcode, x, constant, expected)) {
+                continue;
+            }
+            ASSERT_EQ(test.evaluate(x), expected) << ir_opcode_name(opcode) << " " << x << ", " << constant;
+        }
+    }
+    EXPECT_GT(reduced, 0);
+}
+
+TEST(strength_reduction, multiplies_match_on_sampled_inputs) {
+    verify(IR_MUL);
+}
+
+TEST(strength_reduction, divisions_match_on_sampled_inputs) {
+    verify(IR_DIV);
+}
+
+TEST(strength_reduction, remainders_match_on_sampled_inputs) {
+    verify(IR_REM);
+}
+
+TEST(strength_reduction, multiplies_by_shifts_and_adds) {
+    ReducedFunction test;
+    auto statistics = test.reduce(IR_MUL, 10);
+
+    EXPECT_EQ(statistics.multiplies_reduced, 1);
+    EXPECT_EQ(test.count(IR_MUL), 0);
+    EXPECT_EQ(test.count(IR_SHL), 2);
+    EXPECT_EQ(test.evaluate(-7), -70);
+}
+
+TEST(strength_reduction, keeps_expensive_multiplies) {
+    // 0b1010101: four terms, more than a multiply is worth
+    ReducedFunction test;
+    auto statistics = test.reduce(IR_MUL, 85);
+
+    EXPECT_EQ(statistics.multiplies_reduced, 0);
+    EXPECT_EQ(test.count(IR_MUL), 1);
+}
+
+TEST(strength_reduction, divides_by_magic_numbers) {
+    ReducedFunction test;
+    auto statistics = test.reduce(IR_DIV, 7);
+
+    EXPECT_EQ(statistics.divisions_reduced, 1);
+    EXPECT_EQ(test.count(IR_DIV), 0);
+    EXPECT_EQ(test.count(IR_MULH), 1);
+    EXPECT_EQ(test.evaluate(-15), -2);
+    EXPECT_EQ(division_magic(7).multiplier, static_cast<int32_t>(0x92492493u));
+    EXPECT_EQ(division_magic(7).shift, 2);
+}
+
+TEST(strength_reduction, needs_multiply_high_for_magic_numbers) {
+    ReducedFunction test;
+    auto statistics = test.reduce(IR_DIV, 7, false);
+
+    EXPECT_EQ(statistics.divisions_reduced, 0);
+    EXPECT_EQ(test.count(IR_DIV), 1);
+}
+
+TEST(strength_reduction, rounds_power_of_two_divisions_towards_zero) {
+    ReducedFunction test;
+    auto statistics = test.reduce(IR_DIV, 8, false);
+
+    EXPECT_EQ(statistics.divisions_reduced, 1);
+    EXPECT_EQ(test.count(IR_DIV), 0);
+    EXPECT_EQ(test.count(IR_MULH), 0);
+    EXPECT_EQ(test.evaluate(-9), -1);
+    EXPECT_EQ(test.evaluate(9), 1);
+}
@@ -0,0 +1,151 @@
+#include "gtest/gtest.h"
+#include "memory"
+#include "syntax_directed_emitter.h"
+#include "ir_interpreter.h"
+
+// The calls below are the ones the parser actions make, in reduction order.
+
+TEST(syntax_directed_emitter, backpatches_if_else) {
+    // int main() { int a = 1; if (a > 3) a = 3; else a = a + 1; return a; }
+    SyntaxDirectedEmitter emitter;
+    emitter.begin_function("main");
+    emitter.enter_scope();
+    emitter.push_constant(1);
+    emitter.define_var("a");
+    emitter.push_name("a");
+    emitter.load_name();
+    emitter.push_constant(3);
+    emitter.binary(IR_GT);
+    emitter.if_head();
+    emitter.push_name("a");
+    emitter.push_constant(3);
+    emitter.assign();
+    emitter.else_head();
+    emitter.push_name("a");
+    emitter.push_name("a");
+    emitter.load_name();
+    emitter.push_constant(1);
+    emitter.binary(IR_ADD);
+    emitter.assign();
+    emitter.end_if_else();
+    emitter.push_name("a");
+    emitter.load_name();
+    emitter.ret();
+    emitter.exit_scope();
+    emitter.end_function();
+
+    EXPECT_EQ(emitter.peak_stack_depth(), 2);
+    auto module = emitter.finish();
+    auto &function = *module->functions.front();
+    EXPECT_EQ(ir_interpret(function), 2);
+    for (auto block: function.layout) {
+        for (auto target: function.successors(block)) {
+            EXPECT_NE(target, 0);
+        }
+    }
+}
+
+TEST(syntax_directed_emitter, if_without_else_falls_through) {
+    // int main() { const int c = 5; if (c) { return -c; } return 0; }
+    SyntaxDirectedEmitter emitter;
+    emitter.begin_function("main");
+    emitter.enter_scope();
+    emitter.push_constant(5);
+    emitter.define_const("c");
+    emitter.push_name("c");
+    emitter.load_name();
+    emitter.if_head();
+    emitter.enter_scope();
+    emitter.push_name("c");
+    emitter.load_name();
+    emitter.unary("-");
+    emitter.ret();
+    emitter.exit_scope();
+    emitter.end_if();
+    emitter.push_constant(0);
+    emitter.ret();
+    emitter.exit_scope();
+    emitter.end_function();
+
+    auto module = emitter.finish();
+    EXPECT_EQ(ir_interpret(*module->functions.front()), -5);
+}
+
+TEST(syntax_directed_emitter, short_circuits_logical_operators) {
+    // int main() { int a = 0; if (a != 0 && 10 / a > 1) return 1; return a == 0 || 10 / a; }
+    SyntaxDirectedEmitter emitter;
+    emitter.begin_function("main");
+    emitter.enter_scope();
+    emitter.push_constant(0);
+    emitter.define_var("a");
+    emitter.push_name("a");
+    emitter.load_name();
+    emitter.push_constant(0);
+    emitter.binary(IR_NE);
+    emitter.logical_head("&&");
+    emitter.push_constant(10);
+    emitter.push_name("a");
+    emitter.load_name();
+    emitter.binary(IR_DIV);
+    emitter.push_constant(1);
+    emitter.binary(IR_GT);
+    emitter.logical("&&");
+    emitter.if_head();
+    emitter.push_constant(1);
+    emitter.ret();
+    emitter.end_if();
+    emitter.push_name("a");
+    emitter.load_name();
+    emitter.push_constant(0);
+    emitter.binary(IR_EQ);
+    emitter.logical_head("||");
+    emitter.push_constant(10);
+    emitter.push_name("a");
+    emitter.load_name();
+    emitter.binary(IR_DIV);
+    emitter.logical("||");
+    emitter.ret();
+    emitter.exit_scope();
+    emitter.end_function();
+
+    // the divisions by zero are never reached
+    auto module = emitter.finish();
+    EXPECT_EQ(ir_interpret(*module->functions.front()), 1);
+}
+
+TEST(syntax_directed_emitter, names_shadowing_variables_apart_from_source_names) {
+    // int main() { int a_1 = 5; { int a = 1; { int a = 2; a_1 = a_1 + a; } } return a_1; }
+    SyntaxDirectedEmitter emitter;
+    emitter.begin_function("main");
+    emitter.enter_scope();
+    emitter.push_constant(5);
+    emitter.define_var("a_1");
+    emitter.enter_scope();
+    emitter.push_constant(1);
+    emitter.define_var("a");
+    emitter.enter_scope();
+    emitter.push_constant(2);
+    emitter.define_var("a");
+    emitter.push_name("a_1");
+    emitter.push_name("a_1");
+    emitter.load_name();
+    emitter.push_name("a");
+    emitter.load_name();
+    emitter.binary(IR_ADD);
+    emitter.assign();
+    emitter.exit_scope();
+    emitter.exit_scope();
+    emitter.push_name("a_1");
+    emitter.load_name();
+    emitter.ret();
+    emitter.exit_scope();
+    emitter.end_function();
+
+    auto module = emitter.finish();
+    auto &function = *module->functions.front();
+    EXPECT_EQ(ir_interpret(function), 7);
+    auto entry = function.block_instructions(function.entry());
+    EXPECT_EQ(function.value_name(entry[0]), "@a_1");
+    EXPECT_EQ(function.value_name(entry[1]), "@a");
+    EXPECT_EQ(function.value_name(entry[2]), "@a_2");
+}
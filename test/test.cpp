@@ -2,7 +2,12 @@
 #include "iostream"
 #include "symbol_table.h"
 #include "Ast.h"
+#include "persistent_symbol_table.h"
+#include "scope_index.h"
 #include "memory"
+#include "thread"
+#include "vector"
+#include "type_traits"
 
 TEST(test1, test1) {
     auto symbolTable = SymbolTableFactory::symbol_table;
@@ -54,4 +59,146 @@ TEST(test1, test1) {
 
     std::cout << (name_exists == nullptr) << std::endl;
 
-}
\ No newline at end of file
+}
+
+TEST(global_symbol_table, frozen_scope_is_shared_by_workers) {
+    auto global = SymbolTableFactory::new_global_symbol_table();
+    for (int i = 0; i < 100; i++) {
+        auto name = "global_" + std::to_string(i);
+        global->insert(name, SymbolTableFactory::wrap_symbol_info(
+                true, "int", name, std::to_string(i), std::make_shared<LocationImpl>(1, 1, 1, 1)));
+        // the declaration phase sees what it declared so far
+        EXPECT_EQ(global->lookup(name)->value(), std::to_string(i));
+        EXPECT_EQ(global->find("global_" + std::to_string(i + 1)), nullptr);
+    }
+    global->freeze();
+    EXPECT_TRUE(global->frozen());
+    static_assert(std::is_same<decltype(global->lookup("")), std::shared_ptr<const SymbolInformation>>::value,
+                  "shared symbols are read only");
+
+    // too late, the declaration phase is over
+    EXPECT_DEATH(global->insert("late", SymbolTableFactory::wrap_symbol_info(
+            false, "int", "late", "", std::make_shared<LocationImpl>(1, 1, 1, 1))), "frozen");
+    EXPECT_EQ(global->lookup("late"), nullptr);
+
+    std::vector<std::thread> workers;
+    std::vector<int> mismatches(4, 0);
+    for (int worker = 0; worker < 4; worker++) {
+        workers.emplace_back([&, worker]() {
+            auto local = SymbolTableFactory::new_scoped_symbol_table(global);
+            // shadows a global in this worker only
+            local->insert("global_0", SymbolTableFactory::wrap_symbol_info(
+                    false, "int", "global_0", "local", std::make_shared<LocationImpl>(2, 2, 2, 2)));
+            for (int round = 0; round < 1000; round++) {
+                int i = (round + worker) % 100;
+                auto name = "global_" + std::to_string(i);
+                auto expected = i == 0 ? std::string("local") : std::to_string(i);
+                if (local->lookup(name)->value() != expected || global->find(name)->name() != name) {
+                    mismatches[worker]++;
+                }
+            }
+        });
+    }
+    for (auto &worker: workers) {
+        worker.join();
+    }
+
+    for (auto count: mismatches) {
+        EXPECT_EQ(count, 0);
+    }
+    EXPECT_EQ(global->lookup("global_0")->value(), "0");
+    EXPECT_EQ(global->find("missing"), nullptr);
+}
+
+TEST(persistent_symbol_table, snapshots_share_structure) {
+    auto table = SymbolTableFactory::new_persistent_symbol_table();
+    auto location = std::make_shared<LocationImpl>(1, 1, 1, 1);
+    PersistentSymbolMap half;
+    for (int i = 0; i < 10000; i++) {
+        if (i == 5000) {
+            half = table->snapshot();
+        }
+        auto name = "v" + std::to_string(i);
+        table->insert(name, SymbolTableFactory::wrap_symbol_info(false, "int", name, std::to_string(i), location));
+    }
+
+    auto all = table->snapshot();
+    EXPECT_EQ(all.size(), 10000u);
+    EXPECT_EQ(half.size(), 5000u);
+    EXPECT_EQ(all.find("v7777")->value(), "7777");
+    EXPECT_EQ(half.find("v7777"), nullptr);
+    EXPECT_EQ(half.find("v4999")->value(), "4999");
+
+    // shadowing replaces the binding in the new version only
+    table->insert("v1", SymbolTableFactory::wrap_symbol_info(true, "int", "v1", "inner", location));
+    EXPECT_EQ(table->lookup("v1")->value(), "inner");
+    EXPECT_EQ(table->snapshot().size(), 10000u);
+    EXPECT_EQ(all.lookup("v1")->value(), "1");
+
+    table->restore(half);
+    EXPECT_EQ(table->lookup("v6000"), nullptr);
+}
+
+static std::unique_ptr<BaseAST> declaration_item(const std::string &ident, int line, int column) {
+    auto var_def = std::make_unique<VarDefinitionAST>();
+    var_def->ident = ident;
+    var_def->location = std::make_shared<LocationImpl>(line, column, line, column + (int) ident.size() - 1);
+    auto var_def_list = std::make_unique<VarDefinitionListAST>();
+    var_def_list->choice = VAR_DEFINITION;
+    var_def_list->var_definition = std::move(var_def);
+    auto var_decl = std::make_unique<VarDeclarationAST>();
+    var_decl->var_definition_list = std::move(var_def_list);
+    auto decl = std::make_unique<DeclarationAST>();
+    decl->choice = VAR_DECLARATION;
+    decl->var_declaration = std::move(var_decl);
+    auto item = std::make_unique<BlockItemAST>();
+    item->choice = DECLARATION;
+    item->declaration = std::move(decl);
+    return item;
+}
+
+static std::unique_ptr<BlockAST> block(int start_line, int end_line, std::vector<std::unique_ptr<BaseAST>> items) {
+    auto list = std::make_unique<BlockItemListAST>();
+    list->choice = items.empty() ? EMPTY : BLOCK_LIST;
+    list->list = std::move(items);
+    auto block = std::make_unique<BlockAST>();
+    block->block_item_list = std::move(list);
+    block->location = std::make_shared<LocationImpl>(start_line, 1, end_line, 1);
+    return block;
+}
+
+TEST(scope_index, answers_visibility_by_position) {
+    // int main() {          line 1
+    //     int a = 1;        line 2
+    //     {                 line 3
+    //         int b = 2;    line 4
+    //         int a = 3;    line 5
+    //     }                 line 6
+    //     return a;         line 7
+    // }                     line 8
+    std::vector<std::unique_ptr<BaseAST>> inner_items;
+    inner_items.push_back(declaration_item("b", 4, 13));
+    inner_items.push_back(declaration_item("a", 5, 13));
+    auto inner_statement = std::make_unique<StmtAST>();
+    inner_statement->choice = BLOCK_STATEMENT;
+    inner_statement->block = block(3, 6, std::move(inner_items));
+    auto inner_item = std::make_unique<BlockItemAST>();
+    inner_item->choice = STATEMENT;
+    inner_item->statement = std::move(inner_statement);
+
+    std::vector<std::unique_ptr<BaseAST>> outer_items;
+    outer_items.push_back(declaration_item("a", 2, 9));
+    outer_items.push_back(std::move(inner_item));
+    auto root = block(1, 8, std::move(outer_items));
+
+    auto index = ScopeIndex::build(root.get());
+
+    EXPECT_EQ(index->visible_at(1, 5).size(), 0u);
+    EXPECT_EQ(index->visible_at(2, 20).size(), 1u);
+    EXPECT_EQ(index->visible_at(4, 5).find("b"), nullptr);
+    EXPECT_NE(index->visible_at(4, 20).find("b"), nullptr);
+    EXPECT_EQ(index->visible_at(5, 20).lookup("a")->location()->start_line(), 5);
+    EXPECT_EQ(index->visible_at(7, 5).find("b"), nullptr);
+    EXPECT_EQ(index->visible_at(7, 5).lookup("a")->location()->start_line(), 2);
+    EXPECT_EQ(index->visible_at(9, 1).size(), 0u);
+}
@@ -0,0 +1,189 @@
+#include "gtest/gtest.h"
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include "x86_backend.h"
+#include "ir_interpreter.h"
+
+// a C compiler for the host to assemble and link with, which these tests need to run anything
+static bool host_compiler() {
+#if defined(__x86_64__) && defined(__linux__)
+    return std::system("cc --version > /dev/null 2>&1") == 0;
+#else
+    return false;
+#endif
+}
+
+static std::string assembly(const std::vector<const IrFunction *> &functions) {
+    std::string text;
+    {
+        BufferedWriter out(&text);
+        out << "  .text\n";
+        for (auto function: functions) {
+            X86Backend().write_function(*function, out);
+        }
+        out << "  .section .note.GNU-stack,\"\",@progbits\n";
+    }
+    return text;
+}
+
+// links `assembly` with the C in `c_file` and runs it, returning what it printed
+static std::string build_and_run(const std::string &assembly, const std::string &c_file,
+                                 const std::string &environment = "") {
+    auto directory = testing::TempDir();
+    auto source = directory + "x86_backend_test.s";
+    auto executable = directory + "x86_backend_test";
+    std::ofstream(source) << assembly;
+    auto command = "cc -o " + executable + " " + source + " " + c_file;
+    EXPECT_EQ(std::system(command.c_str()), 0) << command;
+
+    std::string output;
+    auto pipe = popen((environment + " " + executable + " 2>&1").c_str(), "r");
+    char buffer[4096];
+    for (size_t read; (read = fread(buffer, 1, sizeof(buffer), pipe)) > 0;) {
+        output.append(buffer, read);
+    }
+    pclose(pipe);
+    return output;
+}
+
+// what sysy_main returned, through the runtime
+static int32_t run_main(const IrFunction &function) {
+    auto output = build_and_run(assembly({&function}), X86_RUNTIME, "SYSY_REPEAT=1");
+    int32_t result = 0;
+    EXPECT_EQ(sscanf(output.c_str(), "sysy_main returned %d", &result), 1) << output;
+    return result;
+}
+
+TEST(x86_backend, runs_every_operator) {
+    if (!host_compiler()) {
+        GTEST_SKIP() << "no C compiler for the host";
+    }
+    const IrOpcode opcodes[] = {IR_ADD, IR_SUB, IR_MUL, IR_MULH, IR_DIV, IR_REM, IR_AND, IR_OR, IR_XOR,
+                                IR_SHL, IR_SHR, IR_SAR, IR_EQ, IR_NE, IR_LT, IR_GT, IR_LE, IR_GE};
+    const int32_t values[] = {0, 1, -1, 3, 5, 9, -9, 2048, 100000, INT_MIN, INT_MAX};
+    // all of them in one executable, which prints each result on a line
+    std::vector<std::unique_ptr<IrFunction>> functions;
+    std::vector<int32_t> expected;
+    std::ostringstream driver;
+    driver << "#include <stdio.h>\n";
+    for (auto opcode: opcodes) {
+        for (auto x: values) {
+            for (auto y: values) {
+                int32_t folded;
+                if (!ir_evaluate(opcode, x, y, folded)) {
+                    continue;
+                }
+                // both operands in slots, and each of them a constant in turn
+                for (int shape = 0; shape < 3; shape++) {
+                    auto name = "f" + std::to_string(functions.size());
+                    functions.push_back(std::make_unique<IrFunction>(name));
+                    auto &function = *functions.back();
+                    IrBuilder builder(&function);
+                    builder.set_block(function.add_block("entry"));
+                    auto a = builder.alloca_slot();
+                    auto b = builder.alloca_slot();
+                    builder.store(function.constant(x), a);
+                    builder.store(function.constant(y), b);
+                    auto lhs = shape == 1 ? function.constant(x) : builder.load(a);
+                    auto rhs = shape == 2 ? function.constant(y) : builder.load(b);
+                    builder.ret(builder.binary(opcode, lhs, rhs));
+                    expected.push_back(folded);
+                    driver << "int sysy_" << name << "(void);\n";
+                }
+            }
+        }
+    }
+    driver << "int main(void) {\n";
+    for (size_t i = 0; i < functions.size(); i++) {
+        driver << "    printf(\"%d\\n\", sysy_f" << i << "());\n";
+    }
+    driver << "    return 0;\n}\n";
+    auto c_file = testing::TempDir() + "x86_backend_test_driver.c";
+    std::ofstream(c_file) << driver.str();
+
+    std::vector<const IrFunction *> pointers;
+    for (auto &function: functions) {
+        pointers.push_back(function.get());
+    }
+    std::istringstream output(build_and_run(assembly(pointers), c_file));
+    for (size_t i = 0; i < functions.size(); i++) {
+        int32_t result;
+        ASSERT_TRUE(output >> result) << i;
+        ASSERT_EQ(result, expected[i]) << "f" << i << "\n" << functions[i]->dump() << assembly({functions[i].get()});
+    }
+}
+
+TEST(x86_backend, chooses_phi_operands_with_cmov) {
+    if (!host_compiler()) {
+        GTEST_SKIP() << "no C compiler for the host";
+    }
+    for (auto x: {-4, 3, 8}) {
+        // y = x < 3 ? 10 : 20 through empty arms; return y + x
+        IrFunction function("main");
+        IrBuilder builder(&function);
+        auto entry = function.add_block("entry");
+        auto then = function.add_block("then");
+        auto otherwise = function.add_block("otherwise");
+        auto join = function.add_block("join");
+        builder.set_block(entry);
+        auto a = builder.alloca_slot();
+        builder.store(function.constant(x), a);
+        auto loaded = builder.load(a);
+        builder.branch(builder.binary(IR_LT, loaded, function.constant(3)), then, otherwise);
+        builder.set_block(then);
+        builder.jump(join);
+        builder.set_block(otherwise);
+        builder.jump(join);
+        builder.set_block(join);
+        auto y = builder.phi();
+        function.add_incoming(y, function.constant(10), then);
+        function.add_incoming(y, function.constant(20), otherwise);
+        builder.ret(builder.binary(IR_ADD, y, loaded));
+
+        std::string text;
+        X86Statistics statistics;
+        {
+            BufferedWriter out(&text);
+            statistics = X86Backend().write_function(function, out);
+        }
+
+        EXPECT_EQ(statistics.branches_converted, 1);
+        EXPECT_EQ(statistics.branches_fused, 1);
+        EXPECT_EQ(statistics.cmov, 1);
+        EXPECT_EQ(text.find("cmovll"), text.find("cmov")) << text;
+        EXPECT_EQ(run_main(function), ir_interpret(function)) << text;
+    }
+}
+
+TEST(x86_backend, swaps_phis_through_staging) {
+    if (!host_compiler()) {
+        GTEST_SKIP() << "no C compiler for the host";
+    }
+    // a, b = 1, 2; do { a, b = b, a; i++ } while (i < 5); return a * 10 + b
+    IrFunction function("main");
+    IrBuilder builder(&function);
+    auto entry = function.add_block("entry");
+    auto loop = function.add_block("loop");
+    auto exit = function.add_block("exit");
+    builder.set_block(entry);
+    builder.jump(loop);
+    builder.set_block(loop);
+    auto a = builder.phi();
+    auto b = builder.phi();
+    auto i = builder.phi();
+    auto next = builder.binary(IR_ADD, i, function.constant(1));
+    function.add_incoming(a, function.constant(1), entry);
+    function.add_incoming(a, b, loop);
+    function.add_incoming(b, function.constant(2), entry);
+    function.add_incoming(b, a, loop);
+    function.add_incoming(i, function.constant(0), entry);
+    function.add_incoming(i, next, loop);
+    builder.branch(builder.binary(IR_LT, next, function.constant(5)), loop, exit);
+    builder.set_block(exit);
+    builder.ret(builder.binary(IR_ADD, builder.binary(IR_MUL, a, function.constant(10)), b));
+
+    EXPECT_EQ(run_main(function), ir_interpret(function)) << assembly({&function});
+}